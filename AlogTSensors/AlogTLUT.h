@@ -0,0 +1,144 @@
+/*
+Compile time ADC->temperature lookup tables for the analogue temperature sensor library.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Each table holds one entry per 10bit ADC value, in hundredths of a degree Celsius, and is built by the compiler
+  from the same divider, Steinhart-Hart and Beta formulas used by the TMP36 and Thermistor classes.
+  Nothing is calculated at run time, and the table lives in flash (PROGMEM), using 2KB of program space.
+
+Usage (at global scope):
+  ATS_SHH_LUT(myKY013LUT, 110000, true, 0.0005182977433, 0.0002252079282, 0.0000001615362158);
+  ATS_BETA_LUT(myMF52DLUT, 10000, true, 3435, 10000, 25.0);
+  ATS_TMP36_LUT(myTMP36LUT, 4.83, 0.5, 100.0);
+Then in setup():
+  myKY013.setLUT(myKY013LUT);
+
+https://en.wikipedia.org/wiki/Natural_logarithm#Series
+https://www.nongnu.org/avr-libc/user-manual/pgmspace.html
+*/
+
+#ifndef ALOGTLUT_H
+  #define ALOGTLUT_H
+
+  #include <Arduino.h>
+
+  #define _ATSLUTSIZE 1024                  //One entry per 10bit ADC value.
+  #define _ATSLUTSCALE 100.0                //Entries are in 1/100ths of a degree Celsius.
+  #define _ATSLUTMIN -32768
+  #define _ATSLUTMAX 32767
+
+  //Compile time natural logarithm, using the ln((1+z)/(1-z)) series on a mantissa normalised to [1, 2).
+  constexpr double _atsLnSeries(double z, double z2, double term, uint8_t n) {
+    return (n > 31) ? 0.0 : (term / n) + _atsLnSeries(z, z2, term * z2, n + 2);
+  }
+
+  constexpr double _atsLnMantissa(double z) {
+    return 2.0 * _atsLnSeries(z, z * z, z, 1);
+  }
+
+  constexpr double _atsLn(double x, int8_t exponent = 0) {
+    return (x >= 2.0) ? _atsLn(x / 2.0, exponent + 1) :
+           (x < 1.0) ? _atsLn(x * 2.0, exponent - 1) :
+           (exponent * 0.69314718055994530942) + _atsLnMantissa((x - 1.0) / (x + 1.0));
+  }
+
+  //Round and clamp a Celsius temperature into a table entry.
+  constexpr int16_t _atsLUTEntry(double temperatureC) {
+    return ((temperatureC * _ATSLUTSCALE) >= _ATSLUTMAX) ? _ATSLUTMAX :
+           ((temperatureC * _ATSLUTSCALE) <= _ATSLUTMIN) ? _ATSLUTMIN :
+           (int16_t)((temperatureC * _ATSLUTSCALE) + ((temperatureC >= 0.0) ? 0.5 : -0.5));
+  }
+
+  //The thermistor resistance for an ADC value, as calculated by vDivider::calcR2() or calcR1().
+  //  ADC values of 0 are treated as 1, as the resistance is then zero or infinite.
+  constexpr double _atsLUTResistance(double balanceResistor, bool isR1, uint16_t averageADC) {
+    return (averageADC == 0) ? _atsLUTResistance(balanceResistor, isR1, 1) :
+           isR1 ? balanceResistor / (((double)_ATSLUTSIZE / averageADC) - 1.0) :
+                  balanceResistor * (((double)_ATSLUTSIZE / averageADC) - 1.0);
+  }
+
+  //Steinhart-Hart table generator, as Thermistor::readTemperatureK() with setC123().
+  struct atsLUTShh {
+    double balanceResistor;
+    bool isR1;
+    double coefficient1;
+    double coefficient2;
+    double coefficient3;
+    constexpr atsLUTShh(double balanceResistor, bool isR1, double coefficient1, double coefficient2, double coefficient3)
+      : balanceResistor(balanceResistor), isR1(isR1), coefficient1(coefficient1), coefficient2(coefficient2), coefficient3(coefficient3) {}
+    constexpr double oneOverTK(double lntRst) const {
+      return coefficient1 + (coefficient2 * lntRst) + (coefficient3 * lntRst * lntRst * lntRst);
+    }
+    constexpr int16_t operator()(uint16_t averageADC) const {
+      return _atsLUTEntry((1.0 / oneOverTK(_atsLn(_atsLUTResistance(balanceResistor, isR1, averageADC)))) - 273.15);
+    }
+  };
+
+  //Beta coefficient table generator, as Thermistor::readTemperatureK() with setCBeta().
+  struct atsLUTBeta {
+    double balanceResistor;
+    bool isR1;
+    double cBeta;
+    double nomRst;
+    double nomTemp;
+    constexpr atsLUTBeta(double balanceResistor, bool isR1, double cBeta, double nomRst, double nomTemp)
+      : balanceResistor(balanceResistor), isR1(isR1), cBeta(cBeta), nomRst(nomRst), nomTemp(nomTemp) {}
+    constexpr double oneOverTK(double tRst) const {
+      return (1.0 / (nomTemp + 273.15)) + ((1.0 / cBeta) * _atsLn(tRst / nomRst));
+    }
+    constexpr int16_t operator()(uint16_t averageADC) const {
+      return _atsLUTEntry((1.0 / oneOverTK(_atsLUTResistance(balanceResistor, isR1, averageADC))) - 273.15);
+    }
+  };
+
+  //TMP36 table generator, as TMP36::readTemperatureC() with setConsts() and setParms().
+  struct atsLUTTMP36 {
+    double avRef;
+    double offset;
+    double multiplier;
+    constexpr atsLUTTMP36(double avRef, double offset, double multiplier)
+      : avRef(avRef), offset(offset), multiplier(multiplier) {}
+    constexpr int16_t operator()(uint16_t averageADC) const {
+      return _atsLUTEntry(((averageADC * (avRef / _ATSLUTSIZE)) - offset) * multiplier);
+    }
+  };
+
+  //Expand a generator over every ADC value.
+  #define _ATSLUT4(g, i) (g)(i), (g)((i) + 1), (g)((i) + 2), (g)((i) + 3)
+  #define _ATSLUT16(g, i) _ATSLUT4(g, i), _ATSLUT4(g, (i) + 4), _ATSLUT4(g, (i) + 8), _ATSLUT4(g, (i) + 12)
+  #define _ATSLUT64(g, i) _ATSLUT16(g, i), _ATSLUT16(g, (i) + 16), _ATSLUT16(g, (i) + 32), _ATSLUT16(g, (i) + 48)
+  #define _ATSLUT256(g, i) _ATSLUT64(g, i), _ATSLUT64(g, (i) + 64), _ATSLUT64(g, (i) + 128), _ATSLUT64(g, (i) + 192)
+  #define _ATSLUT1024(g) _ATSLUT256(g, 0), _ATSLUT256(g, 256), _ATSLUT256(g, 512), _ATSLUT256(g, 768)
+
+  //Table definitions, for use at global scope.
+  #define ATS_SHH_LUT(name, balanceResistor, isR1, coefficient1, coefficient2, coefficient3) \
+    constexpr int16_t name[_ATSLUTSIZE] PROGMEM = { _ATSLUT1024(atsLUTShh(balanceResistor, isR1, coefficient1, coefficient2, coefficient3)) }
+  #define ATS_BETA_LUT(name, balanceResistor, isR1, cBeta, nomRst, nomTemp) \
+    constexpr int16_t name[_ATSLUTSIZE] PROGMEM = { _ATSLUT1024(atsLUTBeta(balanceResistor, isR1, cBeta, nomRst, nomTemp)) }
+  #define ATS_TMP36_LUT(name, avRef, offset, multiplier) \
+    constexpr int16_t name[_ATSLUTSIZE] PROGMEM = { _ATSLUT1024(atsLUTTMP36(avRef, offset, multiplier)) }
+
+  //Read a table entry in degrees Celsius.
+  inline float atsLUTRead(const int16_t *lut, uint16_t averageADC) {
+    if (averageADC >= _ATSLUTSIZE) {
+      averageADC = _ATSLUTSIZE - 1;
+    }
+    return (int16_t)pgm_read_word(&lut[averageADC]) / _ATSLUTSCALE;
+  }
+
+  //Read a table entry in degrees Celsius, interpolating an oversampled ADC value with extra fractional bits.
+  inline float atsLUTRead(const int16_t *lut, uint32_t adcScaled, uint8_t extraBits) {
+    uint16_t averageADC = adcScaled >> extraBits;
+    if (averageADC >= (_ATSLUTSIZE - 1)) {
+      return atsLUTRead(lut, (uint16_t)(_ATSLUTSIZE - 1));
+    }
+    int16_t lower = pgm_read_word(&lut[averageADC]);
+    int16_t upper = pgm_read_word(&lut[averageADC + 1]);
+    int32_t fraction = adcScaled & ((1UL << extraBits) - 1);
+    int32_t entry = lower + (((int32_t)(upper - lower) * fraction) >> extraBits);
+    return entry / _ATSLUTSCALE;
+  }
+#endif
+
+//EOF
@@ -0,0 +1,141 @@
+/*
+Arduino library for analogue temperature sensors - compile time selectable arithmetic.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Two traits classes extend the voltage divider traits (VDividerMath.h) with the temperature calculations:
+ - atsFloatMath : float degrees Celsius, exactly as the TMP36 and Thermistor classes.
+ - atsFixedMath : Q16.16 degrees Celsius, using 32bit integer arithmetic (64bit for three Steinhart-Hart products).
+Coefficients are converted once, at compile time, with the shh(), beta() and tmp36() functions of the chosen traits.
+
+Usage:
+  template <class M> float ky013C(uint16_t averageADC) {
+    static constexpr typename M::shh_t coefficients = M::shh(C1_KY, C2_KY, C3_KY);
+    return M::toFloat(M::shhC(M::r2(averageADC, M::ohms(KY013R1), 1023), coefficients));
+  }
+  ky013C<atsFloatMath>(averageADC) or ky013C<atsFixedMath>(averageADC)
+
+atsFixedMath error bounds, against atsFloatMath, for thermistors between 1K and 1M Ohms and -40 to +125 deg C:
+ - Steinhart-Hart: within 0.02 deg C.
+ - Beta          : within 0.02 deg C.
+ - TMP36         : within 0.01 deg C.
+ - C->F, C->K    : within 1 LSB of Q16.16.
+*/
+
+#ifndef ALOGTMATH_H
+  #define ALOGTMATH_H
+
+  #include <Arduino.h>
+  #include <VDividerMath.h>
+  #include "AlogTLUT.h"
+
+  #define _ATSKELVIN 273.15
+
+  //Temperature calculations using float arithmetic.
+  struct atsFloatMath : vdFloatMath {
+    typedef float temp_t;                   //Degrees Celsius.
+    struct shh_t {
+      float coefficient1;
+      float coefficient2;
+      float coefficient3;
+    };
+    struct beta_t {
+      float oneOverNomTemp;                 //1/T0, in 1/Kelvin.
+      float oneOverCBeta;
+      float nomRst;
+    };
+    struct tmp36_t {
+      float offset;
+      float multiplier;
+    };
+    static constexpr shh_t shh(double coefficient1, double coefficient2, double coefficient3) {
+      return shh_t{(float)coefficient1, (float)coefficient2, (float)coefficient3};
+    }
+    static constexpr beta_t beta(double cBeta, double nomRst, double nomTemp) {
+      return beta_t{(float)(1.0 / (nomTemp + _ATSKELVIN)), (float)(1.0 / cBeta), (float)nomRst};
+    }
+    static constexpr tmp36_t tmp36(double offset, double multiplier) {
+      return tmp36_t{(float)offset, (float)multiplier};
+    }
+    static temp_t shhC(ohms_t tRst, const shh_t &coefficients) {
+      float lntRst = log(tRst);
+      float oneOverTK = coefficients.coefficient1 + (coefficients.coefficient2 * lntRst) + (coefficients.coefficient3 * pow(lntRst, 3));
+      return (1.0 / oneOverTK) - _ATSKELVIN;
+    }
+    static temp_t betaC(ohms_t tRst, const beta_t &coefficients) {
+      float oneOverTK = coefficients.oneOverNomTemp + (coefficients.oneOverCBeta * log(tRst / coefficients.nomRst));
+      return (1.0 / oneOverTK) - _ATSKELVIN;
+    }
+    static temp_t tmp36C(volts_t vOut, const tmp36_t &parms) {
+      return (vOut - parms.offset) * parms.multiplier;
+    }
+    static temp_t toKelvin(temp_t temperatureC) {
+      return temperatureC + _ATSKELVIN;
+    }
+    static temp_t toFahrenheit(temp_t temperatureC) {
+      return ((temperatureC * 9.0) / 5.0) + 32.0;
+    }
+  };
+
+  //Temperature calculations using integer arithmetic only.
+  //  1/T is held in Q8.24 (1/Kelvin), which resolves about 0.005 deg C at room temperature.
+  struct atsFixedMath : vdFixedMath {
+    typedef q16_t temp_t;                   //Q16.16 degrees Celsius.
+    struct shh_t {
+      int32_t coefficient1;                 //Q8.24.
+      int32_t coefficient2;                 //Q0.40.
+      int32_t coefficient3;                 //Q0.48.
+    };
+    struct beta_t {
+      int32_t oneOverNomTemp;               //Q8.24.
+      q16_t lnNomRst;                       //Q16.16.
+      int32_t cBeta;
+    };
+    struct tmp36_t {
+      q16_t offset;
+      int32_t multiplier;                   //Whole number multiplier.
+    };
+    static constexpr shh_t shh(double coefficient1, double coefficient2, double coefficient3) {
+      return shh_t{(int32_t)((coefficient1 * 16777216.0) + 0.5),
+                   (int32_t)((coefficient2 * 1099511627776.0) + 0.5),
+                   (int32_t)((coefficient3 * 281474976710656.0) + 0.5)};
+    }
+    static constexpr beta_t beta(double cBeta, double nomRst, double nomTemp) {
+      return beta_t{(int32_t)((16777216.0 / (nomTemp + _ATSKELVIN)) + 0.5), toQ16(_atsLn(nomRst)), (int32_t)(cBeta + 0.5)};
+    }
+    static constexpr tmp36_t tmp36(double offset, double multiplier) {
+      return tmp36_t{toQ16(offset), (int32_t)(multiplier + 0.5)};
+    }
+    static temp_t shhC(ohms_t tRst, const shh_t &coefficients) {
+      int64_t lntRst = ln(tRst);                                  //Q16.16.
+      int64_t lntRst3 = (((lntRst * lntRst) >> 16) * lntRst) >> 16; //Q16.16.
+      int32_t oneOverTK = coefficients.coefficient1
+                        + (int32_t)((coefficients.coefficient2 * lntRst) >> 32)
+                        + (int32_t)((coefficients.coefficient3 * lntRst3) >> 40);
+      return fromOneOverTK(oneOverTK);
+    }
+    static temp_t betaC(ohms_t tRst, const beta_t &coefficients) {
+      int32_t oneOverTK = coefficients.oneOverNomTemp + (((ln(tRst) - coefficients.lnNomRst) * 256) / coefficients.cBeta);
+      return fromOneOverTK(oneOverTK);
+    }
+    static temp_t tmp36C(volts_t vOut, const tmp36_t &parms) {
+      return (vOut - parms.offset) * parms.multiplier;
+    }
+    static temp_t toKelvin(temp_t temperatureC) {
+      return temperatureC + toQ16(_ATSKELVIN);
+    }
+    static temp_t toFahrenheit(temp_t temperatureC) {
+      return ((temperatureC * 9) / 5) + toQ16(32.0);
+    }
+    //Convert 1/T in Q8.24 into degrees Celsius in Q16.16, via Kelvin in Q24.8.
+    static temp_t fromOneOverTK(int32_t oneOverTK) {
+      if (oneOverTK <= 0) {
+        return 0x7FFFFFFF;
+      }
+      uint32_t temperatureK = 0xFFFFFFFFUL / (uint32_t)oneOverTK;
+      return (q16_t)(temperatureK << 8) - toQ16(_ATSKELVIN);
+    }
+  };
+#endif
+
+//EOF
@@ -37,6 +37,7 @@ TMP36::TMP36(uint8_t sPin)
       : vDivider(sPin, 0.0) {
   _offset = _TMP36OFFSET;
   _multiplier = _TMP36MULTIPLIER;
+  _lut = NULL;
 }
 
 void TMP36::setParms(float offset, float multiplier) {
@@ -44,18 +45,40 @@ void TMP36::setParms(float offset, float multiplier) {
   _multiplier = multiplier;
 }
 
+/*!
+ *  @brief  Set a compile time ADC->temperature table, replacing the voltage calculations.
+ *  @param  lut
+ *          The table, defined with ATS_TMP36_LUT using the same AVRef, offset and multiplier. NULL to calculate again.
+ */
+
+void TMP36::setLUT(const int16_t *lut) {
+  _lut = lut;
+}
+
 float TMP36::readTemperatureC() {
-  float vOut = calcVOut();
-  float temperatureC = ((vOut - _offset) * _multiplier);
+  uint16_t averageADC = readADC();
+  float temperatureC = readTemperatureC(averageADC);
   return temperatureC;
 }
 
 float TMP36::readTemperatureC(uint16_t averageADC) {
+  if (_lut != NULL) {
+    return atsLUTRead(_lut, averageADC);
+  }
   float vOut = calcVOut(averageADC);
   float temperatureC = ((vOut - _offset) * _multiplier);
   return temperatureC;
 }
 
+//Calculate the temperature using an oversampled ADC reading (from readADCOversampled()), interpolating any table.
+float TMP36::readTemperatureC(uint16_t adcScaled, uint8_t extraBits) {
+  if (_lut != NULL) {
+    return atsLUTRead(_lut, (uint32_t)adcScaled, extraBits);
+  }
+  float vOut = (adcScaled * (_avRef / (float)(_adcMax + 1))) / (float)(1UL << extraBits);
+  return readTemperatureC(vOut);
+}
+
 float TMP36::readTemperatureC(float vOut) {
   constrain(vOut, 0, _adcMax);  //Ensure that the passed ADC value is within hardware bounds.
   float temperatureC = ((vOut - _offset) * _multiplier);
@@ -113,6 +136,7 @@ float TMP36::convertCelsiusToFahrenheit(float temperatureC) {
 Thermistor::Thermistor(uint8_t sPin, float balanceResistor, bool isR1, bool useCBeta)
       : vDivider(sPin, balanceResistor, isR1) {
   _useCBeta = useCBeta;
+  _lut = NULL;
   setTType();
 }
 
@@ -179,18 +203,45 @@ void Thermistor::setC123(float coefficient1, float coefficient2, float coefficie
   _coefficient3 = coefficient3;
 }
 
+/*!
+ *  @brief  Set a compile time ADC->temperature table, replacing the divider and Steinhart-Hart/Beta calculations.
+ *  @param  lut
+ *          The table, defined with ATS_SHH_LUT or ATS_BETA_LUT using the same balance resistor and coefficients.
+ *          NULL to calculate again.
+ */
+
+void Thermistor::setLUT(const int16_t *lut) {
+  _lut = lut;
+}
+
 float Thermistor::readTemperatureK() {
+  uint16_t averageADC = readADC();
+  float temperatureK = readTemperatureK(averageADC);
+  return temperatureK;
+}
+
+//Calculate the temperature using the given ADC reading.
+float Thermistor::readTemperatureK(uint16_t averageADC) {
+  if (_lut != NULL) {
+    return atsLUTRead(_lut, averageADC) + 273.15;
+  }
   float tRst;
   if (_isR1) {
-    tRst = calcR2();
+    tRst = calcR2(averageADC);
   }
   else {
-    tRst = calcR1();
+    tRst = calcR1(averageADC);
   }
   float temperatureK = readTemperatureK(tRst);
   return temperatureK;
 }
 
+//Calculate the temperature using the given ADC reading (accepting it as an int).
+float Thermistor::readTemperatureK(int averageADC) {
+  float temperatureK = readTemperatureK((uint16_t)averageADC);  //Cast the int to a uint16_t.
+  return temperatureK;
+}
+
 float Thermistor::readTemperatureK(float tRst) {
   float oneOverTK;
   if (_useCBeta) {
@@ -206,8 +257,37 @@ float Thermistor::readTemperatureK(float tRst) {
 }
 
 float Thermistor::readTemperatureC() {
-  float temperature = readTemperatureK();
-  return convertKelvinToCelsius(temperature);
+  uint16_t averageADC = readADC();
+  return readTemperatureC(averageADC);
+}
+
+float Thermistor::readTemperatureC(uint16_t averageADC) {
+  if (_lut != NULL) {
+    return atsLUTRead(_lut, averageADC);
+  }
+  float temperatureK = readTemperatureK(averageADC);
+  return convertKelvinToCelsius(temperatureK);
+}
+
+//Calculate the temperature using an oversampled ADC reading (from readADCOversampled()), interpolating any table.
+float Thermistor::readTemperatureC(uint16_t adcScaled, uint8_t extraBits) {
+  if (_lut != NULL) {
+    return atsLUTRead(_lut, (uint32_t)adcScaled, extraBits);
+  }
+  float vOut = (adcScaled * (_avRef / (float)(_adcMax + 1))) / (float)(1UL << extraBits);
+  float tRst;
+  if (_isR1) {
+    tRst = calcR2(vOut);
+  }
+  else {
+    tRst = calcR1(vOut);
+  }
+  return readTemperatureC(tRst);
+}
+
+float Thermistor::readTemperatureC(int averageADC) {
+  float temperatureC = readTemperatureC((uint16_t)averageADC); //Cast the int to a uint16_t.
+  return temperatureC;
 }
 
 float Thermistor::readTemperatureC(float tRst) {
@@ -220,6 +300,16 @@ float Thermistor::readTemperatureF() {
   return convertCelsiusToFahrenheit(temperatureC);
 }
 
+float Thermistor::readTemperatureF(uint16_t averageADC) {
+  float temperatureC = readTemperatureC(averageADC);
+  return convertCelsiusToFahrenheit(temperatureC);
+}
+
+float Thermistor::readTemperatureF(int averageADC) {
+  float temperatureC = readTemperatureC(averageADC);
+  return convertCelsiusToFahrenheit(temperatureC);
+}
+
 float Thermistor::readTemperatureF(float tRst) {
   float temperatureC = readTemperatureC(tRst);
   return convertCelsiusToFahrenheit(temperatureC);
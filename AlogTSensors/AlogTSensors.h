@@ -30,6 +30,7 @@ https://www.thinksrs.com/downloads/programs/Therm%20Calc/NTCCalibrator/NTCcalcul
 
   #include <Arduino.h>
   #include <VDivider.h>
+  #include "AlogTLUT.h"
 
   //Analog Temperature Sensor type numbers.
   #define ATS_DEFLT 0
@@ -68,8 +69,10 @@ https://www.thinksrs.com/downloads/programs/Therm%20Calc/NTCCalibrator/NTCcalcul
   public:
     TMP36(uint8_t sPin = _ANALOGPIN);
     void setParms(float offset = _TMP36OFFSET, float multiplier = _TMP36MULTIPLIER);    
+    void setLUT(const int16_t *lut = NULL);  //Use a compile time ADC->temperature table (from ATS_TMP36_LUT) instead of calculating.
     float readTemperatureC();
     float readTemperatureC(uint16_t);
+    float readTemperatureC(uint16_t, uint8_t); //Version that will use a given oversampled ADC reading, and its extra bits.
     float readTemperatureC(float);
     float readTemperatureK();
     float readTemperatureK(uint16_t);
@@ -81,6 +84,7 @@ https://www.thinksrs.com/downloads/programs/Therm%20Calc/NTCCalibrator/NTCcalcul
   private:
     float _offset;
     float _multiplier;
+    const int16_t *_lut;
     float convertCelsiusToKelvin(float temperatureC);
     float convertCelsiusToFahrenheit(float temperatureC);
   };
@@ -92,11 +96,19 @@ https://www.thinksrs.com/downloads/programs/Therm%20Calc/NTCCalibrator/NTCcalcul
     void setTType(uint16_t tType = ATS_DEFLT);
     void setCBeta(uint16_t cBeta = _DEFCBETA, float nomRst = _DEFNOMRST, float nomTemp = _DEFNOMTEMP);    
     void setC123(float coefficient1 = _DEFCOEFFICIENT1, float coefficient2 = _DEFCOEFFICIENT2, float coefficient3 = _DEFCOEFFICIENT3);    
+    void setLUT(const int16_t *lut = NULL);  //Use a compile time ADC->temperature table (from ATS_SHH_LUT or ATS_BETA_LUT) instead of calculating.
     float readTemperatureC();
+    float readTemperatureC(uint16_t);
+    float readTemperatureC(uint16_t, uint8_t); //Version that will use a given oversampled ADC reading, and its extra bits.
+    float readTemperatureC(int);
     float readTemperatureC(float);
     float readTemperatureK();
+    float readTemperatureK(uint16_t);
+    float readTemperatureK(int);
     float readTemperatureK(float);
     float readTemperatureF();
+    float readTemperatureF(uint16_t);
+    float readTemperatureF(int);
     float readTemperatureF(float);
 
   private:
@@ -108,6 +120,7 @@ https://www.thinksrs.com/downloads/programs/Therm%20Calc/NTCCalibrator/NTCcalcul
     float _coefficient1;
     float _coefficient2;
     float _coefficient3;
+    const int16_t *_lut;
     float convertKelvinToCelsius(float temperatureK);
     float convertCelsiusToFahrenheit(float temperatureC);
   };
@@ -0,0 +1,135 @@
+/*
+Arduino library for analogue temperature sensors - compile time configured versions.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+ThermistorT and TMP36T are the Thermistor and TMP36 classes built on the compile time configured vDividerT.
+  The sensor coefficients are held in a coefficients type, so nothing is stored in RAM, and the coefficients are
+  converted into the chosen arithmetic (atsFloatMath or atsFixedMath, following the divider) at compile time.
+
+Usage:
+  ATS_SHH_COEFFICIENTS(ky013Coefficients, C1_KY, C2_KY, C3_KY);
+  ThermistorT<vDividerT<A0, 110000, true, 32>, ky013Coefficients> myKY013;
+  KY013T<A0, 110000> myOtherKY013;          //The library KY013 coefficients.
+  MF52DT<A2, 10000> myMF52D;                //The library MF52D Beta values.
+  TMP36T<vDividerT<A1, 0, true, 32, 1, 20, 4830> > myTMP36;
+  float temperatureC = myKY013.readTemperatureC();
+
+The runtime configured classes remain available, and are needed for vDividerGroup and non-blocking sampling.
+*/
+
+#ifndef ALOGTSENSORST_H
+  #define ALOGTSENSORST_H
+
+  #include <Arduino.h>
+  #include <VDividerT.h>
+  #include "AlogTSensors.h"
+  #include "AlogTMath.h"
+
+  //Select the temperature arithmetic that matches the divider arithmetic.
+  template <class M> struct atsMathFor;
+  template <> struct atsMathFor<vdFloatMath> {
+    typedef atsFloatMath math_t;
+  };
+  template <> struct atsMathFor<vdFixedMath> {
+    typedef atsFixedMath math_t;
+  };
+
+  //Define a Steinhart-Hart coefficients type.
+  #define ATS_SHH_COEFFICIENTS(name, coefficient1, coefficient2, coefficient3) \
+    struct name { \
+      template <class M> static typename M::temp_t temperatureC(typename M::ohms_t tRst) { \
+        static constexpr typename M::shh_t coefficients = M::shh(coefficient1, coefficient2, coefficient3); \
+        return M::shhC(tRst, coefficients); \
+      } \
+    }
+
+  //Define a Beta coefficient type.
+  #define ATS_BETA_COEFFICIENTS(name, cBeta, nomRst, nomTemp) \
+    struct name { \
+      template <class M> static typename M::temp_t temperatureC(typename M::ohms_t tRst) { \
+        static constexpr typename M::beta_t coefficients = M::beta(cBeta, nomRst, nomTemp); \
+        return M::betaC(tRst, coefficients); \
+      } \
+    }
+
+  //The library default coefficients.
+  ATS_SHH_COEFFICIENTS(atsDefaultC123, _DEFCOEFFICIENT1, _DEFCOEFFICIENT2, _DEFCOEFFICIENT3);
+  ATS_BETA_COEFFICIENTS(atsDefaultCBeta, _DEFCBETA, _DEFNOMRST, _DEFNOMTEMP);
+  ATS_SHH_COEFFICIENTS(atsKY013C123, _KY013COEFFICIENT1, _KY013COEFFICIENT2, _KY013COEFFICIENT3);
+  ATS_BETA_COEFFICIENTS(atsMF52DCBeta, _MF52DCBETA, _MF52DNOMRST, _MF52DNOMTEMP);
+
+  //A resistance based analog temperature sensor, on the voltage divider Divider (a vDividerT).
+  template <class Divider, class Coefficients = atsDefaultCBeta>
+  class ThermistorT : public Divider {
+  public:
+    typedef typename atsMathFor<typename Divider::math_t>::math_t math_t;
+    typedef typename math_t::temp_t temp_t;
+
+    static temp_t readTemperatureC() {
+      return readTemperatureC(Divider::readADC());
+    }
+
+    static temp_t readTemperatureC(uint16_t averageADC) {
+      return Coefficients::template temperatureC<math_t>(Divider::calcRUnknown(averageADC));
+    }
+
+    static temp_t readTemperatureK() {
+      return math_t::toKelvin(readTemperatureC());
+    }
+
+    static temp_t readTemperatureK(uint16_t averageADC) {
+      return math_t::toKelvin(readTemperatureC(averageADC));
+    }
+
+    static temp_t readTemperatureF() {
+      return math_t::toFahrenheit(readTemperatureC());
+    }
+
+    static temp_t readTemperatureF(uint16_t averageADC) {
+      return math_t::toFahrenheit(readTemperatureC(averageADC));
+    }
+  };
+
+  //A diode/voltage based analog temperature sensor, on the pin of Divider (a vDividerT), with the offset in millivolts.
+  template <class Divider, uint16_t OffsetmV = (uint16_t)(_TMP36OFFSET * 1000), uint16_t Multiplier = (uint16_t)_TMP36MULTIPLIER>
+  class TMP36T : public Divider {
+  public:
+    typedef typename atsMathFor<typename Divider::math_t>::math_t math_t;
+    typedef typename math_t::temp_t temp_t;
+
+    static temp_t readTemperatureC() {
+      return readTemperatureC(Divider::readADC());
+    }
+
+    static temp_t readTemperatureC(uint16_t averageADC) {
+      static constexpr typename math_t::tmp36_t parms = math_t::tmp36(OffsetmV / 1000.0, Multiplier);
+      return math_t::tmp36C(Divider::calcVOut(averageADC), parms);
+    }
+
+    static temp_t readTemperatureK() {
+      return math_t::toKelvin(readTemperatureC());
+    }
+
+    static temp_t readTemperatureK(uint16_t averageADC) {
+      return math_t::toKelvin(readTemperatureC(averageADC));
+    }
+
+    static temp_t readTemperatureF() {
+      return math_t::toFahrenheit(readTemperatureC());
+    }
+
+    static temp_t readTemperatureF(uint16_t averageADC) {
+      return math_t::toFahrenheit(readTemperatureC(averageADC));
+    }
+  };
+
+  //KY013 and MF52D with the library coefficients.
+  template <uint8_t Pin = _ANALOGPIN, uint32_t BalanceResistor = (uint32_t)_BALANCERESISTOR, uint16_t Samples = _VDIVSAMPLES, class M = vdFloatMath>
+  using KY013T = ThermistorT<vDividerT<Pin, BalanceResistor, true, Samples, _SAMPLEDELAY, _ADCREADYDELAY, _AVREFMV, _ADCMAX, M>, atsKY013C123>;
+
+  template <uint8_t Pin = _ANALOGPIN, uint32_t BalanceResistor = (uint32_t)_BALANCERESISTOR, uint16_t Samples = _VDIVSAMPLES, class M = vdFloatMath>
+  using MF52DT = ThermistorT<vDividerT<Pin, BalanceResistor, true, Samples, _SAMPLEDELAY, _ADCREADYDELAY, _AVREFMV, _ADCMAX, M>, atsMF52DCBeta>;
+#endif
+
+//EOF
@@ -0,0 +1,99 @@
+/*
+Analog temperature sensor fixed point arithmetic example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+The same conversion code is compiled twice, once with float arithmetic (atsFloatMath) and once with
+  Q16.16 fixed point arithmetic (atsFixedMath), and the two are compared for every ADC value, and timed.
+To compare the program size, build with only one of the conversions, by setting MATHONLY to the traits to use.
+*/
+
+#include <AlogTSensors.h>
+#include <AlogTMath.h>
+
+//#define MATHONLY atsFixedMath             //Build with just this arithmetic, to compare the program size.
+
+#define KY013R1 110000                      //110K balance resistor (100K external + 10K on board).
+#define C1_KY 0.0005182977433               //Steinhart-Hart coefficient 1.
+#define C2_KY 0.0002252079282               //Steinhart-Hart coefficient 2.
+#define C3_KY 0.0000001615362158            //Steinhart-Hart coefficient 3.
+
+#define MF52DR1 10000                       //10K balance resistor.
+#define CBETA_MF 3435                       //Beta coefficient.
+#define NOMRST_MF 10000                     //Nominal resistance.
+#define NOMTEMP_MF 25.0                     //Nominal temperature.
+
+#define ADCMAXVALUE 1023
+#define FIRSTADC 100                        //Keep the thermistors between 1K and 1M Ohms.
+#define LASTADC 900
+
+//KY013 conversion, ADC->degrees C, using the arithmetic M.
+template <class M> typename M::temp_t ky013C(uint16_t averageADC) {
+  static constexpr typename M::shh_t coefficients = M::shh(C1_KY, C2_KY, C3_KY);
+  return M::shhC(M::r2(averageADC, M::ohms(KY013R1), ADCMAXVALUE), coefficients);
+}
+
+//MF52D conversion, ADC->degrees C, using the arithmetic M.
+template <class M> typename M::temp_t mf52dC(uint16_t averageADC) {
+  static constexpr typename M::beta_t coefficients = M::beta(CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+  return M::betaC(M::r2(averageADC, M::ohms(MF52DR1), ADCMAXVALUE), coefficients);
+}
+
+//Compare the float and fixed point conversions of every ADC value, and time them.
+void compareMaths(float (*floatC)(uint16_t), q16_t (*fixedC)(uint16_t)) {
+  float maxError = 0.0;
+  unsigned int maxErrorADC = 0;
+  unsigned long startTime;
+  unsigned long floatTime;
+  unsigned long fixedTime;
+  volatile float temperatureC;
+  volatile q16_t temperatureQ16;
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    float error = fabs(floatC(averageADC) - q16ToFloat(fixedC(averageADC)));
+    if (error > maxError) {
+      maxError = error;
+      maxErrorADC = averageADC;
+    }
+  }
+  startTime = micros();
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    temperatureC = floatC(averageADC);
+  }
+  floatTime = micros() - startTime;
+  startTime = micros();
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    temperatureQ16 = fixedC(averageADC);
+  }
+  fixedTime = micros() - startTime;
+  Serial.print("  Max Error     = ");
+  Serial.print(maxError, 3);
+  Serial.print("\xC2\xB0");
+  Serial.print("C at ADC ");
+  Serial.println(maxErrorADC);
+  Serial.print("  Float         = ");
+  Serial.print((float)floatTime / (LASTADC - FIRSTADC + 1));
+  Serial.println("us per reading");
+  Serial.print("  Fixed Point   = ");
+  Serial.print((float)fixedTime / (LASTADC - FIRSTADC + 1));
+  Serial.println("us per reading");
+  Serial.println();
+}
+
+void setup() {
+  //Start the serial console.
+  Serial.begin(9600);
+  #ifdef MATHONLY
+    volatile float temperatureC = MATHONLY::toFloat(ky013C<MATHONLY>(analogRead(A0)) + mf52dC<MATHONLY>(analogRead(A2)));
+    Serial.println(temperatureC);
+  #else
+    Serial.println("KY013 (Steinhart-Hart):");
+    compareMaths(ky013C<atsFloatMath>, ky013C<atsFixedMath>);
+    Serial.println("MF52D (Beta):");
+    compareMaths(mf52dC<atsFloatMath>, mf52dC<atsFixedMath>);
+  #endif
+}
+
+void loop() {
+}
+
+//EOF
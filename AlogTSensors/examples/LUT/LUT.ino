@@ -0,0 +1,92 @@
+/*
+Analog temperature sensor lookup table example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Compares the compile time ADC->temperature tables against the floating point calculations, for every ADC value,
+  and times both methods. The tables must be built with the same settings as the sensor objects.
+*/
+
+#include <AlogTSensors.h>
+
+#define KY013PIN A0                         //The vDivider class default is A0.
+#define MF52DPIN A2
+
+#define KY013R1 110000                      //110K balance resistor (100K external + 10K on board).
+#define C1_KY 0.0005182977433               //Steinhart-Hart coefficient 1.
+#define C2_KY 0.0002252079282               //Steinhart-Hart coefficient 2.
+#define C3_KY 0.0000001615362158            //Steinhart-Hart coefficient 3.
+
+#define MF52DR1 10000                       //10K balance resistor.
+#define CBETA_MF 3435                       //Beta coefficient.
+#define NOMRST_MF 10000                     //Nominal resistance.
+#define NOMTEMP_MF 25.0                     //Nominal temperature.
+
+#define FIRSTADC 20                         //Skip the ends of the ADC range, where the sensors are open or shorted.
+#define LASTADC 1003
+
+ATS_SHH_LUT(ky013LUT, KY013R1, true, C1_KY, C2_KY, C3_KY);
+ATS_BETA_LUT(mf52dLUT, MF52DR1, true, CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+
+KY013 myKY013(KY013PIN, KY013R1);           //The balance resistor is R1.
+MF52D myMF52D(MF52DPIN, MF52DR1);           //The balance resistor is R1.
+
+void setup() {
+  //Start the serial console.
+  Serial.begin(9600);
+  myKY013.setC123(C1_KY, C2_KY, C3_KY);
+  myMF52D.setCBeta(CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+  Serial.println("KY013 (Steinhart-Hart):");
+  compareLUT(myKY013, ky013LUT);
+  Serial.println("MF52D (Beta):");
+  compareLUT(myMF52D, mf52dLUT);
+}
+
+void loop() {
+}
+
+void compareLUT(Thermistor &sensor, const int16_t *lut) {
+  float maxError = 0.0;
+  unsigned int maxErrorADC = 0;
+  unsigned long startTime;
+  unsigned long calcTime;
+  unsigned long lutTime;
+  volatile float temperatureC;
+  //Accuracy, against the floating point calculations.
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    sensor.setLUT();
+    float calcC = sensor.readTemperatureC(averageADC);
+    sensor.setLUT(lut);
+    float lutC = sensor.readTemperatureC(averageADC);
+    if (fabs(calcC - lutC) > maxError) {
+      maxError = fabs(calcC - lutC);
+      maxErrorADC = averageADC;
+    }
+  }
+  //Speed, with the lookup table enabled and then disabled.
+  startTime = micros();
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    temperatureC = sensor.readTemperatureC(averageADC);
+  }
+  lutTime = micros() - startTime;
+  sensor.setLUT();
+  startTime = micros();
+  for (unsigned int averageADC = FIRSTADC; averageADC <= LASTADC; averageADC++) {
+    temperatureC = sensor.readTemperatureC(averageADC);
+  }
+  calcTime = micros() - startTime;
+  Serial.print("  Max Error     = ");
+  Serial.print(maxError, 3);
+  Serial.print("\xC2\xB0");
+  Serial.print("C at ADC ");
+  Serial.println(maxErrorADC);
+  Serial.print("  Calculated    = ");
+  Serial.print((float)calcTime / (LASTADC - FIRSTADC + 1));
+  Serial.println("us per reading");
+  Serial.print("  Lookup Table  = ");
+  Serial.print((float)lutTime / (LASTADC - FIRSTADC + 1));
+  Serial.println("us per reading");
+  Serial.println();
+}
+
+//EOF
@@ -0,0 +1,57 @@
+/*
+Compile time configured analog temperature sensor example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+The sensors are configured entirely by template parameters, so they use no RAM for their settings.
+  Compare the "Global variables use" figure with the same sensors built from the KY013, MF52D, TMP36 and vDivider classes.
+*/
+
+#include <AlogTSensorsT.h>
+
+#define KY013_PIN A0
+#define TMP36_PIN A1
+#define MF52D_PIN A2
+#define LDR_PIN A3
+
+#define SAMPLES 32
+#define AVREFMV 4830                        //Actual measured 5V reference voltage, in millivolts.
+
+#define C1_KY 0.0005182977433               //Steinhart-Hart coefficient 1.
+#define C2_KY 0.0002252079282               //Steinhart-Hart coefficient 2.
+#define C3_KY 0.0000001615362158            //Steinhart-Hart coefficient 3.
+
+#define DELAY 5000
+
+ATS_SHH_COEFFICIENTS(ky013Coefficients, C1_KY, C2_KY, C3_KY);
+ATS_BETA_COEFFICIENTS(mf52dCoefficients, 3435, 10000, 25.0);
+
+ThermistorT<vDividerT<KY013_PIN, 110000, true, SAMPLES>, ky013Coefficients> myKY013;     //110K balance resistor as R1.
+ThermistorT<vDividerT<MF52D_PIN, 10000, true, SAMPLES>, mf52dCoefficients> myMF52D;      //10K balance resistor as R1.
+TMP36T<vDividerT<TMP36_PIN, 0, true, SAMPLES, 1, 20, AVREFMV> > myTMP36;                 //No balance resistor.
+vDividerT<LDR_PIN, 100000, false, SAMPLES> myLDR;                                          //100K balance resistor as R2.
+//The same KY013 with fixed point arithmetic - the temperature is Q16.16 degrees C.
+ThermistorT<vDividerT<KY013_PIN, 110000, true, SAMPLES, _SAMPLEDELAY, _ADCREADYDELAY, _AVREFMV, _ADCMAX, vdFixedMath>, ky013Coefficients> myKY013Fixed;
+
+void setup() {
+  //Start the serial console.
+  Serial.begin(9600);
+}
+
+void loop() {
+  Serial.print("KY013 Temperature   = ");
+  Serial.println(myKY013.readTemperatureC());
+  Serial.print("KY013 Temperature Q = ");
+  Serial.println(q16ToFloat(myKY013Fixed.readTemperatureC()));
+  Serial.print("MF52D Temperature   = ");
+  Serial.println(myMF52D.readTemperatureC());
+  Serial.print("TMP36 Temperature   = ");
+  Serial.println(myTMP36.readTemperatureC());
+  Serial.print("LDR Light Level     = ");
+  Serial.println(myLDR.readADC());
+  Serial.println();
+  //Wait for a while...
+  delay(DELAY);
+}
+
+//EOF
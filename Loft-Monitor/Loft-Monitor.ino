@@ -58,6 +58,13 @@ Licence: GPLv3
 //Read data from the BME280, DHT11, DHT22, DS18B20, KY013, TMP36 & MF52D temperature sensors, and send it to the serial console,
 //  and then update some temperature band LEDs.
 //The light level is also recorded, using an LDR sensor, and sent to the serial console.
+//A PWM fan can be driven from the temperature, with a fan curve or a PID loop (FAN_ENABLED, see LoftControl.h).
+//The temperature trend is forecast, to warn before the loft gets too hot, not after (USE_FORECAST, see LoftForecast.h).
+//The band and the trend are saved in EEPROM, and restored after a watchdog or brown-out reset (USE_FASTSTART, see LoftState.h).
+//Recent data is also kept in EEPROM, and can be sent again to fill a gap in a capture (USE_HISTORY, see LoftHistory.h).
+//Quiet periods can be sent as short sparse lines, of just the columns that have changed (PLOTSPARSE).
+//The sensor reads and the data output can be timed, and the times sent as diagnostics lines (USE_PROBES, see LoftProbe.h).
+//The sketch also builds and runs, unchanged, on a PC, against a simulated Nano and sensors, with Tools/HostSim.
 //
 //Band 7: Red + White(F) = more than 55 deg C
 //Band 6: Red + White = 45 --> 55 deg C
@@ -92,7 +99,17 @@ Licence: GPLv3
 //L. Review code looking for any more code optimisations - completed (several times, and always on-going).
 //M. Compile code with all->no sensors enabled, for SDEBUG and PLOTDATA options - completed.
 //N. Add an average humidity option?
-//O. Add support for multiple DS18B20 sensors on the OneWire bus.
+//O. Add support for multiple DS18B20 sensors on the OneWire bus - completed.
+//P. Stop the sensor tasks waiting for the serial port - completed, the output is buffered and sent between tasks.
+//Q. Use a spare output to control a fan - completed, a fan curve or PID loop on a PWM pin, simulated with Tools/LoftThermalSim.
+//R. Fuse the temperature sensors, rather than a plain average, so a failed or poor sensor does not skew the bands - completed.
+//S. Forecast the time to the next bands, and pre-alert before the loft overheats - completed, replayed with Tools/LoftForecastReplay.
+//T. Restart quickly, and carry on where it left off, after a reset - completed, the state is saved in EEPROM, and a watchdog added.
+//U. Keep the recent readings, so a gap in a capture can be filled in afterwards - completed, an EEPROM history, merged with Tools/LoftBackfill.
+//V. Send less when nothing is changing - completed, PLOTSPARSE only sends the columns that move beyond their deadbands, expanded with Tools/LoftSparseExpander.
+//W. Find out where the time goes, and how long the slowest reads really take - completed, latency probes, summarised with Tools/LoftProbeReport.
+//X. Try changes, and benchmark loop(), without the hardware - completed, a host build on a simulated Nano, virtual clock and sensors, Tools/HostSim.
+//Y. Analyse months of captures, which LibreCalc cannot open - started, a fast parallel capture reader, Tools/LoftIngest, and a compressed store, with hourly and daily rollups, Tools/LoftArchive, the sensors compared, Tools/LoftCompare, and the thermistors calibrated, Tools/LoftCalibrate.
 
 //Code Optimisation
 //https://learn.adafruit.com/memories-of-an-arduino/optimizing-program-memory
@@ -112,6 +129,17 @@ Licence: GPLv3
 #include <DallasTemperature.h>    //DS18B20 sensor library.
 #include <VDivider.h>             //My own analog voltage divider library, used for the LDR and the analog temperature sensors.
 #include <AlogTSensors.h>         //My own analog sensor library for KY013, MF52D and TMP36 temperature sensors. Inherits from VDivider.h.
+#include <LoopScheduler.h>        //My own cooperative task scheduler library.
+#include "LoftFrame.h"            //Binary telemetry frames, for PLOTBINARY.
+#include "LoftOutput.h"           //Buffered serial output, so the tasks never wait for the serial port.
+#include "LoftSensors.h"          //The compile time sensor list.
+#include "LoftBands.h"            //The temperature band table.
+#include "LoftControl.h"          //The fan controller, for FAN_ENABLED.
+#include "LoftFusion.h"           //The temperature sensor fusion, for USEFUSEDTEMP.
+#include "LoftForecast.h"         //The temperature trend forecast, for USE_FORECAST.
+#include "LoftState.h"            //The state saved in EEPROM, and the reset flags, for USE_FASTSTART.
+#include "LoftHistory.h"          //The recent data lines kept in EEPROM, for USE_HISTORY.
+#include "LoftProbe.h"            //The latency probes, for USE_PROBES.
 
 #define SCRIPT_NAME FLASHSTR("Binaria Loft Environment Monitor v1.01")
 
@@ -135,6 +163,7 @@ Licence: GPLv3
 
 //DS18B20 sensor defines.
 #define DS18B20_ENABLED
+#define DS18B20_PROBES 1          //The number of DS18B20 probes on the OneWire bus, 1 - 9. Each probe has its own data column.
 
 //KY013 sensor defines - NTC Thermistor Temperature Sensor AZ Deliveries KY013, 100K@T25 nominal resistance.
 #define KY013_ENABLED
@@ -163,10 +192,25 @@ Licence: GPLv3
 #define LDR_SAMPLES 32
 #define LDRR2 100000              //100K balance resistor.
 
+//Analog sensor sampling defines.
+#define USE_ADCGROUP              //Sample the KY013, TMP36, MF52D & LDR sensors in one interleaved sweep, sharing the ADC settle and sample delays.
+#define USE_TEMPLUT               //Convert the KY013 & MF52D readings with compile time lookup tables (2KB flash each), instead of float maths.
+#define USE_ADAPTIVEADC           //Stop sampling the KY013, TMP36, MF52D & LDR sensors early when their readings are steady.
+#define ADC_MINSAMPLES 8          //Adaptive sampling - always take at least this many samples.
+#define ADC_MAXSTDERR 0.25        //Adaptive sampling - stop when the standard error of the mean is below this many ADC steps.
+
 //Check that some sensors are enabled.
 #if not (defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED) || defined(DS18B20_ENABLED) || defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED) || defined(LDR_ENABLED))
   #error "Sketch compilation STOPPED - No sensors are enabled!"
 #endif
+//Check the number of DS18B20 probes.
+#if defined(DS18B20_ENABLED) && ((DS18B20_PROBES < 1) || (DS18B20_PROBES > 9))
+  #error "Sketch compilation STOPPED - DS18B20_PROBES must be 1 - 9!"
+#endif
+//Check that only one band temperature is chosen.
+#if defined(USEFUSEDTEMP) && defined(USEAVERAGETEMP)
+  #error "Sketch compilation STOPPED - USEFUSEDTEMP and USEAVERAGETEMP cannot both be enabled!"
+#endif
 //Check if no temperature sensors are enabled.
 #if not (defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED) || defined(DS18B20_ENABLED) || defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED))
   #warning "Sketch compilation PROBLEM - No temperature sensors are enabled!"
@@ -192,6 +236,7 @@ Licence: GPLv3
 #define GREEN_LED 7
 #define BLUE_LED 8
 #define WHITE_LED 9
+#define FAN_PIN 10                //A PWM pin (Timer1), for a fan driver MOSFET.
 #define LED_TEST_DELAY 500
 
 //Debugging & testing define.
@@ -202,9 +247,55 @@ Licence: GPLv3
 //#define DATADELIMITER FLASHSTR(" ")
 //#define DATADELIMITER FLASHSTR("\t")
 #define DATADELIMITER FLASHSTR(",")
+//#define PLOTBINARY              //Send the plot data as compact binary frames (LoftFrame.h) instead of CSV text. Decode them with Tools/LoftFrameDecoder.
+//#define PLOTSPARSE              //Only send the columns that have moved more than their deadband, as short "~" lines, between full CSV lines. Expand them with Tools/LoftSparseExpander.
+#define SPARSE_KEYFRAME 40        //Send a full CSV line first, and then every X data outputs (10 minutes), so a capture can be expanded from any of them.
+//Check that the binary frames and sparse lines have plot data to send.
+#if defined(PLOTBINARY) && !defined(PLOTDATA)
+  #error "Sketch compilation STOPPED - PLOTBINARY needs PLOTDATA!"
+#endif
+#if defined(PLOTSPARSE) && (!defined(PLOTDATA) || defined(PLOTBINARY))
+  #error "Sketch compilation STOPPED - PLOTSPARSE needs PLOTDATA, and cannot be used with PLOTBINARY!"
+#endif
+
+//Sparse line deadbands (PLOTSPARSE), for each sensor's columns, in 1/100ths deg C or % (whole numbers for the light
+//  level, the fan duty and the minutes to alert). A column is sent when it has moved more than its deadband from the
+//  value last sent, so the expanded CSV always stays within the deadband of the readings. The band is sent on any change.
+#define DEADBAND_BME280 10        //0.1 deg C and 0.1 %.
+#define DEADBAND_DHT11 0          //Whole degrees and %, every step is a real change.
+#define DEADBAND_DHT22 10
+#define DEADBAND_DS18B20 10       //More than one 0.0625 deg C step.
+#define DEADBAND_KY013 25         //The analog sensors are the noisiest.
+#define DEADBAND_TMP36 25
+#define DEADBAND_MF52D 25
+#define DEADBAND_FUSED 10
+#define DEADBAND_LDR 5            //ADC steps.
+#define DEADBAND_FAN 2            //%.
+#define DEADBAND_FORECAST 5       //Minutes.
+
+//Serial output defines.
+#define OUTPUT_BUFFER 128         //Queue the serial output in a RAM buffer of this many bytes, and send it between tasks. It must hold a whole CSV line.
+#define OUTPUT_DROPWHENFULL       //Drop a whole CSV line or frame if the buffer is full, rather than wait (PLOTDATA only, a text block is too big).
+
+//Temperature band defines. The band LEDs follow the fused temperature, or the average temperature, or the first sensor.
+#define USEFUSEDTEMP              //Fuse the temperature sensors (LoftFusion.h), use the result to update the temperature band LEDs, and add a Temperature(Fused) data column.
+//#define USEAVERAGETEMP          //Calculate an average sensor temperature and use it to update the temperature band LEDs.
 
-//Temperature band defines.
-#define USEAVERAGETEMP            //Calculate an average sensor temperature and use it to update the temperature band LEDs.
+//Sensor fusion defines (USEFUSEDTEMP). Each temperature sensor's reading noise (standard deviation, deg C), valid range
+//  (deg C), and whether it is relative - read often, but with an offset, which is learnt from the digital sensors. The
+//  models are kept in flash.
+constexpr fusionModel bme280Fusion PROGMEM = {0.5, -40.0, 85.0, false};
+constexpr fusionModel dht11Fusion PROGMEM = {1.5, 0.0, 50.0, false};
+constexpr fusionModel dht22Fusion PROGMEM = {0.5, -40.0, 80.0, false};
+constexpr fusionModel ds18b20Fusion PROGMEM = {0.25, -55.0, 125.0, false};
+constexpr fusionModel ky013Fusion PROGMEM = {0.5, -40.0, 125.0, true};
+constexpr fusionModel tmp36Fusion PROGMEM = {0.5, -40.0, 125.0, true};
+constexpr fusionModel mf52dFusion PROGMEM = {0.3, -40.0, 125.0, true};
+#define FUSION_PROCESS 0.000001   //How fast the loft temperature trend can change, deg C^2/s^3. Bigger follows faster, smaller is smoother.
+#define FUSION_GATE 4.0           //Reject a reading more than this many standard deviations from the fused temperature.
+#define FUSION_STUCKDELTA 2.0     //Reject a reading that has not changed while the fused temperature moved this far, deg C.
+#define FUSION_OFFSETGAIN 0.01    //How fast the offset of a relative sensor is learnt, per reading.
+#define FUSION_TIMEOUT 300000     //With no reading used for X ms, the fused temperature is stale, and the band LEDs, fan and forecast treat it as failed.
 
 //All these thresholds are in deg C.
 #define UHOT_BAND 55.0            //Band 7 - Same LEDs as VHOT, but the white LED is blinked.
@@ -217,52 +308,477 @@ Licence: GPLv3
 #define UCOLD_BAND -274.0         //Band 0 - Same LEDs as VCOLD, but the white LED is blinked.
 #define BAND_HYSTERESIS 0.5       //Stop jitter if the temperature is around a band boundry.
 
+//The temperature bands, coldest first - the threshold each band starts at, the LEDs it lights, the LEDs it blinks, and
+//  its alert label. Add a row for a new band, or a pin to a row for a new output, e.g. a fan relay.
+constexpr char ucoldLabel[] PROGMEM = "<Deep Space!>";
+constexpr char vcoldLabel[] PROGMEM = "<Ice Age!>";
+constexpr char blueLabel[] PROGMEM = "<BLUE>";
+constexpr char greenLabel[] PROGMEM = "<GREEN>";
+constexpr char yellowLabel[] PROGMEM = "<YELLOW>";
+constexpr char redLabel[] PROGMEM = "<RED>";
+constexpr char vhotLabel[] PROGMEM = "<Melting!>";
+constexpr char uhotLabel[] PROGMEM = "<Inferno!>";
+constexpr bandEntry bandTable[] PROGMEM = {
+  {UCOLD_BAND, BANDPIN(BLUE_LED), BANDPIN(WHITE_LED), ucoldLabel},                 //Band 0.
+  {VCOLD_BAND, BANDPIN(BLUE_LED) | BANDPIN(WHITE_LED), 0, vcoldLabel},             //Band 1.
+  {BLUE_BAND, BANDPIN(BLUE_LED), 0, blueLabel},                                    //Band 2.
+  {GREEN_BAND, BANDPIN(GREEN_LED), 0, greenLabel},                                 //Band 3.
+  {YELLOW_BAND, BANDPIN(YELLOW_LED), 0, yellowLabel},                              //Band 4.
+  {RED_BAND, BANDPIN(RED_LED), 0, redLabel},                                       //Band 5.
+  {VHOT_BAND, BANDPIN(RED_LED) | BANDPIN(WHITE_LED), 0, vhotLabel},                //Band 6.
+  {UHOT_BAND, BANDPIN(RED_LED), BANDPIN(WHITE_LED), uhotLabel}                     //Band 7.
+};
+static_assert(bandTableValid(bandTable, BAND_HYSTERESIS), "The band thresholds must be in order, and more than 2 x BAND_HYSTERESIS apart!");
+constexpr uint8_t bandCount = sizeof(bandTable) / sizeof(bandTable[0]);
+constexpr uint16_t bandOutputs = bandAllPins(bandTable);
+
+//Fan controller defines. The fan follows the same temperature as the band LEDs, unless FAN_SENSOR is set.
+//#define FAN_ENABLED               //Drive a PWM fan on FAN_PIN from the loft temperature, and add a Fan-Duty data column.
+//#define FAN_USEPID                //Hold the temperature at FAN_SETPOINT with a PID loop, instead of following the fan curve.
+//#define FAN_SENSOR tmp36Sensor    //Control the fan from the first temperature of this sensor adapter.
+#define FAN_SETPOINT 30.0           //PID - deg C.
+#define FAN_KP 10.0                 //PID - duty % per deg C above the setpoint.
+#define FAN_KI 0.05                 //PID - duty % per deg C above the setpoint, per second.
+#define FAN_KD 0.0                  //PID - duty % per deg C/min rise.
+#define FAN_FEEDFORWARD 10.0        //Extra duty % per deg C/min rise, so the fan reacts as soon as the loft starts heating.
+#define FAN_RATETIME 30.0           //The rate of change smoothing time constant, in seconds.
+#define FAN_MINDUTY 25              //The lowest duty % the fan runs at. It stops below half of this.
+#define FAN_MAXDUTY 100
+#define FAN_KICKTIME 1000           //Run the fan at full duty for X ms when it starts, so it does not stall.
+
+#ifdef FAN_ENABLED
+  //The fan curve, coolest first - the temperature (deg C), and the fan duty (%) at it. The duty is interpolated between the points.
+  const fanCurvePoint fanCurve[] = {
+    {25.0, 0},
+    {30.0, 30},
+    {40.0, 70},
+    {45.0, 100}
+  };
+#endif
+
+//Forecast defines. The trend of the band LED temperature is forecast, and a pre-alert raised before it reaches FORECAST_BAND.
+//#define USE_FORECAST              //Forecast the time to each hotter band, and add a Minutes-To-Alert data column. Needs a task, and about 70 bytes of RAM.
+#define FORECAST_WINDOW 15.0        //The trend follows roughly the last X minutes of temperatures.
+#define FORECAST_MINSLOPE 0.005     //Slower rises than this, deg C/min (0.3 deg C/hour), are not forecast.
+#define FORECAST_BAND 6             //Pre-alert before the temperature reaches this band (VHOT_BAND).
+#define FORECAST_HORIZON 30.0       //Pre-alert when the band will be reached within X minutes.
+static_assert(FORECAST_BAND < bandCount, "FORECAST_BAND must be in the band table!");
+
+//Restart defines. After a warm start (a watchdog, brown-out or reset button reset, not a power on) the start up delays
+//  and the LED tests are skipped, and the saved state is restored, so the first readings are taken within a second.
+//#define USE_FASTSTART           //Save the band, the trend and the restart counts in EEPROM (LoftState.h), and restore them after a warm start. Needs a task, and about 130 bytes of RAM.
+#define FASTSTART_OUTPUT 1500     //After a warm start, output the first sensor data after X ms.
+#define STATE_VERSION 1           //Change this when loftState changes, so an old saved state is not restored.
+//#define USE_WATCHDOG            //Restart the MCU if a task hangs for WATCHDOG_TIMEOUT. Needs Optiboot (the "new" Nano bootloader), and LOFTSTATE_OPTIBOOT in LoftState.h.
+#define WATCHDOG_TIMEOUT WDTO_2S
+
+//History defines. Every HISTORY_EVERY data outputs, the data line is also kept in the EEPROM, after the saved state, so a
+//  gap in a capture can be filled in later. Send "B<sequence>" for the kept lines from that one on ("B" for them all),
+//  or "S" for the min, max and mean of each column over the kept lines. The replies are lines starting with '#'.
+//#define USE_HISTORY             //Keep the recent data lines (LoftHistory.h), and answer the backfill and summary commands. Needs a task, and about 270 bytes of RAM.
+#define HISTORY_EVERY 8           //Keep every Xth data line, one every 2 minutes, so the history spans hours, not minutes.
+#define COMMAND_PERIOD 100        //Check for a command, and send the next line of a reply, every X ms.
+#ifdef USE_HISTORY
+  #define STATE_EEPROM 384        //The EEPROM bytes for the saved state, the rest are for the history.
+#else
+  #define STATE_EEPROM (E2END + 1)
+#endif
+
+//Latency probe defines. Each sensor read, and the data output, is timed (LoftProbe.h), and every PROBE_EVERY data outputs
+//  the times of the next probe that has run are sent after the data line, and reset, as a diagnostics line:
+//  "#P,<probe>,<count>,<min us>,<mean us>,<max us>,<bucket counts...>". Summarise a capture with Tools/LoftProbeReport.
+//  The probes take about 180 bytes of RAM, and compile out completely when disabled.
+//#define USE_PROBES                //Time the sensor reads and the data output, and send the diagnostics lines.
+#define PROBE_EVERY 1               //Send a probe's line every X data outputs, so each probe's every X x 8 outputs at most.
+#ifdef USE_PROBES
+  #define PROBE_START() uint32_t probeStart = micros()
+  #define PROBE_STOP(probe) probes[probe].add(micros() - probeStart)
+#else
+  #define PROBE_START()
+  #define PROBE_STOP(probe)
+#endif
+
 //Code loop variables and defines.
 bool hbStatus = LOW;                          //Heartbeat status.
-bool wlStatus = LOW;                          //White LED status.
+bool blinkStatus = HIGH;                      //Blinking band LEDs status.
 byte temperatureBand = 3;                     //Initial temperature band value (green band).
-#define loopDelayTime 500                     //Loop delay in ms.
-#define sampleEvery 30                        //Read the sensors every X loop delays. Ensure sensor readings are not faster than once every 5 secs.
-byte sampleCountDown = sampleEvery / 3;       //Sample delay count down start value.
-#ifdef USEAVERAGETEMP
-  byte numTSensors = 0;                       //Average temperature divider.
+byte ledBand = 0xFF;                          //The band the LEDs are showing, none until the first update.
+float alertTemperature = 0.0;                 //The temperature last used to update the band LEDs.
+#define loopDelayTime 500                     //Heartbeat and band LED blink period in ms.
+#define sampleEvery 30                        //Output the sensor data every X heartbeats.
+#define sampleStart (sampleEvery / 3)         //Output the first sensor data after X heartbeats.
+bool warmStart = false;                       //Restarted by a reset, not a power on, and the saved state restored.
+uint16_t outputStart = sampleStart * loopDelayTime; //The first data output, in ms, sooner after a warm start.
+
+//Task scheduler defines. Each sensor is read, and its reading cached, on its own period (in ms).
+#define BME280_PERIOD 5000                    //Ensure BME280 readings are not faster than once every 5 secs (self-heating).
+#define DHT11_PERIOD 2000                     //The DHT11 needs at least 1 sec between readings.
+#define DHT22_PERIOD 2000                     //The DHT22 needs at least 2 secs between readings.
+#define DS18B20_PERIOD 5000
+#define ANALOG_PERIOD 1000                    //The KY013, TMP36, MF52D & LDR sensors.
+#define ADCPOLL_PERIOD 1                      //Take the next round of an analog sensor sweep (USE_ADCGROUP).
+#define ADCPOLL_DEADLINE 10
+#define FUSION_PERIOD 1000                    //Fuse the new temperature readings, as often as the analog sensors are read.
+#define BAND_PERIOD 1000                      //Update the temperature band LEDs.
+#define FAN_PERIOD 1000                       //Update the fan duty, so it reacts in seconds, not at the next data output.
+#define FORECAST_PERIOD 10000                 //Add the band temperature to the trend forecast.
+#define STATE_PERIOD 60000                    //Count down to the next state save.
+#define STATE_SAVEEVERY 5                     //Save the state in EEPROM every X state periods, the first time after one, so a restart loop does not wear it out.
+#define OUTPUT_PERIOD (sampleEvery * loopDelayTime)
+#define TASKSTATS_EVERY 4                     //Report the task stats every X data outputs (not for PLOTDATA), 0 = never.
+#define USE_IDLESLEEP                         //Put the MCU into idle sleep when no task is due.
+#ifdef USE_IDLESLEEP
+  #include <avr/sleep.h>
+#endif
+#ifdef USE_WATCHDOG
+  #include <avr/wdt.h>
+#endif
+extern loopScheduler scheduler;             //Defined after the sensor list, which sizes its task table.
+uint8_t outputBuffer[OUTPUT_BUFFER];
+#if defined(OUTPUT_DROPWHENFULL) && defined(PLOTDATA)
+  loftOutput serialOut(Serial, outputBuffer, OUTPUT_BUFFER, true);
+#else
+  loftOutput serialOut(Serial, outputBuffer, OUTPUT_BUFFER, false);
+#endif
+#if !defined(SDEBUG) && defined(USE_ADCGROUP)
+  vDividerGroup adcGroup;                     //The analog sensor sweep group. The analog sensors add themselves in setup().
+  int8_t adcPollTask;                         //The analog sensor sweep task, enabled while a sweep is in progress.
+#endif
+
+//Sensor adapters (see LoftSensors.h). Each one holds a sensor, and its cached readings, and its member functions,
+//  defined with the sensor read tasks below, start it, read it, and send its readings.
+#ifdef BME280_ENABLED
+  struct bme280Sensor : sensorAdapter {
+    static constexpr uint8_t columns = 2;
+    static constexpr uint8_t temperatures = 1;
+    static constexpr uint8_t tasks = 1;
+    static constexpr uint16_t frameBit = LFM_BME280;
+    static constexpr int16_t deadband = DEADBAND_BME280;
+    #ifndef SDEBUG
+      static Adafruit_BME280 device;
+    #endif
+    static float temperature;
+    static float humidity;
+    static uint8_t readings;                  //Counts the reads, so each reading is fused once.
+    #ifdef GETPRESSURE
+      static float pressure;
+    #endif
+    #ifdef GETALTITUDE
+      static float altitude;
+    #endif
+    static void begin();
+    static void addTasks();
+    static void read();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+    static float firstTemperature();
+    static void addTemperatures(float &total);
+    static void fuse(loftFusion &fusion, uint8_t channel);
+  };
+#endif
+
+#if defined(DHT11_ENABLED) || defined(DHT22_ENABLED)
+  //One adapter for each DHT sensor type, DHT_TYPE11 or DHT_TYPE22.
+  template<uint8_t type> struct dhtSensor : sensorAdapter {
+    static constexpr uint8_t columns = 2;
+    static constexpr uint8_t temperatures = 1;
+    static constexpr uint8_t tasks = 1;
+    static constexpr uint16_t frameBit = (type == DHT_TYPE11) ? LFM_DHT11 : LFM_DHT22;
+    static constexpr int16_t deadband = (type == DHT_TYPE11) ? DEADBAND_DHT11 : DEADBAND_DHT22;
+    #ifndef SDEBUG
+      static DHT device;
+    #endif
+    static float temperature;
+    static float humidity;
+    static uint8_t readings;
+    static void begin();
+    static void addTasks();
+    static void read();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+    static float firstTemperature();
+    static void addTemperatures(float &total);
+    static void fuse(loftFusion &fusion, uint8_t channel);
+    static const __FlashStringHelper *name();
+  };
+  #ifdef DHT11_ENABLED
+    typedef dhtSensor<DHT_TYPE11> dht11Sensor;
+  #endif
+  #ifdef DHT22_ENABLED
+    typedef dhtSensor<DHT_TYPE22> dht22Sensor;
+  #endif
+#endif
+
+#ifdef DS18B20_ENABLED
+  struct ds18b20Sensor : sensorAdapter {
+    static constexpr uint8_t columns = DS18B20_PROBES;
+    static constexpr uint8_t temperatures = DS18B20_PROBES;
+    static constexpr uint8_t tasks = 2;
+    static constexpr uint16_t frameBit = LFM_DS18B20;
+    static constexpr int16_t deadband = DEADBAND_DS18B20;
+    #ifndef SDEBUG
+      static OneWire bus;
+      static DallasTemperature device;
+      static DeviceAddress address[DS18B20_PROBES]; //The probe addresses, found once in setup().
+      static bool found[DS18B20_PROBES];      //The probes that were found.
+      static uint16_t convTime;               //Milliseconds for a temperature conversion, at the probe resolution.
+    #endif
+    static float temperature[DS18B20_PROBES];
+    static uint8_t readings;
+    static int8_t collectTask;                //The results task, enabled when a conversion has been started.
+    static void begin();
+    static void addTasks();
+    static void read();
+    static void collect();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+    static float firstTemperature();
+    static void addTemperatures(float &total);
+    static void fuse(loftFusion &fusion, uint8_t channel);
+  };
+#endif
+
+#if defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED)
+  //One adapter for each analog temperature sensor, by its device class and its LFM_* bit. Only the device construction,
+  //  and its set up, differ, and each sensor has its own specialisation of these, below.
+  template<typename deviceType, uint16_t bit> struct alogTSensor : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t temperatures = 1;
+    static constexpr uint8_t analogs = 1;
+    static constexpr uint16_t frameBit = bit;
+    static constexpr int16_t deadband = (bit == LFM_KY013) ? DEADBAND_KY013 : (bit == LFM_TMP36) ? DEADBAND_TMP36 : DEADBAND_MF52D;
+    #ifndef SDEBUG
+      static deviceType device;
+      static void setUp();
+    #endif
+    static float temperature;
+    static uint8_t readings;
+    static void begin();
+    static void readAnalog();
+    static void collectAnalog();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+    static float firstTemperature();
+    static void addTemperatures(float &total);
+    static void fuse(loftFusion &fusion, uint8_t channel);
+    static const __FlashStringHelper *name();
+  };
+#endif
+
+#ifdef KY013_ENABLED
+  #if !defined(SDEBUG) && defined(USE_TEMPLUT)
+    ATS_SHH_LUT(ky013LUT, KY013R1, true, C1_KY, C2_KY, C3_KY);             //KY013 ADC->temperature table.
+  #endif
+  typedef alogTSensor<KY013, LFM_KY013> ky013Sensor;
+  #ifndef SDEBUG
+    template<> KY013 ky013Sensor::device;
+    template<> void ky013Sensor::setUp();
+  #endif
+#endif
+
+#ifdef TMP36_ENABLED
+  typedef alogTSensor<TMP36, LFM_TMP36> tmp36Sensor;
+  #ifndef SDEBUG
+    template<> TMP36 tmp36Sensor::device;
+    template<> void tmp36Sensor::setUp();
+  #endif
+#endif
+
+#ifdef MF52D_ENABLED
+  #if !defined(SDEBUG) && defined(USE_TEMPLUT)
+    ATS_BETA_LUT(mf52dLUT, MF52DR1, true, CBETA_MF, NOMRST_MF, NOMTEMP_MF); //MF52D ADC->temperature table.
+  #endif
+  typedef alogTSensor<MF52D, LFM_MF52D> mf52dSensor;
+  #ifndef SDEBUG
+    template<> MF52D mf52dSensor::device;
+    template<> void mf52dSensor::setUp();
+  #endif
+#endif
+
+#ifdef LDR_ENABLED
+  struct ldrSensor : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t analogs = 1;
+    static constexpr uint16_t frameBit = LFM_LDR;
+    static constexpr int16_t deadband = DEADBAND_LDR;
+    #ifndef SDEBUG
+      static vDivider device;
+    #endif
+    static unsigned int lightLevel;
+    static void begin();
+    static void readAnalog();
+    static void collectAnalog();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+  };
+#endif
+
+#ifdef USEFUSEDTEMP
+  //The fused temperature, from the temperature sensors in the list. It has no temperatures of its own, so it is not fused or averaged.
+  struct fusedSensor : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t tasks = 1;
+    static constexpr uint16_t frameBit = LFM_FUSED;
+    static constexpr int16_t deadband = DEADBAND_FUSED;
+    static fusionChannel channels[];          //One for each temperature column.
+    static loftFusion fusion;
+    static uint32_t lastUpdate;               //millis() at the last update.
+    static void begin();
+    static void addTasks();
+    static void update();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+  };
+#endif
+
+#ifdef FAN_ENABLED
+  //Not a sensor, but it has its own task and a data column, so the fan is an adapter too.
+  struct fanOutput : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t tasks = 1;
+    static constexpr uint16_t frameBit = LFM_FAN;
+    static constexpr int16_t deadband = DEADBAND_FAN;
+    static fanController controller;
+    static uint32_t lastUpdate;               //millis() at the last update.
+    static void begin();
+    static void addTasks();
+    static void update();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+  };
 #endif
 
-//Sensor object initialisations.
-#ifndef SDEBUG
+#ifdef USE_FORECAST
+  //Not a sensor either, the trend forecast of the band LED temperature, and the pre-alert for FORECAST_BAND.
+  struct forecastOutput : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t tasks = 1;
+    static constexpr uint16_t frameBit = LFM_FORECAST;
+    static constexpr int16_t deadband = DEADBAND_FORECAST;
+    static loftForecast forecast;
+    static uint32_t lastUpdate;               //millis() at the last update.
+    static void begin();
+    static void addTasks();
+    static void update();
+    static uint16_t minutesToAlert();
+    static void showPreAlert();
+    static void printHeader(Print &out);
+    static void show();
+    static void addFields(loftFrame &frame);
+  };
+#endif
+
+//The enabled sensors, in CSV column order. A new sensor only needs an adapter, and adding here.
+typedef sensorList<
   #ifdef BME280_ENABLED
-    Adafruit_BME280 myBME280;                 //Initialise the BME280 sensor using I2C interface, SCL = A5, SDA = A4.
+    bme280Sensor,
   #endif
   #ifdef DHT11_ENABLED
-    DHT myDHT11(DHT11_PIN, DHT_TYPE11);       //Initialize the DHT11 sensor for normal 16mhz Arduino (default delay = 6).
+    dht11Sensor,
   #endif
   #ifdef DHT22_ENABLED
-    DHT myDHT22(DHT22_PIN, DHT_TYPE22);       //Initialize the DHT22 sensor for normal 16mhz Arduino (default delay = 6).
+    dht22Sensor,
   #endif
   #ifdef DS18B20_ENABLED
-    OneWire oneWireBus(DS18B20_PIN);          //Setup a oneWire instance to communicate with the DS18B20 sensor.
-    DallasTemperature myDS18B20(&oneWireBus); //Initialise the DS18B20 sensor.
+    ds18b20Sensor,
   #endif
   #ifdef KY013_ENABLED
-    KY013 myKY013(KY013_PIN, KY013R1);        //Initialise the KY013 sensor. The balance resistor is R1.
+    ky013Sensor,
   #endif
   #ifdef TMP36_ENABLED
-    TMP36 myTMP36(TMP36_PIN);                 //Initialise the TMP36 sensor. This sensor does not use a balance resistor.
+    tmp36Sensor,
   #endif
   #ifdef MF52D_ENABLED
-    MF52D myMF52D(MF52D_PIN, MF52DR1);        //Initialise the MF52D sensor. The balance resistor is R1.
+    mf52dSensor,
   #endif
   #ifdef LDR_ENABLED
-    vDivider myLDR(LDR_PIN, LDRR2, false);    //Initialise the LDR sensor. The balance resistor is R2 (not R1).
+    ldrSensor,
+  #endif
+  #ifdef FAN_ENABLED
+    fanOutput,
+  #endif
+  #ifdef USEFUSEDTEMP
+    fusedSensor,                              //After the columns there were before it, so they keep their places.
   #endif
+  #ifdef USE_FORECAST
+    forecastOutput,
+  #endif
+  sensorListEnd> sensors;
+
+#if defined(PLOTBINARY) || defined(PLOTSPARSE) || defined(USE_HISTORY)
+  loftFrame frame;                            //The binary frame builder, and its column set.
+  const uint16_t frameMask = sensors::frameMask | ((sensors::temperatures > 0) ? LFM_BAND : 0);
 #endif
 
-void setup() {
-  #ifndef SDEBUG
-    #ifdef BME280_ENABLED
-      bool bme280_status;
+#ifdef PLOTSPARSE
+  //The columns as last sent, as binary frame fields, so only the ones that have moved are sent.
+  constexpr uint8_t sparseFields = sensors::columns + ((sensors::temperatures > 0) ? 1 : 0);
+  int16_t sparseSent[sparseFields];
+#endif
+
+#ifdef USE_FASTSTART
+  //The state saved in EEPROM, and restored after a warm start. The restart counts are kept over a power on too.
+  struct loftState {
+    uint8_t band;                             //temperatureBand, so the band hysteresis carries on.
+    float temperature;                        //alertTemperature.
+    uint16_t starts;                          //Every start since the EEPROM was first used...
+    uint16_t watchdogResets;                  //...the watchdog resets...
+    uint16_t brownoutResets;                  //...and the brown-out resets.
+    #ifdef USE_FORECAST
+      forecastState forecast;
     #endif
+  };
+  static_assert(STATE_EEPROM / (sizeof(loftState) + LOFTSTORE_OVERHEAD) >= 2, "The EEPROM must hold at least two saved states!");
+  loftState state;
+  uint8_t stateBuffer[sizeof(loftState) + LOFTSTORE_OVERHEAD];
+  loftStore stateStore(stateBuffer, sizeof(loftState), 0, STATE_EEPROM, STATE_VERSION);
+#endif
+
+#ifdef USE_HISTORY
+  //The kept data lines, as binary frame fields, and the command reply being sent.
+  constexpr uint8_t historyFields = sensors::columns + ((sensors::temperatures > 0) ? 1 : 0);
+  static_assert((historyFields > 0) && (historyFields <= LOFTFRAME_MAXFIELDS), "The history needs 1 to LOFTFRAME_MAXFIELDS data columns!");
+  int16_t historyValues[2 * historyFields];
+  uint8_t historyLine[LOFTHISTORY_LINESIZE(historyFields)];
+  loftHistory history(STATE_EEPROM, E2END + 1 - STATE_EEPROM, historyFields, historyValues, historyLine);
+  uint32_t historyTime = 0;                   //millis() when the newest line was kept.
+  enum replyStates : byte {REPLY_NONE, REPLY_STATUS, REPLY_BACKFILL, REPLY_END, REPLY_SUMMARY};
+  replyStates replyState = REPLY_NONE;
+  uint16_t replySequence;                     //The first line to backfill...
+  int16_t replyValues[historyFields];
+  historyCursor replyCursor = {0, 0, replyValues};  //...the line being sent...
+  uint8_t replyField;                         //...or the column being summarised.
+#endif
+
+//The most tasks setup() and the sensor adapters add, so a feature is never left without one.
+constexpr uint8_t schedulerTasks = 3 + sensors::tasks + ((sensors::analogs > 0) ? 1 : 0) + ((sensors::temperatures > 0) ? 1 : 0)
+  #if !defined(SDEBUG) && defined(USE_ADCGROUP)
+    + ((sensors::analogs > 0) ? 1 : 0)
+  #endif
+  #ifdef USE_FASTSTART
+    + 1
   #endif
+  #ifdef USE_HISTORY
+    + 1
+  #endif
+  ;
+lsTask taskTable[schedulerTasks];           //27 bytes of RAM each.
+loopScheduler scheduler(taskTable, schedulerTasks);
+
+#ifdef USE_PROBES
+  //The latency probes, one for each sensor read, whether or not the sensor is enabled (those never run are not sent).
+  enum probeIds : byte {PROBE_BME280, PROBE_DHT11, PROBE_DHT22, PROBE_DS18B20, PROBE_DS18B20RX, PROBE_ANALOG, PROBE_ADCSWEEP, PROBE_OUTPUT, PROBE_COUNT};
+  loftProbe probes[PROBE_COUNT];
+#endif
+
+void setup() {
   //Set up the heartbeat LED.
   pinMode(HB_LED, OUTPUT);
   digitalWrite(HB_LED, hbStatus);
@@ -277,177 +793,87 @@ void setup() {
     pinMode(POT_PIN, INPUT);
     randomSeed(analogRead(POT_PIN));
   #endif
+  //Restore the saved state, and find out if this is a warm start.
+  #ifdef USE_FASTSTART
+    loadState();
+  #endif
   //Start the serial console.
   Serial.begin(9600);
   while(!Serial); //Wait for the serial I/O to start.
-  delay(850);
+  if (!warmStart) {
+    delay(850);
+  }
   #ifndef PLOTDATA
     Serial.println();
     Serial.println(SCRIPT_NAME);
+    #ifdef USE_FASTSTART
+      showRestart();
+    #endif
     Serial.println();
-    delay(150);
+    if (!warmStart) {
+      delay(150);
+    }
   #endif
-  #ifndef SDEBUG
-    //Start the BME280 sensor.
-    #ifdef BME280_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("BME280 starting:"));
-      #endif
-      bme280_status = myBME280.begin(BME280_I2C_ADDRESS);
-      #ifndef PLOTDATA
-        Serial.print(FLASHSTR(" -> Status = "));
-        Serial.println(bme280_status);
-      #endif
-      if (!bme280_status) {
-        #ifndef PLOTDATA
-          Serial.println(FLASHSTR(" -> BME280 sensor not found - check the wiring or the I2C address!"));
-          Serial.println(FLASHSTR(" -> Code HALTed!"));
-        #endif
-        while(true) {
-          //ALERT! Rapidly flash the Heartbeat LED.
-          hbStatus = !hbStatus;
-          digitalWrite(HB_LED, hbStatus);
-          delay(loopDelayTime / 5);
-        }
-      }
-      //Set up the BME280 for forced mode reading.
-      myBME280.setSampling(Adafruit_BME280::MODE_FORCED,  //Force reading after delayTime.
-                           Adafruit_BME280::SAMPLING_X1,  //Temperature sampling set to 1.
-                           Adafruit_BME280::SAMPLING_X1,  //Pressure sampling set to 1.
-                           Adafruit_BME280::SAMPLING_X1,  //Humidity sampling set to 1.
-                           Adafruit_BME280::FILTER_OFF);  //Filter off - immediate 100% step response.
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> BME280 forced mode enabled."));
-        //Serial.println();
-      #endif
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the DHT11 sensors.
-    #ifdef DHT11_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("DHT11 starting:"));
-      #endif
-      myDHT11.begin();
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the DHT22 sensor.
-    #ifdef DHT22_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("DHT22 starting:"));
-      #endif
-      myDHT22.begin();
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the DS18B20 sensor.
-    #ifdef DS18B20_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("DS18B20 starting:"));
-      #endif
-      myDS18B20.begin();
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the KY013 sensor.
-    #ifdef KY013_ENABLED
-      //Start the KY013 sensor.
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("KY013 starting:"));
-      #endif
-      myKY013.setConsts(KY013_SAMPLES);
-      myKY013.setC123(C1_KY, C2_KY, C3_KY);
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the TMP36 sensor.
-    #ifdef TMP36_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("TMP36 starting:"));
-      #endif
-      myTMP36.setConsts(TMP36_SAMPLES, TMP36_SDELAY, TMP36_ADCRDYDLY, AVREF);
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the MF52D sensor.
-    #ifdef MF52D_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("MF52D starting:"));
-      #endif
-      myMF52D.setConsts(MF52D_SAMPLES);
-      myMF52D.setCBeta(CBETA_MF, NOMRST_MF, NOMTEMP_MF);
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-      #ifdef USEAVERAGETEMP
-        numTSensors++;
-      #endif
-    #endif
-    //Start the LDR sensor.
-    #ifdef LDR_ENABLED
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR("LDR starting:"));
-      #endif
-      myLDR.setConsts(LDR_SAMPLES);
-      #ifndef PLOTDATA
-        Serial.println(FLASHSTR(" -> OK"));
-      #endif
-    #endif
-    //Separator.
-    #ifndef PLOTDATA
-      Serial.println();
+  //Start the sensors.
+  sensors::begin();
+  #if !defined(SDEBUG) && !defined(PLOTDATA)
+    Serial.println(); //Separator.
+  #endif
+  //Test the LEDs, unless this is a warm start, when they show the restored band straight away.
+  if (!warmStart) {
+    ledTest();
+  }
+  else if (sensors::temperatures > 0) {
+    updateLEDS(alertTemperature);
+  }
+  //Send the plot column names, unless binary frames are being sent (the decoder adds them).
+  #ifdef PLOTDATA
+    #ifndef PLOTBINARY
+      sensors::printHeader(Serial);
+      Serial.println(FLASHSTR("Temperature-Band"));
     #endif
   #else
-    #ifdef USEAVERAGETEMP
-      #ifdef BME280_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef DHT11_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef DHT22_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef DS18B20_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef KY013_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef TMP36_ENABLED
-        numTSensors++;
-      #endif
-      #ifdef MF52D_ENABLED
-        numTSensors++;
-      #endif
+    Serial.println(); //Data block separator.
+  #endif
+  //Schedule the tasks. The sensors are read at staggered times, and well before the first data output.
+  scheduler.add(heartbeatTask, loopDelayTime, 0, 0, F("Heartbeat"));
+  scheduler.add(blinkTask, loopDelayTime, 0, 0, F("Band Blink"));
+  sensors::addTasks();
+  if (sensors::analogs > 0) {
+    scheduler.add(readAnalog, ANALOG_PERIOD, 50, 0, F("Analog"));
+    #if !defined(SDEBUG) && defined(USE_ADCGROUP)
+      adcPollTask = scheduler.add(pollADCGroup, ADCPOLL_PERIOD, 0, ADCPOLL_DEADLINE, F("ADC Sweep"));
+      scheduler.disable(adcPollTask);   //Enabled by readAnalog().
     #endif
+  }
+  if (sensors::temperatures > 0) {
+    scheduler.add(bandTask, BAND_PERIOD, outputStart / 2, 0, F("Band LEDs"));
+  }
+  #if defined(USE_PROBES)
+    scheduler.add(probeOutput, OUTPUT_PERIOD, outputStart, 0, F("Output"));
+  #elif defined(PLOTBINARY)
+    scheduler.add(sendFrame, OUTPUT_PERIOD, outputStart, 0, F("Output"));
+  #elif defined(PLOTSPARSE)
+    scheduler.add(sendSparse, OUTPUT_PERIOD, outputStart, 0, F("Output"));
+  #else
+    scheduler.add(outputTask, OUTPUT_PERIOD, outputStart, 0, F("Output"));
+  #endif
+  #ifdef USE_FASTSTART
+    scheduler.add(stateTask, STATE_PERIOD, STATE_PERIOD, 0, F("Save State"));
+  #endif
+  #ifdef USE_HISTORY
+    scheduler.add(commandTask, COMMAND_PERIOD, 0, 0, F("Commands"));
+  #endif
+  #ifdef USE_IDLESLEEP
+    scheduler.setIdleHook(idleSleep);
   #endif
-  //Test the LEDs.
+  #ifdef USE_WATCHDOG
+    wdt_enable(WATCHDOG_TIMEOUT);
+  #endif
+}
+
+//Light the LEDs one at a time, then turn them off one at a time.
+void ledTest() {
   #ifndef PLOTDATA
     Serial.println(FLASHSTR("LED Tests:"));
     Serial.print(FLASHSTR(" -> ON : R"));
@@ -499,636 +925,1314 @@ void setup() {
   #endif
     digitalWrite(WHITE_LED, LOW);
     delay(LED_TEST_DELAY);
-  //Send the plot column names.
-  #ifdef PLOTDATA
-    #ifdef BME280_ENABLED
-      Serial.print(FLASHSTR("Temperature(BME280)"));
-      Serial.print(DATADELIMITER);
-      Serial.print(FLASHSTR("Humidity(BME280)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef DHT11_ENABLED
-      Serial.print(FLASHSTR("Temperature(DHT11)"));
-      Serial.print(DATADELIMITER);
-      Serial.print(FLASHSTR("Humidity(DHT11)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef DHT22_ENABLED
-      Serial.print(FLASHSTR("Temperature(DHT22)"));
-      Serial.print(DATADELIMITER);
-      Serial.print(FLASHSTR("Humidity(DHT22)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef DS18B20_ENABLED
-      Serial.print(FLASHSTR("Temperature(DS18B20)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef KY013_ENABLED
-      Serial.print(FLASHSTR("Temperature(KY013)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef TMP36_ENABLED
-      Serial.print(FLASHSTR("Temperature(TMP36)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef MF52D_ENABLED
-      Serial.print(FLASHSTR("Temperature(MF52D)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    #ifdef LDR_ENABLED
-      Serial.print(FLASHSTR("Light-Level(LDR)"));
-      Serial.print(DATADELIMITER);
-    #endif
-    Serial.println(FLASHSTR("Temperature-Band"));
-  #else
-    Serial.println(); //Data block separator.
-  #endif
 }
 
 void loop() {
-  #ifdef BME280_ENABLED
-    float temperature_BME280;
+  //Run the next due task, or sleep until one is due, and then send as much of the queued output as the serial port will take,
+  //  and the next byte of a state save or history line, and tell the watchdog the loop is still running.
+  scheduler.run();
+  serialOut.drain();
+  #ifdef USE_FASTSTART
+    stateStore.drain();
   #endif
-  #ifdef DHT11_ENABLED
-    float temperature_DHT11;
-  #endif
-  #ifdef DHT22_ENABLED
-    float temperature_DHT22;
+  #ifdef USE_HISTORY
+    history.drain();
   #endif
-  #ifdef DS18B20_ENABLED
-    float temperature_DS18B20;
+  #ifdef USE_WATCHDOG
+    wdt_reset();
   #endif
-  #ifdef KY013_ENABLED
-    float temperature_KY013;
+}
+
+//Toggle the heartbeat LED.
+void heartbeatTask() {
+  hbStatus = !hbStatus;
+  digitalWrite(HB_LED, hbStatus);
+  #ifndef PLOTDATA
+    serialOut.print(FLASHSTR("."));    //Display dots while waiting for the next data output.
   #endif
-  #ifdef TMP36_ENABLED
-    float temperature_TMP36;
+}
+
+//Toggle the LEDs that blink in the current temperature band, e.g. the white LED in band 0 (ucold) and 7 (uhot).
+void blinkTask() {
+  uint16_t blinkPins = (ledBand < bandCount) ? bandBlink(bandTable, ledBand) : 0;
+  if (blinkPins != 0) {
+    blinkStatus = !blinkStatus;
+    bandWritePins(blinkStatus ? blinkPins : 0, blinkPins);
+  }
+}
+
+#ifdef USE_IDLESLEEP
+  //Sleep until the next interrupt. The Timer0 millis() interrupt wakes the MCU at least every 1.024ms.
+  void idleSleep(uint32_t msToNext) {
+    if (msToNext > 0) {
+      set_sleep_mode(SLEEP_MODE_IDLE);
+      sleep_mode();
+    }
+  }
+#endif
+
+//The BME280, DHT11, DHT22, DS18B20, KY013, TMP36, MF52D and LDR sensor adapters, and the fused temperature and fan adapters. The read tasks cache the sensor data for the output task.
+#ifdef BME280_ENABLED
+  #ifndef SDEBUG
+    Adafruit_BME280 bme280Sensor::device;     //The BME280 sensor, using the I2C interface, SCL = A5, SDA = A4.
   #endif
-  #ifdef MF52D_ENABLED
-    float temperature_MF52D;
+  float bme280Sensor::temperature = NAN;
+  float bme280Sensor::humidity = NAN;
+  uint8_t bme280Sensor::readings = 0;
+  #ifdef GETPRESSURE
+    float bme280Sensor::pressure = NAN;
   #endif
-  #ifdef USEAVERAGETEMP
-    float totalTemperature = 0.0;
+  #ifdef GETALTITUDE
+    float bme280Sensor::altitude = NAN;
   #endif
-  //Toggle the heartbeat LED.
-  hbStatus = !hbStatus;
-  digitalWrite(HB_LED, hbStatus);
-  //Toggle the white LED if the temperature band is 0 (ucold) or 7 (uhot).
-  if (temperatureBand == 0 or temperatureBand == 7) {
-    wlStatus = !wlStatus;
-    digitalWrite(WHITE_LED, wlStatus);
-  }
-  //Get the BME280, DHT11, DHT22, DS18B20, KY013, TMP36, MF52D and LDR sensor data.
-  if (--sampleCountDown <= 0) {
-    #ifndef PLOTDATA
-      Serial.println(); //Data block separator.
-    #endif
-    sampleCountDown = sampleEvery;
-    #ifdef SDEBUG
-      #ifdef BME280_ENABLED
-        char sensorNameBME280[] = "BME280";
-        temperature_BME280 = getPseudoTemp(sensorNameBME280);
-        getPseudoHumidity(sensorNameBME280);
-      #endif
-      #ifdef DHT11_ENABLED
-        char sensorNameDHT11[] = "DHT11";
-        temperature_DHT11 = getPseudoTemp(sensorNameDHT11);
-        getPseudoHumidity(sensorNameDHT11);
+
+  void bme280Sensor::begin() {
+    #ifndef SDEBUG
+      bool bme280_status;
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR("BME280 starting:"));
       #endif
-      #ifdef DHT22_ENABLED
-        char sensorNameDHT22[] = "DHT22";
-        temperature_DHT22 = getPseudoTemp(sensorNameDHT22);
-        getPseudoHumidity(sensorNameDHT22);
+      bme280_status = device.begin(BME280_I2C_ADDRESS);
+      #ifndef PLOTDATA
+        Serial.print(FLASHSTR(" -> Status = "));
+        Serial.println(bme280_status);
       #endif
-      #ifdef DS18B20_ENABLED
-        char sensorNameDS18B20[] = "DS18B20";
-        temperature_DS18B20 = getPseudoTemp(sensorNameDS18B20);
+      if (!bme280_status) {
+        #ifndef PLOTDATA
+          Serial.println(FLASHSTR(" -> BME280 sensor not found - check the wiring or the I2C address!"));
+          Serial.println(FLASHSTR(" -> Code HALTed!"));
+        #endif
+        while(true) {
+          //ALERT! Rapidly flash the Heartbeat LED.
+          hbStatus = !hbStatus;
+          digitalWrite(HB_LED, hbStatus);
+          delay(loopDelayTime / 5);
+        }
+      }
+      //Set up the BME280 for forced mode reading.
+      device.setSampling(Adafruit_BME280::MODE_FORCED,  //Force reading after delayTime.
+                         Adafruit_BME280::SAMPLING_X1,  //Temperature sampling set to 1.
+                         Adafruit_BME280::SAMPLING_X1,  //Pressure sampling set to 1.
+                         Adafruit_BME280::SAMPLING_X1,  //Humidity sampling set to 1.
+                         Adafruit_BME280::FILTER_OFF);  //Filter off - immediate 100% step response.
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR(" -> BME280 forced mode enabled."));
+        Serial.println(FLASHSTR(" -> OK"));
       #endif
-      #ifdef KY013_ENABLED
-        char sensorNameKY013[] = "KY013";
-        temperature_KY013 = getPseudoTemp(sensorNameKY013);
-      #endif
-      #ifdef TMP36_ENABLED
-        char sensorNameTMP36[] = "TMP36";
-        temperature_TMP36 = getPseudoTemp(sensorNameTMP36);
-      #endif
-      #ifdef MF52D_ENABLED
-        char sensorNameMF52D[] = "MF52D";
-        temperature_MF52D = getPseudoTemp(sensorNameMF52D);
-      #endif
-      #ifdef LDR_ENABLED
-        getPseudoLight();
-      #endif
-    #else
-      //Get the BME280 sensor data.
-      #ifdef BME280_ENABLED
-        temperature_BME280 = getBME280data();
-      #endif
-      //Get DHT11 sensor data.
-      #ifdef DHT11_ENABLED
-        temperature_DHT11 = getDHT11data();
-      #endif
-      //Get DHT22 sensor data.
-      #ifdef DHT22_ENABLED
-        temperature_DHT22 = getDHT22data();
-      #endif
-      //Get DS18B20 sensor data.
-      #ifdef DS18B20_ENABLED
-        temperature_DS18B20 = getDS18B20data();
-      #endif
-      //Get KY013 sensor data.
-      #ifdef KY013_ENABLED
-        temperature_KY013 = getKY013data();
-      #endif
-      //Get TMP36 sensor data.
-      #ifdef TMP36_ENABLED
-        temperature_TMP36 = getTMP36data();
-      #endif
-      //Get MF52D sensor data.
-      #ifdef MF52D_ENABLED
-        temperature_MF52D = getMF52Ddata();
-      #endif
-      //Get LDR sensor data.
-      #ifdef LDR_ENABLED
-        getLDRdata();
+    #endif
+  }
+
+  void bme280Sensor::addTasks() {
+    scheduler.add(read, BME280_PERIOD, 100, 0, F("BME280"));
+  }
+
+  void bme280Sensor::read() {
+    PROBE_START();
+    #ifndef SDEBUG
+      device.takeForcedMeasurement();         //Only needed in forced mode!
+      temperature = device.readTemperature();
+      humidity = device.readHumidity();
+      #ifdef GETPRESSURE
+        pressure = device.readPressure();
       #endif
-    #endif    
-    //Update the LED indicators, if possible.
-    #ifndef USEAVERAGETEMP
-      //Update with the first enabled temperature sensor, or not at all if none are enabled. 
-      #if defined(BME280_ENABLED)
-        updateLEDS(temperature_BME280);
-      #elif defined(DHT11_ENABLED)
-        updateLEDS(temperature_DHT11);
-      #elif defined(DHT22_ENABLED)
-        updateLEDS(temperature_DHT22);
-      #elif defined(DS18B20_ENABLED)
-        updateLEDS(temperature_DS18B20);
-      #elif defined(KY013_ENABLED)
-        updateLEDS(temperature_KY013);
-      #elif defined(TMP36_ENABLED)
-        updateLEDS(temperature_TMP36);
-      #elif defined(MF52D_ENABLED)
-        updateLEDS(temperature_MF52D);
+      #ifdef GETALTITUDE
+        altitude = device.readAltitude(SEALEVELPRESSURE_HPA);
       #endif
     #else
-      //Update with the average temperature across the enabled temperature sensors.
-      #ifdef BME280_ENABLED
-        totalTemperature += temperature_BME280;
-      #endif
-      #ifdef DHT11_ENABLED
-        totalTemperature += temperature_DHT11;
-      #endif
-      #ifdef DHT22_ENABLED
-        totalTemperature += temperature_DHT22;
-      #endif
-      #ifdef DS18B20_ENABLED
-        totalTemperature += temperature_DS18B20;
-      #endif
-      #ifdef KY013_ENABLED
-        totalTemperature += temperature_KY013;
-      #endif
-      #ifdef TMP36_ENABLED
-        totalTemperature += temperature_TMP36;
-      #endif
-      #ifdef MF52D_ENABLED
-        totalTemperature += temperature_MF52D;
-      #endif
-      #if defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED) || defined(DS18B20_ENABLED) || defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED)
-        updateLEDS(totalTemperature / numTSensors); //This will only be compiled if there is at least one temperature sensor enabled.
-      #endif
+      temperature = getPseudoTemp();
+      humidity = getPseudoHumidity();
     #endif
-    Serial.println();               //Blank line or new line after data display.
+    readings++;
+    PROBE_STOP(PROBE_BME280);
   }
-  else {
-    #ifndef PLOTDATA
-      Serial.print(FLASHSTR("."));  //Display dots while waiting for the next data read.
-    #endif
+
+  void bme280Sensor::printHeader(Print &out) {
+    out.print(FLASHSTR("Temperature(BME280)"));
+    out.print(DATADELIMITER);
+    out.print(FLASHSTR("Humidity(BME280)"));
+    out.print(DATADELIMITER);
   }
-  delay(loopDelayTime);
-}
 
-#ifndef SDEBUG
-  #ifdef BME280_ENABLED
-    float getBME280data() {
-      char sensorName[] = "BME280";
-      float temperature;
-      float humidity;
+  void bme280Sensor::show() {
+    char sensorName[] = "BME280";
+    showTemperature(sensorName, temperature);
+    showHumidity(sensorName, humidity);
+    #ifndef PLOTDATA
       #ifdef GETPRESSURE
-        float bmePressure;
+        serialOut.print(FLASHSTR("Pressure    (BME280)\t= "));
+        serialOut.printFixed(pressure / 100.0);
+        serialOut.println(FLASHSTR("hPa"));
       #endif
       #ifdef GETALTITUDE
-        float bmeAltitude;
+        serialOut.print(FLASHSTR("Altitude    (BME280)\t= "));
+        serialOut.printFixed(altitude);
+        serialOut.println(FLASHSTR("m"));
       #endif
-      myBME280.takeForcedMeasurement(); //Only needed in forced mode!
-      temperature = myBME280.readTemperature();
-      humidity = myBME280.readHumidity();
-      #ifdef GETPRESSURE
-        bmePressure = myBME280.readPressure();
+    #endif
+  }
+
+  void bme280Sensor::addFields(loftFrame &frame) {
+    frame.add(temperature);
+    frame.add(humidity);
+  }
+
+  float bme280Sensor::firstTemperature() {
+    return validTemperature(temperature);
+  }
+
+  void bme280Sensor::addTemperatures(float &total) {
+    total += validTemperature(temperature);
+  }
+
+  void bme280Sensor::fuse(loftFusion &fusion, uint8_t channel) {
+    fusion.update_P(channel, temperature, readings, &bme280Fusion);
+  }
+#endif
+
+#if defined(DHT11_ENABLED) || defined(DHT22_ENABLED)
+  #ifndef SDEBUG
+    template<uint8_t type> DHT dhtSensor<type>::device((type == DHT_TYPE11) ? DHT11_PIN : DHT22_PIN, type); //Default delay = 6, for a normal 16mhz Arduino.
+  #endif
+  template<uint8_t type> float dhtSensor<type>::temperature = NAN;
+  template<uint8_t type> float dhtSensor<type>::humidity = NAN;
+  template<uint8_t type> uint8_t dhtSensor<type>::readings = 0;
+
+  template<uint8_t type> void dhtSensor<type>::begin() {
+    #ifndef SDEBUG
+      #ifndef PLOTDATA
+        Serial.print(name());
+        Serial.println(FLASHSTR(" starting:"));
       #endif
-      #ifdef GETALTITUDE
-        bmeAltitude = myBME280.readAltitude(SEALEVELPRESSURE_HPA);
+      device.begin();
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR(" -> OK"));
       #endif
-        showTemperature(sensorName, temperature);
-        showHumidity(sensorName, humidity);
+    #endif
+  }
+
+  template<uint8_t type> void dhtSensor<type>::addTasks() {
+    if (type == DHT_TYPE11) {
+      scheduler.add(read, DHT11_PERIOD, 200, 0, name());
+    }
+    else {
+      scheduler.add(read, DHT22_PERIOD, 300, 0, name());
+    }
+  }
+
+  template<uint8_t type> void dhtSensor<type>::read() {
+    PROBE_START();
+    #ifndef SDEBUG
+      temperature = device.readTemperature();
+      humidity = device.readHumidity();
+    #else
+      temperature = getPseudoTemp();
+      humidity = getPseudoHumidity();
+    #endif
+    readings++;
+    PROBE_STOP((type == DHT_TYPE11) ? PROBE_DHT11 : PROBE_DHT22);
+  }
+
+  template<uint8_t type> void dhtSensor<type>::printHeader(Print &out) {
+    out.print(FLASHSTR("Temperature("));
+    out.print(name());
+    out.print(FLASHSTR(")"));
+    out.print(DATADELIMITER);
+    out.print(FLASHSTR("Humidity("));
+    out.print(name());
+    out.print(FLASHSTR(")"));
+    out.print(DATADELIMITER);
+  }
+
+  template<uint8_t type> void dhtSensor<type>::show() {
+    char sensorName[] = "DHTnn";
+    sensorName[3] = '0' + (type / 10);
+    sensorName[4] = '0' + (type % 10);
+    //Check if the DHT11/DHT22 data read failed.
+    if (isnan(temperature) || isnan(humidity)) {
       #ifndef PLOTDATA
-        #ifdef GETPRESSURE
-          Serial.print(FLASHSTR("Pressure    (BME280)\t= "));
-          Serial.print(bmePressure / 100.0);
-          Serial.println(FLASHSTR("hPa"));
-        #endif
-        #ifdef GETALTITUDE
-          Serial.print(FLASHSTR("Altitude    (BME280)\t= "));
-          Serial.print(bmeAltitude);
-          Serial.println(FLASHSTR("m"));
-        #endif
+        serialOut.print(FLASHSTR("Failed to read data from the "));
+        serialOut.print(sensorName);
+        serialOut.println(FLASHSTR(" sensor!"));
+      #else
+        spPlotData(0.0);
+        spPlotData(0.0);
       #endif
-      return temperature;
     }
-  #endif
-  
-  #if defined(DHT11_ENABLED)
-    float getDHT11data() {
-      char sensorName[] = "DHT11";
-      float temperature;
-      float humidity;
-      temperature = myDHT11.readTemperature();
-      humidity = myDHT11.readHumidity();
-      sendDHT1122data(sensorName, temperature, humidity);
-      return temperature;
+    else {
+      showTemperature(sensorName, temperature);
+      showHumidity(sensorName, humidity);
     }
-  #endif
-  
-  #if defined(DHT22_ENABLED)
-    float getDHT22data() {
-      char sensorName[] = "DHT22";
-      float temperature;
-      float humidity;
-      temperature = myDHT22.readTemperature();
-      humidity = myDHT22.readHumidity();
-      sendDHT1122data(sensorName, temperature, humidity);
-      return temperature;
+  }
+
+  //A failed reading is sent as 0.0, as in the CSV.
+  template<uint8_t type> void dhtSensor<type>::addFields(loftFrame &frame) {
+    if (isnan(temperature) || isnan(humidity)) {
+      frame.add(0.0);
+      frame.add(0.0);
     }
+    else {
+      frame.add(temperature);
+      frame.add(humidity);
+    }
+  }
+
+  template<uint8_t type> float dhtSensor<type>::firstTemperature() {
+    return validTemperature(temperature);
+  }
+
+  template<uint8_t type> void dhtSensor<type>::addTemperatures(float &total) {
+    total += validTemperature(temperature);
+  }
+
+  template<uint8_t type> void dhtSensor<type>::fuse(loftFusion &fusion, uint8_t channel) {
+    fusion.update_P(channel, temperature, readings, (type == DHT_TYPE11) ? &dht11Fusion : &dht22Fusion);
+  }
+
+  template<uint8_t type> const __FlashStringHelper *dhtSensor<type>::name() {
+    return (type == DHT_TYPE11) ? F("DHT11") : F("DHT22");
+  }
+#endif
+
+#ifdef DS18B20_ENABLED
+  #ifndef SDEBUG
+    OneWire ds18b20Sensor::bus(DS18B20_PIN);  //The OneWire bus the DS18B20 probes are on.
+    DallasTemperature ds18b20Sensor::device(&ds18b20Sensor::bus);
+    DeviceAddress ds18b20Sensor::address[DS18B20_PROBES];
+    bool ds18b20Sensor::found[DS18B20_PROBES];
+    uint16_t ds18b20Sensor::convTime;
   #endif
-  
-  #if defined(DHT11_ENABLED) || defined(DHT22_ENABLED)
-    void sendDHT1122data(char *sensorName, float temperature, float humidity) {
-      //Check if any DHT11/DHT22 data reads failed.
-      if (isnan(temperature) || isnan(humidity)) {
-        temperature = 0.0;
-        humidity = 0.0;
-        #ifndef PLOTDATA
-          Serial.print(FLASHSTR("Failed to read data from the "));
-          Serial.print(sensorName);
-          Serial.println(FLASHSTR(" sensor!"));
-        #else
-          spPlotData(temperature);
-          spPlotData(humidity);
-        #endif
+  float ds18b20Sensor::temperature[DS18B20_PROBES];
+  uint8_t ds18b20Sensor::readings = 0;
+  int8_t ds18b20Sensor::collectTask;
+
+  void ds18b20Sensor::begin() {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      temperature[probe] = DEVICE_DISCONNECTED_C;
+    }
+    #ifndef SDEBUG
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR("DS18B20 starting:"));
+      #endif
+      device.begin();
+      //Find the probe addresses once, so no bus search is needed for each reading.
+      for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+        found[probe] = device.getAddress(address[probe], probe);
       }
-      else {
-        showTemperature(sensorName, temperature);
-        showHumidity(sensorName, humidity);
+      //Start conversions without waiting for them, the results are collected by a later task.
+      device.setWaitForConversion(false);
+      convTime = device.millisToWaitForConversion(device.getResolution());
+      #ifndef PLOTDATA
+        Serial.print(FLASHSTR(" -> Probes found = "));
+        Serial.print(device.getDeviceCount());
+        Serial.print(FLASHSTR(" of "));
+        Serial.println(DS18B20_PROBES);
+        Serial.println(FLASHSTR(" -> OK"));
+      #endif
+    #endif
+  }
+
+  void ds18b20Sensor::addTasks() {
+    scheduler.add(read, DS18B20_PERIOD, 400, 0, F("DS18B20"));
+    collectTask = scheduler.add(collect, 0, 0, 0, F("DS18B20 Rx"));
+    scheduler.disable(collectTask);           //Enabled by read().
+  }
+
+  //Start a temperature conversion on all the probes together, and collect the results when the conversion is done.
+  void ds18b20Sensor::read() {
+    PROBE_START();
+    #ifndef SDEBUG
+      device.requestTemperatures();           //Send the command to get the temperatures, without waiting.
+      scheduler.enable(collectTask, convTime);
+    #else
+      scheduler.enable(collectTask);
+    #endif
+    PROBE_STOP(PROBE_DS18B20);
+  }
+
+  void ds18b20Sensor::collect() {
+    PROBE_START();
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      #ifndef SDEBUG
+        if (found[probe]) {
+          temperature[probe] = device.getTempC(address[probe]); //Read the probe by its address, no bus search.
+        }
+        else {
+          temperature[probe] = DEVICE_DISCONNECTED_C;
+        }
+      #else
+        temperature[probe] = getPseudoTemp();
+      #endif
+    }
+    readings++;
+    PROBE_STOP(PROBE_DS18B20RX);
+  }
+
+  void ds18b20Sensor::printHeader(Print &out) {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      out.print(FLASHSTR("Temperature(DS18B20"));
+      if (probe > 0) {
+        out.print(FLASHSTR("-"));
+        out.print(probe + 1);
       }
+      out.print(FLASHSTR(")"));
+      out.print(DATADELIMITER);
     }
-  #endif
-  
-  #ifdef DS18B20_ENABLED
-    float getDS18B20data() {
-      char sensorName[] = "DS18B20";
-      float temperature;
-      myDS18B20.requestTemperatures();            //Send the command to get the temperature.
-      temperature = myDS18B20.getTempCByIndex(0); //Get the temperature from the first sensor on the bus.
+  }
+
+  void ds18b20Sensor::show() {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      char sensorName[] = "DS18B20-n";
+      //Name the probes DS18B20, DS18B20-2, DS18B20-3...
+      if (probe > 0) {
+        sensorName[8] = '1' + probe;
+      }
+      else {
+        sensorName[7] = '\0';
+      }
       //Check if the DS18B20 data read failed.
-      if (temperature == DEVICE_DISCONNECTED_C) {
-        temperature = 0.0;
+      if (temperature[probe] == DEVICE_DISCONNECTED_C) {
         #ifndef PLOTDATA
-          Serial.println(FLASHSTR("Failed to read data from the DS18B20 sensor!"));
+          serialOut.print(FLASHSTR("Failed to read data from the "));
+          serialOut.print(sensorName);
+          serialOut.println(FLASHSTR(" sensor!"));
         #else
-          spPlotData(temperature);
+          spPlotData(0.0);
         #endif
       }
       else {
-        showTemperature(sensorName, temperature);
+        showTemperature(sensorName, temperature[probe]);
       }
-      return temperature;
     }
-  #endif
-  
-  #ifdef KY013_ENABLED
-    float getKY013data() {
-      char sensorName[] = "KY013";
-      float temperature = myKY013.readTemperatureC();
-      showTemperature(sensorName, temperature);
-      return temperature;
+  }
+
+  //A failed reading is sent as 0.0, as in the CSV.
+  void ds18b20Sensor::addFields(loftFrame &frame) {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      frame.add((temperature[probe] == DEVICE_DISCONNECTED_C) ? 0.0 : temperature[probe]);
     }
-  #endif
-  
-  #ifdef TMP36_ENABLED
-    float getTMP36data() {
-      char sensorName[] = "TMP36";
-      float temperature = myTMP36.readTemperatureC();
-      showTemperature(sensorName, temperature);
-      return temperature;
+  }
+
+  float ds18b20Sensor::firstTemperature() {
+    return validTemperature(temperature[0]);
+  }
+
+  void ds18b20Sensor::addTemperatures(float &total) {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      total += validTemperature(temperature[probe]);
     }
-  #endif
-  
-  #ifdef MF52D_ENABLED
-    float getMF52Ddata() {
-      char sensorName[] = "MF52D";
-      float temperature = myMF52D.readTemperatureC();
-      showTemperature(sensorName, temperature);
-      return temperature;
+  }
+
+  void ds18b20Sensor::fuse(loftFusion &fusion, uint8_t channel) {
+    for (byte probe = 0; probe < DS18B20_PROBES; probe++) {
+      fusion.update_P(channel + probe, temperature[probe], readings, &ds18b20Fusion);
     }
-  #endif
-  
-  #ifdef LDR_ENABLED
-    void getLDRdata() {
-      unsigned int lightLevel;
-      lightLevel = myLDR.readADC();
+  }
+#endif
+
+#if defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED)
+  template<typename deviceType, uint16_t bit> float alogTSensor<deviceType, bit>::temperature = NAN;
+  template<typename deviceType, uint16_t bit> uint8_t alogTSensor<deviceType, bit>::readings = 0;
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::begin() {
+    #ifndef SDEBUG
       #ifndef PLOTDATA
-        Serial.print(FLASHSTR("Light Level (LDR)\t= "));
-        Serial.println(lightLevel);
-      #else
-        Serial.print(lightLevel);
-        Serial.print(DATADELIMITER);    
+        Serial.print(name());
+        Serial.println(FLASHSTR(" starting:"));
       #endif
-    }
-  #endif
+      setUp();
+      #ifdef USE_ADAPTIVEADC
+        device.setAdaptive(ADC_MINSAMPLES, ADC_MAXSTDERR);
+      #endif
+      #ifdef USE_ADCGROUP
+        adcGroup.add(device);
+      #endif
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR(" -> OK"));
+      #endif
+    #endif
+  }
 
-#else
-  #if defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED) || defined(DS18B20_ENABLED) || defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED)
-    float getPseudoTemp(char *sensorName) {
-      unsigned int potVal;
-      float randDelta;
-      float temperature;
-      //Read the potentiometer value and convert it to a pseudo temperature.
-      potVal = analogRead(POT_PIN);
-      randDelta = random(-999, 999) / 1000.0;             //Get some randomness into the mix.
-      temperature = ((potVal / 10.0) - 30.0) + randDelta; //Gives fractional results too.
-      showTemperature(sensorName, temperature);
-      return temperature;
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::readAnalog() {
+    #ifndef SDEBUG
+      temperature = device.readTemperatureC();
+    #else
+      temperature = getPseudoTemp();
+    #endif
+    readings++;
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::collectAnalog() {
+    #ifndef SDEBUG
+      temperature = device.readTemperatureC(device.result());
+    #endif
+    readings++;
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::printHeader(Print &out) {
+    out.print(FLASHSTR("Temperature("));
+    out.print(name());
+    out.print(FLASHSTR(")"));
+    out.print(DATADELIMITER);
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::show() {
+    char sensorName[6];
+    strcpy_P(sensorName, (PGM_P)name());
+    showTemperature(sensorName, temperature);
+    #if defined(USE_ADAPTIVEADC) && !defined(PLOTDATA) && !defined(SDEBUG)
+      showSamplesUsed(device);
+    #endif
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::addFields(loftFrame &frame) {
+    frame.add(temperature);
+  }
+
+  template<typename deviceType, uint16_t bit> float alogTSensor<deviceType, bit>::firstTemperature() {
+    return validTemperature(temperature);
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::addTemperatures(float &total) {
+    total += validTemperature(temperature);
+  }
+
+  template<typename deviceType, uint16_t bit> void alogTSensor<deviceType, bit>::fuse(loftFusion &fusion, uint8_t channel) {
+    fusion.update_P(channel, temperature, readings, (bit == LFM_KY013) ? &ky013Fusion : (bit == LFM_TMP36) ? &tmp36Fusion : &mf52dFusion);
+  }
+
+  template<typename deviceType, uint16_t bit> const __FlashStringHelper *alogTSensor<deviceType, bit>::name() {
+    return (bit == LFM_KY013) ? F("KY013") : (bit == LFM_TMP36) ? F("TMP36") : F("MF52D");
+  }
+#endif
+
+#if defined(KY013_ENABLED) && !defined(SDEBUG)
+  template<> KY013 ky013Sensor::device(KY013_PIN, KY013R1); //The balance resistor is R1.
+
+  template<> void ky013Sensor::setUp() {
+    device.setConsts(KY013_SAMPLES);
+    device.setC123(C1_KY, C2_KY, C3_KY);
+    #ifdef USE_TEMPLUT
+      device.setLUT(ky013LUT);
+    #endif
+  }
+#endif
+
+#if defined(TMP36_ENABLED) && !defined(SDEBUG)
+  template<> TMP36 tmp36Sensor::device(TMP36_PIN); //This sensor does not use a balance resistor.
+
+  template<> void tmp36Sensor::setUp() {
+    device.setConsts(TMP36_SAMPLES, TMP36_SDELAY, TMP36_ADCRDYDLY, AVREF);
+  }
+#endif
+
+#if defined(MF52D_ENABLED) && !defined(SDEBUG)
+  template<> MF52D mf52dSensor::device(MF52D_PIN, MF52DR1); //The balance resistor is R1.
+
+  template<> void mf52dSensor::setUp() {
+    device.setConsts(MF52D_SAMPLES);
+    device.setCBeta(CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+    #ifdef USE_TEMPLUT
+      device.setLUT(mf52dLUT);
+    #endif
+  }
+#endif
+
+#ifdef USEFUSEDTEMP
+  fusionChannel fusedSensor::channels[(sensors::temperatures > 0) ? sensors::temperatures : 1];
+  loftFusion fusedSensor::fusion(fusedSensor::channels, sensors::temperatures);
+  uint32_t fusedSensor::lastUpdate = 0;
+
+  void fusedSensor::begin() {
+    fusion.setLimits(FUSION_PROCESS, FUSION_GATE, FUSION_STUCKDELTA, FUSION_OFFSETGAIN, FUSION_TIMEOUT);
+    lastUpdate = millis();
+  }
+
+  void fusedSensor::addTasks() {
+    if (sensors::temperatures > 0) {
+      scheduler.add(update, FUSION_PERIOD, outputStart / 2 - 100, 0, F("Fusion"));
     }
-  #endif
+  }
 
-  #if defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED)
-    void getPseudoHumidity(char *sensorName) {
-      unsigned int potVal;
-      signed char randDelta;
-      float humidity;
-      //Read the potentiometer value and convert it to a pseudo humidity.
-      potVal = analogRead(POT_PIN);
-      randDelta = random(-99, 99);                                          //Get some randomness into the mix.
-      humidity = (map(potVal, 0, ADCMAXVALUE, 99, 901) + randDelta) / 10.0; //Gives fractional results too.
-      showHumidity(sensorName, humidity);
-     }
+  //Move the fused temperature on to now, and correct it with every new reading since the last update.
+  void fusedSensor::update() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate;
+    lastUpdate = now;
+    fusion.predict((elapsed > 0xFFFF) ? 0xFFFF : elapsed);
+    sensors::fuse(fusion);
+  }
+
+  void fusedSensor::printHeader(Print &out) {
+    out.print(FLASHSTR("Temperature(Fused)"));
+    out.print(DATADELIMITER);
+  }
+
+  void fusedSensor::show() {
+    char sensorName[] = "Fused";
+    showTemperature(sensorName, fusion.temperature());
+    #ifndef PLOTDATA
+      serialOut.print(FLASHSTR(" -> Uncertainty\t= "));
+      serialOut.printFixed(fusion.uncertainty());
+      serialOut.print(FLASHSTR("\xC2\xB0"));
+      serialOut.println(FLASHSTR("C"));
+      serialOut.print(FLASHSTR(" -> Readings used\t= "));
+      serialOut.print(fusion.used());
+      serialOut.print(FLASHSTR(" of "));
+      serialOut.println(fusion.count());
+    #endif
+  }
+
+  void fusedSensor::addFields(loftFrame &frame) {
+    frame.add(fusion.temperature());
+  }
+#endif
+
+#ifdef LDR_ENABLED
+  #ifndef SDEBUG
+    vDivider ldrSensor::device(LDR_PIN, LDRR2, false); //The balance resistor is R2 (not R1).
   #endif
+  unsigned int ldrSensor::lightLevel = 0;
 
-  #ifdef LDR_ENABLED
-    void getPseudoLight() {
-      unsigned int potVal;
-      signed char randDelta;
-      unsigned int lightLevel;
-      //Read the potentiometer value and convert it to a pseudo light level.
-      potVal = analogRead(POT_PIN);
-      randDelta = random(-9, 9);                                      //Get some randomness into the mix.
-      lightLevel = map(potVal, 0, ADCMAXVALUE, 109, 891) + randDelta; //Restrict the range (100 - 900) much like an LDC does.
+  void ldrSensor::begin() {
+    #ifndef SDEBUG
       #ifndef PLOTDATA
-        Serial.print(FLASHSTR("Light Level (LDR)\t= "));
-        Serial.println(lightLevel);
-      #else
-        Serial.print(lightLevel);
-        Serial.print(DATADELIMITER);    
+        Serial.println(FLASHSTR("LDR starting:"));
       #endif
-    }
-  #endif
-#endif
+      device.setConsts(LDR_SAMPLES);
+      #ifdef USE_ADAPTIVEADC
+        device.setAdaptive(ADC_MINSAMPLES, ADC_MAXSTDERR);
+      #endif
+      #ifdef USE_ADCGROUP
+        adcGroup.add(device);
+      #endif
+      #ifndef PLOTDATA
+        Serial.println(FLASHSTR(" -> OK"));
+      #endif
+    #endif
+  }
 
-#if defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED) || defined(DS18B20_ENABLED) || defined(KY013_ENABLED) || defined(TMP36_ENABLED) || defined(MF52D_ENABLED)
-  void showTemperature(char *sensorName, float temperature) {
-    #ifndef PLOTDATA
-      Serial.print(FLASHSTR("Temperature ("));
-      Serial.print(sensorName);
-      Serial.print(FLASHSTR(")\t= "));
-      Serial.print(temperature);
-      Serial.print(FLASHSTR("\xC2\xB0"));
-      Serial.println(FLASHSTR("C"));
+  void ldrSensor::readAnalog() {
+    #ifndef SDEBUG
+      lightLevel = device.readADC();
     #else
-      spPlotData(temperature);
+      lightLevel = getPseudoLight();
     #endif
   }
-#endif
 
-#if defined(BME280_ENABLED) || defined(DHT11_ENABLED) || defined(DHT22_ENABLED)
-void showHumidity(char *sensorName, float humidity) {
+  void ldrSensor::collectAnalog() {
+    #ifndef SDEBUG
+      lightLevel = device.result();
+    #endif
+  }
+
+  void ldrSensor::printHeader(Print &out) {
+    out.print(FLASHSTR("Light-Level(LDR)"));
+    out.print(DATADELIMITER);
+  }
+
+  void ldrSensor::show() {
     #ifndef PLOTDATA
-      Serial.print(FLASHSTR("Humidity    ("));
-      Serial.print(sensorName);
-      Serial.print(FLASHSTR(")\t= "));
-      Serial.print(humidity);
-      Serial.println(FLASHSTR("%"));
+      serialOut.print(FLASHSTR("Light Level (LDR)\t= "));
+      serialOut.printUnsigned(lightLevel);
+      serialOut.println();
+      #if defined(USE_ADAPTIVEADC) && !defined(SDEBUG)
+        showSamplesUsed(device);
+      #endif
     #else
-      spPlotData(humidity);
+      serialOut.printUnsigned(lightLevel);
+      serialOut.print(DATADELIMITER);
     #endif
   }
-#endif
 
-#ifdef PLOTDATA
-  void spPlotData(float sensorReading) {
-      Serial.print(sensorReading);
-      Serial.print(DATADELIMITER);    
+  void ldrSensor::addFields(loftFrame &frame) {
+    frame.addInt(lightLevel);
   }
 #endif
 
-void updateLEDS(float temperature) {
-  //Band transition variables.
-  float uhot_band;    //Temperature band 7.
-  float vhot_band;    //Temperature band 6.
-  float red_band;     //Temperature band 5.
-  float yellow_band;  //Temperature band 4.
-  float green_band;   //Temperature band 3.
-  float blue_band;    //Temperature band 2.
-  float vcold_band;   //Temperature band 1.
-  //float ucold_band;   //Temperature band 0. Variable not actually needed.
-  //Hysteresis - adjust the band thresholds dependant upon the current temperature band.
-  if (temperatureBand == 7) {       //If we are currently in the uhot band.
-    uhot_band = UHOT_BAND - BAND_HYSTERESIS;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 6) {  //If we are currently in the vhot band.
-    uhot_band = UHOT_BAND + BAND_HYSTERESIS;
-    vhot_band = VHOT_BAND - BAND_HYSTERESIS;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 5) {  //If we are currently in the red band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND + BAND_HYSTERESIS;
-    red_band = RED_BAND - BAND_HYSTERESIS;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 4) {  //If we are currently in the yellow band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND + BAND_HYSTERESIS;
-    yellow_band = YELLOW_BAND - BAND_HYSTERESIS;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 3) {  //If we are currently in the green band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND + BAND_HYSTERESIS;
-    green_band = GREEN_BAND - BAND_HYSTERESIS;
-    blue_band = BLUE_BAND;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 2) {  //If we are currently in the blue band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND + BAND_HYSTERESIS;
-    blue_band = BLUE_BAND - BAND_HYSTERESIS;
-    vcold_band = VCOLD_BAND;
-    //ucold_band = UCOLD_BAND;
-  }
-  else if (temperatureBand == 1) {  //If we are currently in the vcold band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND + BAND_HYSTERESIS;    
-    vcold_band = VCOLD_BAND - BAND_HYSTERESIS;
-    //ucold_band = UCOLD_BAND;
-  }
-  else {                            //We must currently be in the ucold band.
-    uhot_band = UHOT_BAND;
-    vhot_band = VHOT_BAND;
-    red_band = RED_BAND;
-    yellow_band = YELLOW_BAND;
-    green_band = GREEN_BAND;
-    blue_band = BLUE_BAND;    
-    vcold_band = VCOLD_BAND + BAND_HYSTERESIS;
-    //ucold_band = UCOLD_BAND;
-  }
-//Work out the new temperature band.
-  #ifndef PLOTDATA
-    Serial.print(FLASHSTR("Alert Temperature\t: "));
-    Serial.print(temperature);
-    Serial.print(FLASHSTR("\xC2\xB0"));
-    Serial.println(FLASHSTR("C"));
-    Serial.print(FLASHSTR("!LED Alert Level!\t: "));
-  #endif
-  if (temperature >= uhot_band) {
-    temperatureBand = 7;
-    digitalWrite(RED_LED, HIGH);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, LOW);
-    digitalWrite(WHITE_LED, HIGH);  //This LED will be flashed!
+#ifdef FAN_ENABLED
+  fanController fanOutput::controller;
+  uint32_t fanOutput::lastUpdate = 0;
+
+  void fanOutput::begin() {
     #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<Inferno!>"));
+      Serial.println(FLASHSTR("Fan starting:"));
     #endif
-  }
-  else if (temperature >= vhot_band and temperature < uhot_band) {
-    temperatureBand = 6;
-    digitalWrite(RED_LED, HIGH);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, LOW);
-    digitalWrite(WHITE_LED, HIGH);
+    pinMode(FAN_PIN, OUTPUT);
+    analogWrite(FAN_PIN, 0);
+    controller.setCurve(fanCurve, sizeof(fanCurve) / sizeof(fanCurve[0]));
+    controller.setPID(FAN_SETPOINT, FAN_KP, FAN_KI, FAN_KD);
+    controller.setFeedForward(FAN_FEEDFORWARD, FAN_RATETIME);
+    controller.setLimits(FAN_MINDUTY, FAN_MAXDUTY, FAN_KICKTIME);
+    #ifdef FAN_USEPID
+      controller.usePID();
+    #endif
+    lastUpdate = millis();
     #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<Melting!>"));
+      #ifdef FAN_USEPID
+        Serial.print(FLASHSTR(" -> PID control, setpoint = "));
+        Serial.print(FAN_SETPOINT);
+        Serial.print(FLASHSTR("\xC2\xB0"));
+        Serial.println(FLASHSTR("C"));
+      #else
+        Serial.println(FLASHSTR(" -> Fan curve control."));
+      #endif
+      Serial.println(FLASHSTR(" -> OK"));
     #endif
   }
-  else if (temperature >= red_band and temperature < vhot_band) {
-    temperatureBand = 5;
-    digitalWrite(RED_LED, HIGH);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, LOW);
-    digitalWrite(WHITE_LED, LOW);
-    #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<RED>"));
+
+  void fanOutput::addTasks() {
+    if (sensors::temperatures > 0) {
+      scheduler.add(update, FAN_PERIOD, outputStart / 2, 0, F("Fan"));
+    }
+  }
+
+  //Work out the new fan duty from the latest cached temperatures, and set the PWM output.
+  void fanOutput::update() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate;
+    lastUpdate = now;
+    #ifdef FAN_SENSOR
+      float temperature = FAN_SENSOR::firstTemperature();
+    #else
+      float temperature = loftTemperature();
     #endif
+    uint8_t duty = controller.update(temperature, (elapsed > 0xFFFF) ? 0xFFFF : elapsed);
+    analogWrite(FAN_PIN, ((uint16_t)duty * 255) / 100);
   }
-  else if (temperature >= yellow_band and temperature < red_band) {
-    temperatureBand = 4;
-    digitalWrite(RED_LED, LOW);
-    digitalWrite(YELLOW_LED, HIGH);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, LOW);
-    digitalWrite(WHITE_LED, LOW);
+
+  void fanOutput::printHeader(Print &out) {
+    out.print(FLASHSTR("Fan-Duty(PWM)"));
+    out.print(DATADELIMITER);
+  }
+
+  void fanOutput::show() {
     #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<YELLOW>"));
+      serialOut.print(FLASHSTR("Fan Duty    (PWM)\t= "));
+      serialOut.printUnsigned(controller.duty());
+      serialOut.println(FLASHSTR("%"));
+      serialOut.print(FLASHSTR(" -> Rate of change\t= "));
+      serialOut.printFixed(controller.rate());
+      serialOut.print(FLASHSTR("\xC2\xB0"));
+      serialOut.println(FLASHSTR("C/min"));
+    #else
+      serialOut.printUnsigned(controller.duty());
+      serialOut.print(DATADELIMITER);
     #endif
   }
-  else if (temperature >= green_band and temperature < yellow_band) {
-    temperatureBand = 3;
-    digitalWrite(RED_LED, LOW);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, HIGH);
-    digitalWrite(BLUE_LED, LOW);
-    digitalWrite(WHITE_LED, LOW);
+
+  void fanOutput::addFields(loftFrame &frame) {
+    frame.addInt(controller.duty());
+  }
+#endif
+
+#ifdef USE_FORECAST
+  loftForecast forecastOutput::forecast(FORECAST_WINDOW, FORECAST_MINSLOPE);
+  uint32_t forecastOutput::lastUpdate = 0;
+
+  void forecastOutput::begin() {
+    lastUpdate = millis();
+  }
+
+  void forecastOutput::addTasks() {
+    if (sensors::temperatures > 0) {
+      scheduler.add(update, FORECAST_PERIOD, outputStart / 2 + 100, 0, F("Forecast"));
+    }
+  }
+
+  //Add the band LED temperature to the trend, and check whether it will reach FORECAST_BAND within FORECAST_HORIZON.
+  void forecastOutput::update() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastUpdate;
+    lastUpdate = now;
+    forecast.add(loftTemperature(), (elapsed > 0xFFFF) ? 0xFFFF : elapsed);
+    bool wasAlert = forecast.alert();
+    if (forecast.checkAlert(bandThreshold(bandTable, FORECAST_BAND), FORECAST_HORIZON) && !wasAlert) {
+      #ifndef PLOTDATA
+        //Warn straight away, not at the next data output.
+        serialOut.println();
+        showPreAlert();
+      #endif
+    }
+  }
+
+  //The forecast minutes until FORECAST_BAND is reached, 0 if it has been, or FORECAST_NEVER.
+  uint16_t forecastOutput::minutesToAlert() {
+    return forecast.minutesTo(bandThreshold(bandTable, FORECAST_BAND)) + 0.5;
+  }
+
+  void forecastOutput::showPreAlert() {
+    serialOut.print(FLASHSTR("!Pre-Alert!\t\t: "));
+    serialOut.print(bandLabel(bandTable, FORECAST_BAND));
+    serialOut.print(FLASHSTR(" in "));
+    serialOut.printUnsigned(minutesToAlert());
+    serialOut.println(FLASHSTR(" min"));
+  }
+
+  void forecastOutput::printHeader(Print &out) {
+    out.print(FLASHSTR("Minutes-To-Alert"));
+    out.print(DATADELIMITER);
+  }
+
+  void forecastOutput::show() {
     #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<GREEN>"));
+      serialOut.print(FLASHSTR("Temperature Trend\t= "));
+      serialOut.printFixed(forecast.ready() ? forecast.slope() * 60.0 : NAN);
+      serialOut.print(FLASHSTR("\xC2\xB0"));
+      serialOut.println(FLASHSTR("C/hour"));
+      //The time to each hotter band that the trend will reach.
+      for (uint8_t band = temperatureBand + 1; band < bandCount; band++) {
+        float minutes = forecast.minutesTo(bandThreshold(bandTable, band));
+        if (minutes < FORECAST_NEVER) {
+          serialOut.print(FLASHSTR(" -> "));
+          serialOut.print(bandLabel(bandTable, band));
+          serialOut.print(FLASHSTR(" in\t= "));
+          serialOut.printUnsigned(minutes + 0.5);
+          serialOut.println(FLASHSTR(" min"));
+        }
+      }
+      if (forecast.alert() && (temperatureBand < FORECAST_BAND)) {
+        showPreAlert();
+      }
+    #else
+      serialOut.printUnsigned(minutesToAlert());
+      serialOut.print(DATADELIMITER);
     #endif
   }
-  else if (temperature >= blue_band and temperature < green_band) {
-    temperatureBand = 2;
-    digitalWrite(RED_LED, LOW);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, HIGH);
-    digitalWrite(WHITE_LED, LOW);
-    #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<BLUE>"));
+
+  void forecastOutput::addFields(loftFrame &frame) {
+    frame.addInt(minutesToAlert());
+  }
+#endif
+
+//Read the KY013, TMP36, MF52D & LDR sensors.
+void readAnalog() {
+  PROBE_START();
+  #if !defined(SDEBUG) && defined(USE_ADCGROUP)
+    //Start a sweep of all the analog sensors together, and collect it without waiting.
+    if (adcGroup.startSampling()) {
+      scheduler.enable(adcPollTask);
+    }
+  #else
+    sensors::readAnalog();
+  #endif
+  PROBE_STOP(PROBE_ANALOG);
+}
+
+#if !defined(SDEBUG) && defined(USE_ADCGROUP)
+  //Take the next round of samples from the analog sweep, and when it is done, convert the ADC values.
+  void pollADCGroup() {
+    PROBE_START();
+    if (adcGroup.isReady()) {
+      sensors::collectAnalog();
+      scheduler.disable(adcPollTask);
+    }
+    PROBE_STOP(PROBE_ADCSWEEP);
+  }
+#endif
+
+#ifdef USE_FASTSTART
+  //Restore the saved state, and count this start. After a warm start the band, and the trend, carry on from it.
+  void loadState() {
+    uint8_t flags = loftResetFlags();
+    bool saved = stateStore.load(&state);
+    if (!saved) {
+      state.band = 0xFF;                      //No band yet, so none is restored until one has been worked out.
+    }
+    if (saved && (flags != 0) && !(flags & _BV(PORF)) && (state.band < bandCount)) {
+      warmStart = true;
+      outputStart = FASTSTART_OUTPUT;
+      temperatureBand = state.band;
+      alertTemperature = state.temperature;
+      #ifdef USE_FORECAST
+        forecastOutput::forecast.restore(state.forecast);
+      #endif
+    }
+    state.starts++;
+    if (!(flags & _BV(PORF))) {
+      if (flags & _BV(WDRF)) {
+        state.watchdogResets++;
+      }
+      if (flags & _BV(BORF)) {
+        state.brownoutResets++;
+      }
+    }
+  }
+
+  #ifndef PLOTDATA
+    void showRestart() {
+      Serial.print(warmStart ? FLASHSTR("Warm start") : FLASHSTR("Cold start"));
+      Serial.print(FLASHSTR(" -> Starts = "));
+      Serial.print(state.starts);
+      Serial.print(FLASHSTR(", watchdog resets = "));
+      Serial.print(state.watchdogResets);
+      Serial.print(FLASHSTR(", brown-out resets = "));
+      Serial.println(state.brownoutResets);
+    }
+  #endif
+
+  //Save the state every STATE_SAVEEVERY runs. It is written to the EEPROM a byte at a time, from loop().
+  void stateTask() {
+    static byte saveCountDown = 1;
+    if (--saveCountDown == 0) {
+      saveCountDown = STATE_SAVEEVERY;
+      //Keep the saved band while there is no temperature, so a restart does not restore one never worked out.
+      if (!isnan(loftTemperature())) {
+        state.band = temperatureBand;
+        state.temperature = alertTemperature;
+      }
+      #ifdef USE_FORECAST
+        forecastOutput::forecast.save(state.forecast);
+      #endif
+      stateStore.save(&state);
+    }
+  }
+#endif
+
+//Update the LED indicators.
+void bandTask() {
+  updateLEDS(loftTemperature());
+}
+
+//The temperature the band LEDs, the fan, and the forecast follow.
+float loftTemperature() {
+  #if defined(USEFUSEDTEMP)
+    //The fused temperature, nan until the first good reading.
+    return fusedSensor::fusion.temperature();
+  #elif defined(USEAVERAGETEMP)
+    //The average temperature across the enabled temperature sensors.
+    float totalTemperature = 0.0;
+    sensors::addTemperatures(totalTemperature);
+    return totalTemperature / sensors::temperatures;
+  #else
+    //The first enabled temperature sensor.
+    return sensors::firstTemperature();
+  #endif
+}
+
+//A failed reading counts as 0.0 deg C.
+float validTemperature(float temperature) {
+  if (isnan(temperature) || (temperature == DEVICE_DISCONNECTED_C)) {
+    return 0.0;
+  }
+  return temperature;
+}
+
+//Send the cached sensor data, and the temperature band, to the serial console.
+void outputTask() {
+  #ifndef PLOTDATA
+    serialOut.println();               //Data block separator.
+  #endif
+  sensors::show();
+  if (sensors::temperatures > 0) {
+    showAlert();
+  }
+  serialOut.println();                 //Blank line or new line after data display.
+  #if (TASKSTATS_EVERY > 0) && !defined(PLOTDATA)
+    static byte statsCountDown = TASKSTATS_EVERY;
+    if (--statsCountDown == 0) {
+      statsCountDown = TASKSTATS_EVERY;
+      showTaskStats();
+    }
+  #endif
+  #ifdef USE_HISTORY
+    recordHistory();
+  #endif
+}
+
+#if defined(PLOTBINARY) || defined(PLOTSPARSE) || defined(USE_HISTORY)
+  //Build a binary frame of the cached sensor data, and the temperature band. Failed readings are 0.0, as in the CSV.
+  void buildFrame() {
+    frame.begin(frameMask, (frameMask & LFM_DS18B20) ? DS18B20_PROBES : 0);
+    sensors::addFields(frame);
+    if (sensors::temperatures > 0) {
+      frame.addInt(temperatureBand);
+    }
+  }
+#endif
+
+#ifdef PLOTBINARY
+  //Send the cached sensor data, and the temperature band, as one binary frame.
+  void sendFrame() {
+    buildFrame();
+    frame.send(serialOut);
+    #ifdef USE_HISTORY
+      recordHistory();
     #endif
   }
-  else if (temperature >= vcold_band and temperature < blue_band) {
-    temperatureBand = 1;
-    digitalWrite(RED_LED, LOW);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, HIGH);    
-    digitalWrite(WHITE_LED, HIGH);
-    #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<Ice Age!>"));
+#endif
+
+#ifdef PLOTSPARSE
+  //Send a full CSV line every SPARSE_KEYFRAME data outputs, and in between, a "~" line of just the columns that have moved
+  //  more than their deadband since they were last sent, as <column>:<value>, e.g. "~10:19.94,11:741" (columns from 0),
+  //  or nothing when none has. The keyframes show the sketch is still running.
+  void sendSparse() {
+    static byte keyframeCountDown = 1;
+    buildFrame();
+    if (--keyframeCountDown == 0) {
+      keyframeCountDown = SPARSE_KEYFRAME;
+      memcpy(sparseSent, frame.fields(), sizeof(sparseSent));
+      outputTask();
+      return;
+    }
+    bool first = true;
+    for (uint8_t column = 0; column < sparseFields; column++) {
+      int16_t value = frame.fields()[column];
+      int16_t sent = sparseSent[column];
+      bool moved = ((value == LOFTFRAME_NAN) || (sent == LOFTFRAME_NAN)) ? (value != sent) :
+                   (abs((int32_t)value - sent) > sensors::columnDeadband(column));
+      if (moved) {
+        if (first) {
+          serialOut.print(FLASHSTR("~"));
+        }
+        else {
+          serialOut.print(DATADELIMITER);
+        }
+        first = false;
+        serialOut.printUnsigned(column);
+        serialOut.print(FLASHSTR(":"));
+        printFrameField(value, loftFrameWholeField(frameMask, sparseFields, column));
+        sparseSent[column] = value;
+      }
+    }
+    if (!first) {
+      serialOut.println();
+    }
+    #ifdef USE_HISTORY
+      recordHistory();
     #endif
   }
-  else {
-    temperatureBand = 0;
-    digitalWrite(RED_LED, LOW);
-    digitalWrite(YELLOW_LED, LOW);
-    digitalWrite(GREEN_LED, LOW);
-    digitalWrite(BLUE_LED, HIGH);    
-    digitalWrite(WHITE_LED, HIGH);  //This LED will be flashed!
-    #ifndef PLOTDATA
-      Serial.println(FLASHSTR("<Deep Space!>"));
+#endif
+
+#if defined(PLOTSPARSE) || defined(USE_HISTORY)
+  //Print a binary frame field as the CSV has it, 2 decimal places for 1/100ths.
+  void printFrameField(int16_t value, bool whole) {
+    if (whole) {
+      serialOut.print(value);
+    }
+    else if (value == LOFTFRAME_NAN) {
+      serialOut.print(FLASHSTR("nan"));
+    }
+    else {
+      serialOut.printFixed(value / 100.0);
+    }
+  }
+#endif
+
+#ifdef USE_HISTORY
+  //Keep every HISTORY_EVERY data line, the first one straight away. It is written to the EEPROM a byte at a time, from loop().
+  void recordHistory() {
+    static byte historyCountDown = 1;
+    if (--historyCountDown == 0) {
+      historyCountDown = HISTORY_EVERY;
+      buildFrame();
+      if (history.add(frame.fields(), frame.count())) {
+        historyTime = millis();
+      }
+    }
+  }
+
+  //Read a command from the serial port, and send the next line of the reply, once the last output has been sent, so a
+  //  backfill never crowds out the data lines. A command is only read once the reply before it is finished, so one sent
+  //  meanwhile waits its turn in the serial receive buffer, rather than cutting the reply short.
+  void commandTask() {
+    static char command[8];
+    static uint8_t length = 0;
+    while ((replyState == REPLY_NONE) && (Serial.available() > 0)) {
+      char next = Serial.read();
+      if ((next == '\r') || (next == '\n')) {
+        if (length > 0) {
+          command[length] = '\0';
+          startReply(command);
+          length = 0;
+        }
+      }
+      else if (length < sizeof(command) - 1) {
+        command[length++] = next;
+      }
+    }
+    if ((replyState != REPLY_NONE) && (serialOut.queued() == 0) && !history.writing()) {
+      sendReply();
+    }
+  }
+
+  //B<sequence> - backfill from that line, or from the oldest (also after a restart, when it is ahead). S - summarise each column.
+  void startReply(const char *command) {
+    if ((command[0] == 'B') || (command[0] == 'b')) {
+      replySequence = (command[1] != '\0') ? (uint16_t)strtoul(&command[1], NULL, 10) : history.first();
+      replyState = REPLY_STATUS;
+    }
+    else if ((command[0] == 'S') || (command[0] == 's')) {
+      replyField = 0;
+      replyState = REPLY_SUMMARY;
+    }
+    else {
+      serialOut.println(FLASHSTR("#?"));
+    }
+  }
+
+  //Send one line of the reply:
+  //  #H,<first>,<end>,<bytes used>,<bytes>   The history status, the oldest line kept, and the next line to be kept.
+  //  #B,<sequence>,<age secs>,<columns...>   A kept line, and how long ago it was kept, in the CSV column order.
+  //  #E,<end>                                The end of a backfill, the line to ask for next time.
+  //  #S,<column>,<min>,<max>,<mean>          A column's summary, nan if it has no readings.
+  void sendReply() {
+    bool whole = loftFrameWholeField(frameMask, historyFields, replyField);
+    int16_t low, high, mean;
+    switch (replyState) {
+      case REPLY_STATUS:
+        serialOut.print(FLASHSTR("#H,"));
+        serialOut.printUnsigned(history.first());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(history.end());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(history.used());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(E2END + 1 - STATE_EEPROM);
+        serialOut.println();
+        replyState = history.seek(replyCursor, replySequence) ? REPLY_BACKFILL : REPLY_END;
+        break;
+      case REPLY_BACKFILL:
+        serialOut.print(FLASHSTR("#B,"));
+        serialOut.printUnsigned(replyCursor.sequence);
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned((millis() - historyTime) / 1000 + (uint16_t)(history.end() - 1 - replyCursor.sequence) * ((uint32_t)HISTORY_EVERY * OUTPUT_PERIOD / 1000));
+        for (uint8_t field = 0; field < historyFields; field++) {
+          serialOut.print(FLASHSTR(","));
+          printFrameField(replyCursor.values[field], loftFrameWholeField(frameMask, historyFields, field));
+        }
+        serialOut.println();
+        if (!history.next(replyCursor)) {
+          replyState = REPLY_END;
+        }
+        break;
+      case REPLY_END:
+        serialOut.print(FLASHSTR("#E,"));
+        serialOut.printUnsigned(history.end());
+        serialOut.println();
+        replyState = REPLY_NONE;
+        break;
+      case REPLY_SUMMARY:
+        serialOut.print(FLASHSTR("#S,"));
+        serialOut.printUnsigned(replyField);
+        if (history.summary(replyField, low, high, mean)) {
+          serialOut.print(FLASHSTR(","));
+          printFrameField(low, whole);
+          serialOut.print(FLASHSTR(","));
+          printFrameField(high, whole);
+          serialOut.print(FLASHSTR(","));
+          printFrameField(mean, whole);
+          serialOut.println();
+        }
+        else {
+          serialOut.println(FLASHSTR(",nan,nan,nan"));
+        }
+        if (++replyField >= historyFields) {
+          replyState = REPLY_NONE;
+        }
+        break;
+      default:
+        replyState = REPLY_NONE;
+    }
+  }
+#endif
+
+#ifdef USE_PROBES
+  //Send the data output, as set up, and time it.
+  void probeOutput() {
+    PROBE_START();
+    #if defined(PLOTBINARY)
+      sendFrame();
+    #elif defined(PLOTSPARSE)
+      sendSparse();
+    #else
+      outputTask();
     #endif
+    PROBE_STOP(PROBE_OUTPUT);
+    showProbe();
   }
-  #ifdef PLOTDATA
-    Serial.print(temperatureBand);
+
+  //Send the times of the next probe that has run since it was last sent, after the data line, and reset them:
+  //  #P,<probe>,<count>,<min us>,<mean us>,<max us>,<bucket counts...>   The buckets are as in LoftProbe.h.
+  void showProbe() {
+    static byte probeCountDown = PROBE_EVERY;
+    static byte nextProbe = 0;
+    if (--probeCountDown != 0) {
+      return;
+    }
+    probeCountDown = PROBE_EVERY;
+    for (byte tries = 0; tries < PROBE_COUNT; tries++) {
+      byte id = nextProbe;
+      nextProbe = (nextProbe + 1) % PROBE_COUNT;
+      if (probes[id].count() > 0) {
+        serialOut.print(FLASHSTR("#P,"));
+        serialOut.print(probeName(id));
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(probes[id].count());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(probes[id].low());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(probes[id].mean());
+        serialOut.print(FLASHSTR(","));
+        serialOut.printUnsigned(probes[id].high());
+        for (uint8_t bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+          serialOut.print(FLASHSTR(","));
+          serialOut.printUnsigned(probes[id].bucket(bucket));
+        }
+        serialOut.println();
+        probes[id].reset();
+        return;
+      }
+    }
+  }
+
+  const __FlashStringHelper *probeName(byte probe) {
+    switch (probe) {
+      case PROBE_BME280:
+        return F("BME280");
+      case PROBE_DHT11:
+        return F("DHT11");
+      case PROBE_DHT22:
+        return F("DHT22");
+      case PROBE_DS18B20:
+        return F("DS18B20");
+      case PROBE_DS18B20RX:
+        return F("DS18B20 Rx");
+      case PROBE_ANALOG:
+        return F("Analog");
+      case PROBE_ADCSWEEP:
+        return F("ADC Sweep");
+      default:
+        return F("Output");
+    }
+  }
+#endif
+
+#if (TASKSTATS_EVERY > 0) && !defined(PLOTDATA)
+  //Report the task runs, overruns, lateness and execution times, and the output buffer use, since the last report.
+  void showTaskStats() {
+    serialOut.println(FLASHSTR("Task Stats\t: Runs\tOverrun\tLate ms\tMax us\tAvg us"));
+    for (uint8_t task = 0; task < scheduler.count(); task++) {
+      serialOut.print(FLASHSTR(" -> "));
+      serialOut.print(scheduler.name(task));
+      serialOut.print(FLASHSTR("\t: "));
+      serialOut.print(scheduler.runs(task));
+      serialOut.print(FLASHSTR("\t"));
+      serialOut.print(scheduler.overruns(task));
+      serialOut.print(FLASHSTR("\t"));
+      serialOut.print(scheduler.maxLateness(task));
+      serialOut.print(FLASHSTR("\t"));
+      serialOut.print(scheduler.maxExecTime(task));
+      serialOut.print(FLASHSTR("\t"));
+      serialOut.println(scheduler.avgExecTime(task));
+    }
+    serialOut.print(FLASHSTR(" -> Output buffer\t: Queued "));
+    serialOut.print(serialOut.queued());
+    serialOut.print(FLASHSTR(", max "));
+    serialOut.print(serialOut.maxQueued());
+    serialOut.print(FLASHSTR(" of "));
+    serialOut.print(OUTPUT_BUFFER);
+    serialOut.print(FLASHSTR(" bytes, dropped "));
+    serialOut.println(serialOut.dropped());
+    serialOut.println();
+    scheduler.resetStats();
+    serialOut.resetStats();
+  }
+#endif
+
+#if defined(USE_ADAPTIVEADC) && !defined(PLOTDATA) && !defined(SDEBUG)
+  void showSamplesUsed(vDivider &divider) {
+    serialOut.print(FLASHSTR(" -> Samples used\t= "));
+    serialOut.println(divider.samplesUsed());
+  }
+#endif
+
+#ifdef SDEBUG
+  float getPseudoTemp() {
+    unsigned int potVal;
+    float randDelta;
+    //Read the potentiometer value and convert it to a pseudo temperature.
+    potVal = analogRead(POT_PIN);
+    randDelta = random(-999, 999) / 1000.0;             //Get some randomness into the mix.
+    return ((potVal / 10.0) - 30.0) + randDelta;        //Gives fractional results too.
+  }
+
+  float getPseudoHumidity() {
+    unsigned int potVal;
+    signed char randDelta;
+    //Read the potentiometer value and convert it to a pseudo humidity.
+    potVal = analogRead(POT_PIN);
+    randDelta = random(-99, 99);                                          //Get some randomness into the mix.
+    return (map(potVal, 0, ADCMAXVALUE, 99, 901) + randDelta) / 10.0;     //Gives fractional results too.
+  }
+
+  unsigned int getPseudoLight() {
+    unsigned int potVal;
+    signed char randDelta;
+    //Read the potentiometer value and convert it to a pseudo light level.
+    potVal = analogRead(POT_PIN);
+    randDelta = random(-9, 9);                                      //Get some randomness into the mix.
+    return map(potVal, 0, ADCMAXVALUE, 109, 891) + randDelta;       //Restrict the range (100 - 900) much like an LDC does.
+  }
+#endif
+
+void showTemperature(char *sensorName, float temperature) {
+  #ifndef PLOTDATA
+    serialOut.print(FLASHSTR("Temperature ("));
+    serialOut.print(sensorName);
+    serialOut.print(FLASHSTR(")\t= "));
+    serialOut.printFixed(temperature);
+    serialOut.print(FLASHSTR("\xC2\xB0"));
+    serialOut.println(FLASHSTR("C"));
+  #else
+    spPlotData(temperature);
+  #endif
+}
+
+void showHumidity(char *sensorName, float humidity) {
+  #ifndef PLOTDATA
+    serialOut.print(FLASHSTR("Humidity    ("));
+    serialOut.print(sensorName);
+    serialOut.print(FLASHSTR(")\t= "));
+    serialOut.printFixed(humidity);
+    serialOut.println(FLASHSTR("%"));
+  #else
+    spPlotData(humidity);
+  #endif
+}
+
+#ifdef PLOTDATA
+  void spPlotData(float sensorReading) {
+      serialOut.printFixed(sensorReading);
+      serialOut.print(DATADELIMITER);    
+  }
+#endif
+
+//Work out the new temperature band, and only if it has changed, update the LEDs.
+void updateLEDS(float temperature) {
+  //With no temperature (before the first reading, or with every sensor failed) keep the band, as nan is not band 0.
+  if (isnan(temperature)) {
+    return;
+  }
+  alertTemperature = temperature;
+  temperatureBand = bandClassify(bandTable, temperature, temperatureBand, BAND_HYSTERESIS);
+  if (temperatureBand != ledBand) {
+    ledBand = temperatureBand;
+    blinkStatus = HIGH;
+    bandWritePins(bandPins(bandTable, ledBand) | bandBlink(bandTable, ledBand), bandOutputs);
+  }
+}
+
+//Send the temperature band last used to update the LEDs.
+void showAlert() {
+  #ifndef PLOTDATA
+    serialOut.print(FLASHSTR("Alert Temperature\t: "));
+    serialOut.printFixed(alertTemperature);
+    serialOut.print(FLASHSTR("\xC2\xB0"));
+    serialOut.println(FLASHSTR("C"));
+    serialOut.print(FLASHSTR("!LED Alert Level!\t: "));
+    serialOut.println(bandLabel(bandTable, temperatureBand));
+  #else
+    serialOut.printUnsigned(temperatureBand);
   #endif
 }
 
@@ -0,0 +1,128 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Temperature Band Table.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+The temperature bands are a table, coldest first. Each band has a threshold, the temperature it starts at, the digital
+  pins it sets HIGH (all the other band pins are set LOW), the pins it blinks, and an alert label.
+
+The band for a temperature is found with a binary search of the thresholds. Hysteresis is applied to the thresholds of
+  the current band only, which are each moved away from the temperature, so the temperature must go past a threshold by
+  the hysteresis to change band. The thresholds must be far enough apart that they stay in order after moving them,
+  which bandTableValid() checks at compile time.
+
+The band pins are digital pins 0 - 15, as a bit mask, BANDPIN(pin). On an ATmega328P/168 (Uno, Nano, Pro Mini) pins
+  0 - 7 are PORTD and pins 8 - 15 are PORTB, so the low and high bytes of a mask are written straight to those ports.
+
+Usage:
+  constexpr char hotLabel[] PROGMEM = "<HOT>";
+  ...
+  constexpr bandEntry bands[] PROGMEM = {
+    {-274.0, BANDPIN(BLUE_LED), 0, coldLabel},
+    {25.0, BANDPIN(RED_LED), BANDPIN(WHITE_LED), hotLabel},   //Red, with a blinking white LED, from 25 deg C.
+  };
+  band = bandClassify(bands, temperature, band, 0.5);
+  bandWritePins(bandPins(bands, band), bandAllPins(bands));
+*/
+
+#ifndef LOFTBANDS_H
+  #define LOFTBANDS_H
+
+  #include <Arduino.h>
+
+  #define BANDPIN(pin) ((uint16_t)1 << (pin))
+
+  struct bandEntry {
+    float threshold;                  //The temperature the band starts at, deg C. Not used for band 0.
+    uint16_t pins;                    //The pins set HIGH in this band.
+    uint16_t blink;                   //The pins blinked in this band.
+    const char *label;                //The alert label, in PROGMEM.
+  };
+
+  //Compile time checks of a band table.
+
+  template<uint8_t bands> constexpr bool bandTableValid(const bandEntry (&table)[bands], float hysteresis, uint8_t band = 1) {
+    return (band >= bands) || ((table[band].threshold - table[band - 1].threshold > 2 * hysteresis) && bandTableValid(table, hysteresis, band + 1));
+  }
+
+  template<uint8_t bands> constexpr uint16_t bandAllPins(const bandEntry (&table)[bands], uint8_t band = 0) {
+    return (band >= bands) ? 0 : (table[band].pins | table[band].blink | bandAllPins(table, band + 1));
+  }
+
+  //Run time band lookups, from the table in PROGMEM.
+
+  template<uint8_t bands> inline float bandThreshold(const bandEntry (&table)[bands], uint8_t band) {
+    return pgm_read_float(&table[band].threshold);
+  }
+
+  template<uint8_t bands> inline uint16_t bandPins(const bandEntry (&table)[bands], uint8_t band) {
+    return pgm_read_word(&table[band].pins);
+  }
+
+  template<uint8_t bands> inline uint16_t bandBlink(const bandEntry (&table)[bands], uint8_t band) {
+    return pgm_read_word(&table[band].blink);
+  }
+
+  template<uint8_t bands> inline const __FlashStringHelper *bandLabel(const bandEntry (&table)[bands], uint8_t band) {
+    return (const __FlashStringHelper *)pgm_read_ptr(&table[band].label);
+  }
+
+  /*!
+   *  @brief  Find the band for a temperature, with hysteresis.
+   *  @param  table
+   *          The band table, in PROGMEM.
+   *  @param  temperature
+   *          The temperature, deg C. A nan temperature is in band 0.
+   *  @param  current
+   *          The current band.
+   *  @param  hysteresis
+   *          How far, deg C, the temperature must go past a threshold of the current band to leave it.
+   *  @return The highest band whose threshold the temperature has reached, or band 0.
+   */
+
+  template<uint8_t bands> uint8_t bandClassify(const bandEntry (&table)[bands], float temperature, uint8_t current, float hysteresis) {
+    uint8_t low = 0;                  //The temperature has reached the threshold of band low...
+    uint8_t high = bands;             //...but not of band high.
+    while (high - low > 1) {
+      uint8_t band = (low + high) / 2;
+      float threshold = bandThreshold(table, band);
+      if (band == current) {
+        threshold -= hysteresis;
+      }
+      else if (band == current + 1) {
+        threshold += hysteresis;
+      }
+      if (temperature >= threshold) {
+        low = band;
+      }
+      else {
+        high = band;
+      }
+    }
+    return low;
+  }
+
+  //Set the band output pins. Pins in outputs are set HIGH if they are in pins, and LOW if not.
+  inline void bandWritePins(uint16_t pins, uint16_t outputs) {
+    #if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+      uint8_t oldSREG = SREG;
+      cli();                          //Another pin on the port could be changed by an interrupt.
+      if (lowByte(outputs) != 0) {
+        PORTD = (PORTD & ~lowByte(outputs)) | (lowByte(pins) & lowByte(outputs));
+      }
+      if (highByte(outputs) != 0) {
+        PORTB = (PORTB & ~highByte(outputs)) | (highByte(pins) & highByte(outputs));
+      }
+      SREG = oldSREG;
+    #else
+      for (uint8_t pin = 0; pin < 16; pin++) {
+        if (outputs & BANDPIN(pin)) {
+          digitalWrite(pin, (pins & BANDPIN(pin)) ? HIGH : LOW);
+        }
+      }
+    #endif
+  }
+#endif
+
+//EOF
@@ -0,0 +1,214 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Fan Controller.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftControl.h"
+
+/*!
+ *  @brief  Instantiates a new fanController class, with no fan curve, no feed-forward, and the default limits.
+ */
+
+fanController::fanController() {
+  _points = 0;
+  _pid = false;
+  setPID(30.0, 10.0, 0.1, 0.0);
+  setFeedForward(0.0);
+  setLimits();
+  reset();
+}
+
+/*!
+ *  @brief  Set the fan curve. The points are copied.
+ *  @param  curve
+ *          The temperature, duty points, in rising temperature order. The duty is the first point's below the first
+ *          temperature, and the last point's above the last temperature.
+ *  @param  points
+ *          The number of points, up to FANCTRL_MAXPOINTS.
+ */
+
+void fanController::setCurve(const fanCurvePoint *curve, uint8_t points) {
+  if (points > FANCTRL_MAXPOINTS) {
+    points = FANCTRL_MAXPOINTS;
+  }
+  for (uint8_t point = 0; point < points; point++) {
+    _curve[point] = curve[point];
+  }
+  _points = points;
+}
+
+/*!
+ *  @brief  Set the PID loop terms, used when usePID() is set.
+ *  @param  setpoint
+ *          The temperature to hold, deg C.
+ *  @param  kp
+ *          Duty % per deg C above the setpoint.
+ *  @param  ki
+ *          Duty % per deg C above the setpoint, per second.
+ *  @param  kd
+ *          Duty % per deg C/min of temperature rise.
+ */
+
+void fanController::setPID(float setpoint, float kp, float ki, float kd) {
+  _setpoint = setpoint;
+  _kp = kp;
+  _ki = ki;
+  _kd = kd;
+}
+
+/*!
+ *  @brief  Set the rate of change feed-forward.
+ *  @param  gain
+ *          Duty % added per deg C/min of temperature rise. A falling temperature adds nothing.
+ *  @param  rateTime
+ *          The time constant, seconds, of the rate of change smoothing.
+ */
+
+void fanController::setFeedForward(float gain, float rateTime) {
+  _ffGain = gain;
+  _rateTime = rateTime;
+}
+
+/*!
+ *  @brief  Set the duty limits.
+ *  @param  minDuty
+ *          The lowest duty the fan runs at, %. The fan starts when the demand reaches this, and stops when it falls
+ *          below half of it.
+ *  @param  maxDuty
+ *          The highest duty, %.
+ *  @param  kickTime
+ *          The time, ms, the fan runs at full duty when it starts.
+ */
+
+void fanController::setLimits(uint8_t minDuty, uint8_t maxDuty, uint16_t kickTime) {
+  _maxDuty = (maxDuty > 100) ? 100 : maxDuty;
+  _minDuty = (minDuty > _maxDuty) ? _maxDuty : minDuty;
+  _kickTime = kickTime;
+}
+
+void fanController::usePID(bool pid) {
+  _pid = pid;
+}
+
+/*!
+ *  @brief  Work out the fan duty for a new temperature.
+ *  @param  temperature
+ *          The temperature, deg C, or nan if there is no reading.
+ *  @param  elapsed
+ *          The time, ms, since the last update.
+ *  @return The fan duty, %.
+ */
+
+uint8_t fanController::update(float temperature, uint16_t elapsed) {
+  float seconds = elapsed / 1000.0;
+  if (isnan(temperature)) {
+    //Fail safe, run the fan flat out, and start the rate again when the readings come back.
+    _started = false;
+    _running = true;
+    _kickLeft = 0;
+    _demand = _maxDuty;
+    _duty = _maxDuty;
+    return _duty;
+  }
+  if (_started && (elapsed > 0)) {
+    float rawRate = (temperature - _lastTemperature) * 60.0 / seconds;
+    _rate += (rawRate - _rate) * seconds / (_rateTime + seconds);
+  }
+  _started = true;
+  _lastTemperature = temperature;
+  float feedForward = (_rate > 0.0) ? _ffGain * _rate : 0.0;
+  if (_pid) {
+    float error = temperature - _setpoint;
+    float output = _kp * error + _integral + _kd * _rate + feedForward;
+    //Anti-windup, only integrate when it moves the output back into range.
+    if (!(((output >= _maxDuty) && (error > 0.0)) || ((output <= 0.0) && (error < 0.0)))) {
+      _integral += _ki * error * seconds;
+      if (_integral < 0.0) {
+        _integral = 0.0;
+      }
+      else if (_integral > _maxDuty) {
+        _integral = _maxDuty;
+      }
+      output = _kp * error + _integral + _kd * _rate + feedForward;
+    }
+    _demand = output;
+  }
+  else {
+    _demand = curveDuty(temperature) + feedForward;
+  }
+  //Start at the minimum duty, stop below half of it.
+  bool wasRunning = _running;
+  _running = (_demand > 0.0) && ((_demand >= _minDuty) || (_running && (_demand >= _minDuty / 2.0)));
+  if (!_running) {
+    _kickLeft = 0;
+    _duty = 0;
+    return _duty;
+  }
+  if (!wasRunning) {
+    _kickLeft = _kickTime;
+  }
+  else if (_kickLeft > elapsed) {
+    _kickLeft -= elapsed;
+  }
+  else {
+    _kickLeft = 0;
+  }
+  if (_kickLeft > 0) {
+    _duty = 100;
+  }
+  else if (_demand <= _minDuty) {
+    _duty = _minDuty;
+  }
+  else if (_demand >= _maxDuty) {
+    _duty = _maxDuty;
+  }
+  else {
+    _duty = (uint8_t)(_demand + 0.5);
+  }
+  return _duty;
+}
+
+uint8_t fanController::duty() {
+  return _duty;
+}
+
+float fanController::demand() {
+  return _demand;
+}
+
+float fanController::rate() {
+  return _rate;
+}
+
+//Forget the temperature history, the integral, and stop the fan.
+void fanController::reset() {
+  _started = false;
+  _lastTemperature = 0.0;
+  _rate = 0.0;
+  _integral = 0.0;
+  _demand = 0.0;
+  _duty = 0;
+  _running = false;
+  _kickLeft = 0;
+}
+
+//Interpolate the fan curve.
+float fanController::curveDuty(float temperature) {
+  if (_points == 0) {
+    return 0.0;
+  }
+  if (temperature <= _curve[0].temperature) {
+    return _curve[0].duty;
+  }
+  for (uint8_t point = 1; point < _points; point++) {
+    if (temperature < _curve[point].temperature) {
+      float fraction = (temperature - _curve[point - 1].temperature) / (_curve[point].temperature - _curve[point - 1].temperature);
+      return _curve[point - 1].duty + fraction * ((float)_curve[point].duty - _curve[point - 1].duty);
+    }
+  }
+  return _curve[_points - 1].duty;
+}
+
+//EOF
@@ -0,0 +1,84 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Fan Controller.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Works out a fan duty (0 - 100%) from a temperature, called every few seconds, much more often than the data is sent.
+
+Two modes:
+  Fan curve - the duty is interpolated from a table of temperature, duty points.
+  PID       - the duty holds the temperature at a setpoint. The integral is clamped to the duty range, and is not
+              increased while the duty is saturated (anti-windup). The derivative is taken from the temperature
+              rate of change, not the error, so a setpoint change does not kick the fan.
+In both modes the rate of change of the temperature (deg C/min, smoothed) feeds forward - a rising temperature adds
+  duty straight away, before the temperature itself has risen far enough to move the curve or the PID error.
+
+The fan is stopped below a minimum duty, with hysteresis (it restarts at the minimum, and stops below half of it),
+  and is run at full duty for a kick time when it starts, so it does not stall. A nan temperature runs the fan at
+  the maximum duty, which is the fail-safe for cooling.
+
+This header is shared with the host simulation, Tools/LoftThermalSim, so it must compile without Arduino.h.
+
+https://en.wikipedia.org/wiki/PID_controller
+https://en.wikipedia.org/wiki/Feed_forward_(control)
+*/
+
+#ifndef LOFTCONTROL_H
+  #define LOFTCONTROL_H
+
+  #ifdef ARDUINO
+    #include <Arduino.h>
+  #else
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <math.h>
+  #endif
+
+  #define FANCTRL_MAXPOINTS 8         //The most fan curve points.
+
+  struct fanCurvePoint {
+    float temperature;                //deg C, the points must be in rising temperature order.
+    uint8_t duty;                     //%.
+  };
+
+  class fanController {
+  public:
+    fanController();
+    void setCurve(const fanCurvePoint *curve, uint8_t points);
+    void setPID(float setpoint, float kp, float ki, float kd);
+    void setFeedForward(float gain, float rateTime = 30.0);
+    void setLimits(uint8_t minDuty = 25, uint8_t maxDuty = 100, uint16_t kickTime = 1000);
+    void usePID(bool pid = true);     //False follows the fan curve.
+    uint8_t update(float temperature, uint16_t elapsed);
+    uint8_t duty();                   //The duty from the last update, %.
+    float demand();                   //The duty asked for by the curve or PID, and feed-forward, before the limits, %.
+    float rate();                     //The smoothed temperature rate of change, deg C/min.
+    void reset();
+
+  private:
+    fanCurvePoint _curve[FANCTRL_MAXPOINTS];
+    uint8_t _points;
+    bool _pid;
+    float _setpoint;
+    float _kp;
+    float _ki;
+    float _kd;
+    float _ffGain;                    //Duty % per deg C/min of rise.
+    float _rateTime;                  //Rate smoothing time constant, seconds.
+    uint8_t _minDuty;
+    uint8_t _maxDuty;
+    uint16_t _kickTime;               //ms.
+    bool _started;                    //There is a previous temperature, for the rate.
+    float _lastTemperature;
+    float _rate;
+    float _integral;
+    float _demand;
+    uint8_t _duty;
+    bool _running;
+    uint16_t _kickLeft;               //ms of kick start left.
+    float curveDuty(float temperature);
+  };
+#endif
+
+//EOF
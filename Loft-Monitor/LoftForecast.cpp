@@ -0,0 +1,165 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Temperature Trend Forecast.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftForecast.h"
+
+/*!
+ *  @brief  Instantiates a new loftForecast class.
+ *  @param  window
+ *          The weighting time constant, minutes. A sample this old has 37% of the weight of a new one.
+ *  @param  minSlope
+ *          The slowest rise, deg C/min, that is forecast.
+ */
+
+loftForecast::loftForecast(float window, float minSlope) {
+  setWindow(window, minSlope);
+  reset();
+}
+
+void loftForecast::setWindow(float window, float minSlope) {
+  _window = window;
+  _minSlope = minSlope;
+}
+
+/*!
+ *  @brief  Add a temperature sample.
+ *  @param  temperature
+ *          The temperature, deg C. A nan sample is skipped, but its time still ages the older samples.
+ *  @param  elapsed
+ *          The time, ms, since the last sample.
+ */
+
+void loftForecast::add(float temperature, uint16_t elapsed) {
+  _pending += elapsed / 60000.0;
+  if (isnan(temperature)) {
+    return;
+  }
+  //Age the sums, and move their time origin to this sample.
+  float age = _pending;
+  float decay = exp(-age / _window);
+  _sumTT = decay * (_sumTT - 2.0 * age * _sumT + age * age * _sumW);
+  _sumTY = decay * (_sumTY - age * _sumY);
+  _sumT = decay * (_sumT - age * _sumW);
+  _sumY = decay * _sumY;
+  _sumW = decay * _sumW;
+  _pending = 0.0;
+  if ((_samples > 0) && (_span < _window)) {
+    _span += age;
+  }
+  //Add this sample, at time 0.
+  _sumW += 1.0;
+  _sumY += temperature;
+  if (_samples < FORECAST_MINSAMPLES) {
+    _samples++;
+  }
+}
+
+bool loftForecast::ready() {
+  return (_samples >= FORECAST_MINSAMPLES) && (_span >= FORECAST_MINSPAN * _window) && ((_sumW * _sumTT - _sumT * _sumT) > 0.0);
+}
+
+float loftForecast::level() {
+  if (_samples == 0) {
+    return NAN;
+  }
+  return (_sumY - slope() * _sumT) / _sumW;
+}
+
+float loftForecast::slope() {
+  float spread = _sumW * _sumTT - _sumT * _sumT;
+  if ((_samples < FORECAST_MINSAMPLES) || (spread <= 0.0)) {
+    return 0.0;
+  }
+  return (_sumW * _sumTY - _sumT * _sumY) / spread;
+}
+
+/*!
+ *  @brief  Forecast the time until the temperature rises to a threshold.
+ *  @param  threshold
+ *          The temperature, deg C.
+ *  @return Minutes, from the newest sample, 0 if the level is already at the threshold, or FORECAST_NEVER if it is
+ *          not rising fast enough, or there are not enough samples yet.
+ */
+
+float loftForecast::minutesTo(float threshold) {
+  if (!ready()) {
+    return FORECAST_NEVER;
+  }
+  float rise = threshold - level();
+  if (rise <= 0.0) {
+    return 0.0;
+  }
+  float trend = slope();
+  if ((trend < _minSlope) || (rise / trend > FORECAST_NEVER)) {
+    return FORECAST_NEVER;
+  }
+  return rise / trend;
+}
+
+/*!
+ *  @brief  Update the pre-alert for a threshold.
+ *  @param  threshold
+ *          The temperature, deg C.
+ *  @param  horizon
+ *          Raise the pre-alert when the threshold will be reached within this many minutes, or has been reached.
+ *  @return True if the pre-alert is raised.
+ */
+
+bool loftForecast::checkAlert(float threshold, float horizon) {
+  float minutes = minutesTo(threshold);
+  if (minutes <= horizon) {
+    _alert = true;
+  }
+  else if (minutes > FORECAST_CLEAR * horizon) {
+    _alert = false;
+  }
+  return _alert;
+}
+
+bool loftForecast::alert() {
+  return _alert;
+}
+
+void loftForecast::save(forecastState &state) {
+  state.sumW = _sumW;
+  state.sumT = _sumT;
+  state.sumY = _sumY;
+  state.sumTT = _sumTT;
+  state.sumTY = _sumTY;
+  state.pending = _pending;
+  state.span = _span;
+  state.samples = _samples;
+  state.alert = _alert;
+}
+
+//Carry on from a saved fit. The time since it was saved is not known, so it is taken to be short, e.g. a reset.
+void loftForecast::restore(const forecastState &state) {
+  _sumW = state.sumW;
+  _sumT = state.sumT;
+  _sumY = state.sumY;
+  _sumTT = state.sumTT;
+  _sumTY = state.sumTY;
+  _pending = state.pending;
+  _span = state.span;
+  _samples = state.samples;
+  _alert = state.alert;
+}
+
+//Forget all the samples, and clear the pre-alert.
+void loftForecast::reset() {
+  _sumW = 0.0;
+  _sumT = 0.0;
+  _sumY = 0.0;
+  _sumTT = 0.0;
+  _sumTY = 0.0;
+  _pending = 0.0;
+  _span = 0.0;
+  _samples = 0;
+  _alert = false;
+}
+
+//EOF
@@ -0,0 +1,86 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Temperature Trend Forecast.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Fits a straight line to the recent temperatures, and forecasts how long the temperature will take to rise to a
+  threshold, so kit can be powered down before the loft gets too hot, not after.
+
+The fit is an exponentially weighted linear regression - every sample is weighted by exp(-age / window), so the
+  window slides without storing any samples. Only five weighted sums are kept, and each new sample first ages them
+  (moving their time origin to the new sample), then adds itself. So the memory and the work per sample are constant.
+  Times are in minutes from the newest sample, which keeps the sums small enough for float.
+
+From the fit:
+  level()       - the smoothed temperature now, the line at the newest sample.
+  slope()       - the trend, deg C/min.
+  minutesTo()   - the time until the line reaches a threshold above the level, or FORECAST_NEVER.
+  checkAlert()  - a pre-alert, raised when a threshold will be reached within a horizon, or has been reached, and
+                  cleared again when it will not be reached within 1.5 x the horizon, e.g. once the loft is cooling.
+
+This header is shared with the host replay tool, Tools/LoftForecastReplay, so it must compile without Arduino.h.
+
+https://en.wikipedia.org/wiki/Simple_linear_regression
+https://en.wikipedia.org/wiki/Exponential_smoothing
+*/
+
+#ifndef LOFTFORECAST_H
+  #define LOFTFORECAST_H
+
+  #ifdef ARDUINO
+    #include <Arduino.h>
+  #else
+    #include <stdint.h>
+    #include <math.h>
+  #endif
+
+  #define FORECAST_NEVER 9999.0       //minutesTo() when the threshold will not be reached.
+  #define FORECAST_MINSAMPLES 3       //Samples needed before forecasting...
+  #define FORECAST_MINSPAN 0.5        //...and they must span at least this fraction of the window.
+  #define FORECAST_CLEAR 1.5          //A pre-alert clears when the time to the threshold is more than this x the horizon.
+
+  //The fit, so it can be saved, and restored after a restart.
+  struct forecastState {
+    float sumW;
+    float sumT;
+    float sumY;
+    float sumTT;
+    float sumTY;
+    float pending;
+    float span;
+    uint8_t samples;
+    bool alert;
+  };
+
+  class loftForecast {
+  public:
+    loftForecast(float window = 15.0, float minSlope = 0.005);
+    void setWindow(float window, float minSlope = 0.005);
+    void add(float temperature, uint16_t elapsed);
+    bool ready();                     //There are enough samples to forecast.
+    float level();                    //deg C.
+    float slope();                    //deg C/min.
+    float minutesTo(float threshold);
+    bool checkAlert(float threshold, float horizon);
+    bool alert();                     //The pre-alert from the last checkAlert().
+    void save(forecastState &state);
+    void restore(const forecastState &state);
+    void reset();
+
+  private:
+    float _window;                    //The weighting time constant, minutes.
+    float _minSlope;                  //Slower rises than this, deg C/min, are not forecast.
+    float _sumW;                      //The weighted sums, with times in minutes from the newest sample.
+    float _sumT;
+    float _sumY;
+    float _sumTT;
+    float _sumTY;
+    float _pending;                   //Minutes since the newest sample, from skipped (nan) samples.
+    float _span;                      //Minutes since the first sample, up to the window.
+    uint8_t _samples;
+    bool _alert;
+  };
+#endif
+
+//EOF
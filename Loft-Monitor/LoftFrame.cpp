@@ -0,0 +1,86 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Binary Telemetry Frames.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftFrame.h"
+
+loftFrame::loftFrame() {
+  _sequence = 0;
+  _mask = 0;
+  _probes = 0;
+  _count = 0;
+}
+
+void loftFrame::begin(uint16_t mask, uint8_t probes) {
+  _mask = mask;
+  _probes = probes;
+  _count = 0;
+}
+
+//Scale to 1/100ths, rounding half away from zero, and clamping to the int16_t range.
+void loftFrame::add(float value) {
+  int16_t field;
+  if (isnan(value)) {
+    field = LOFTFRAME_NAN;
+  }
+  else {
+    value *= 100.0;
+    if (value >= 32767.0) {
+      field = 32767;
+    }
+    else if (value <= -32767.0) {
+      field = -32767;
+    }
+    else {
+      field = (value >= 0.0) ? (int16_t)(value + 0.5) : (int16_t)(value - 0.5);
+    }
+  }
+  addInt(field);
+}
+
+void loftFrame::addInt(int16_t value) {
+  if (_count < LOFTFRAME_MAXFIELDS) {
+    _fields[_count++] = value;
+  }
+}
+
+uint8_t loftFrame::send(Print &out) {
+  uint8_t header[LOFTFRAME_HEADER] = {LOFTFRAME_SYNC1, LOFTFRAME_SYNC2, LOFTFRAME_VERSION,
+                                      (uint8_t)_sequence, (uint8_t)(_sequence >> 8),
+                                      (uint8_t)_mask, (uint8_t)(_mask >> 8),
+                                      _probes, _count};
+  uint16_t crc = LOFTFRAME_CRCINIT;
+  for (uint8_t index = 2; index < LOFTFRAME_HEADER; index++) {
+    crc = loftFrameCRC(crc, header[index]);
+  }
+  out.write(header, LOFTFRAME_HEADER);
+  for (uint8_t index = 0; index < _count; index++) {
+    uint8_t low = (uint16_t)_fields[index];
+    uint8_t high = (uint16_t)_fields[index] >> 8;
+    crc = loftFrameCRC(crc, low);
+    crc = loftFrameCRC(crc, high);
+    out.write(low);
+    out.write(high);
+  }
+  out.write((uint8_t)crc);
+  out.write((uint8_t)(crc >> 8));
+  _sequence++;
+  return LOFTFRAME_HEADER + (2 * _count) + LOFTFRAME_CRC;
+}
+
+uint16_t loftFrame::sequence() {
+  return _sequence;
+}
+
+const int16_t *loftFrame::fields() {
+  return _fields;
+}
+
+uint8_t loftFrame::count() {
+  return _count;
+}
+
+//EOF
@@ -0,0 +1,113 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Binary Telemetry Frames.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+A compact alternative to the PLOTDATA CSV lines. Each frame carries one line of sensor data as fixed width scaled
+  integers, and describes its own column set, so a decoder can start part way through a capture.
+
+Frame layout, all multi-byte values are little endian:
+  Offset  Size  Field
+  0       2     Sync word, 0xA5 0x5A.
+  2       1     Version, LOFTFRAME_VERSION.
+  3       2     Sequence number, incremented for every frame sent, so dropped frames can be detected.
+  5       2     Sensor mask, LFM_* bits, the sensors that have fields in this frame, in CSV column order.
+  7       1     DS18B20 probes, the number of DS18B20 fields when LFM_DS18B20 is set.
+  8       1     Field count, n.
+  9       2n    Fields, int16_t. Temperatures (deg C) and humidities (%) are in 1/100ths, the light level (ADC value),
+                the fan duty (%), the minutes to alert and the temperature band are whole numbers. LOFTFRAME_NAN marks
+                a missing (nan) reading.
+  9+2n    2     CRC-16/CCITT-FALSE of bytes 2 to 8+2n (everything after the sync word).
+
+This header is shared with the host decoder, Tools/LoftFrameDecoder, so it must compile without Arduino.h.
+
+https://en.wikipedia.org/wiki/Cyclic_redundancy_check
+https://reveng.sourceforge.io/crc-catalogue/16.htm#crc.cat.crc-16-ibm-3740
+*/
+
+#ifndef LOFTFRAME_H
+  #define LOFTFRAME_H
+
+  #ifdef ARDUINO
+    #include <Arduino.h>
+  #else
+    #include <stdint.h>
+  #endif
+
+  #define LOFTFRAME_SYNC1 0xA5
+  #define LOFTFRAME_SYNC2 0x5A
+  #define LOFTFRAME_VERSION 1
+  #define LOFTFRAME_HEADER 9          //Bytes before the fields.
+  #define LOFTFRAME_CRC 2             //Bytes after the fields.
+  #define LOFTFRAME_MAXFIELDS 32
+  #define LOFTFRAME_NAN -32768        //A missing reading.
+  #define LOFTFRAME_CRCINIT 0xFFFF
+
+  //Sensor mask bits, in CSV column order. Each bit adds the columns shown.
+  #define LFM_BME280 0x0001           //Temperature(BME280), Humidity(BME280).
+  #define LFM_DHT11 0x0002            //Temperature(DHT11), Humidity(DHT11).
+  #define LFM_DHT22 0x0004            //Temperature(DHT22), Humidity(DHT22).
+  #define LFM_DS18B20 0x0008          //Temperature(DS18B20), Temperature(DS18B20-2)... one per probe.
+  #define LFM_KY013 0x0010            //Temperature(KY013).
+  #define LFM_TMP36 0x0020            //Temperature(TMP36).
+  #define LFM_MF52D 0x0040            //Temperature(MF52D).
+  #define LFM_LDR 0x0080              //Light-Level(LDR), whole number.
+  #define LFM_BAND 0x0100             //Temperature-Band, whole number. Always the last column.
+  #define LFM_FAN 0x0200              //Fan-Duty(PWM), whole number. Added later, so its column is before the band's.
+  #define LFM_FUSED 0x0400            //Temperature(Fused). Added later, its column is after the fan's.
+  #define LFM_FORECAST 0x0800         //Minutes-To-Alert, whole number. Added later, its column is after the fused temperature's.
+
+  //Update a CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) with one byte.
+  inline uint16_t loftFrameCRC(uint16_t crc, uint8_t data) {
+    crc ^= (uint16_t)data << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+  }
+
+  //Whether a field of a frame of count fields is a whole number (the light level, the fan duty, the minutes to alert and
+  //  the temperature band), or in 1/100ths. The whole number columns, with the fused temperature among them, are the
+  //  last ones, so the field is found from the end.
+  inline bool loftFrameWholeField(uint16_t mask, uint8_t count, uint8_t index) {
+    uint8_t fromEnd = count - 1 - index;
+    if ((mask & LFM_BAND) && (fromEnd-- == 0)) {
+      return true;
+    }
+    if ((mask & LFM_FORECAST) && (fromEnd-- == 0)) {
+      return true;
+    }
+    if ((mask & LFM_FUSED) && (fromEnd-- == 0)) {
+      return false;
+    }
+    if ((mask & LFM_FAN) && (fromEnd-- == 0)) {
+      return true;
+    }
+    return (mask & LFM_LDR) && (fromEnd == 0);
+  }
+
+  #ifdef ARDUINO
+    //Build and send frames.
+    class loftFrame {
+    public:
+      loftFrame();
+      void begin(uint16_t mask, uint8_t probes = 0);  //Start a new frame.
+      void add(float value);                          //Add a temperature or humidity field, in 1/100ths.
+      void addInt(int16_t value);                     //Add a whole number field.
+      uint8_t send(Print &out);                       //Send the frame, returns the bytes sent.
+      uint16_t sequence();                            //The sequence number of the next frame.
+      const int16_t *fields();                        //The fields added since begin()...
+      uint8_t count();                                //...and how many.
+
+    private:
+      uint16_t _sequence;
+      uint16_t _mask;
+      uint8_t _probes;
+      uint8_t _count;
+      int16_t _fields[LOFTFRAME_MAXFIELDS];
+    };
+  #endif
+#endif
+
+//EOF
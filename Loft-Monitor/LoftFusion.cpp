@@ -0,0 +1,227 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Temperature Sensor Fusion.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftFusion.h"
+
+#define FUSION_STARTRATE 0.0003       //The rate variance when the estimate is started, (deg C/s)^2, about (1 deg C/min)^2.
+
+/*!
+ *  @brief  Instantiates a new loftFusion class.
+ *  @param  channels
+ *          The channel states, preallocated by the caller.
+ *  @param  count
+ *          The number of channels, one for each temperature reading.
+ */
+
+loftFusion::loftFusion(fusionChannel *channels, uint8_t count) {
+  _channels = channels;
+  _count = count;
+  setLimits(0.000001);
+  reset();
+}
+
+/*!
+ *  @brief  Set the filter limits.
+ *  @param  process
+ *          The process noise, deg C^2/s^3, how fast the rate of change of the loft temperature can change. Bigger
+ *          follows changes faster, smaller is smoother.
+ *  @param  gate
+ *          Readings more than this many standard deviations from the estimate are outliers.
+ *  @param  stuck
+ *          A reading that has not changed while the estimate has moved this far, deg C, is stuck.
+ *  @param  offsetGain
+ *          How fast a relative sensor's offset follows the estimate, the fraction of the difference per reading.
+ *  @param  timeout
+ *          The time, ms, without a used reading before the estimate is stale.
+ */
+
+void loftFusion::setLimits(float process, float gate, float stuck, float offsetGain, uint32_t timeout) {
+  _process = process;
+  _gate = gate;
+  _stuck = stuck;
+  _offsetGain = offsetGain;
+  _timeout = timeout;
+}
+
+/*!
+ *  @brief  Move the estimate on in time, by its rate of change, or hold it once it is stale.
+ *  @param  elapsed
+ *          The time, ms, since the last prediction.
+ */
+
+void loftFusion::predict(uint16_t elapsed) {
+  if (!_started) {
+    return;
+  }
+  if (current()) {
+    _sinceUsed += elapsed;
+  }
+  if (!current()) {
+    //No reading has been used for the timeout, so the trend is no longer known.
+    _rate = 0.0;
+  }
+  float seconds = elapsed / 1000.0;
+  _temperature += _rate * seconds;
+  _p00 += seconds * (2.0 * _p01 + seconds * _p11) + _process * seconds * seconds * seconds / 3.0;
+  _p01 += seconds * _p11 + _process * seconds * seconds / 2.0;
+  _p11 += _process * seconds;
+}
+
+#ifdef ARDUINO
+  /*!
+   *  @brief  Correct the estimate with a sensor reading, whose model is in PROGMEM, so it takes no RAM.
+   *  @return The channel status, FUSION_*.
+   */
+
+  uint8_t loftFusion::update_P(uint8_t channel, float reading, uint8_t stamp, const fusionModel *model) {
+    fusionModel copy;
+    memcpy_P(&copy, model, sizeof(copy));
+    return update(channel, reading, stamp, copy);
+  }
+#endif
+
+/*!
+ *  @brief  Correct the estimate with a sensor reading.
+ *  @param  channel
+ *          The channel, 0 to count - 1.
+ *  @param  reading
+ *          The temperature, deg C.
+ *  @param  stamp
+ *          Changes with every new reading. The reading is skipped if the stamp is the same as last time.
+ *  @param  model
+ *          The sensor's noise, range, and whether it is relative.
+ *  @return The channel status, FUSION_*.
+ */
+
+uint8_t loftFusion::update(uint8_t channel, float reading, uint8_t stamp, const fusionModel &model) {
+  if (channel >= _count) {
+    return FUSION_NOREADING;
+  }
+  fusionChannel &state = _channels[channel];
+  if (stamp == state.stamp) {
+    return state.status;
+  }
+  state.stamp = stamp;
+  if (isnan(reading)) {
+    return state.status = FUSION_NAN;
+  }
+  if ((reading < model.low) || (reading > model.high)) {
+    return state.status = FUSION_RANGE;
+  }
+  if (reading != state.lastReading) {
+    state.lastReading = reading;
+    state.changedAt = _started ? _temperature : reading;
+  }
+  else if (_started && (fabs(_temperature - state.changedAt) >= _stuck)) {
+    return state.status = FUSION_STUCK;
+  }
+  float variance = model.noise * model.noise;
+  if (!model.relative && !_anchored) {
+    //The first absolute reading sets the estimate, and the relative sensor offsets are learnt again from it.
+    start(reading, variance);
+    _anchored = true;
+    for (uint8_t index = 0; index < _count; index++) {
+      _channels[index].calibrated = false;
+    }
+    return state.status = FUSION_USED;
+  }
+  if (!_started) {
+    start(reading, variance);
+    return state.status = FUSION_USED;
+  }
+  bool relative = model.relative && _anchored;
+  if (relative && !state.calibrated) {
+    state.offset = reading - _temperature;
+    state.calibrated = true;
+    return state.status = FUSION_CALIBRATED;
+  }
+  float offset = relative ? state.offset : 0.0;
+  float innovation = reading - offset - _temperature;
+  float innovationVariance = _p00 + variance;
+  if (innovation * innovation > _gate * _gate * innovationVariance) {
+    return state.status = FUSION_OUTLIER;
+  }
+  float gain0 = _p00 / innovationVariance;
+  float gain1 = _p01 / innovationVariance;
+  _temperature += gain0 * innovation;
+  _rate += gain1 * innovation;
+  _p11 -= gain1 * _p01;
+  _p01 -= gain0 * _p01;
+  _p00 -= gain0 * _p00;
+  if (relative) {
+    state.offset += _offsetGain * (reading - _temperature - state.offset);
+  }
+  _sinceUsed = 0;
+  return state.status = FUSION_USED;
+}
+
+float loftFusion::temperature() {
+  return current() ? _temperature : NAN;
+}
+
+float loftFusion::rate() {
+  return _rate * 60.0;
+}
+
+float loftFusion::uncertainty() {
+  return current() ? sqrt(_p00) : NAN;
+}
+
+uint8_t loftFusion::status(uint8_t channel) {
+  return (channel < _count) ? _channels[channel].status : FUSION_NOREADING;
+}
+
+uint8_t loftFusion::used() {
+  uint8_t used = 0;
+  for (uint8_t channel = 0; channel < _count; channel++) {
+    if (_channels[channel].status == FUSION_USED) {
+      used++;
+    }
+  }
+  return used;
+}
+
+uint8_t loftFusion::count() {
+  return _count;
+}
+
+//Forget the estimate, and all the channel states.
+void loftFusion::reset() {
+  _started = false;
+  _anchored = false;
+  _temperature = 0.0;
+  _rate = 0.0;
+  _sinceUsed = 0;
+  _p00 = 0.0;
+  _p01 = 0.0;
+  _p11 = 0.0;
+  for (uint8_t channel = 0; channel < _count; channel++) {
+    _channels[channel].offset = 0.0;
+    _channels[channel].lastReading = NAN;
+    _channels[channel].changedAt = 0.0;
+    _channels[channel].stamp = 0;
+    _channels[channel].status = FUSION_NOREADING;
+    _channels[channel].calibrated = false;
+  }
+}
+
+void loftFusion::start(float temperature, float variance) {
+  _started = true;
+  _sinceUsed = 0;
+  _temperature = temperature;
+  _rate = 0.0;
+  _p00 = variance;
+  _p01 = 0.0;
+  _p11 = FUSION_STARTRATE;
+}
+
+//Started, and a reading has been used within the timeout.
+bool loftFusion::current() {
+  return _started && (_sinceUsed < _timeout);
+}
+
+//EOF
@@ -0,0 +1,113 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Temperature Sensor Fusion.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Fuses the readings of all the temperature sensors into one estimate of the loft temperature, with a Kalman filter.
+
+The filter state is the temperature, and its rate of change. predict() moves the estimate on by the rate, and grows
+  its uncertainty, then update() corrects it with each new sensor reading, weighted by how noisy that sensor is. So a
+  ±2 deg C DHT11 counts for far less than a DS18B20, and the estimate keeps following a trend between readings.
+
+Each sensor reading is a channel, described by a fusionModel - its noise, its valid range, and whether it is relative.
+  A relative sensor (the analog thermistors) is read often, but has an offset. Its offset is learnt, slowly, from the
+  estimate, once an absolute sensor (the digital sensors) has set the estimate, so the fast readings track the changes
+  between the slow absolute readings without pulling the estimate away from them. With no absolute sensors the
+  relative sensors are used as they are.
+
+A reading is rejected, and does not change the estimate, if it is:
+  nan               - a failed read.
+  out of range      - outside the model range, e.g. a disconnected DS18B20 (-127 deg C).
+  stuck             - unchanged, while the estimate has moved by the stuck limit.
+  an outlier        - more than the gate (standard deviations) from the estimate. The uncertainty grows while readings
+                      are rejected, so a real, fast change is accepted again after a few readings.
+
+If no reading has been used for the timeout, e.g. every sensor has failed, the estimate is stale. Its rate is zeroed,
+  so it stops following the old trend, and temperature() is nan, so whatever follows it takes its failure path, until
+  a reading is used again.
+
+A reading is only used once - the caller passes a stamp, e.g. a count of the sensor reads, with each reading, and a
+  reading with the same stamp as the last one is skipped.
+
+This header is shared with the host tools, so it must compile without Arduino.h.
+
+https://en.wikipedia.org/wiki/Kalman_filter
+https://en.wikipedia.org/wiki/Sensor_fusion
+*/
+
+#ifndef LOFTFUSION_H
+  #define LOFTFUSION_H
+
+  #ifdef ARDUINO
+    #include <Arduino.h>
+  #else
+    #include <stdint.h>
+    #include <math.h>
+  #endif
+
+  //Channel status, for the last reading.
+  #define FUSION_NOREADING 0
+  #define FUSION_USED 1
+  #define FUSION_NAN 2
+  #define FUSION_RANGE 3
+  #define FUSION_STUCK 4
+  #define FUSION_OUTLIER 5
+  #define FUSION_CALIBRATED 6         //A relative sensor's offset was set from the estimate.
+
+  struct fusionModel {
+    float noise;                      //The reading noise, standard deviation, deg C.
+    float low;                        //The valid range, deg C.
+    float high;
+    bool relative;                    //Has an offset, learnt from the absolute sensors.
+  };
+
+  //The state kept for each channel. Preallocated by the caller, one per channel.
+  struct fusionChannel {
+    float offset;                     //A relative sensor's offset, deg C.
+    float lastReading;
+    float changedAt;                  //The estimate when the reading last changed, for the stuck check.
+    uint8_t stamp;
+    uint8_t status;
+    bool calibrated;                  //The offset has been set.
+  };
+
+  class loftFusion {
+  public:
+    loftFusion(fusionChannel *channels, uint8_t count);
+    void setLimits(float process, float gate = 4.0, float stuck = 1.0, float offsetGain = 0.01, uint32_t timeout = 300000);
+    void predict(uint16_t elapsed);
+    uint8_t update(uint8_t channel, float reading, uint8_t stamp, const fusionModel &model);
+    #ifdef ARDUINO
+      uint8_t update_P(uint8_t channel, float reading, uint8_t stamp, const fusionModel *model);  //A PROGMEM model.
+    #endif
+    float temperature();              //The estimate, deg C, nan until the first reading, and while it is stale.
+    float rate();                     //deg C/min.
+    float uncertainty();              //Standard deviation, deg C, nan while the estimate is.
+    uint8_t status(uint8_t channel);
+    uint8_t used();                   //The channels whose last reading was used.
+    uint8_t count();
+    void reset();
+
+  private:
+    fusionChannel *_channels;
+    uint8_t _count;
+    float _process;                   //Process noise, deg C^2/s^3, how fast the rate of change can change.
+    float _gate;
+    float _stuck;
+    float _offsetGain;
+    uint32_t _timeout;                //ms without a used reading before the estimate is stale.
+    uint32_t _sinceUsed;              //ms since a reading was last used.
+    bool _started;
+    bool _anchored;                   //An absolute sensor has set the estimate.
+    float _temperature;
+    float _rate;                      //deg C/s.
+    float _p00;                       //The covariance of the temperature and rate.
+    float _p01;
+    float _p11;
+    void start(float temperature, float variance);
+    bool current();
+  };
+#endif
+
+//EOF
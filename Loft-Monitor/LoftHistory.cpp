@@ -0,0 +1,262 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Data History.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftHistory.h"
+
+/*!
+ *  @brief  Instantiates a new loftHistory class.
+ *  @param  start
+ *          The EEPROM address of the ring.
+ *  @param  size
+ *          The size of the ring, in bytes.
+ *  @param  fields
+ *          The number of fields in every line.
+ *  @param  values
+ *          2 x fields, for the oldest and the newest lines, preallocated by the caller.
+ *  @param  line
+ *          LOFTHISTORY_LINESIZE(fields) bytes, for the line being written, preallocated by the caller.
+ */
+
+loftHistory::loftHistory(uint16_t start, uint16_t size, uint8_t fields, int16_t *values, uint8_t *line) {
+  _start = start;
+  _size = size;
+  _fields = fields;
+  _oldest = values;
+  _newest = values + fields;
+  _line = line;
+  _lineLength = 0;
+  _written = 0;
+  _head = 0;
+  _used = 0;
+  _first = 0;
+  _lines = 0;
+  for (uint8_t field = 0; field < fields; field++) {
+    _newest[field] = 0;
+  }
+}
+
+/*!
+ *  @brief  Start adding a line. drain() writes it, and the oldest lines are dropped to make room.
+ *  @param  fields
+ *          The fields of the line, as in a binary frame.
+ *  @param  count
+ *          The number of fields, which must be the number the history was made for.
+ *  @return False if the last line is still being written, or the count is wrong, and this one is skipped.
+ */
+
+bool loftHistory::add(const int16_t *fields, uint8_t count) {
+  if (writing() || (count != _fields) || (LOFTHISTORY_LINESIZE(_fields) > _size)) {
+    return false;
+  }
+  //Encode the changes from the newest line.
+  uint8_t mapSize = (_fields + 7) / 8;
+  uint8_t length = mapSize;
+  for (uint8_t index = 0; index < mapSize; index++) {
+    _line[index] = 0;
+  }
+  for (uint8_t field = 0; field < _fields; field++) {
+    int32_t change = (int32_t)fields[field] - _newest[field];
+    if (change != 0) {
+      _line[field / 8] |= 1 << (field % 8);
+      if ((change >= -127) && (change <= 127)) {
+        _line[length++] = (int8_t)change;
+      }
+      else {
+        _line[length++] = (uint8_t)LOFTHISTORY_ESCAPE;
+        _line[length++] = (uint16_t)fields[field] & 0xFF;
+        _line[length++] = (uint16_t)fields[field] >> 8;
+      }
+      _newest[field] = fields[field];
+    }
+  }
+  while (_used + length > _size) {
+    dropOldest();
+  }
+  _lineLength = length;
+  _written = 0;
+  return true;
+}
+
+void loftHistory::drain() {
+  if (writing() && eeprom_is_ready()) {
+    eeprom_update_byte((uint8_t *)(_start + (_head + _used + _written) % _size), _line[_written]);
+    _written++;
+    if (_written == _lineLength) {
+      //Written, so it is now part of the history.
+      if (_lines == 0) {
+        for (uint8_t field = 0; field < _fields; field++) {
+          _oldest[field] = _newest[field];
+        }
+      }
+      _used += _lineLength;
+      _lines++;
+    }
+  }
+}
+
+bool loftHistory::writing() {
+  return _written < _lineLength;
+}
+
+/*!
+ *  @brief  Point a cursor at a line.
+ *  @param  cursor
+ *          The cursor, with its values array set.
+ *  @param  sequence
+ *          The sequence number of the line. If it has been dropped, or is ahead of the history, the cursor is set to
+ *          the oldest line. The sequence numbers start again from 0 at a restart, so a host asking for a line ahead of
+ *          the history has only seen lines from before it, and needs all of these.
+ *  @return False if the line is the next one to be kept, or the history is empty.
+ */
+
+bool loftHistory::seek(historyCursor &cursor, uint16_t sequence) {
+  if ((_lines == 0) || (sequence == end())) {
+    return false;
+  }
+  if ((int16_t)(sequence - end()) > 0) {
+    sequence = _first;
+  }
+  cursor.sequence = _first;
+  cursor.position = _head;
+  for (uint8_t field = 0; field < _fields; field++) {
+    cursor.values[field] = _oldest[field];
+  }
+  while ((int16_t)(cursor.sequence - sequence) < 0) {
+    next(cursor);
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Move a cursor on to the next line.
+ *  @param  cursor
+ *          The cursor, from seek().
+ *  @return False if there is no next line yet. If the cursor's line has been dropped meanwhile, the cursor is set to
+ *          the oldest line, and its sequence number jumps.
+ */
+
+bool loftHistory::next(historyCursor &cursor) {
+  if ((_lines == 0) || ((int16_t)(cursor.sequence - _first) < 0)) {
+    return seek(cursor, _first);
+  }
+  if ((uint16_t)(cursor.sequence + 1 - _first) >= _lines) {
+    return false;
+  }
+  cursor.position = (cursor.position + decode(cursor.position, NULL)) % _size;
+  decode(cursor.position, cursor.values);
+  cursor.sequence++;
+  return true;
+}
+
+/*!
+ *  @brief  Summarise one field over the whole history.
+ *  @param  field
+ *          The field index.
+ *  @param  low, high, mean
+ *          Set to the minimum, maximum and mean of the field, skipping LOFTFRAME_NAN.
+ *  @return False if there are no values of the field.
+ */
+
+bool loftHistory::summary(uint8_t field, int16_t &low, int16_t &high, int16_t &mean) {
+  if (field >= _fields) {
+    return false;
+  }
+  int16_t value = _oldest[field];
+  int32_t total = 0;
+  uint16_t count = 0;
+  uint16_t position = _head;
+  for (uint16_t line = 0; line < _lines; line++) {
+    if (line > 0) {
+      position = (position + decode(position, NULL)) % _size;
+      decode(position, &value, field);
+    }
+    if (value != LOFTFRAME_NAN) {
+      if ((count == 0) || (value < low)) {
+        low = value;
+      }
+      if ((count == 0) || (value > high)) {
+        high = value;
+      }
+      total += value;
+      count++;
+    }
+  }
+  if (count == 0) {
+    return false;
+  }
+  mean = (total >= 0) ? (total + count / 2) / count : (total - count / 2) / (int32_t)count;
+  return true;
+}
+
+uint16_t loftHistory::first() {
+  return _first;
+}
+
+uint16_t loftHistory::end() {
+  return _first + _lines;
+}
+
+uint16_t loftHistory::lines() {
+  return _lines;
+}
+
+uint16_t loftHistory::used() {
+  return _used;
+}
+
+uint8_t loftHistory::fields() {
+  return _fields;
+}
+
+uint8_t loftHistory::readByte(uint16_t position, uint8_t offset) {
+  return eeprom_read_byte((const uint8_t *)(_start + (position + offset) % _size));
+}
+
+//Apply the changes in the line at position to values, every field, or just one when field is given and values points
+//  to that field alone. With no values, the line is only measured. Returns the line length.
+uint8_t loftHistory::decode(uint16_t position, int16_t *values, uint8_t field) {
+  uint8_t mapSize = (_fields + 7) / 8;
+  uint8_t length = mapSize;
+  uint8_t map = 0;
+  for (uint8_t index = 0; index < _fields; index++) {
+    if (index % 8 == 0) {
+      map = readByte(position, index / 8);
+    }
+    if (map & (1 << (index % 8))) {
+      int8_t change = readByte(position, length++);
+      int16_t value = 0;
+      if (change == LOFTHISTORY_ESCAPE) {
+        value = readByte(position, length) | ((uint16_t)readByte(position, length + 1) << 8);
+        length += 2;
+      }
+      if (values != NULL) {
+        int16_t *target = (field == LOFTHISTORY_NOFIELD) ? values + index : ((index == field) ? values : NULL);
+        if (target != NULL) {
+          *target = (change == LOFTHISTORY_ESCAPE) ? value : *target + change;
+        }
+      }
+    }
+  }
+  return length;
+}
+
+//Drop the oldest line, moving the oldest fields on to the line after it.
+void loftHistory::dropOldest() {
+  if (_lines == 0) {
+    return;
+  }
+  uint8_t length = decode(_head, NULL);
+  _head = (_head + length) % _size;
+  _used -= length;
+  _lines--;
+  _first++;
+  if (_lines > 0) {
+    decode(_head, _oldest);
+  }
+}
+
+//EOF
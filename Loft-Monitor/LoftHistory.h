@@ -0,0 +1,89 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Data History.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Keeps recent data lines in an EEPROM ring buffer, so a gap in the capture (CoolTerm not capturing, the PC restarting)
+  can be filled in afterwards, from the history, without sending the data any more often.
+
+Each line is kept as its binary frame fields (LoftFrame.h), scaled integers, delta encoded against the line before -
+  a bitmap of the fields that changed, then for each changed field its change as one signed byte, or, if it changed by
+  more than 127 (1.27 deg C), LOFTHISTORY_ESCAPE and then the whole value in two bytes. So an unchanged line is just
+  the bitmap, and a typical line only a few bytes more, rather than 2 bytes a field.
+
+When the buffer is full the oldest lines are dropped. The fields of the oldest line, and of the newest, are kept
+  decoded in RAM, so the lines after the oldest can always be decoded, and the next line encoded.
+
+A new line is written a byte at a time by drain(), called between scheduler tasks, like loftState, and is only part
+  of the history once it is all written. Nothing is wear-levelled here, the ring spreads the writes by itself. The
+  history is started afresh at each restart.
+
+Usage:
+  int16_t historyValues[2 * FIELDS];
+  uint8_t historyLine[LOFTHISTORY_LINESIZE(FIELDS)];
+  loftHistory history(384, 640, FIELDS, historyValues, historyLine);
+  history.add(fields, FIELDS);          //Every few data lines.
+  history.drain();                      //In loop().
+
+Each line has a sequence number, counting from 0 at start up, so a host can ask for everything after the last line it
+  has. A host that asks for a line ahead of the history was last sent lines from before a restart, and gets every line. To read the lines, with a cursor whose values array holds the fields of one line:
+  if (history.seek(cursor, sequence)) {
+    do {
+      ...                               //cursor.values holds the fields of line cursor.sequence.
+    } while (history.next(cursor));
+  }
+*/
+
+#ifndef LOFTHISTORY_H
+  #define LOFTHISTORY_H
+
+  #include <Arduino.h>
+  #include <avr/eeprom.h>
+  #include "LoftFrame.h"                //LOFTFRAME_NAN.
+
+  #define LOFTHISTORY_ESCAPE -128       //The change is too big for one byte, the whole value follows.
+  #define LOFTHISTORY_NOFIELD 0xFF
+  #define LOFTHISTORY_LINESIZE(fields) (((fields) + 7) / 8 + 3 * (fields))  //The longest encoded line.
+
+  struct historyCursor {
+    uint16_t sequence;                  //The line that values holds.
+    uint16_t position;                  //Where that line starts in the ring.
+    int16_t *values;                    //Its fields, preallocated by the caller.
+  };
+
+  class loftHistory {
+  public:
+    loftHistory(uint16_t start, uint16_t size, uint8_t fields, int16_t *values, uint8_t *line);
+    bool add(const int16_t *fields, uint8_t count);
+    void drain();                       //Write the next byte of a new line, if the EEPROM is ready.
+    bool writing();                     //A new line is still being written.
+    bool seek(historyCursor &cursor, uint16_t sequence);
+    bool next(historyCursor &cursor);
+    bool summary(uint8_t field, int16_t &low, int16_t &high, int16_t &mean);
+    uint16_t first();                   //The sequence number of the oldest line.
+    uint16_t end();                     //The sequence number the next line will have.
+    uint16_t lines();
+    uint16_t used();                    //Bytes.
+    uint8_t fields();
+
+  private:
+    uint16_t _start;                    //The EEPROM address of the ring.
+    uint16_t _size;
+    uint8_t _fields;
+    int16_t *_oldest;                   //The fields of the oldest line, the first half of the values buffer...
+    int16_t *_newest;                   //...and of the newest, including one still being written.
+    uint8_t *_line;                     //The line being written, LOFTHISTORY_LINESIZE(fields) bytes.
+    uint8_t _lineLength;
+    uint8_t _written;                   //Bytes of the line written, _lineLength when done.
+    uint16_t _head;                     //Where the oldest line starts.
+    uint16_t _used;
+    uint16_t _first;
+    uint16_t _lines;
+    uint8_t readByte(uint16_t position, uint8_t offset);
+    uint8_t decode(uint16_t position, int16_t *values, uint8_t field = LOFTHISTORY_NOFIELD);
+    void dropOldest();
+  };
+#endif
+
+//EOF
@@ -0,0 +1,196 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Buffered Serial Output.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftOutput.h"
+
+/*!
+ *  @brief  Instantiates a new loftOutput class.
+ *  @param  port
+ *          The port to send the output to, e.g. Serial.
+ *  @param  buffer
+ *          The ring buffer, preallocated by the caller.
+ *  @param  size
+ *          The size of the buffer, in bytes. A record longer than this is always dropped (dropWhenFull = true).
+ *  @param  dropWhenFull
+ *          True to drop a whole record when the buffer is full, false to wait for the port instead.
+ */
+
+loftOutput::loftOutput(Print &port, uint8_t *buffer, uint16_t size, bool dropWhenFull) {
+  _port = &port;
+  _buffer = buffer;
+  _size = size;
+  _dropWhenFull = dropWhenFull;
+  _head = 0;
+  _end = 0;
+  _used = 0;
+  _record = 0;
+  _discarding = false;
+  resetStats();
+}
+
+size_t loftOutput::write(uint8_t data) {
+  if (_discarding) {
+    _dropped++;
+    return 0;
+  }
+  if (_used == _size) {
+    if (_dropWhenFull) {
+      //Take the record back out of the buffer, and drop the rest of it too.
+      _dropped += _record + 1;
+      _used -= _record;
+      _end = (_end >= _record) ? _end - _record : _end + _size - _record;
+      _record = 0;
+      _discarding = true;
+      return 0;
+    }
+    commit();
+    sendByte();                                     //Waits for the port to have room.
+  }
+  _buffer[_end] = data;
+  if (++_end == _size) {
+    _end = 0;
+  }
+  _used++;
+  _record++;
+  if (_used > _maxUsed) {
+    _maxUsed = _used;
+  }
+  return 1;
+}
+
+size_t loftOutput::write(const uint8_t *data, size_t count) {
+  size_t written = 0;
+  while (count-- > 0) {
+    written += write(*data++);
+  }
+  return written;
+}
+
+int loftOutput::availableForWrite() {
+  return _size - _used;
+}
+
+void loftOutput::flush() {
+  commit();
+  while (_used > 0) {
+    sendByte();
+  }
+}
+
+void loftOutput::drain() {
+  commit();
+  int room = _port->availableForWrite();
+  while ((_used > 0) && (room-- > 0)) {
+    sendByte();
+  }
+}
+
+/*!
+ *  @brief  Print a float with a fixed number of decimal places. The text is identical to Print::print(number, digits).
+ *  @param  number
+ *          The number to print.
+ *  @param  digits
+ *          The decimal places.
+ *  @return The number of characters queued.
+ */
+
+size_t loftOutput::printFixed(float number, uint8_t digits) {
+  char text[1 + LOFTOUTPUT_MAXDIGITS + 1 + 2 * LOFTOUTPUT_MAXDIGITS];
+  uint8_t length = 0;
+  if (digits > LOFTOUTPUT_MAXDIGITS) {
+    digits = LOFTOUTPUT_MAXDIGITS;
+  }
+  if (isnan(number)) {
+    return write("nan");
+  }
+  if (isinf(number)) {
+    return write("inf");
+  }
+  if ((number > 4294967040.0) || (number < -4294967040.0)) {
+    return write("ovf");
+  }
+  if (number < 0.0) {
+    text[length++] = '-';
+    number = -number;
+  }
+  //Round, and split off the whole number part, with the same float steps as Print::printFloat().
+  float rounding = 0.5;
+  for (uint8_t digit = 0; digit < digits; digit++) {
+    rounding /= 10.0;
+  }
+  number += rounding;
+  uint32_t wholePart = (uint32_t)number;
+  float remainder = number - (float)wholePart;
+  length += formatUnsigned(wholePart, &text[length]);
+  if (digits > 0) {
+    text[length++] = '.';
+  }
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    uint16_t toPrint = (uint16_t)remainder;
+    length += formatUnsigned(toPrint, &text[length]);
+    remainder -= toPrint;
+  }
+  return write((const uint8_t *)text, length);
+}
+
+size_t loftOutput::printUnsigned(uint32_t number) {
+  char text[LOFTOUTPUT_MAXDIGITS];
+  return write((const uint8_t *)text, formatUnsigned(number, text));
+}
+
+uint16_t loftOutput::queued() {
+  return _used;
+}
+
+uint16_t loftOutput::maxQueued() {
+  return _maxUsed;
+}
+
+uint32_t loftOutput::dropped() {
+  return _dropped;
+}
+
+void loftOutput::resetStats() {
+  _maxUsed = _used;
+  _dropped = 0;
+}
+
+//End the current record. Its bytes can now be sent.
+void loftOutput::commit() {
+  _record = 0;
+  _discarding = false;
+}
+
+void loftOutput::sendByte() {
+  _port->write(_buffer[_head]);
+  if (++_head == _size) {
+    _head = 0;
+  }
+  _used--;
+}
+
+//Convert to decimal digits, using 16 bit division once the number is small enough. Returns the number of digits.
+uint8_t loftOutput::formatUnsigned(uint32_t number, char *text) {
+  char reversed[LOFTOUTPUT_MAXDIGITS];
+  uint8_t count = 0;
+  while (number > 0xFFFF) {
+    reversed[count++] = '0' + (number % 10);
+    number /= 10;
+  }
+  uint16_t small = number;
+  do {
+    reversed[count++] = '0' + (small % 10);
+    small /= 10;
+  } while (small > 0);
+  for (uint8_t index = 0; index < count; index++) {
+    text[index] = reversed[count - 1 - index];
+  }
+  return count;
+}
+
+//EOF
@@ -0,0 +1,68 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Buffered Serial Output.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+A Print class that queues its output in a preallocated ring buffer, instead of waiting for the serial port. The queue
+  is drained by drain(), called between scheduler tasks, which only sends as many bytes as the serial TX buffer has
+  room for, so it never waits.
+
+Output is queued in records, everything written between two drain() calls, which is everything one task prints.
+  When the buffer is full a record is either dropped whole (dropWhenFull = true), so a CSV capture never gets a
+  partial line, or the write waits for the serial port to take the oldest bytes (dropWhenFull = false).
+  The bytes queued, the most ever queued, and the bytes dropped are counted.
+
+printFixed() formats a float with exactly the same float steps, and so exactly the same text, as Print::print(float),
+  but converts the whole number part with 16 bit, rather than 32 bit, division when it can, and writes the whole
+  number into the buffer in one go, rather than one virtual write() per character.
+
+Usage:
+  uint8_t outputBuffer[256];
+  loftOutput serialOut(Serial, outputBuffer, sizeof(outputBuffer), true);
+  serialOut.printFixed(temperature);    //Same as Serial.print(temperature).
+  serialOut.drain();                    //Send what the serial port has room for.
+*/
+
+#ifndef LOFTOUTPUT_H
+  #define LOFTOUTPUT_H
+
+  #include <Arduino.h>
+
+  #define LOFTOUTPUT_MAXDIGITS 10     //The digits in the largest uint32_t.
+
+  class loftOutput : public Print {
+  public:
+    loftOutput(Print &port, uint8_t *buffer, uint16_t size, bool dropWhenFull = true);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t count);
+    using Print::write;
+    int availableForWrite();
+    void flush();                                   //Send everything queued, waiting for the serial port.
+    void drain();                                   //Send what the serial port has room for, without waiting.
+    size_t printFixed(float number, uint8_t digits = 2);
+    size_t printUnsigned(uint32_t number);
+    uint16_t queued();                              //Bytes waiting to be sent.
+    uint16_t maxQueued();                           //The most bytes ever waiting to be sent.
+    uint32_t dropped();                             //Bytes dropped because the buffer was full.
+    void resetStats();
+
+  private:
+    Print *_port;
+    uint8_t *_buffer;
+    uint16_t _size;
+    bool _dropWhenFull;
+    uint16_t _head;                                 //The next byte to send.
+    uint16_t _end;                                  //Where the next byte is queued.
+    uint16_t _used;                                 //Bytes queued, including the current record.
+    uint16_t _record;                               //Bytes queued in the current record.
+    bool _discarding;                               //The current record has been dropped.
+    uint16_t _maxUsed;
+    uint32_t _dropped;
+    void commit();
+    void sendByte();
+    uint8_t formatUnsigned(uint32_t number, char *text);
+  };
+#endif
+
+//EOF
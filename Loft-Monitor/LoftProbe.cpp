@@ -0,0 +1,73 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Latency Probes.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftProbe.h"
+
+loftProbe::loftProbe() {
+  reset();
+}
+
+/*!
+ *  @brief  Add a time to the stats and the histogram.
+ *  @param  time
+ *          The time taken, us. Times are not added once the count is full, so the mean stays true.
+ */
+
+void loftProbe::add(uint32_t time) {
+  if (_count == 0xFFFF) {
+    return;
+  }
+  if ((_count == 0) || (time < _low)) {
+    _low = time;
+  }
+  if (time > _high) {
+    _high = time;
+  }
+  _total += time;
+  _count++;
+  uint8_t index = 0;
+  uint32_t limit = LOFTPROBE_FIRSTLIMIT;
+  while ((index < LOFTPROBE_BUCKETS - 1) && (time >= limit)) {
+    limit <<= 2;
+    index++;
+  }
+  if (_buckets[index] < 0xFF) {
+    _buckets[index]++;
+  }
+}
+
+uint16_t loftProbe::count() {
+  return _count;
+}
+
+uint32_t loftProbe::low() {
+  return _low;
+}
+
+uint32_t loftProbe::high() {
+  return _high;
+}
+
+uint32_t loftProbe::mean() {
+  return (_count > 0) ? (_total + _count / 2) / _count : 0;
+}
+
+uint8_t loftProbe::bucket(uint8_t index) {
+  return (index < LOFTPROBE_BUCKETS) ? _buckets[index] : 0;
+}
+
+void loftProbe::reset() {
+  _low = 0;
+  _high = 0;
+  _total = 0;
+  _count = 0;
+  for (uint8_t index = 0; index < LOFTPROBE_BUCKETS; index++) {
+    _buckets[index] = 0;
+  }
+}
+
+//EOF
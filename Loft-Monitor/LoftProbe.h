@@ -0,0 +1,64 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Latency Probes.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Times a stretch of code, a sensor read or the output of a data line, in micros(), every time it runs, and keeps the
+  count, min, max and mean of the times, and a histogram of them, until it is reset. The scheduler's task stats only
+  have the max and mean of a whole task, and only without PLOTDATA - the histogram shows whether a slow max is a
+  one off or a long tail, e.g. a DHT read waiting on a retry.
+
+The histogram buckets are on a log scale, each 4 times the one before:
+  Bucket  0      1      2       3        4       5        6        7
+  Time    <16us  <64us  <256us  <1.02ms  <4.1ms  <16.4ms  <65.5ms  65.5ms or more
+The bucket counts stop at 255, the count at 65535. micros() steps in 4us on a 16MHz Nano, so the shortest times all
+  land in the first bucket.
+
+This header is shared with the host report, Tools/LoftProbeReport, so it must compile without Arduino.h.
+
+Usage:
+  loftProbe probe;
+  uint32_t start = micros();
+  ...                                   //The code to time.
+  probe.add(micros() - start);
+*/
+
+#ifndef LOFTPROBE_H
+  #define LOFTPROBE_H
+
+  #ifdef ARDUINO
+    #include <Arduino.h>
+  #else
+    #include <stdint.h>
+  #endif
+
+  #define LOFTPROBE_BUCKETS 8
+  #define LOFTPROBE_FIRSTLIMIT 16     //us, the first bucket's upper limit. Each limit is 4 times the one before.
+
+  //The upper limit of a histogram bucket, us, 0 for the last bucket, which has no limit.
+  inline uint32_t loftProbeLimit(uint8_t bucket) {
+    return (bucket < LOFTPROBE_BUCKETS - 1) ? (uint32_t)LOFTPROBE_FIRSTLIMIT << (2 * bucket) : 0;
+  }
+
+  class loftProbe {
+  public:
+    loftProbe();
+    void add(uint32_t time);          //us.
+    uint16_t count();
+    uint32_t low();                   //us, 0 when there are no times.
+    uint32_t high();
+    uint32_t mean();
+    uint8_t bucket(uint8_t index);
+    void reset();
+
+  private:
+    uint32_t _low;
+    uint32_t _high;
+    uint32_t _total;
+    uint16_t _count;
+    uint8_t _buckets[LOFTPROBE_BUCKETS];
+  };
+#endif
+
+//EOF
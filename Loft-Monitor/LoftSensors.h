@@ -0,0 +1,142 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Compile Time Sensor List.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Each sensor is wrapped in an adapter, a struct of static members that starts the sensor, adds its read tasks, caches
+  its readings, and prints or frames them. The enabled adapters are listed once, in a sensorList type, and the list
+  calls each adapter in turn, in list order, which is also the CSV column order. All the calls are resolved at compile
+  time, so they are inlined, and the column and temperature counts are constants - nothing is counted at run time.
+
+An adapter inherits sensorAdapter, and hides just the members it needs, e.g.
+  struct ldrSensor : sensorAdapter {
+    static constexpr uint8_t columns = 1;
+    static constexpr uint8_t analogs = 1;
+    static void begin();
+    static void show();
+    ...
+  };
+  typedef sensorList<bme280Sensor, ldrSensor, sensorListEnd> sensors;
+  sensors::begin();                   //Calls bme280Sensor::begin(), then ldrSensor::begin().
+
+Sensors that differ only in their device, like the DHT and the analog temperature sensors, share one adapter template.
+*/
+
+#ifndef LOFTSENSORS_H
+  #define LOFTSENSORS_H
+
+  #include <Arduino.h>
+
+  //The default adapter members, which do nothing.
+  struct sensorAdapter {
+    static constexpr uint8_t columns = 0;             //Data columns.
+    static constexpr uint8_t temperatures = 0;        //Temperature columns, used for the average temperature.
+    static constexpr uint8_t analogs = 0;             //1 for a sensor read by the analog sensor task.
+    static constexpr uint8_t tasks = 0;               //The most scheduler tasks addTasks() adds.
+    static constexpr uint16_t frameBit = 0;           //The LFM_* sensor mask bit, see LoftFrame.h.
+    static constexpr int16_t deadband = 0;            //The smallest change the sparse lines send, in binary frame units.
+    static void begin() {}                            //Start the sensor, from setup().
+    static void addTasks() {}                         //Add the sensor read tasks to the scheduler.
+    static void readAnalog() {}                       //Read the sensor now, from the analog sensor task.
+    static void collectAnalog() {}                    //Collect the reading from a finished analog sensor sweep.
+    static void printHeader(Print &) {}               //Print the column names, each followed by the delimiter.
+    static void show() {}                             //Print the cached readings.
+    template<typename frameType> static void addFields(frameType &) {}  //Add the cached readings to a binary frame.
+    static float firstTemperature() { return 0.0; }   //The first cached temperature.
+    static void addTemperatures(float &) {}           //Add all the cached temperatures to a total.
+    template<typename fusionType> static void fuse(fusionType &, uint8_t) {}  //Fuse the new temperatures, from this channel on.
+  };
+
+  //Ends a sensor list.
+  struct sensorListEnd : sensorAdapter {};
+
+  template<typename sensor, typename... more> struct sensorList {
+    typedef sensorList<more...> rest;
+    static constexpr uint8_t count = 1 + rest::count;
+    static constexpr uint8_t columns = sensor::columns + rest::columns;
+    static constexpr uint8_t temperatures = sensor::temperatures + rest::temperatures;
+    static constexpr uint8_t analogs = sensor::analogs + rest::analogs;
+    static constexpr uint8_t tasks = sensor::tasks + rest::tasks;
+    static constexpr uint16_t frameMask = sensor::frameBit | rest::frameMask;
+
+    static void begin() {
+      sensor::begin();
+      rest::begin();
+    }
+
+    static void addTasks() {
+      sensor::addTasks();
+      rest::addTasks();
+    }
+
+    static void readAnalog() {
+      sensor::readAnalog();
+      rest::readAnalog();
+    }
+
+    static void collectAnalog() {
+      sensor::collectAnalog();
+      rest::collectAnalog();
+    }
+
+    static void printHeader(Print &out) {
+      sensor::printHeader(out);
+      rest::printHeader(out);
+    }
+
+    static void show() {
+      sensor::show();
+      rest::show();
+    }
+
+    template<typename frameType> static void addFields(frameType &frame) {
+      sensor::addFields(frame);
+      rest::addFields(frame);
+    }
+
+    //The deadband of a column, the deadband of the sensor it belongs to.
+    static int16_t columnDeadband(uint8_t column) {
+      return (column < sensor::columns) ? sensor::deadband : rest::columnDeadband(column - sensor::columns);
+    }
+
+    //The first temperature in the list, from the first sensor that has one.
+    static float firstTemperature() {
+      return (sensor::temperatures > 0) ? sensor::firstTemperature() : rest::firstTemperature();
+    }
+
+    //Add the temperatures to the total in list order, so the sum is always rounded the same way.
+    static void addTemperatures(float &total) {
+      sensor::addTemperatures(total);
+      rest::addTemperatures(total);
+    }
+
+    //Each temperature is a fusion channel, numbered in list order.
+    template<typename fusionType> static void fuse(fusionType &fusion, uint8_t channel = 0) {
+      sensor::fuse(fusion, channel);
+      rest::fuse(fusion, channel + sensor::temperatures);
+    }
+  };
+
+  template<> struct sensorList<sensorListEnd> {
+    static constexpr uint8_t count = 0;
+    static constexpr uint8_t columns = 0;
+    static constexpr uint8_t temperatures = 0;
+    static constexpr uint8_t analogs = 0;
+    static constexpr uint8_t tasks = 0;
+    static constexpr uint16_t frameMask = 0;
+    static void begin() {}
+    static void addTasks() {}
+    static void readAnalog() {}
+    static void collectAnalog() {}
+    static void printHeader(Print &) {}
+    static void show() {}
+    template<typename frameType> static void addFields(frameType &) {}
+    static int16_t columnDeadband(uint8_t) { return 0; }
+    static float firstTemperature() { return 0.0; }
+    static void addTemperatures(float &) {}
+    template<typename fusionType> static void fuse(fusionType &, uint8_t = 0) {}
+  };
+#endif
+
+//EOF
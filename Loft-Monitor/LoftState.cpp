@@ -0,0 +1,155 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Persistent State.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftState.h"
+#include <avr/wdt.h>
+
+#ifdef __AVR__
+  //Not cleared at start up (.bss is cleared in .init4), so the reset flags saved in .init0 or .init3 survive.
+  static uint8_t resetFlags __attribute__((section(".noinit")));
+
+  #ifdef LOFTSTATE_OPTIBOOT
+    //Runs first, before even the zero register is set, so only r2 (Optiboot's copy of MCUSR) is saved.
+    void saveResetFlags() __attribute__((naked, used, section(".init0")));
+    void saveResetFlags() {
+      __asm__ __volatile__("sts %0, r2\n" : "=m"(resetFlags) :);
+    }
+  #endif
+
+  //Runs before the C++ constructors. Without a bootloader MCUSR still holds the flags. Clearing WDRF lets the watchdog,
+  //  which stays on after a watchdog reset, be stopped.
+  void stopWatchdog() __attribute__((naked, used, section(".init3")));
+#else
+  //The host simulation (Tools/HostSim) sets MCUSR, and calls stopWatchdog() itself, before setup().
+  static uint8_t resetFlags;
+#endif
+
+void stopWatchdog() {
+  #ifdef LOFTSTATE_OPTIBOOT
+    if (MCUSR != 0) {
+      resetFlags = MCUSR;
+    }
+  #else
+    resetFlags = MCUSR;
+  #endif
+  MCUSR = 0;
+  wdt_disable();
+}
+
+uint8_t loftResetFlags() {
+  return resetFlags;
+}
+
+/*!
+ *  @brief  Instantiates a new loftStore class.
+ *  @param  buffer
+ *          The slot buffer, LOFTSTORE_OVERHEAD + size bytes, preallocated by the caller.
+ *  @param  size
+ *          The record size, in bytes.
+ *  @param  start
+ *          The EEPROM address of the area to save in.
+ *  @param  length
+ *          The size of the area, in bytes. It is split into as many slots as fit.
+ *  @param  version
+ *          The record layout version. Change it when the record changes.
+ */
+
+loftStore::loftStore(uint8_t *buffer, uint8_t size, uint16_t start, uint16_t length, uint8_t version) {
+  _buffer = buffer;
+  _size = size;
+  _start = start;
+  _slots = length / (size + LOFTSTORE_OVERHEAD);
+  _version = version;
+  _next = 0;
+  _sequence = 0;
+  _address = 0;
+  _written = size + LOFTSTORE_OVERHEAD;
+}
+
+/*!
+ *  @brief  Restore the newest saved record, and carry on saving after it.
+ *  @param  record
+ *          The record to restore, size bytes. It is not changed if there is no saved record.
+ *  @return True if a saved record was restored.
+ */
+
+bool loftStore::load(void *record) {
+  bool found = false;
+  uint8_t slotSize = _size + LOFTSTORE_OVERHEAD;
+  for (uint8_t slot = 0; slot < _slots; slot++) {
+    eeprom_read_block(_buffer, (const void *)(_start + slot * slotSize), slotSize);
+    uint16_t sequence = _buffer[0] | ((uint16_t)_buffer[1] << 8);
+    uint16_t crc = _buffer[slotSize - 2] | ((uint16_t)_buffer[slotSize - 1] << 8);
+    //The newest is the one furthest ahead, allowing for the sequence number wrapping round.
+    if ((crc == checksum()) && (!found || ((int16_t)(sequence - _sequence) >= 0))) {
+      found = true;
+      memcpy(record, _buffer + 2, _size);
+      _sequence = sequence;
+      _next = slot;
+    }
+  }
+  if (found) {
+    _sequence++;
+    _next = (_next + 1) % _slots;
+  }
+  return found;
+}
+
+/*!
+ *  @brief  Start saving a record in the next slot. drain() writes it.
+ *  @param  record
+ *          The record to save, size bytes. It is copied, so it can change straight away.
+ *  @return False if the last save is still being written, or there are no slots, and this one is skipped.
+ */
+
+bool loftStore::save(const void *record) {
+  if (writing() || (_slots == 0)) {
+    return false;
+  }
+  uint8_t slotSize = _size + LOFTSTORE_OVERHEAD;
+  _buffer[0] = _sequence & 0xFF;
+  _buffer[1] = _sequence >> 8;
+  memcpy(_buffer + 2, record, _size);
+  uint16_t crc = checksum();
+  _buffer[slotSize - 2] = crc & 0xFF;
+  _buffer[slotSize - 1] = crc >> 8;
+  _address = _start + _next * slotSize;
+  _written = 0;
+  _sequence++;
+  _next = (_next + 1) % _slots;
+  return true;
+}
+
+void loftStore::drain() {
+  if (writing() && eeprom_is_ready()) {
+    eeprom_update_byte((uint8_t *)(_address + _written), _buffer[_written]);
+    _written++;
+  }
+}
+
+bool loftStore::writing() {
+  return _written < _size + LOFTSTORE_OVERHEAD;
+}
+
+uint8_t loftStore::slots() {
+  return _slots;
+}
+
+uint16_t loftStore::sequence() {
+  return _sequence;
+}
+
+//The CRC of the version, the sequence number and the record in the buffer.
+uint16_t loftStore::checksum() {
+  uint16_t crc = loftFrameCRC(LOFTFRAME_CRCINIT, _version);
+  for (uint8_t index = 0; index < _size + 2; index++) {
+    crc = loftFrameCRC(crc, _buffer[index]);
+  }
+  return crc;
+}
+
+//EOF
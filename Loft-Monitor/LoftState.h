@@ -0,0 +1,72 @@
+/*
+Loft Environment Monitor Sensor Data Collector - Persistent State.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Saves a small record (the band, the trend, some counters) in EEPROM, so it can be restored after a restart.
+
+The EEPROM area is split into slots, one record each, and each save goes into the next slot round the ring, so the
+  writes are spread across the whole area (wear-levelling). Each slot holds a sequence number, the record, and a CRC
+  of both. load() reads every slot, and restores the valid record with the newest sequence number. So a save cut off
+  by a reset, or a new (erased) EEPROM, is just skipped, and the record from the save before is restored.
+
+Writing an EEPROM byte takes 3.3ms, far too long to wait for in a task, so save() only copies the record into a
+  preallocated buffer. drain(), called between scheduler tasks like loftOutput::drain(), writes the next byte when the
+  EEPROM is ready, and only if it has changed.
+
+The version is part of the CRC, so a record saved by a sketch with a different record layout is never restored.
+
+Usage:
+  uint8_t stateBuffer[sizeof(myState) + LOFTSTORE_OVERHEAD];
+  loftStore stateStore(stateBuffer, sizeof(myState), 0, E2END + 1, 1);
+  stateStore.load(&state);              //In setup().
+  stateStore.save(&state);              //Every few minutes.
+  stateStore.drain();                   //In loop().
+
+The reset flags (MCUSR) are also captured here, before the Arduino core starts, and the watchdog is stopped, so a
+  watchdog reset does not keep resetting the MCU while the sketch starts. Optiboot clears MCUSR, but passes it in r2,
+  which is only trusted with LOFTSTATE_OPTIBOOT. Other bootloaders leave r2 holding anything, and the old Nano one
+  clears MCUSR, so without it the flags are MCUSR's, 0 (a cold start) when a bootloader has cleared them.
+
+https://www.microchip.com/en-us/application-notes/an2526
+https://github.com/Optiboot/optiboot/wiki/HowOptibootWorks
+*/
+
+#ifndef LOFTSTATE_H
+  #define LOFTSTATE_H
+
+  #include <Arduino.h>
+  #include <avr/eeprom.h>
+  #include "LoftFrame.h"                //loftFrameCRC().
+
+  #define LOFTSTORE_OVERHEAD 4          //The sequence number and CRC bytes in each slot.
+  //#define LOFTSTATE_OPTIBOOT          //Enable this when the bootloader is Optiboot (the "new" Nano bootloader), to take the reset flags from r2.
+
+  uint8_t loftResetFlags();             //MCUSR at the last reset, e.g. _BV(WDRF) after a watchdog reset.
+
+  class loftStore {
+  public:
+    loftStore(uint8_t *buffer, uint8_t size, uint16_t start, uint16_t length, uint8_t version);
+    bool load(void *record);
+    bool save(const void *record);
+    void drain();                       //Write the next byte of a save, if the EEPROM is ready.
+    bool writing();                     //A save is still being written.
+    uint8_t slots();
+    uint16_t sequence();                //The sequence number of the next save.
+
+  private:
+    uint8_t *_buffer;                   //The slot being written, LOFTSTORE_OVERHEAD + size bytes.
+    uint8_t _size;                      //The record size, in bytes.
+    uint16_t _start;                    //The EEPROM address of the first slot.
+    uint8_t _slots;
+    uint8_t _version;
+    uint8_t _next;                      //The next slot to write.
+    uint16_t _sequence;
+    uint16_t _address;                  //The EEPROM address of the slot being written.
+    uint8_t _written;                   //Bytes of it written, LOFTSTORE_OVERHEAD + size when done.
+    uint16_t checksum();
+  };
+#endif
+
+//EOF
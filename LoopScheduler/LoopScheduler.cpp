@@ -0,0 +1,226 @@
+/*
+Arduino library for a cooperative, millis() based, task scheduler.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+https://en.wikipedia.org/wiki/Cooperative_multitasking
+https://en.wikipedia.org/wiki/Earliest_deadline_first_scheduling
+https://www.arduino.cc/reference/en/language/functions/time/millis/
+*/
+
+#include "LoopScheduler.h"
+
+/*!
+ *  @brief  Instantiates a new loopScheduler class, with no tasks.
+ *  @param  tasks
+ *          The task table, allocated by the caller.
+ *  @param  size
+ *          The number of tasks the table has room for.
+ */
+
+loopScheduler::loopScheduler(lsTask *tasks, uint8_t size) {
+  _tasks = tasks;
+  _size = size;
+  _count = 0;
+  _idleHook = NULL;
+}
+
+/*!
+ *  @brief  Add a task to the scheduler. The task is enabled.
+ *  @param  task
+ *          The function to run. It must not block.
+ *  @param  period
+ *          Milliseconds between runs, 1 - 65535. 0 runs the task once, and then disables it.
+ *  @param  delay
+ *          Milliseconds until the first run.
+ *  @param  deadline
+ *          Milliseconds after the task is due by which the run should have finished. 0 uses the period.
+ *  @param  name
+ *          Optional task name, for reporting, e.g. F("Heartbeat").
+ *  @return The task number, or _LSNOTASK if there is no room for another task.
+ */
+
+int8_t loopScheduler::add(lsTaskFunc task, uint16_t period, uint16_t delay, uint16_t deadline, const __FlashStringHelper *name) {
+  if (_count >= _size) {
+    return _LSNOTASK;
+  }
+  lsTask *newTask = &_tasks[_count];
+  newTask->function = task;
+  newTask->name = name;
+  newTask->period = period;
+  if (deadline == 0) {
+    deadline = period;
+  }
+  newTask->deadline = deadline;
+  newTask->runs = 0;
+  newTask->overruns = 0;
+  newTask->maxLateness = 0;
+  newTask->maxExecTime = 0;
+  newTask->totalExecTime = 0;
+  enable(_count, delay);
+  return _count++;
+}
+
+uint8_t loopScheduler::count() {
+  return _count;
+}
+
+void loopScheduler::setPeriod(int8_t task, uint16_t period) {
+  if (validTask(task)) {
+    _tasks[task].period = period;
+  }
+}
+
+void loopScheduler::enable(int8_t task, uint16_t delay) {
+  if ((task >= 0) && (task < _size)) {
+    _tasks[task].due = millis() + delay;
+    _tasks[task].enabled = true;
+  }
+}
+
+void loopScheduler::disable(int8_t task) {
+  if (validTask(task)) {
+    _tasks[task].enabled = false;
+  }
+}
+
+bool loopScheduler::isEnabled(int8_t task) {
+  return validTask(task) && _tasks[task].enabled;
+}
+
+/*!
+ *  @brief  Set a function to be called when no task is due, e.g. to sleep until the next timer interrupt.
+ *  @param  hook
+ *          The idle function, passed the milliseconds until the next task is due. NULL removes the hook.
+ */
+
+void loopScheduler::setIdleHook(lsIdleFunc hook) {
+  _idleHook = hook;
+}
+
+/*!
+ *  @brief  Run the due task with the earliest deadline, and record its stats. Call this from loop().
+ *          A task that is due again by the time it finishes runs again as soon as possible, but only once,
+ *          so a long delay does not cause a burst of catch up runs.
+ *  @return True if a task was run, false if no task was due (and the idle hook was called).
+ */
+
+bool loopScheduler::run() {
+  uint32_t now = millis();
+  int8_t next = _LSNOTASK;
+  uint32_t nextDeadline = 0;
+  for (uint8_t index = 0; index < _count; index++) {
+    lsTask *task = &_tasks[index];
+    if (task->enabled && ((int32_t)(now - task->due) >= 0)) {
+      uint32_t deadline = task->due + task->deadline;
+      if ((next == _LSNOTASK) || ((int32_t)(deadline - nextDeadline) < 0)) {
+        next = index;
+        nextDeadline = deadline;
+      }
+    }
+  }
+  if (next == _LSNOTASK) {
+    if (_idleHook != NULL) {
+      _idleHook(timeToNext());
+    }
+    return false;
+  }
+  lsTask *task = &_tasks[next];
+  uint32_t due = task->due;
+  uint32_t lateness = now - due;
+  uint32_t execStart = micros();
+  task->function();
+  uint32_t execTime = micros() - execStart;
+  uint32_t finish = millis();
+  //Record the stats.
+  if (task->runs < 0xFFFF) {
+    task->runs++;
+  }
+  if ((finish - due) > task->deadline) {
+    if (task->overruns < 0xFFFF) {
+      task->overruns++;
+    }
+  }
+  if (lateness > task->maxLateness) {
+    task->maxLateness = (lateness > 0xFFFF) ? 0xFFFF : lateness;
+  }
+  if (execTime > task->maxExecTime) {
+    task->maxExecTime = execTime;
+  }
+  task->totalExecTime += execTime;
+  //Schedule the next run, unless the task disabled or rescheduled itself.
+  if (task->enabled && (task->due == due)) {
+    if (task->period == 0) {
+      task->enabled = false;
+    }
+    else {
+      task->due = due + task->period;
+      if ((int32_t)(finish - task->due) > 0) {
+        task->due = finish;
+      }
+    }
+  }
+  return true;
+}
+
+uint32_t loopScheduler::timeToNext() {
+  uint32_t now = millis();
+  uint32_t shortest = _LSNOTHINGDUE;
+  for (uint8_t index = 0; index < _count; index++) {
+    lsTask *task = &_tasks[index];
+    if (task->enabled) {
+      int32_t untilDue = (int32_t)(task->due - now);
+      if (untilDue <= 0) {
+        return 0;
+      }
+      if ((uint32_t)untilDue < shortest) {
+        shortest = untilDue;
+      }
+    }
+  }
+  return shortest;
+}
+
+const __FlashStringHelper *loopScheduler::name(int8_t task) {
+  return validTask(task) ? _tasks[task].name : NULL;
+}
+
+uint16_t loopScheduler::runs(int8_t task) {
+  return validTask(task) ? _tasks[task].runs : 0;
+}
+
+uint16_t loopScheduler::overruns(int8_t task) {
+  return validTask(task) ? _tasks[task].overruns : 0;
+}
+
+uint16_t loopScheduler::maxLateness(int8_t task) {
+  return validTask(task) ? _tasks[task].maxLateness : 0;
+}
+
+uint32_t loopScheduler::maxExecTime(int8_t task) {
+  return validTask(task) ? _tasks[task].maxExecTime : 0;
+}
+
+uint32_t loopScheduler::avgExecTime(int8_t task) {
+  if (!validTask(task) || (_tasks[task].runs == 0)) {
+    return 0;
+  }
+  return _tasks[task].totalExecTime / _tasks[task].runs;
+}
+
+void loopScheduler::resetStats() {
+  for (uint8_t index = 0; index < _count; index++) {
+    lsTask *task = &_tasks[index];
+    task->runs = 0;
+    task->overruns = 0;
+    task->maxLateness = 0;
+    task->maxExecTime = 0;
+    task->totalExecTime = 0;
+  }
+}
+
+bool loopScheduler::validTask(int8_t task) {
+  return (task >= 0) && (task < _count);
+}
+
+//EOF
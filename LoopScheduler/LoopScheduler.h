@@ -0,0 +1,85 @@
+/*
+Arduino library for a cooperative, millis() based, task scheduler.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Each task is a plain void function, run every period milliseconds. Tasks must not block - a task that has to wait
+  for something (an ADC settle, a sensor conversion) should start it, and finish it on a later run, or enable another
+  task to finish it. When no task is due the scheduler calls an optional idle hook, which can put the MCU to sleep.
+
+The sketch allocates the task table, an array of lsTask, 27 bytes of RAM each on an AVR, and passes it to the
+  constructor, so it has room for exactly as many tasks as the sketch adds.
+
+When more than one task is due, the task with the earliest deadline runs first. Each task has a deadline, by default
+  its period, and a run that finishes more than the deadline after the task was due is counted as an overrun.
+  The run count, overruns, maximum lateness, and maximum and average execution times are recorded for every task.
+
+Usage:
+  lsTask taskTable[2];
+  loopScheduler scheduler(taskTable, 2);
+  int8_t hbTask = scheduler.add(heartbeat, 500);          //Every 500ms, starting now.
+  int8_t rdTask = scheduler.add(readSensor, 2000, 100);   //Every 2s, starting in 100ms.
+  void loop() {
+    scheduler.run();
+  }
+
+https://en.wikipedia.org/wiki/Cooperative_multitasking
+https://en.wikipedia.org/wiki/Earliest_deadline_first_scheduling
+https://www.arduino.cc/reference/en/language/functions/time/millis/
+*/
+
+#ifndef LOOPSCHEDULER_H
+  #define LOOPSCHEDULER_H
+
+  #include <Arduino.h>
+
+  #define _LSNOTASK -1              //Returned by add() when there is no room for another task.
+  #define _LSNOTHINGDUE 0xFFFFFFFF  //Returned by timeToNext() when no task is enabled.
+
+  typedef void (*lsTaskFunc)();             //A task function.
+  typedef void (*lsIdleFunc)(uint32_t);     //An idle hook, passed the milliseconds until the next task is due.
+
+  struct lsTask {                           //A task, and its stats.
+    lsTaskFunc function;
+    const __FlashStringHelper *name;
+    uint16_t period;                        //Milliseconds, 0 = run once, then disable.
+    uint16_t deadline;                      //Milliseconds after the due time.
+    uint32_t due;                           //millis() when the task is next due.
+    bool enabled;
+    uint16_t runs;
+    uint16_t overruns;
+    uint16_t maxLateness;
+    uint32_t maxExecTime;
+    uint32_t totalExecTime;
+  };
+
+  class loopScheduler {
+  public:
+    loopScheduler(lsTask *tasks, uint8_t size);
+    int8_t add(lsTaskFunc task, uint16_t period, uint16_t delay = 0, uint16_t deadline = 0, const __FlashStringHelper *name = NULL);
+    uint8_t count();                      //The number of tasks added.
+    void setPeriod(int8_t task, uint16_t period);
+    void enable(int8_t task, uint16_t delay = 0);   //Enable a task, first running it after the delay.
+    void disable(int8_t task);
+    bool isEnabled(int8_t task);
+    void setIdleHook(lsIdleFunc hook = NULL);
+    bool run();                           //Run the next due task, returns false if no task was due.
+    uint32_t timeToNext();                //Milliseconds until the next task is due, 0 if one is due now.
+    const __FlashStringHelper *name(int8_t task);
+    uint16_t runs(int8_t task);           //Runs since the stats were reset.
+    uint16_t overruns(int8_t task);       //Runs that finished after their deadline.
+    uint16_t maxLateness(int8_t task);    //The latest start, in milliseconds after the task was due.
+    uint32_t maxExecTime(int8_t task);    //The longest run, in microseconds.
+    uint32_t avgExecTime(int8_t task);    //The average run, in microseconds.
+    void resetStats();
+
+  private:
+    lsTask *_tasks;
+    uint8_t _size;                        //The tasks there is room for.
+    uint8_t _count;
+    lsIdleFunc _idleHook;
+    bool validTask(int8_t task);
+  };
+#endif
+
+//EOF
@@ -0,0 +1,72 @@
+/*
+Cooperative task scheduler example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Blink the built in LED, read an analog pin, and report the task stats, each as a task with its own period.
+
+https://en.wikipedia.org/wiki/Cooperative_multitasking
+*/
+
+#include <LoopScheduler.h>
+
+#define HB_LED 13
+#define ANALOG_PIN A0
+
+#define BLINK_PERIOD 250
+#define READ_PERIOD 100
+#define REPORT_PERIOD 5000
+#define TASKS 3
+
+lsTask taskTable[TASKS];
+loopScheduler scheduler(taskTable, TASKS);
+bool hbStatus = LOW;
+uint32_t readingTotal = 0;
+
+void setup() {
+  //Start the serial output at 9600 baud.
+  Serial.begin(9600);
+  pinMode(HB_LED, OUTPUT);
+  //Add the tasks, the report first runs after one report period.
+  scheduler.add(blinkTask, BLINK_PERIOD, 0, 0, F("Blink"));
+  scheduler.add(readTask, READ_PERIOD, 0, 0, F("Read"));
+  scheduler.add(reportTask, REPORT_PERIOD, REPORT_PERIOD, 0, F("Report"));
+}
+
+void loop() {
+  scheduler.run();
+}
+
+void blinkTask() {
+  hbStatus = !hbStatus;
+  digitalWrite(HB_LED, hbStatus);
+}
+
+void readTask() {
+  readingTotal += analogRead(ANALOG_PIN);
+}
+
+void reportTask() {
+  Serial.print("Average ADC Val = ");
+  Serial.println(readingTotal / (float)scheduler.runs(1));
+  readingTotal = 0;
+  for (uint8_t task = 0; task < scheduler.count(); task++) {
+    Serial.print("  ");
+    Serial.print(scheduler.name(task));
+    Serial.print(": runs = ");
+    Serial.print(scheduler.runs(task));
+    Serial.print(", overruns = ");
+    Serial.print(scheduler.overruns(task));
+    Serial.print(", max late = ");
+    Serial.print(scheduler.maxLateness(task));
+    Serial.print("ms, max exec = ");
+    Serial.print(scheduler.maxExecTime(task));
+    Serial.print("us, avg exec = ");
+    Serial.print(scheduler.avgExecTime(task));
+    Serial.println("us");
+  }
+  Serial.println();
+  scheduler.resetStats();
+}
+
+//EOF
@@ -0,0 +1,997 @@
+/*
+Loft Environment Monitor Host Simulation.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Builds the sketch, unchanged, and its libraries, for a PC, against a simulated Arduino (the hal folder), and runs it on
+  a virtual clock - an hour of the loft in well under a second - so it can be tested, and its loop() and sensor
+  conversions benchmarked, without a Nano, sensors or a serial lead.
+
+The simulation:
+  Clock   - A virtual clock, in us. It only moves on when the sketch waits (delay(), idle sleep, a full serial buffer,
+            an EEPROM write) or calls the Arduino functions, each of which costs what it does on a 16MHz Nano (e.g.
+            112us for analogRead()), and 10us for each loop() call. Idle sleep wakes at the next Timer0 overflow.
+  Loft    - A loft temperature, humidity and light level, each following the script's points, straight lines between.
+  Sensors - Fake BME280, DHT11, DHT22 and DS18B20 devices, with their libraries' interfaces and timings, read the
+            loft, as do the analog sensors, through their dividers: KY013 on A0 (Steinhart-Hart, 110K balance
+            resistor), TMP36 on A1, MF52D on A2 (Beta 3435, 10K) and the LDR on A3, with the sketch's coefficients and
+            4.83V reference. The pot on A7 reads 512. A script can fix any analog or digital input instead.
+  Serial  - Sent at the baud rate through a 63 byte buffer, into the capture, optionally with CoolTerm timestamps, so
+            it can be fed to the other tools. Script lines are received as commands.
+  EEPROM  - 1KB, erased or loaded from a file, and saved back at the end, so a restart can be simulated, with the
+            reset cause (MCUSR) given. Each byte write takes 3.4ms.
+  Watchdog- If the sketch enables it, and does not reset it in time, the simulation stops, as the Nano would restart.
+
+Script lines, "<time> <command> [arguments]", the time in seconds (or with an s, m or h suffix), # starts a comment:
+  <time> temp <deg C>             A loft temperature point.
+  <time> humidity <%>             A loft humidity point.
+  <time> light <ADC value>        A light level point, the LDR's ADC value.
+  <time> offset <sensor> <deg C>  A sensor reads this much high from then on (bme280, dht11, dht22, ds18b20, ky013,
+                                  tmp36 or mf52d).
+  <time> fail <sensor> [0|1]      A sensor fails (nan, disconnected or an open circuit), or recovers with 0.
+  <time> adc <pin> <value|auto>   Fix an analog input (A0-A7), or return it to its sensor.
+  <time> pin <pin> <0|1>          Set a digital input.
+  <time> probes <count>           The number of DS18B20 probes on the bus, 1 at the start.
+  <time> noise <steps>            Add up to +/- this many ADC steps of noise to the analog sensors.
+  <time> send <text>              Send a line to the sketch, e.g. "B" for a history backfill.
+With no script the loft stays at 20 deg C, 50 % and a light level of 740.
+
+The report, to stderr, has the virtual and real time, loop() calls and their real time (the benchmark), the CPU load
+  (the time not in idle sleep), and the bytes sent and EEPROM bytes written.
+
+Build, from the repository root (any C++11 compiler). The sketch is first made into C++, as the Arduino IDE does, by
+  HostSimPrep, which adds the function prototypes, and can enable (-D), set (-D NAME=value) or disable (-U) its
+  defines, e.g. -D USE_PROBES -U PLOTDATA. The sketch and its libraries are built with single precision constants, as
+  on the Nano, where a double is a float, and the simulation without:
+  g++ -std=c++11 -O2 -o HostSimPrep Tools/HostSim/HostSimPrep.cpp
+  ./HostSimPrep Loft-Monitor/Loft-Monitor.ino > LoftMonitorHost.cpp
+  g++ -std=gnu++11 -O2 -DARDUINO=10813 -ITools/HostSim/hal -c -o HostSim.o Tools/HostSim/HostSim.cpp
+  g++ -std=gnu++11 -O2 -DARDUINO=10813 -fsingle-precision-constant -Wno-int-to-pointer-cast -ITools/HostSim/hal \
+      -ILoft-Monitor -IVDivider -IAlogTSensors -ILoopScheduler -o HostSim HostSim.o LoftMonitorHost.cpp \
+      Loft-Monitor/Loft*.cpp VDivider/VDivider.cpp AlogTSensors/AlogTSensors.cpp LoopScheduler/LoopScheduler.cpp
+
+Usage:
+  HostSim [-t time] [-f script] [-o capture] [-T "YYYY-MM-DD HH:MM:SS"] [-r reset] [-e eeprom.bin] [-s seed] [-p] [-q]
+    -t  How long to run, seconds (or with an s, m, h or d suffix), default 1h.
+    -f  The script.
+    -o  The capture file, default stdout.
+    -T  Start each captured line with a CoolTerm timestamp, the virtual time from this date and time.
+    -r  The reset cause, power (the default), external, brownout or watchdog.
+    -e  Load the EEPROM from this file, if it exists, and save it there at the end.
+    -s  The noise seed, default 1.
+    -p  Trace the digital and PWM outputs to stderr.
+    -q  No report.
+*/
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <Wire.h>
+#include <OneWire.h>
+#include <Adafruit_BME280.h>
+#include <DHT.h>
+#include <DallasTemperature.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+void stopWatchdog() __attribute__((weak));      //The sketch's reset flag capture (LoftState.cpp), if it has one.
+
+//The virtual time each call takes on a 16MHz Nano, us. The sketch's busy waits poll these, so the clock moves on.
+#define SIM_CLOCKCOST 2                         //millis(), micros().
+#define SIM_PINCOST 4                           //digitalRead(), digitalWrite(), pinMode(), analogWrite().
+#define SIM_ADCCOST 112                         //analogRead(), 13 ADC clocks at 125KHz, and the set up.
+#define SIM_SERIALCOST 2                        //Serial.available(), read(), availableForWrite(), and each byte written.
+#define SIM_LOOPCOST 10                         //The rest of each loop() call.
+#define SIM_TICK 1024                           //The Timer0 overflow period, which wakes the MCU from idle sleep.
+#define SIM_EEPROMWRITE 3400                    //An EEPROM byte write.
+#define SIM_I2CREAD 300                         //Reading a BME280 result.
+#define SIM_BME280CONVERSION 9300               //A forced measurement, x1 oversampling.
+#define SIM_DHTBITS 4000                        //The 40 data bits from a DHT.
+#define SIM_ONEWIRECOMMAND 2000                 //A OneWire reset and command.
+#define SIM_ONEWIREREAD 6000                    //Reading a DS18B20 scratchpad.
+#define SIM_TXBUFFER 63                         //The serial transmit buffer room.
+#define SIM_EEPROMSIZE (E2END + 1)
+#define SIM_MAXPROBES 9
+
+//The analog sensors, as in the sketch.
+#define SIM_AVREF 4.83
+#define SIM_KY013R1 110000.0
+#define SIM_KY013C1 0.0005182977433
+#define SIM_KY013C2 0.0002252079282
+#define SIM_KY013C3 0.0000001615362158
+#define SIM_MF52DR1 10000.0
+#define SIM_MF52DBETA 3435.0
+#define SIM_MF52DNOMINAL 10000.0
+
+enum simSensor : uint8_t {SIM_BME280, SIM_DHT11, SIM_DHT22, SIM_DS18B20, SIM_KY013, SIM_TMP36, SIM_MF52D, SIM_SENSORS};
+static const char *const sensorNames[SIM_SENSORS] = {"bme280", "dht11", "dht22", "ds18b20", "ky013", "tmp36", "mf52d"};
+
+struct simPoint {
+  double time;                                  //Seconds.
+  double value;
+};
+
+struct simEvent {
+  double time;                                  //Seconds.
+  std::string command;
+  std::vector<std::string> arguments;
+  std::string rest;                             //The line after the command, for send.
+};
+
+struct simLoft {
+  std::vector<simPoint> temperature;
+  std::vector<simPoint> humidity;
+  std::vector<simPoint> light;
+  float offset[SIM_SENSORS];
+  bool failed[SIM_SENSORS];
+  int adc[NUM_DIGITAL_PINS];                    //A fixed analog input, -1 for the sensor's.
+  uint8_t input[NUM_DIGITAL_PINS];
+  uint8_t output[NUM_DIGITAL_PINS];
+  int pwm[NUM_DIGITAL_PINS];
+  uint8_t probes;
+  int noise;
+};
+
+struct simStats {
+  uint64_t sleep;                               //us of virtual time in idle sleep.
+  unsigned long loops;
+  double loopTotal;                             //ns of real time in loop().
+  double loopMax;
+  unsigned long loopBuckets[32];                //loop() real times, by the power of 2 ns.
+  unsigned long bytesSent;
+  unsigned long eepromWrites;
+  unsigned long txWaits;                        //Writes that waited for room in the serial buffer.
+};
+
+HardwareSerial Serial;
+TwoWire Wire;
+volatile uint8_t MCUSR = _BV(PORF);
+volatile uint8_t SREG = 0;
+
+static uint64_t simTime = 0;                    //The virtual clock, us.
+static simLoft loft;
+static std::vector<simEvent> events;
+static size_t nextEvent = 0;
+static simStats stats;
+static FILE *capture = stdout;
+static bool timestamps = false;
+static double startDate = 0.0;                  //Seconds since 1970, for the timestamps.
+static bool lineStart = true;
+static bool tracePins = false;
+static uint32_t noiseState = 1;
+static uint32_t randomState = 1;
+static uint8_t eeprom[SIM_EEPROMSIZE];
+static uint64_t eepromReady = 0;
+static std::string eepromFile;
+static uint64_t watchdogTimeout = 0;            //us, 0 when off.
+static uint64_t watchdogReset = 0;
+static uint32_t baud = 0;
+static double txDone = 0.0;                     //When the last byte in the serial buffer will have been sent, us.
+static std::string received;
+
+static void finish(int status);
+
+//The loft, straight lines between the script points, holding the first and last.
+static double follow(const std::vector<simPoint> &points, double fallback) {
+  if (points.empty()) {
+    return fallback;
+  }
+  double time = simTime / 1e6;
+  if (time <= points.front().time) {
+    return points.front().value;
+  }
+  for (size_t index = 1; index < points.size(); index++) {
+    if (time < points[index].time) {
+      const simPoint &from = points[index - 1];
+      const simPoint &to = points[index];
+      return from.value + (to.value - from.value) * (time - from.time) / (to.time - from.time);
+    }
+  }
+  return points.back().value;
+}
+
+static float sensorTemperature(simSensor sensor) {
+  return loft.failed[sensor] ? NAN : follow(loft.temperature, 20.0) + loft.offset[sensor];
+}
+
+static float loftHumidity() {
+  return follow(loft.humidity, 50.0);
+}
+
+static int parsePin(const std::string &text) {
+  if ((text.size() > 1) && ((text[0] == 'A') || (text[0] == 'a'))) {
+    return A0 + atoi(text.c_str() + 1);
+  }
+  return atoi(text.c_str());
+}
+
+static int parseSensor(const std::string &name) {
+  for (int sensor = 0; sensor < SIM_SENSORS; sensor++) {
+    if (name == sensorNames[sensor]) {
+      return sensor;
+    }
+  }
+  return -1;
+}
+
+//Apply the script's events that are due.
+static void applyEvents() {
+  while ((nextEvent < events.size()) && (events[nextEvent].time * 1e6 <= simTime)) {
+    const simEvent &event = events[nextEvent++];
+    const std::vector<std::string> &arguments = event.arguments;
+    if ((event.command == "offset") && (arguments.size() >= 2) && (parseSensor(arguments[0]) >= 0)) {
+      loft.offset[parseSensor(arguments[0])] = atof(arguments[1].c_str());
+    }
+    else if ((event.command == "fail") && (arguments.size() >= 1) && (parseSensor(arguments[0]) >= 0)) {
+      loft.failed[parseSensor(arguments[0])] = (arguments.size() < 2) || (atoi(arguments[1].c_str()) != 0);
+    }
+    else if ((event.command == "adc") && (arguments.size() >= 2)) {
+      int pin = parsePin(arguments[0]);
+      if ((pin >= 0) && (pin < NUM_DIGITAL_PINS)) {
+        loft.adc[pin] = (arguments[1] == "auto") ? -1 : constrain(atoi(arguments[1].c_str()), 0, 1023);
+      }
+    }
+    else if ((event.command == "pin") && (arguments.size() >= 2)) {
+      int pin = parsePin(arguments[0]);
+      if ((pin >= 0) && (pin < NUM_DIGITAL_PINS)) {
+        loft.input[pin] = (atoi(arguments[1].c_str()) != 0) ? HIGH : LOW;
+      }
+    }
+    else if ((event.command == "probes") && (arguments.size() >= 1)) {
+      loft.probes = constrain(atoi(arguments[0].c_str()), 0, SIM_MAXPROBES);
+    }
+    else if ((event.command == "noise") && (arguments.size() >= 1)) {
+      loft.noise = abs(atoi(arguments[0].c_str()));
+    }
+    else if (event.command == "send") {
+      received += event.rest + "\n";
+    }
+  }
+}
+
+//Move the virtual clock on, checking the script and the watchdog.
+static void advance(uint64_t time) {
+  simTime += time;
+  applyEvents();
+  if ((watchdogTimeout > 0) && (simTime - watchdogReset > watchdogTimeout)) {
+    fprintf(stderr, "Watchdog reset at %.3fs, restart with -r watchdog to carry on.\n", simTime / 1e6);
+    finish(3);
+  }
+}
+
+//The analog sensors, through their dividers, as ADC values.
+static double dividerADC(double r1, double r2) {
+  return 1024.0 * r2 / (r1 + r2);
+}
+
+static double sensorADC(uint8_t pin) {
+  double kelvin;
+  switch (pin) {
+    case A0: {
+      if (loft.failed[SIM_KY013]) {
+        return 1023;
+      }
+      //Steinhart-Hart, solved for the resistance.
+      kelvin = sensorTemperature(SIM_KY013) + 273.15;
+      double y = (SIM_KY013C1 - 1.0 / kelvin) / SIM_KY013C3;
+      double x = sqrt(pow(SIM_KY013C2 / (3.0 * SIM_KY013C3), 3.0) + y * y / 4.0);
+      double resistance = exp(cbrt(x - y / 2.0) - cbrt(x + y / 2.0));
+      return dividerADC(SIM_KY013R1, resistance);
+    }
+    case A1:
+      return loft.failed[SIM_TMP36] ? 0 : (0.5 + sensorTemperature(SIM_TMP36) / 100.0) / SIM_AVREF * 1024.0;
+    case A2: {
+      if (loft.failed[SIM_MF52D]) {
+        return 1023;
+      }
+      kelvin = sensorTemperature(SIM_MF52D) + 273.15;
+      double resistance = SIM_MF52DNOMINAL * exp(SIM_MF52DBETA * (1.0 / kelvin - 1.0 / 298.15));
+      return dividerADC(SIM_MF52DR1, resistance);
+    }
+    case A3:
+      return follow(loft.light, 740.0);
+    case A7:
+      return 512;
+    default:
+      return 0;
+  }
+}
+
+static int noise() {
+  if (loft.noise == 0) {
+    return 0;
+  }
+  noiseState = noiseState * 1664525UL + 1013904223UL;
+  return (int)((noiseState >> 16) % (2 * loft.noise + 1)) - loft.noise;
+}
+
+//The time as a CoolTerm timestamp, the civil date from the days, http://howardhinnant.github.io/date_algorithms.html
+static std::string formatTimestamp(double time) {
+  long seconds = (long)time;
+  long days = (seconds >= 0) ? seconds / 86400 : (seconds - 86399) / 86400;
+  long secondOfDay = seconds - days * 86400;
+  days += 719468;
+  long era = (days >= 0 ? days : days - 146096) / 146097;
+  long dayOfEra = days - era * 146097;
+  long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  long monthIndex = (5 * dayOfYear + 2) / 153;
+  long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  long month = monthIndex + ((monthIndex < 10) ? 3 : -9);
+  long year = yearOfEra + era * 400 + ((month <= 2) ? 1 : 0);
+  char text[80];
+  snprintf(text, sizeof(text), "%04ld-%02ld-%02ld %02ld:%02ld:%02ld", year, month, day,
+           secondOfDay / 3600, (secondOfDay / 60) % 60, secondOfDay % 60);
+  return text;
+}
+
+//Seconds since 1970 for a "YYYY-MM-DD HH:MM:SS" timestamp, or -1.
+static double parseTimestamp(const char *text) {
+  int year, month, day, hour, minute, second;
+  if (sscanf(text, "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return -1.0;
+  }
+  year -= (month <= 2) ? 1 : 0;
+  long era = (year >= 0 ? year : year - 399) / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+  return days * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+}
+
+//A time, seconds, with an optional s, m, h or d suffix.
+static double parseTime(const char *text) {
+  char *end;
+  double time = strtod(text, &end);
+  switch (*end) {
+    case 'm':
+      return time * 60.0;
+    case 'h':
+      return time * 3600.0;
+    case 'd':
+      return time * 86400.0;
+    default:
+      return time;
+  }
+}
+
+static bool readScript(const char *path) {
+  FILE *input = fopen(path, "r");
+  if (input == NULL) {
+    perror(path);
+    return false;
+  }
+  char buffer[1024];
+  unsigned lineNumber = 0;
+  while (fgets(buffer, sizeof(buffer), input) != NULL) {
+    lineNumber++;
+    std::string line = buffer;
+    while (!line.empty() && ((line[line.size() - 1] == '\n') || (line[line.size() - 1] == '\r'))) {
+      line.erase(line.size() - 1);
+    }
+    size_t comment = line.find('#');
+    std::string command = (comment == std::string::npos) ? line : line.substr(0, comment);
+    char time[32], name[32];
+    int used = 0;
+    if (sscanf(command.c_str(), "%31s %31s %n", time, name, &used) < 2) {
+      continue;
+    }
+    simEvent event;
+    event.time = parseTime(time);
+    event.command = name;
+    event.rest = line.substr(used);
+    char argument[64];
+    int length;
+    const char *next = command.c_str() + used;
+    while (sscanf(next, "%63s%n", argument, &length) == 1) {
+      event.arguments.push_back(argument);
+      next += length;
+    }
+    if ((event.command == "temp") || (event.command == "humidity") || (event.command == "light")) {
+      if (event.arguments.empty()) {
+        fprintf(stderr, "%s:%u: %s needs a value\n", path, lineNumber, name);
+        continue;
+      }
+      simPoint point = {event.time, atof(event.arguments[0].c_str())};
+      std::vector<simPoint> &points = (event.command == "temp") ? loft.temperature :
+                                      ((event.command == "humidity") ? loft.humidity : loft.light);
+      points.push_back(point);
+    }
+    else if ((event.command == "offset") || (event.command == "fail") || (event.command == "adc") ||
+             (event.command == "pin") || (event.command == "probes") || (event.command == "noise") ||
+             (event.command == "send")) {
+      events.push_back(event);
+    }
+    else {
+      fprintf(stderr, "%s:%u: unknown command %s\n", path, lineNumber, name);
+    }
+  }
+  fclose(input);
+  std::stable_sort(events.begin(), events.end(), [](const simEvent &a, const simEvent &b) {
+    return a.time < b.time;
+  });
+  for (std::vector<simPoint> *points : {&loft.temperature, &loft.humidity, &loft.light}) {
+    std::stable_sort(points->begin(), points->end(), [](const simPoint &a, const simPoint &b) {
+      return a.time < b.time;
+    });
+  }
+  return true;
+}
+
+//Arduino core.
+
+uint32_t millis() {
+  advance(SIM_CLOCKCOST);
+  return (uint32_t)(simTime / 1000);
+}
+
+uint32_t micros() {
+  advance(SIM_CLOCKCOST);
+  return (uint32_t)simTime;
+}
+
+void delay(uint32_t ms) {
+  advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  advance(SIM_PINCOST);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  advance(SIM_PINCOST);
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  value = (value != LOW) ? HIGH : LOW;
+  if (tracePins && (loft.output[pin] != value)) {
+    fprintf(stderr, "%.3fs D%u %s\n", simTime / 1e6, pin, (value == HIGH) ? "HIGH" : "LOW");
+  }
+  loft.output[pin] = value;
+}
+
+int digitalRead(uint8_t pin) {
+  advance(SIM_PINCOST);
+  return (pin < NUM_DIGITAL_PINS) ? loft.input[pin] : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  advance(SIM_ADCCOST);
+  if (pin < A0) {
+    pin += A0;                                  //analogRead(0) is A0.
+  }
+  if (pin >= NUM_DIGITAL_PINS) {
+    return 0;
+  }
+  if (loft.adc[pin] >= 0) {
+    return loft.adc[pin];
+  }
+  int value = (int)sensorADC(pin) + ((pin <= A3) ? noise() : 0);
+  return constrain(value, 0, 1023);
+}
+
+void analogReference(uint8_t mode) {}
+
+void analogWrite(uint8_t pin, int value) {
+  advance(SIM_PINCOST);
+  if (pin >= NUM_DIGITAL_PINS) {
+    return;
+  }
+  if (tracePins && (loft.pwm[pin] != value)) {
+    fprintf(stderr, "%.3fs D%u PWM %d\n", simTime / 1e6, pin, value);
+  }
+  loft.pwm[pin] = value;
+}
+
+//The avr-libc random(), so SDEBUG's pseudo readings are the same as on the Nano.
+static long nextRandom() {
+  long state = (randomState == 0) ? 123459876L : randomState;
+  long high = state / 127773L;
+  long low = state % 127773L;
+  state = 16807L * low - 2836L * high;
+  if (state < 0) {
+    state += 0x7FFFFFFFL;
+  }
+  randomState = state;
+  return state % 0x80000000UL;
+}
+
+long random(long howBig) {
+  return (howBig == 0) ? 0 : nextRandom() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+  return (howSmall >= howBig) ? howSmall : random(howBig - howSmall) + howSmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    randomState = seed;
+  }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+//Serial.
+
+static double byteTime() {
+  return (baud > 0) ? 10e6 / baud : 0.0;
+}
+
+static int txQueued() {
+  return (txDone > simTime) ? (int)ceil((txDone - simTime) / byteTime()) : 0;
+}
+
+void HardwareSerial::begin(unsigned long rate) {
+  baud = rate;
+}
+
+void HardwareSerial::end() {
+  baud = 0;
+}
+
+int HardwareSerial::available() {
+  advance(SIM_SERIALCOST);
+  return received.size();
+}
+
+int HardwareSerial::peek() {
+  advance(SIM_SERIALCOST);
+  return received.empty() ? -1 : (uint8_t)received[0];
+}
+
+int HardwareSerial::read() {
+  advance(SIM_SERIALCOST);
+  if (received.empty()) {
+    return -1;
+  }
+  uint8_t data = received[0];
+  received.erase(0, 1);
+  return data;
+}
+
+int HardwareSerial::availableForWrite() {
+  advance(SIM_SERIALCOST);
+  return (baud > 0) ? std::max(SIM_TXBUFFER - txQueued(), 0) : SIM_TXBUFFER;
+}
+
+void HardwareSerial::flush() {
+  if (txDone > simTime) {
+    advance((uint64_t)ceil(txDone - simTime));
+  }
+}
+
+size_t HardwareSerial::write(uint8_t data) {
+  advance(SIM_SERIALCOST);
+  double sent = simTime;
+  if (baud > 0) {
+    if (txQueued() >= SIM_TXBUFFER) {
+      //Wait for room, as the real one does.
+      advance((uint64_t)ceil(txDone - (SIM_TXBUFFER - 1) * byteTime() - simTime));
+      stats.txWaits++;
+    }
+    sent = std::max(txDone, (double)simTime);
+    txDone = sent + byteTime();
+  }
+  if (timestamps && lineStart) {
+    fprintf(capture, "%s\t", formatTimestamp(startDate + sent / 1e6).c_str());
+  }
+  fputc(data, capture);
+  lineStart = (data == '\n');
+  stats.bytesSent++;
+  return 1;
+}
+
+//EEPROM.
+
+uint8_t eeprom_read_byte(const uint8_t *address) {
+  return eeprom[(uintptr_t)address % SIM_EEPROMSIZE];
+}
+
+uint16_t eeprom_read_word(const uint16_t *address) {
+  return eeprom_read_byte((const uint8_t *)address) | (eeprom_read_byte((const uint8_t *)address + 1) << 8);
+}
+
+void eeprom_read_block(void *destination, const void *source, size_t size) {
+  for (size_t index = 0; index < size; index++) {
+    ((uint8_t *)destination)[index] = eeprom_read_byte((const uint8_t *)source + index);
+  }
+}
+
+void eeprom_write_byte(uint8_t *address, uint8_t value) {
+  if (eepromReady > simTime) {
+    advance(eepromReady - simTime);
+  }
+  eeprom[(uintptr_t)address % SIM_EEPROMSIZE] = value;
+  eepromReady = simTime + SIM_EEPROMWRITE;
+  stats.eepromWrites++;
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value) {
+  if (eeprom_read_byte(address) != value) {
+    eeprom_write_byte(address, value);
+  }
+}
+
+void eeprom_update_block(const void *source, void *destination, size_t size) {
+  for (size_t index = 0; index < size; index++) {
+    eeprom_update_byte((uint8_t *)destination + index, ((const uint8_t *)source)[index]);
+  }
+}
+
+bool eeprom_is_ready() {
+  return eepromReady <= simTime;
+}
+
+//Watchdog and sleep.
+
+void wdt_enable(uint8_t timeout) {
+  watchdogTimeout = (uint64_t)16000 << std::min(timeout, (uint8_t)WDTO_8S);
+  watchdogReset = simTime;
+}
+
+void wdt_disable() {
+  watchdogTimeout = 0;
+}
+
+void wdt_reset() {
+  watchdogReset = simTime;
+}
+
+void set_sleep_mode(uint8_t mode) {}
+
+void sleep_mode() {
+  uint64_t wake = (simTime / SIM_TICK + 1) * SIM_TICK;
+  stats.sleep += wake - simTime;
+  advance(wake - simTime);
+}
+
+//BME280.
+
+bool Adafruit_BME280::begin(uint8_t address, TwoWire *wire) {
+  advance(2 * SIM_I2CREAD);
+  return !loft.failed[SIM_BME280];
+}
+
+void Adafruit_BME280::setSampling(sensor_mode mode, sensor_sampling temperatureSampling, sensor_sampling pressureSampling,
+                                  sensor_sampling humiditySampling, sensor_filter filter, standby_duration duration) {
+  advance(SIM_I2CREAD);
+}
+
+bool Adafruit_BME280::takeForcedMeasurement() {
+  advance(SIM_BME280CONVERSION);
+  return !loft.failed[SIM_BME280];
+}
+
+float Adafruit_BME280::readTemperature() {
+  advance(SIM_I2CREAD);
+  return roundf(sensorTemperature(SIM_BME280) * 100.0f) / 100.0f;
+}
+
+float Adafruit_BME280::readHumidity() {
+  advance(2 * SIM_I2CREAD);                     //The temperature is read first, for its compensation.
+  return loft.failed[SIM_BME280] ? NAN : roundf(loftHumidity() * 1024.0f) / 1024.0f;
+}
+
+float Adafruit_BME280::readPressure() {
+  advance(2 * SIM_I2CREAD);
+  return loft.failed[SIM_BME280] ? NAN : 101325.0f;
+}
+
+float Adafruit_BME280::readAltitude(float seaLevel) {
+  float atmospheric = readPressure() / 100.0f;
+  return 44330.0f * (1.0f - powf(atmospheric / seaLevel, 0.1903f));
+}
+
+//DHT11/22.
+
+DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
+  _pin = pin;
+  _type = type;
+  _lastRead = 0;
+  _read = false;
+  _temperature = NAN;
+  _humidity = NAN;
+}
+
+void DHT::begin(uint8_t pullTime) {
+  advance(SIM_PINCOST);
+}
+
+bool DHT::read(bool force) {
+  uint32_t now = millis();
+  if (!force && _read && (now - _lastRead < 2000)) {
+    return !isnan(_temperature);
+  }
+  _read = true;
+  _lastRead = now;
+  advance(((_type == DHT11) ? 20000 : 1100) + SIM_DHTBITS);
+  simSensor sensor = (_type == DHT11) ? SIM_DHT11 : SIM_DHT22;
+  float step = (_type == DHT11) ? 1.0f : 0.1f;
+  _temperature = roundf(sensorTemperature(sensor) / step) * step;
+  _humidity = loft.failed[sensor] ? NAN : roundf(loftHumidity() / step) * step;
+  return !isnan(_temperature);
+}
+
+float DHT::readTemperature(bool fahrenheit, bool force) {
+  read(force);
+  return fahrenheit ? _temperature * 1.8f + 32.0f : _temperature;
+}
+
+float DHT::readHumidity(bool force) {
+  read(force);
+  return _humidity;
+}
+
+//DS18B20.
+
+static uint64_t conversionStart = 0;
+static uint64_t conversionDone = 0;             //0 before the first conversion.
+static float conversionTemperature = 85.0f;     //The power on value.
+
+//Catch up with a conversion that has finished since.
+static void convert() {
+  if ((conversionDone > 0) && (conversionDone <= simTime) && (conversionStart > 0)) {
+    uint64_t now = simTime;
+    simTime = conversionDone;                   //The temperature at the end of the conversion.
+    conversionTemperature = roundf(sensorTemperature(SIM_DS18B20) * 16.0f) / 16.0f;
+    simTime = now;
+    conversionStart = 0;
+  }
+}
+
+DallasTemperature::DallasTemperature(OneWire *bus) {
+  _wait = true;
+  _resolution = 12;
+}
+
+void DallasTemperature::begin() {
+  advance(SIM_ONEWIRECOMMAND * (loft.probes + 1));  //The bus search.
+}
+
+uint8_t DallasTemperature::getDeviceCount() {
+  return loft.failed[SIM_DS18B20] ? 0 : loft.probes;
+}
+
+bool DallasTemperature::getAddress(uint8_t *address, uint8_t index) {
+  if (index >= getDeviceCount()) {
+    return false;
+  }
+  uint8_t rom[8] = {0x28, (uint8_t)(index + 1), 0x4C, 0x6F, 0x66, 0x74, 0x00, 0x00};
+  memcpy(address, rom, sizeof(rom));
+  return true;
+}
+
+bool DallasTemperature::isConnected(const uint8_t *address) {
+  advance(SIM_ONEWIREREAD);
+  return (address[0] == 0x28) && (address[1] >= 1) && (address[1] <= getDeviceCount());
+}
+
+void DallasTemperature::setWaitForConversion(bool wait) {
+  _wait = wait;
+}
+
+bool DallasTemperature::getWaitForConversion() {
+  return _wait;
+}
+
+uint8_t DallasTemperature::getResolution() {
+  return _resolution;
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t *address) {
+  return _resolution;
+}
+
+bool DallasTemperature::setResolution(uint8_t resolution) {
+  _resolution = constrain(resolution, 9, 12);
+  return true;
+}
+
+int16_t DallasTemperature::millisToWaitForConversion(uint8_t resolution) {
+  return 750 >> (12 - constrain(resolution, 9, 12));
+}
+
+bool DallasTemperature::isConversionComplete() {
+  return conversionDone <= simTime;
+}
+
+void DallasTemperature::requestTemperatures() {
+  convert();
+  advance(SIM_ONEWIRECOMMAND);
+  conversionStart = simTime;
+  conversionDone = simTime + (uint64_t)millisToWaitForConversion(_resolution) * 1000;
+  if (_wait) {
+    advance(conversionDone - simTime);
+  }
+}
+
+float DallasTemperature::getTempC(const uint8_t *address) {
+  if (!isConnected(address)) {
+    return DEVICE_DISCONNECTED_C;
+  }
+  convert();
+  //Each probe reads as if it had its own small offset from the first.
+  return conversionTemperature + (address[1] - 1) * 0.0625f;
+}
+
+float DallasTemperature::getTempCByIndex(uint8_t index) {
+  DeviceAddress address;
+  return getAddress(address, index) ? getTempC(address) : DEVICE_DISCONNECTED_C;
+}
+
+//The simulation.
+
+static double realStart = 0.0;
+
+static double realTime() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool reportWanted = true;
+
+static void report() {
+  double wall = realTime() - realStart;
+  double virtualTime = simTime / 1e6;
+  fprintf(stderr, "Virtual time: %.1fs, real time: %.3fs (%.0f x real time)\n", virtualTime, wall,
+          (wall > 0.0) ? virtualTime / wall : 0.0);
+  fprintf(stderr, "CPU load: %.2f%% (awake, not in idle sleep)\n",
+          (simTime > 0) ? 100.0 * (simTime - stats.sleep) / simTime : 0.0);
+  //loop() real times, the 99th percentile from the power of 2 buckets.
+  unsigned long count = 0;
+  int bucket = 0;
+  for (; bucket < 32; bucket++) {
+    count += stats.loopBuckets[bucket];
+    if (count >= 0.99 * stats.loops) {
+      break;
+    }
+  }
+  fprintf(stderr, "loop() calls: %lu, real time: mean %.0fns, 99%% < %.0fns, max %.0fns\n", stats.loops,
+          (stats.loops > 0) ? stats.loopTotal / stats.loops : 0.0, ldexp(1.0, bucket + 1), stats.loopMax);
+  fprintf(stderr, "Serial: %lu bytes sent, %lu waits for room, EEPROM: %lu bytes written\n", stats.bytesSent,
+          stats.txWaits, stats.eepromWrites);
+}
+
+static void finish(int status) {
+  fflush(capture);
+  if (!eepromFile.empty()) {
+    FILE *output = fopen(eepromFile.c_str(), "wb");
+    if ((output == NULL) || (fwrite(eeprom, 1, sizeof(eeprom), output) != sizeof(eeprom))) {
+      perror(eepromFile.c_str());
+      status = 1;
+    }
+    if (output != NULL) {
+      fclose(output);
+    }
+  }
+  if (reportWanted) {
+    report();
+  }
+  exit(status);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-t time] [-f script] [-o capture] [-T \"YYYY-MM-DD HH:MM:SS\"] [-r reset] [-e eeprom.bin] [-s seed] [-p] [-q]\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  double duration = 3600.0;
+  for (int pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+    loft.adc[pin] = -1;
+    loft.input[pin] = HIGH;                     //Pulled up.
+    loft.output[pin] = LOW;
+    loft.pwm[pin] = 0;
+  }
+  for (int sensor = 0; sensor < SIM_SENSORS; sensor++) {
+    loft.offset[sensor] = 0.0;
+    loft.failed[sensor] = false;
+  }
+  loft.probes = 1;
+  loft.noise = 0;
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  memset(&stats, 0, sizeof(stats));
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    bool hasValue = (arg + 1 < argc);
+    if ((option == "-t") && hasValue) {
+      duration = parseTime(argv[++arg]);
+    }
+    else if ((option == "-f") && hasValue) {
+      if (!readScript(argv[++arg])) {
+        return 1;
+      }
+    }
+    else if ((option == "-o") && hasValue) {
+      capture = fopen(argv[++arg], "wb");
+      if (capture == NULL) {
+        perror(argv[arg]);
+        return 1;
+      }
+    }
+    else if ((option == "-T") && hasValue) {
+      startDate = parseTimestamp(argv[++arg]);
+      if (startDate < 0.0) {
+        usage(argv[0]);
+      }
+      timestamps = true;
+    }
+    else if ((option == "-r") && hasValue) {
+      std::string reset = argv[++arg];
+      if (reset == "power") {
+        MCUSR = _BV(PORF);
+      }
+      else if (reset == "external") {
+        MCUSR = _BV(EXTRF);
+      }
+      else if (reset == "brownout") {
+        MCUSR = _BV(BORF);
+      }
+      else if (reset == "watchdog") {
+        MCUSR = _BV(WDRF);
+      }
+      else {
+        usage(argv[0]);
+      }
+    }
+    else if ((option == "-e") && hasValue) {
+      eepromFile = argv[++arg];
+      FILE *input = fopen(eepromFile.c_str(), "rb");
+      if (input != NULL) {
+        if (fread(eeprom, 1, sizeof(eeprom), input) != sizeof(eeprom)) {
+          fprintf(stderr, "%s: not a %u byte EEPROM image, starting erased\n", eepromFile.c_str(), SIM_EEPROMSIZE);
+          memset(eeprom, 0xFF, sizeof(eeprom));
+        }
+        fclose(input);
+      }
+    }
+    else if ((option == "-s") && hasValue) {
+      noiseState = strtoul(argv[++arg], NULL, 10);
+    }
+    else if (option == "-p") {
+      tracePins = true;
+    }
+    else if (option == "-q") {
+      reportWanted = false;
+    }
+    else {
+      usage(argv[0]);
+    }
+  }
+  applyEvents();
+  realStart = realTime();
+  //As the Nano starts: the reset flags are captured before the sketch, then setup() and loop() forever.
+  if (stopWatchdog) {
+    stopWatchdog();
+  }
+  setup();
+  uint64_t end = (uint64_t)(duration * 1e6);
+  while (simTime < end) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    loop();
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    stats.loops++;
+    stats.loopTotal += elapsed;
+    stats.loopMax = std::max(stats.loopMax, elapsed);
+    int bucket = std::min(std::max(ilogb(std::max(elapsed, 1.0)), 0), 31);
+    stats.loopBuckets[bucket]++;
+    advance(SIM_LOOPCOST);
+  }
+  finish(0);
+}
+
+//EOF
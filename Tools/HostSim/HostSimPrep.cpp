@@ -0,0 +1,156 @@
+/*
+Loft Environment Monitor Host Simulation - Sketch Preparation.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Makes a sketch into C++, as the Arduino IDE does before compiling it, for the host simulation (see HostSim.cpp): it
+  adds #include <Arduino.h>, and a prototype for each function, before setup(), as the sketch's functions are used
+  before they are defined. #line directives keep the compiler's messages pointing at the sketch.
+
+A sketch's options can be changed on the way, without editing it: -D NAME enables a "//#define NAME" line, or sets
+  "#define NAME value" with -D NAME=value, and -U NAME comments a "#define NAME" line out. The first such line, at the
+  start of a line, is changed, keeping its comment.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o HostSimPrep Tools/HostSim/HostSimPrep.cpp
+
+Usage:
+  HostSimPrep [-D NAME[=value]]... [-U NAME]... sketch.ino > sketch.cpp
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct prepDefine {
+  std::string name;
+  std::string value;
+  bool enable;
+  bool done;
+};
+
+static bool readLines(const char *path, std::vector<std::string> &lines) {
+  FILE *input = fopen(path, "r");
+  if (input == NULL) {
+    perror(path);
+    return false;
+  }
+  std::string line;
+  int character;
+  while ((character = fgetc(input)) != EOF) {
+    if (character == '\n') {
+      lines.push_back(line);
+      line.clear();
+    }
+    else if (character != '\r') {
+      line += (char)character;
+    }
+  }
+  if (!line.empty()) {
+    lines.push_back(line);
+  }
+  fclose(input);
+  return true;
+}
+
+//Change the first #define line for each option.
+static void applyDefines(std::vector<std::string> &lines, std::vector<prepDefine> &defines) {
+  for (size_t index = 0; index < defines.size(); index++) {
+    prepDefine &define = defines[index];
+    //"#define NAME value  //comment", or commented out.
+    std::regex pattern("^(//)?#define " + define.name + "(\\s+[^/]*?)?(\\s*//.*)?$");
+    for (size_t number = 0; number < lines.size(); number++) {
+      std::smatch match;
+      if (std::regex_match(lines[number], match, pattern)) {
+        std::string value = define.value.empty() ? match[2].str() : " " + define.value;
+        lines[number] = (define.enable ? "" : "//") + std::string("#define ") + define.name + value + match[3].str();
+        define.done = true;
+        break;
+      }
+    }
+  }
+}
+
+//The functions defined in the sketch, as prototypes, as the IDE finds them.
+static std::vector<std::string> findPrototypes(const std::vector<std::string> &lines) {
+  std::vector<std::string> prototypes;
+  std::regex pattern("^[ \\t]*((?:static |unsigned |signed |const )*[A-Za-z_][\\w<>]*[ \\t*&]+([A-Za-z_]\\w*)\\([^;{)]*\\))[ \\t]*\\{.*");
+  for (size_t number = 0; number < lines.size(); number++) {
+    std::smatch match;
+    if (std::regex_match(lines[number], match, pattern)) {
+      std::string name = match[2].str();
+      if ((name == "if") || (name == "while") || (name == "for") || (name == "switch") || (name == "return")) {
+        continue;
+      }
+      prototypes.push_back(match[1].str() + ";");
+    }
+  }
+  return prototypes;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-D NAME[=value]]... [-U NAME]... sketch.ino > sketch.cpp\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<prepDefine> defines;
+  const char *path = NULL;
+  for (int arg = 1; arg < argc; arg++) {
+    if (((strcmp(argv[arg], "-D") == 0) || (strcmp(argv[arg], "-U") == 0)) && (arg + 1 < argc)) {
+      prepDefine define;
+      define.enable = (argv[arg][1] == 'D');
+      std::string text = argv[++arg];
+      size_t equals = text.find('=');
+      define.name = text.substr(0, equals);
+      define.value = (equals == std::string::npos) ? "" : text.substr(equals + 1);
+      define.done = false;
+      defines.push_back(define);
+    }
+    else if ((argv[arg][0] != '-') && (path == NULL)) {
+      path = argv[arg];
+    }
+    else {
+      usage(argv[0]);
+    }
+  }
+  if (path == NULL) {
+    usage(argv[0]);
+  }
+  std::vector<std::string> lines;
+  if (!readLines(path, lines)) {
+    return 1;
+  }
+  applyDefines(lines, defines);
+  for (size_t index = 0; index < defines.size(); index++) {
+    if (!defines[index].done) {
+      fprintf(stderr, "%s: no #define %s line\n", path, defines[index].name.c_str());
+      return 1;
+    }
+  }
+  std::vector<std::string> prototypes = findPrototypes(lines);
+  //The prototypes go before setup(), after the sketch's types.
+  size_t setupLine = lines.size();
+  for (size_t number = 0; number < lines.size(); number++) {
+    if (lines[number].compare(0, 14, "void setup() {") == 0) {
+      setupLine = number;
+      break;
+    }
+  }
+  printf("#include <Arduino.h>\n#line 1 \"%s\"\n", path);
+  for (size_t number = 0; number < lines.size(); number++) {
+    if (number == setupLine) {
+      for (size_t index = 0; index < prototypes.size(); index++) {
+        printf("%s\n", prototypes[index].c_str());
+      }
+      printf("#line %u \"%s\"\n", (unsigned)(number + 1), path);
+    }
+    printf("%s\n", lines[number].c_str());
+  }
+  return 0;
+}
+
+//EOF
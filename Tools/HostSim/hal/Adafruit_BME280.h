@@ -0,0 +1,40 @@
+/*
+Loft Environment Monitor Host Simulation - BME280.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+A fake BME280, with the Adafruit library's interface, reading the simulated loft. A forced measurement takes 9.3ms
+  (x1 oversampling), and each read 0.3ms of I2C, on the virtual clock. A failed sensor does not begin(), and reads nan.
+*/
+
+#ifndef ADAFRUIT_BME280_H
+  #define ADAFRUIT_BME280_H
+
+  #include <Arduino.h>
+  #include <Wire.h>
+  #include <Adafruit_Sensor.h>
+
+  #define BME280_ADDRESS 0x77
+
+  class Adafruit_BME280 {
+  public:
+    enum sensor_mode {MODE_SLEEP = 0, MODE_FORCED = 1, MODE_NORMAL = 3};
+    enum sensor_sampling {SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16};
+    enum sensor_filter {FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16};
+    enum standby_duration {STANDBY_MS_0_5, STANDBY_MS_62_5, STANDBY_MS_125, STANDBY_MS_250, STANDBY_MS_500,
+                           STANDBY_MS_1000, STANDBY_MS_10, STANDBY_MS_20};
+
+    bool begin(uint8_t address = BME280_ADDRESS, TwoWire *wire = &Wire);
+    void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling temperatureSampling = SAMPLING_X16,
+                     sensor_sampling pressureSampling = SAMPLING_X16, sensor_sampling humiditySampling = SAMPLING_X16,
+                     sensor_filter filter = FILTER_OFF, standby_duration duration = STANDBY_MS_0_5);
+    bool takeForcedMeasurement();
+    float readTemperature();
+    float readHumidity();
+    float readPressure();
+    float readAltitude(float seaLevel);
+  };
+#endif
+
+//EOF
@@ -0,0 +1,16 @@
+/*
+Loft Environment Monitor Host Simulation - Adafruit Unified Sensor.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Nothing from it is used directly.
+*/
+
+#ifndef ADAFRUIT_SENSOR_H
+  #define ADAFRUIT_SENSOR_H
+
+  #include <Arduino.h>
+#endif
+
+//EOF
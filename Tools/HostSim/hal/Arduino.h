@@ -0,0 +1,79 @@
+/*
+Loft Environment Monitor Host Simulation - Arduino core.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Just enough of the Arduino core, for an ATmega328P Nano, for the sketch and its libraries to build on a PC. The time,
+  pin, ADC and serial functions are simulated in HostSim.cpp, on a virtual clock.
+*/
+
+#ifndef ARDUINO_H
+  #define ARDUINO_H
+
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <stdlib.h>
+  #include <string.h>
+  #include <math.h>
+  #include <avr/io.h>
+  #include <avr/pgmspace.h>
+
+  #define HIGH 0x1
+  #define LOW 0x0
+  #define INPUT 0x0
+  #define OUTPUT 0x1
+  #define INPUT_PULLUP 0x2
+  #define DEC 10
+  #define HEX 16
+  #define OCT 8
+  #define BIN 2
+  #define PI 3.1415926535897932384626433832795
+  #define DEG_TO_RAD 0.017453292519943295769236907684886
+  #define RAD_TO_DEG 57.295779513082320876798154814105
+
+  #define A0 14
+  #define A1 15
+  #define A2 16
+  #define A3 17
+  #define A4 18
+  #define A5 19
+  #define A6 20
+  #define A7 21
+  #define NUM_DIGITAL_PINS 22
+
+  #define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+  #define sq(x) ((x) * (x))
+  #define lowByte(w) ((uint8_t)((w) & 0xff))
+  #define highByte(w) ((uint8_t)((w) >> 8))
+  #define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+  #define bitSet(value, bit) ((value) |= (1UL << (bit)))
+  #define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+  #define bit(b) (1UL << (b))
+  #define interrupts() sei()
+  #define noInterrupts() cli()
+
+  typedef bool boolean;
+  typedef uint8_t byte;
+  typedef uint16_t word;
+
+  uint32_t millis();
+  uint32_t micros();
+  void delay(uint32_t ms);
+  void delayMicroseconds(unsigned int us);
+  void pinMode(uint8_t pin, uint8_t mode);
+  void digitalWrite(uint8_t pin, uint8_t value);
+  int digitalRead(uint8_t pin);
+  int analogRead(uint8_t pin);
+  void analogReference(uint8_t mode);
+  void analogWrite(uint8_t pin, int value);
+  long random(long howBig);
+  long random(long howSmall, long howBig);
+  void randomSeed(unsigned long seed);
+  long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+  #include "Print.h"
+  #include "HardwareSerial.h"
+#endif
+
+//EOF
@@ -0,0 +1,42 @@
+/*
+Loft Environment Monitor Host Simulation - DHT11/22.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+A fake DHT11 or DHT22, with the Adafruit library's interface, reading the simulated loft. As in the library, the
+  sensor is only read if the last read was 2 seconds or more ago, otherwise the last reading is returned. A read takes
+  the start signal (20ms for a DHT11, 1.1ms for a DHT22) and 4ms of data bits, on the virtual clock. The DHT11 has
+  whole degrees and %, the DHT22 tenths. A failed sensor reads nan.
+*/
+
+#ifndef DHT_H
+  #define DHT_H
+
+  #include <Arduino.h>
+
+  #define DHT11 11
+  #define DHT12 12
+  #define DHT21 21
+  #define DHT22 22
+  #define AM2301 21
+
+  class DHT {
+  public:
+    DHT(uint8_t pin, uint8_t type, uint8_t count = 6);
+    void begin(uint8_t pullTime = 55);
+    float readTemperature(bool fahrenheit = false, bool force = false);
+    float readHumidity(bool force = false);
+    bool read(bool force = false);
+
+  private:
+    uint8_t _pin;
+    uint8_t _type;
+    uint32_t _lastRead;
+    bool _read;                         //There has been a read.
+    float _temperature;
+    float _humidity;
+  };
+#endif
+
+//EOF
@@ -0,0 +1,50 @@
+/*
+Loft Environment Monitor Host Simulation - DS18B20.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Fake DS18B20 probes, with the DallasTemperature library's interface, on a simulated OneWire bus, reading the loft. A
+  conversion takes 750ms at 12 bits, and a probe's temperature is the one at the end of its last conversion, in
+  0.0625 deg C steps - 85 deg C (the power on value) before the first. The bus commands take a few ms of the virtual
+  clock, and with setWaitForConversion(true) requestTemperatures() waits for the conversion. A failed probe is missing
+  from the bus, and reads DEVICE_DISCONNECTED_C.
+*/
+
+#ifndef DALLASTEMPERATURE_H
+  #define DALLASTEMPERATURE_H
+
+  #include <Arduino.h>
+  #include <OneWire.h>
+
+  #define DEVICE_DISCONNECTED_C -127
+  #define DEVICE_DISCONNECTED_F -196.6
+  #define DEVICE_DISCONNECTED_RAW -7040
+
+  typedef uint8_t DeviceAddress[8];
+
+  class DallasTemperature {
+  public:
+    DallasTemperature(OneWire *bus = NULL);
+    void begin();
+    uint8_t getDeviceCount();
+    bool getAddress(uint8_t *address, uint8_t index);
+    bool isConnected(const uint8_t *address);
+    void setWaitForConversion(bool wait);
+    bool getWaitForConversion();
+    uint8_t getResolution();
+    uint8_t getResolution(const uint8_t *address);
+    bool setResolution(uint8_t resolution);
+    int16_t millisToWaitForConversion(uint8_t resolution);
+    bool isConversionComplete();
+    void requestTemperatures();
+    float getTempC(const uint8_t *address);
+    float getTempCByIndex(uint8_t index);
+
+  private:
+    bool _wait;
+    uint8_t _resolution;
+  };
+#endif
+
+//EOF
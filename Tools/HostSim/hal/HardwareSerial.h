@@ -0,0 +1,36 @@
+/*
+Loft Environment Monitor Host Simulation - Serial.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+The serial port, with a 63 byte transmit buffer, as on the Nano, that empties at the baud rate on the virtual clock. A
+  write to a full buffer waits, moving the clock on, as the real one does. What is sent is captured by HostSim.cpp, and
+  the received bytes come from its script.
+*/
+
+#ifndef HARDWARESERIAL_H
+  #define HARDWARESERIAL_H
+
+  #include "Print.h"
+
+  class HardwareSerial : public Print {
+  public:
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int peek();
+    int read();
+    int availableForWrite();
+    void flush();
+    size_t write(uint8_t data);
+    using Print::write;
+    operator bool() {
+      return true;
+    }
+  };
+
+  extern HardwareSerial Serial;
+#endif
+
+//EOF
@@ -0,0 +1,26 @@
+/*
+Loft Environment Monitor Host Simulation - OneWire.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Only the bus pin, the DS18B20 fake does the rest.
+*/
+
+#ifndef ONEWIRE_H
+  #define ONEWIRE_H
+
+  #include <Arduino.h>
+
+  class OneWire {
+  public:
+    OneWire(uint8_t pin) {
+      _pin = pin;
+    }
+
+  private:
+    uint8_t _pin;
+  };
+#endif
+
+//EOF
@@ -0,0 +1,147 @@
+/*
+Loft Environment Monitor Host Simulation - Print.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+The Arduino Print class. The numbers are printed exactly as on the Nano, where a double is a float, so the floats are
+  stepped in float, not double.
+*/
+
+#ifndef PRINT_H
+  #define PRINT_H
+
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <string.h>
+  #include <math.h>
+
+  class __FlashStringHelper;
+  #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+  class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      size_t count = 0;
+      while (size-- > 0) {
+        if (write(*buffer++) == 0) {
+          break;
+        }
+        count++;
+      }
+      return count;
+    }
+    size_t write(const char *text) {
+      return (text == NULL) ? 0 : write((const uint8_t *)text, strlen(text));
+    }
+    size_t write(const char *buffer, size_t size) {
+      return write((const uint8_t *)buffer, size);
+    }
+    virtual int availableForWrite() {
+      return 0;
+    }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *text) {
+      return write(reinterpret_cast<const char *>(text));
+    }
+    size_t print(const char text[]) {
+      return write(text);
+    }
+    size_t print(char character) {
+      return write((uint8_t)character);
+    }
+    size_t print(unsigned char number, int base = DEC) {
+      return print((unsigned long)number, base);
+    }
+    size_t print(int number, int base = DEC) {
+      return print((long)number, base);
+    }
+    size_t print(unsigned int number, int base = DEC) {
+      return print((unsigned long)number, base);
+    }
+    size_t print(long number, int base = DEC) {
+      if (base == 0) {
+        return write((uint8_t)number);
+      }
+      if ((base == 10) && (number < 0)) {
+        size_t count = print('-');
+        return count + printNumber(-(unsigned long)number, 10);
+      }
+      return printNumber(number, base);
+    }
+    size_t print(unsigned long number, int base = DEC) {
+      return (base == 0) ? write((uint8_t)number) : printNumber(number, base);
+    }
+    size_t print(double number, int digits = 2) {
+      return printFloat(number, digits);
+    }
+
+    size_t println() {
+      return write("\r\n");
+    }
+    template<class T> size_t println(T value) {
+      size_t count = print(value);
+      return count + println();
+    }
+    template<class T> size_t println(T value, int format) {
+      size_t count = print(value, format);
+      return count + println();
+    }
+
+  private:
+    size_t printNumber(unsigned long number, uint8_t base) {
+      char buffer[8 * sizeof(long) + 1];
+      char *text = &buffer[sizeof(buffer) - 1];
+      *text = '\0';
+      if (base < 2) {
+        base = 10;
+      }
+      do {
+        char digit = number % base;
+        number /= base;
+        *--text = (digit < 10) ? digit + '0' : digit + 'A' - 10;
+      } while (number != 0);
+      return write(text);
+    }
+
+    size_t printFloat(float number, uint8_t digits) {
+      size_t count = 0;
+      if (isnan(number)) {
+        return print("nan");
+      }
+      if (isinf(number)) {
+        return print("inf");
+      }
+      if ((number > 4294967040.0f) || (number < -4294967040.0f)) {
+        return print("ovf");
+      }
+      if (number < 0.0f) {
+        count += print('-');
+        number = -number;
+      }
+      float rounding = 0.5f;
+      for (uint8_t digit = 0; digit < digits; digit++) {
+        rounding /= 10.0f;
+      }
+      number += rounding;
+      unsigned long whole = (unsigned long)number;
+      float remainder = number - (float)whole;
+      count += print(whole);
+      if (digits > 0) {
+        count += print('.');
+      }
+      while (digits-- > 0) {
+        remainder *= 10.0f;
+        unsigned int digit = (unsigned int)remainder;
+        count += print(digit);
+        remainder -= digit;
+      }
+      return count;
+    }
+  };
+#endif
+
+//EOF
@@ -0,0 +1,24 @@
+/*
+Loft Environment Monitor Host Simulation - I2C.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Only there for the BME280 fake, which does not use it.
+*/
+
+#ifndef WIRE_H
+  #define WIRE_H
+
+  #include <Arduino.h>
+
+  class TwoWire {
+  public:
+    void begin() {}
+    void setClock(uint32_t clock) {}
+  };
+
+  extern TwoWire Wire;
+#endif
+
+//EOF
@@ -0,0 +1,26 @@
+/*
+Loft Environment Monitor Host Simulation - EEPROM.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+1KB of EEPROM, erased (0xFF), or loaded from a file by HostSim.cpp. A byte write takes 3.4ms of virtual time, and the
+  EEPROM is not ready until it is done, so the sketch's byte at a time drains are paced as on the Nano.
+*/
+
+#ifndef EEPROM_H
+  #define EEPROM_H
+
+  #include <stdint.h>
+  #include <stddef.h>
+
+  uint8_t eeprom_read_byte(const uint8_t *address);
+  uint16_t eeprom_read_word(const uint16_t *address);
+  void eeprom_read_block(void *destination, const void *source, size_t size);
+  void eeprom_write_byte(uint8_t *address, uint8_t value);
+  void eeprom_update_byte(uint8_t *address, uint8_t value);
+  void eeprom_update_block(const void *source, void *destination, size_t size);
+  bool eeprom_is_ready();
+#endif
+
+//EOF
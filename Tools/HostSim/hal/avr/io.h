@@ -0,0 +1,32 @@
+/*
+Loft Environment Monitor Host Simulation - ATmega328P registers.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Only the registers the sketch uses. MCUSR holds the reset cause HostSim.cpp is started with. __AVR_ATmega328P__ is
+  not defined, so the band LEDs are set with digitalWrite(), not the port registers.
+*/
+
+#ifndef IO_H
+  #define IO_H
+
+  #include <stdint.h>
+
+  #define E2END 0x3FF                   //1KB of EEPROM.
+  #define RAMEND 0x8FF
+  #define PORF 0
+  #define EXTRF 1
+  #define BORF 2
+  #define WDRF 3
+  #ifndef _BV
+    #define _BV(bit) (1 << (bit))
+  #endif
+
+  extern volatile uint8_t MCUSR;
+  extern volatile uint8_t SREG;
+  inline void cli() {}
+  inline void sei() {}
+#endif
+
+//EOF
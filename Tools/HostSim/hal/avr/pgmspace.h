@@ -0,0 +1,30 @@
+/*
+Loft Environment Monitor Host Simulation - Program memory.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+There is only one address space on a PC, so PROGMEM data is ordinary const data, read directly.
+*/
+
+#ifndef PGMSPACE_H
+  #define PGMSPACE_H
+
+  #include <stdint.h>
+  #include <string.h>
+
+  #define PROGMEM
+  #define PGM_P const char *
+  #define PSTR(s) (s)
+  #define pgm_read_byte(address) (*(const uint8_t *)(address))
+  #define pgm_read_word(address) (*(const uint16_t *)(address))
+  #define pgm_read_dword(address) (*(const uint32_t *)(address))
+  #define pgm_read_float(address) (*(const float *)(address))
+  #define pgm_read_ptr(address) (*(const void * const *)(address))
+  #define strlen_P strlen
+  #define strcmp_P strcmp
+  #define strcpy_P strcpy
+  #define memcpy_P memcpy
+#endif
+
+//EOF
@@ -0,0 +1,21 @@
+/*
+Loft Environment Monitor Host Simulation - Sleep.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Idle sleep moves the virtual clock on to the next Timer0 overflow, which wakes the Nano every 1.024ms.
+*/
+
+#ifndef SLEEP_H
+  #define SLEEP_H
+
+  #include <stdint.h>
+
+  #define SLEEP_MODE_IDLE 0
+
+  void set_sleep_mode(uint8_t mode);
+  void sleep_mode();
+#endif
+
+//EOF
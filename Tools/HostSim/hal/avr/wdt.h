@@ -0,0 +1,31 @@
+/*
+Loft Environment Monitor Host Simulation - Watchdog.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+The watchdog is checked on the virtual clock by HostSim.cpp, which stops the simulation if it times out.
+*/
+
+#ifndef WDT_H
+  #define WDT_H
+
+  #include <stdint.h>
+
+  #define WDTO_15MS 0
+  #define WDTO_30MS 1
+  #define WDTO_60MS 2
+  #define WDTO_120MS 3
+  #define WDTO_250MS 4
+  #define WDTO_500MS 5
+  #define WDTO_1S 6
+  #define WDTO_2S 7
+  #define WDTO_4S 8
+  #define WDTO_8S 9
+
+  void wdt_enable(uint8_t timeout);
+  void wdt_disable();
+  void wdt_reset();
+#endif
+
+//EOF
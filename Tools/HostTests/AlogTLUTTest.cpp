@@ -0,0 +1,71 @@
+/*
+Loft Environment Monitor Host Tests - ADC->temperature lookup tables.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Checks every entry of the compile time tables (AlogTLUT.h), built with the sketch's KY013, MF52D and TMP36 settings,
+  against the floating point calculation they replace, readTemperatureC(float), given the divider resistance (or
+  voltage) for the same ADC value. An entry is the calculation, in double, rounded to 0.01 deg C, so each must be
+  within ATSTEST_TOLERANCE of it, plus ATSTEST_FLOATERROR, as the sensor calculates in float, which moves a result
+  that is just on a half step by up to 1e-4 deg C. As in the tables, an ADC value of 0 is calculated as 1, and the
+  result is held to the range of an entry.
+
+Build (any C++11 compiler), from the repository folder:
+  g++ -std=gnu++11 -O2 -DARDUINO=10813 -fsingle-precision-constant -ITools/HostSim/hal -IVDivider -IAlogTSensors
+    -o AlogTLUTTest Tools/HostTests/AlogTLUTTest.cpp VDivider/VDivider.cpp AlogTSensors/AlogTSensors.cpp
+
+Usage:
+  AlogTLUTTest
+Exits 0 if every entry is within the tolerance, 1 if not, printing each one that is not.
+*/
+
+#include "HostTest.h"
+#include <AlogTSensors.h>
+
+#define ATSTEST_TOLERANCE 0.005             //deg C, half an entry step.
+#define ATSTEST_FLOATERROR 0.0005           //deg C, the float calculation's own error, against the double table.
+
+//The sketch's sensor settings.
+#define AVREF 4.83
+#define KY013R1 110000
+#define C1_KY 0.0005182977433
+#define C2_KY 0.0002252079282
+#define C3_KY 0.0000001615362158
+#define MF52DR1 10000
+#define CBETA_MF 3435
+#define NOMRST_MF 10000
+#define NOMTEMP_MF 25.0
+
+ATS_SHH_LUT(ky013LUT, KY013R1, true, C1_KY, C2_KY, C3_KY);
+ATS_BETA_LUT(mf52dLUT, MF52DR1, true, CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+ATS_TMP36_LUT(tmp36LUT, AVREF, _TMP36OFFSET, _TMP36MULTIPLIER);
+
+//The calculation, held to the range of a table entry.
+static float entryRange(float temperatureC) {
+  return constrain(temperatureC, _ATSLUTMIN / _ATSLUTSCALE, _ATSLUTMAX / _ATSLUTSCALE);
+}
+
+static void checkEntry(const char *name, const int16_t *lut, uint16_t averageADC, float calcC) {
+  float lutC = atsLUTRead(lut, averageADC);
+  float error = fabs(lutC - entryRange(calcC));
+  check(error <= (ATSTEST_TOLERANCE + ATSTEST_FLOATERROR), "%s ADC %u: table %.3f, calculated %.4f, error %.4f", name, averageADC, lutC, calcC, error);
+}
+
+int main() {
+  KY013 ky013(A0, KY013R1);
+  MF52D mf52d(A2, MF52DR1);
+  TMP36 tmp36(A1);
+  ky013.setC123(C1_KY, C2_KY, C3_KY);
+  mf52d.setCBeta(CBETA_MF, NOMRST_MF, NOMTEMP_MF);
+  tmp36.setConsts(_VDIVSAMPLES, _SAMPLEDELAY, _ADCREADYDELAY, AVREF);
+  for (uint16_t averageADC = 0; averageADC < _ATSLUTSIZE; averageADC++) {
+    uint16_t dividerADC = (averageADC == 0) ? 1 : averageADC;
+    checkEntry("KY013", ky013LUT, averageADC, ky013.readTemperatureC(ky013.calcR2(dividerADC)));
+    checkEntry("MF52D", mf52dLUT, averageADC, mf52d.readTemperatureC(mf52d.calcR2(dividerADC)));
+    checkEntry("TMP36", tmp36LUT, averageADC, tmp36.readTemperatureC(tmp36.calcVOut(averageADC)));
+  }
+  return hostResult("AlogTLUTTest");
+}
+
+//EOF
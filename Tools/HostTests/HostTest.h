@@ -0,0 +1,131 @@
+/*
+Loft Environment Monitor Host Tests - Arduino core and checks.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Just enough of the Arduino core, against the HostSim hal headers, for a test to build the libraries on a PC, and
+  nothing of the loft, so a test decides every ADC value. Included once, by the test's .cpp.
+
+  Clock - A virtual clock, in ms, which only moves on with delay() or hostTick().
+  ADC   - Each analog pin reads its own list of values in turn, set with hostADC(), repeating. The multiplexer
+          needs hostSettle ms on a new pin before a reading is right, as on the Nano, and a reading taken sooner
+          returns HOSTUNSETTLED, and does not use up a value from the list, so it spoils any average it gets into.
+
+check() prints each failure, and hostResult() is the exit status, 0 if every check passed.
+*/
+
+#ifndef HOSTTEST_H
+  #define HOSTTEST_H
+
+  #include <Arduino.h>
+  #include <stdio.h>
+  #include <stdarg.h>
+  #include <vector>
+
+  #define HOSTUNSETTLED 1023                //The reading from a multiplexer that has not settled.
+
+  static uint32_t hostClock = 0;            //ms.
+  static uint32_t hostSettle = 0;           //ms the multiplexer needs on a new pin.
+  static uint8_t hostPin = 0xFF;            //The pin the multiplexer is connected to.
+  static uint32_t hostPinTime = 0;          //When it was connected.
+  static std::vector<uint16_t> hostValues[NUM_DIGITAL_PINS];
+  static size_t hostNext[NUM_DIGITAL_PINS];
+  static uint32_t hostReads = 0;            //Every analogRead().
+  static uint32_t hostUnsettled = 0;        //The analogRead()s before the multiplexer settled.
+  static int hostChecks = 0;
+  static int hostFailures = 0;
+
+  //Set the values a pin reads, in turn, from the first.
+  inline void hostADC(uint8_t pin, const std::vector<uint16_t> &values) {
+    if (pin < A0) {
+      pin += A0;
+    }
+    hostValues[pin] = values;
+    hostNext[pin] = 0;
+  }
+
+  inline void hostTick(uint32_t ms = 1) {
+    hostClock += ms;
+  }
+
+  inline void check(bool condition, const char *format, ...) {
+    hostChecks++;
+    if (!condition) {
+      hostFailures++;
+      va_list args;
+      va_start(args, format);
+      fprintf(stderr, "FAIL: ");
+      vfprintf(stderr, format, args);
+      fprintf(stderr, "\n");
+      va_end(args);
+    }
+  }
+
+  inline int hostResult(const char *name) {
+    printf("%s: %d check(s), %d failed\n", name, hostChecks, hostFailures);
+    return (hostFailures == 0) ? 0 : 1;
+  }
+
+  //Arduino core.
+
+  uint32_t millis() {
+    return hostClock;
+  }
+
+  uint32_t micros() {
+    return hostClock * 1000;
+  }
+
+  void delay(uint32_t ms) {
+    hostClock += ms;
+  }
+
+  void delayMicroseconds(unsigned int us) {}
+  void pinMode(uint8_t pin, uint8_t mode) {}
+  void digitalWrite(uint8_t pin, uint8_t value) {}
+
+  int digitalRead(uint8_t pin) {
+    return LOW;
+  }
+
+  int analogRead(uint8_t pin) {
+    if (pin < A0) {
+      pin += A0;                            //analogRead(0) is A0.
+    }
+    hostReads++;
+    if (pin != hostPin) {
+      hostPin = pin;
+      hostPinTime = hostClock;
+    }
+    if ((hostClock - hostPinTime) < hostSettle) {
+      hostUnsettled++;
+      return HOSTUNSETTLED;
+    }
+    if ((pin >= NUM_DIGITAL_PINS) || hostValues[pin].empty()) {
+      return 0;
+    }
+    uint16_t value = hostValues[pin][hostNext[pin]];
+    hostNext[pin] = (hostNext[pin] + 1) % hostValues[pin].size();
+    return value;
+  }
+
+  void analogReference(uint8_t mode) {}
+  void analogWrite(uint8_t pin, int value) {}
+
+  long random(long howBig) {
+    return 0;
+  }
+
+  long random(long howSmall, long howBig) {
+    return howSmall;
+  }
+
+  void randomSeed(unsigned long seed) {}
+
+  long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+  }
+#endif
+
+//EOF
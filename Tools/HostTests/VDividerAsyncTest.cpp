@@ -0,0 +1,128 @@
+/*
+Loft Environment Monitor Host Tests - Non-blocking voltage divider sampling.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Checks that a vDivider read with startSampling(), isReady() and result(), polled once a millisecond, as from loop(),
+  gives the same averaged ADC value as the blocking readADC() of the same samples, and that it waits out the ADC
+  ready delay, after the start, and again whenever another divider switches the multiplexer away:
+  Steady     - Nothing else uses the ADC.
+  Switched   - Another divider takes a blocking reading part way through the sampling.
+  Settling   - Another divider switches the multiplexer during the ready delay.
+A sample taken before the multiplexer has settled reads HOSTUNSETTLED (see HostTest.h), so spoils the average.
+
+Build (any C++11 compiler), from the repository folder:
+  g++ -std=gnu++11 -O2 -DARDUINO=10813 -ITools/HostSim/hal -IVDivider -o VDividerAsyncTest
+    Tools/HostTests/VDividerAsyncTest.cpp VDivider/VDivider.cpp
+
+Usage:
+  VDividerAsyncTest
+Exits 0 if every check passes, 1 if not, printing each one that does not.
+*/
+
+#include "HostTest.h"
+#include <VDivider.h>
+
+#define VDTEST_SAMPLES 8
+#define VDTEST_SAMPLEDELAY 2                //ms.
+#define VDTEST_READYDELAY 10                //ms, as long as the multiplexer takes to settle.
+#define VDTEST_POLLLIMIT 1000               //ms, for a reading that never finishes.
+
+static const std::vector<uint16_t> dividerValues = {500, 511, 498, 530, 467, 502, 519, 490};
+static const std::vector<uint16_t> otherValues = {100, 101, 99, 100};
+
+static vDivider divider(A0);
+static vDivider other(A1);
+
+//Start from the multiplexer on another pin, with the values read from the first.
+static void restart() {
+  vDivider::adcRead(A7);
+  hostADC(A0, dividerValues);
+  hostADC(A1, otherValues);
+  hostTick(VDTEST_READYDELAY);
+}
+
+//Poll the divider once a millisecond, as loop() would, until it is ready, returning the ms taken.
+static uint32_t pollUntilReady() {
+  uint32_t start = hostClock;
+  while (!divider.isReady() && ((hostClock - start) < VDTEST_POLLLIMIT)) {
+    hostTick();
+  }
+  return hostClock - start;
+}
+
+//Poll until the divider has taken this many samples.
+static void pollUntilSamples(size_t samples) {
+  uint32_t start = hostClock;
+  while ((hostNext[A0] < samples) && ((hostClock - start) < VDTEST_POLLLIMIT)) {
+    divider.isReady();
+    hostTick();
+  }
+}
+
+static void checkReading(const char *name, uint16_t expected, uint32_t unsettled, uint32_t taken, uint32_t fewest) {
+  check(divider.isReady(), "%s: not ready after %u ms", name, taken);
+  check(divider.samplesUsed() == VDTEST_SAMPLES, "%s: %u samples used, not %u", name, divider.samplesUsed(), VDTEST_SAMPLES);
+  uint16_t result = divider.result();
+  check(result == expected, "%s: result %u, readADC() %u", name, result, expected);
+  check(hostUnsettled == unsettled, "%s: %u reading(s) before the multiplexer settled, not %u", name, hostUnsettled, unsettled);
+  check(taken >= fewest, "%s: ready in %u ms, less than the %u ms the delays take", name, taken, fewest);
+  check(!divider.isSampling(), "%s: still sampling after result()", name);
+}
+
+int main() {
+  hostSettle = VDTEST_READYDELAY;
+  divider.setConsts(VDTEST_SAMPLES, VDTEST_SAMPLEDELAY, VDTEST_READYDELAY);
+  other.setConsts(4, VDTEST_SAMPLEDELAY, VDTEST_READYDELAY);
+  uint32_t fewest = VDTEST_READYDELAY + ((VDTEST_SAMPLES - 1) * VDTEST_SAMPLEDELAY);
+
+  //The blocking reading, to compare against. Its ready delay reading is the one unsettled one.
+  restart();
+  hostUnsettled = 0;
+  uint16_t expected = divider.readADC();
+  check(hostUnsettled == 1, "readADC(): %u reading(s) before the multiplexer settled, not 1", hostUnsettled);
+  check(!divider.isSampling(), "readADC(): left a non-blocking reading in progress");
+
+  //Steady.
+  restart();
+  hostUnsettled = 0;
+  check(divider.startSampling(), "Steady: startSampling() refused");
+  check(!divider.startSampling(), "Steady: a second startSampling() was not refused");
+  check(!divider.isReady(), "Steady: ready before the ADC ready delay");
+  uint32_t taken = pollUntilReady();
+  checkReading("Steady", expected, 1, taken, fewest);
+
+  //Switched, after 3 samples, by another divider's blocking reading.
+  restart();
+  hostUnsettled = 0;
+  divider.startSampling();
+  pollUntilSamples(3);
+  uint16_t otherResult = other.readADC();
+  uint32_t resumed = hostClock;
+  check(otherResult == vDivider::averageADC(400, 4), "Switched: the other divider read %u, not its own pin", otherResult);
+  check(!divider.isReady(), "Switched: sampled on without waiting for the multiplexer");
+  check(hostNext[A0] == 3, "Switched: %u samples taken before the multiplexer settled, not 3", (unsigned)hostNext[A0]);
+  pollUntilReady();
+  taken = hostClock - resumed;
+  checkReading("Switched", expected, 3, taken, VDTEST_READYDELAY + ((VDTEST_SAMPLES - 4) * VDTEST_SAMPLEDELAY));
+
+  //Settling, switched by another divider half way through the ready delay.
+  restart();
+  hostUnsettled = 0;
+  divider.startSampling();
+  hostTick(VDTEST_READYDELAY / 2);
+  check(!divider.isReady(), "Settling: ready during the ADC ready delay");
+  vDivider::adcRead(A1);
+  resumed = hostClock;
+  hostTick(VDTEST_READYDELAY / 2);
+  check(!divider.isReady(), "Settling: sampled on without waiting for the multiplexer");
+  check(hostNext[A0] == 0, "Settling: %u samples taken before the multiplexer settled, not 0", (unsigned)hostNext[A0]);
+  pollUntilReady();
+  taken = hostClock - resumed;
+  checkReading("Settling", expected, 3, taken, fewest);
+
+  return hostResult("VDividerAsyncTest");
+}
+
+//EOF
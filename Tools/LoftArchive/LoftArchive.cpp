@@ -0,0 +1,427 @@
+/*
+Loft Environment Monitor Capture Archive.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Keeps CoolTerm captures (e.g. LoftMon20210111-1.csv) in a compressed column store (LoftStore.h), about a tenth of
+  their size or less, and gets them back out, all of them, or a time range of some columns, or the rows where a column
+  is in a range of values, decoding only the blocks that can have them.
+
+  -a  Append captures to a store, creating it if need be, read with the capture reader (Tools/LoftIngest), and report
+      the bytes in and out. Give the captures in time order. The rows of a capture at or before the last time
+      already in the store are skipped, so a capture added twice, or two that overlap, are only stored once.
+  -i  Report what a store holds - the blocks, rows, time covered, and for each column the bytes it takes, the bits per
+      value and how its blocks are stored.
+  -x  Write rows from a store as CSV, to stdout, like "LoftIngest -o", with the time as the first column, and a report
+      of the blocks read and skipped to stderr. By default every row and column, or:
+        -f, -t   Only the rows from, and to, these times, "YYYY-MM-DD HH:MM:SS".
+        -c       Only these columns, -c for each one.
+        -r       Only the rows where the first -c column is in the range low:high, e.g. -r 45:100 for the hot ones.
+  -q  Report each column's count, min, mean, standard deviation, max, first and last value over a time range, from
+      the store's rollups (LoftRollup.h), its hourly and daily buckets, kept in store.lfs.rollup beside it and brought
+      up to date first, if need be (-a does too). Only the part hours at the range's ends are read from the rows.
+        -f, -t   From, and up to but not including, these times, "YYYY-MM-DD HH:MM:SS", by default the whole store.
+        -c       Only these columns, -c for each one.
+        -l       Instead, each column's top hour, or day, buckets in the range, e.g. the hottest hour of a July.
+        -s       Rank the buckets by their "max" (the default), "mean", or lowest "min", e.g. the coldest night.
+        -n       The buckets to report for each column, default 1.
+
+Build (any C++11 compiler with threads):
+  g++ -std=c++11 -O2 -pthread -o LoftArchive Tools/LoftArchive/LoftArchive.cpp Tools/LoftArchive/LoftStore.cpp \
+      Tools/LoftArchive/LoftRollup.cpp Tools/LoftIngest/LoftCapture.cpp
+
+Usage:
+  LoftArchive -a store.lfs [-d delimiter] [-j threads] capture.csv...
+  LoftArchive -i store.lfs
+  LoftArchive -x store.lfs [-f from] [-t to] [-c column]... [-r low:high]
+  LoftArchive -q store.lfs [-f from] [-t to] [-c column]... [-l hour|day [-s max|mean|min] [-n count]]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LoftRollup.h"
+#include "LoftStore.h"
+
+static double elapsedSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string rollupPath(const char *path) {
+  return std::string(path) + ".rollup";
+}
+
+//Bring a store's rollups up to date, reporting any change.
+static bool updateRollups(const char *path, const storeReader &store, rollupIndex &index) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (!index.update(rollupPath(path).c_str(), store)) {
+    fprintf(stderr, "%s\n", index.error().c_str());
+    return false;
+  }
+  if (index.updated() > 0) {
+    fprintf(stderr, "Rollups: %llu buckets updated, %llu in all, %.2f MB, in %.3fs\n",
+            (unsigned long long)index.updated(), (unsigned long long)index.buckets(), index.size() / 1e6,
+            elapsedSince(start));
+  }
+  return true;
+}
+
+static int appendCaptures(const char *path, const std::vector<const char *> &captures, char delimiter, unsigned threads) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  storeWriter writer;
+  if (!writer.open(path)) {
+    fprintf(stderr, "%s\n", writer.error().c_str());
+    return 1;
+  }
+  captureReader reader(delimiter, threads);
+  captureTable table;
+  for (size_t index = 0; index < captures.size(); index++) {
+    //Only the column order is carried from one capture to the next, the rows go straight to the store.
+    std::vector<int> fields = table.fields;
+    std::vector<std::string> names = table.names;
+    table.clear();
+    table.names = names;
+    table.columns.resize(names.size());
+    table.fields = fields;
+    if (!reader.read(captures[index], table)) {
+      fprintf(stderr, "%s\n", reader.error().c_str());
+      return 1;
+    }
+    if (!writer.append(table)) {
+      fprintf(stderr, "%s\n", writer.error().c_str());
+      return 1;
+    }
+  }
+  if (!writer.close()) {
+    fprintf(stderr, "%s\n", writer.error().c_str());
+    return 1;
+  }
+  const captureStats &stats = reader.stats();
+  double seconds = elapsedSince(start);
+  printf("Appended %llu rows from %zu captures, %.1f MB, to %s, %.2f MB (%.1f x smaller), in %.2fs\n",
+         (unsigned long long)writer.rowsWritten(), captures.size(), stats.bytes / 1e6, path, writer.bytesWritten() / 1e6,
+         (writer.bytesWritten() > 0) ? (double)stats.bytes / writer.bytesWritten() : 0.0, seconds);
+  if ((writer.untimed() > 0) || (stats.orphans > 0)) {
+    printf("Skipped %llu rows without a timestamp, and %llu before a header\n", (unsigned long long)writer.untimed(),
+           (unsigned long long)stats.orphans);
+  }
+  if (writer.overlapped() > 0) {
+    printf("Skipped %llu rows at or before the last time already in the store\n", (unsigned long long)writer.overlapped());
+  }
+  fflush(stdout);
+  storeReader store;
+  rollupIndex index;
+  if (!store.open(path)) {
+    fprintf(stderr, "%s\n", store.error().c_str());
+    return 1;
+  }
+  return updateRollups(path, store, index) ? 0 : 1;
+}
+
+static int reportStore(const char *path) {
+  storeReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "%s\n", reader.error().c_str());
+    return 1;
+  }
+  const std::vector<storeBlock> &blocks = reader.blocks();
+  printf("%s: %.2f MB, %zu blocks, %llu rows\n", path, reader.size() / 1e6, blocks.size(),
+         (unsigned long long)reader.rows());
+  if (reader.validSize() < reader.size()) {
+    printf("The last %llu bytes are a block cut short, dropped when next appended to\n",
+           (unsigned long long)(reader.size() - reader.validSize()));
+  }
+  if (blocks.empty()) {
+    return 0;
+  }
+  int64_t first = blocks[0].first;
+  int64_t last = blocks[0].last;
+  uint64_t timeBytes = 0;
+  for (size_t index = 0; index < blocks.size(); index++) {
+    first = (blocks[index].first < first) ? blocks[index].first : first;
+    last = (blocks[index].last > last) ? blocks[index].last : last;
+    timeBytes += blocks[index].timeSize;
+  }
+  printf("From %s to %s\n\n", formatTimestamp(first / 1000.0).c_str(), formatTimestamp(last / 1000.0).c_str());
+  printf("%-26s %10s %10s %10s %8s %8s %10s %10s\n", "Column", "Values", "Nans", "Bytes", "Bits", "Blocks", "Delta", "XOR");
+  printf("%-26s %10llu %10s %10llu %8.2f %8zu\n", "Time", (unsigned long long)reader.rows(), "", (unsigned long long)timeBytes,
+         8.0 * timeBytes / reader.rows(), blocks.size());
+  const std::vector<std::string> &names = reader.names();
+  for (size_t id = 0; id < names.size(); id++) {
+    uint64_t values = 0;
+    uint64_t nans = 0;
+    uint64_t bytes = 0;
+    unsigned long stored = 0;
+    unsigned long encodings[2] = {0, 0};
+    for (size_t index = 0; index < blocks.size(); index++) {
+      const storeColumn *column = blocks[index].column((uint8_t)id);
+      if (column != NULL) {
+        values += blocks[index].rows;
+        nans += column->nans;
+        bytes += column->size;
+        encodings[column->encoding]++;
+        stored++;
+      }
+    }
+    if (stored == 0) {
+      continue;
+    }
+    printf("%-26s %10llu %10llu %10llu %8.2f %8lu %10lu %10lu\n", names[id].c_str(), (unsigned long long)values,
+           (unsigned long long)nans, (unsigned long long)bytes, 8.0 * bytes / values, stored, encodings[STORE_DELTA],
+           encodings[STORE_XOR]);
+  }
+  return 0;
+}
+
+static int extractRows(const char *path, double from, double to, const std::vector<std::string> &columnNames,
+                       float low, float high) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  storeReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "%s\n", reader.error().c_str());
+    return 1;
+  }
+  std::vector<int> ids;
+  for (size_t index = 0; index < columnNames.size(); index++) {
+    ids.push_back(reader.column(columnNames[index]));
+    if (ids.back() < 0) {
+      fprintf(stderr, "%s: no %s column\n", path, columnNames[index].c_str());
+      return 1;
+    }
+  }
+  if (ids.empty()) {
+    for (size_t id = 0; id < reader.names().size(); id++) {
+      if (!reader.names()[id].empty()) {
+        ids.push_back(id);
+      }
+    }
+  }
+  bool filtered = !(std::isinf(low) && std::isinf(high));
+  printf("Time");
+  for (size_t index = 0; index < ids.size(); index++) {
+    printf(",%s", reader.names()[ids[index]].c_str());
+  }
+  printf("\n");
+  storeScanStats stats = {0, 0, 0, 0};
+  std::vector<double> times;
+  std::vector<std::vector<float> > values(ids.size());
+  for (size_t index = 0; index < reader.blocks().size(); index++) {
+    const storeBlock &block = reader.blocks()[index];
+    const storeColumn *first = ids.empty() ? NULL : block.column(ids[0]);
+    stats.blocks++;
+    if ((block.last / 1000.0 < from) || (block.first / 1000.0 > to) ||
+        (filtered && ((first == NULL) || (first->high < low) || (first->low > high)))) {
+      stats.skipped++;
+      continue;
+    }
+    reader.decodeTimes(block, times);
+    for (size_t column = 0; column < ids.size(); column++) {
+      reader.decodeColumn(block, ids[column], values[column]);
+    }
+    stats.rows += block.rows;
+    for (size_t row = 0; row < block.rows; row++) {
+      if ((times[row] < from) || (times[row] > to) ||
+          (filtered && !((values[0][row] >= low) && (values[0][row] <= high)))) {
+        continue;
+      }
+      stats.matched++;
+      fputs(formatTimestamp(times[row]).c_str(), stdout);
+      for (size_t column = 0; column < ids.size(); column++) {
+        const storeColumn *stored = block.column(ids[column]);
+        float value = values[column][row];
+        if (std::isnan(value)) {
+          fputc(',', stdout);
+        }
+        else if (stored->decimals != STORE_NODECIMALS) {
+          printf(",%.*f", (stored->decimals < 2) ? 2 : stored->decimals, value);
+        }
+        else {
+          printf(",%.7g", value);
+        }
+      }
+      fputc('\n', stdout);
+    }
+  }
+  fflush(stdout);
+  fprintf(stderr, "Blocks: %llu, skipped: %llu, rows decoded: %llu, rows written: %llu, in %.3fs\n",
+          (unsigned long long)stats.blocks, (unsigned long long)stats.skipped, (unsigned long long)stats.rows,
+          (unsigned long long)stats.matched, elapsedSince(start));
+  return 0;
+}
+
+//Orders buckets best first, by their max, mean ('e'), or lowest min ('n').
+struct bucketRanking {
+  char stat;
+  bool operator()(const rollupBucket &one, const rollupBucket &other) const {
+    if (stat == 'n') {
+      return one.stats.low < other.stats.low;
+    }
+    if (stat == 'e') {
+      return one.stats.mean() > other.stats.mean();
+    }
+    return one.stats.high > other.stats.high;
+  }
+};
+
+static int queryRollups(const char *path, double from, double to, const std::vector<std::string> &columnNames,
+                        int level, const std::string &stat, unsigned count) {
+  storeReader store;
+  rollupIndex index;
+  if (!store.open(path)) {
+    fprintf(stderr, "%s\n", store.error().c_str());
+    return 1;
+  }
+  if (!updateRollups(path, store, index)) {
+    return 1;
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<int> ids;
+  for (size_t column = 0; column < columnNames.size(); column++) {
+    ids.push_back(store.column(columnNames[column]));
+    if (ids.back() < 0) {
+      fprintf(stderr, "%s: no %s column\n", path, columnNames[column].c_str());
+      return 1;
+    }
+  }
+  if (ids.empty()) {
+    for (size_t id = 0; id < store.names().size(); id++) {
+      if (!store.names()[id].empty()) {
+        ids.push_back(id);
+      }
+    }
+  }
+  if (level < 0) {
+    rollupQueryStats stats = {{0, 0}, 0, 0};
+    printf("%-26s %10s %8s %8s %8s %8s %8s %8s\n", "Column", "Count", "Min", "Mean", "SD", "Max", "First", "Last");
+    for (size_t column = 0; column < ids.size(); column++) {
+      rollupStats values = index.query(store, ids[column], from, to, stats);
+      printf("%-26s %10llu %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", store.names()[ids[column]].c_str(),
+             (unsigned long long)values.count, values.low, values.mean(), values.deviation(), values.high, values.first,
+             values.last);
+    }
+    fflush(stdout);
+    fprintf(stderr, "From %llu day and %llu hour buckets, and %llu rows of %llu blocks, in %.3fms\n",
+            (unsigned long long)stats.buckets[ROLLUP_DAY], (unsigned long long)stats.buckets[ROLLUP_HOUR],
+            (unsigned long long)stats.rows, (unsigned long long)stats.blocks, elapsedSince(start) * 1000.0);
+    return 0;
+  }
+  bucketRanking ranking = {(stat == "min") ? 'n' : ((stat == "mean") ? 'e' : 'x')};
+  uint64_t listed = 0;
+  printf("%-26s %-19s %8s %8s %8s %8s\n", "Column", (level == ROLLUP_DAY) ? "Day" : "Hour", "Count", "Min", "Mean", "Max");
+  for (size_t column = 0; column < ids.size(); column++) {
+    std::vector<rollupBucket> buckets;
+    listed += index.list(level, ids[column], from, to, buckets);
+    size_t shown = (count < buckets.size()) ? count : buckets.size();
+    std::partial_sort(buckets.begin(), buckets.begin() + shown, buckets.end(), ranking);
+    for (size_t bucket = 0; bucket < shown; bucket++) {
+      const rollupStats &values = buckets[bucket].stats;
+      printf("%-26s %-19s %8llu %8.2f %8.2f %8.2f\n", store.names()[ids[column]].c_str(),
+             formatTimestamp(buckets[bucket].start).c_str(), (unsigned long long)values.count, values.low,
+             values.mean(), values.high);
+    }
+  }
+  fflush(stdout);
+  fprintf(stderr, "From %llu buckets, in %.3fms\n", (unsigned long long)listed, elapsedSince(start) * 1000.0);
+  return 0;
+}
+
+static double parseTime(const char *text) {
+  size_t length;
+  double time = captureTimestamp(text, strlen(text), length);
+  if (std::isnan(time)) {
+    fprintf(stderr, "Not a time: %s, use \"YYYY-MM-DD HH:MM:SS\"\n", text);
+    exit(1);
+  }
+  return time;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s -a store.lfs [-d delimiter] [-j threads] capture.csv...\n"
+                  "       %s -i store.lfs\n"
+                  "       %s -x store.lfs [-f from] [-t to] [-c column]... [-r low:high]\n"
+                  "       %s -q store.lfs [-f from] [-t to] [-c column]... [-l hour|day [-s max|mean|min] [-n count]]\n",
+          name, name, name, name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  char mode = 0;
+  const char *path = NULL;
+  char delimiter = 0;
+  unsigned threads = 0;
+  double from = -INFINITY;
+  double to = INFINITY;
+  float low = -INFINITY;
+  float high = INFINITY;
+  int level = -1;
+  std::string stat = "max";
+  unsigned count = 1;
+  std::vector<std::string> columns;
+  std::vector<const char *> captures;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    bool hasValue = (arg + 1 < argc);
+    if (((option == "-a") || (option == "-i") || (option == "-x") || (option == "-q")) && hasValue && (mode == 0)) {
+      mode = option[1];
+      path = argv[++arg];
+    }
+    else if ((option == "-d") && hasValue) {
+      std::string text = argv[++arg];
+      delimiter = (text == "tab") ? '\t' : ((text == "space") ? ' ' : text[0]);
+    }
+    else if ((option == "-j") && hasValue) {
+      threads = atoi(argv[++arg]);
+    }
+    else if ((option == "-f") && hasValue) {
+      from = parseTime(argv[++arg]);
+    }
+    else if ((option == "-t") && hasValue) {
+      to = parseTime(argv[++arg]);
+    }
+    else if ((option == "-c") && hasValue) {
+      columns.push_back(argv[++arg]);
+    }
+    else if ((option == "-r") && hasValue) {
+      if (sscanf(argv[++arg], "%f:%f", &low, &high) != 2) {
+        usage(argv[0]);
+      }
+    }
+    else if ((option == "-l") && hasValue) {
+      std::string text = argv[++arg];
+      level = (text == "hour") ? ROLLUP_HOUR : ((text == "day") ? ROLLUP_DAY : -2);
+    }
+    else if ((option == "-s") && hasValue) {
+      stat = argv[++arg];
+    }
+    else if ((option == "-n") && hasValue) {
+      count = atoi(argv[++arg]);
+    }
+    else if ((option.size() > 1) && (option[0] == '-')) {
+      usage(argv[0]);
+    }
+    else {
+      captures.push_back(argv[arg]);
+    }
+  }
+  if ((mode == 'a') && !captures.empty()) {
+    return appendCaptures(path, captures, delimiter, threads);
+  }
+  if ((mode == 'i') && captures.empty()) {
+    return reportStore(path);
+  }
+  if ((mode == 'x') && captures.empty() && (std::isinf(low) || !columns.empty())) {
+    return extractRows(path, from, to, columns, low, high);
+  }
+  if ((mode == 'q') && captures.empty() && (level >= -1) && ((stat == "max") || (stat == "mean") || (stat == "min"))) {
+    return queryRollups(path, from, to, columns, level, stat, count);
+  }
+  usage(argv[0]);
+}
+
+//EOF
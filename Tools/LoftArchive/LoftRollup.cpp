@@ -0,0 +1,559 @@
+/*
+Loft Environment Monitor Store Rollups.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftRollup.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#ifdef _WIN32
+  #include <fstream>
+  #include <iterator>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define ROLLUP_MAGIC "LoftRoll"
+#define ROLLUP_MAGICSIZE 8
+#define ROLLUP_HEADER 33                //The magic, version, blocks, store offset and bucket count.
+#define ROLLUP_RECORD 60
+#define ROLLUP_BUCKETBITS 48            //Of the key, the bucket number, below the column id and the level.
+#define ROLLUP_MAXTIME 1000000000000000LL  //ms, far beyond any capture, in place of an open ended range.
+
+static const int64_t levelWidths[ROLLUP_LEVELS] = {3600, 86400};
+
+//Little endian fields.
+
+static void put(std::vector<uint8_t> &bytes, uint64_t value, int size) {
+  for (int index = 0; index < size; index++) {
+    bytes.push_back((uint8_t)(value >> (8 * index)));
+  }
+}
+
+static void putFloat(std::vector<uint8_t> &bytes, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  put(bytes, bits, 4);
+}
+
+static void putDouble(std::vector<uint8_t> &bytes, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  put(bytes, bits, 8);
+}
+
+static uint64_t get(const uint8_t *data, int size) {
+  uint64_t value = 0;
+  for (int index = 0; index < size; index++) {
+    value |= (uint64_t)data[index] << (8 * index);
+  }
+  return value;
+}
+
+static float getFloat(const uint8_t *data) {
+  uint32_t bits = (uint32_t)get(data, 4);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static double getDouble(const uint8_t *data) {
+  uint64_t bits = get(data, 8);
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void putRecord(std::vector<uint8_t> &bytes, uint64_t key, const rollupStats &stats) {
+  put(bytes, key, 8);
+  put(bytes, stats.count, 4);
+  putFloat(bytes, stats.low);
+  putFloat(bytes, stats.high);
+  putFloat(bytes, stats.first);
+  putFloat(bytes, stats.last);
+  putDouble(bytes, stats.sum);
+  putDouble(bytes, stats.squares);
+  put(bytes, (uint64_t)stats.firstTime, 8);
+  put(bytes, (uint64_t)stats.lastTime, 8);
+}
+
+static void getRecord(const uint8_t *record, rollupStats &stats) {
+  stats.count = get(record + 8, 4);
+  stats.low = getFloat(record + 12);
+  stats.high = getFloat(record + 16);
+  stats.first = getFloat(record + 20);
+  stats.last = getFloat(record + 24);
+  stats.sum = getDouble(record + 28);
+  stats.squares = getDouble(record + 36);
+  stats.firstTime = (int64_t)get(record + 44, 8);
+  stats.lastTime = (int64_t)get(record + 52, 8);
+}
+
+//Seconds, perhaps infinite, as ms from 1970 on.
+static int64_t toTime(double seconds) {
+  if (!(seconds > 0.0)) {
+    return 0;
+  }
+  if (seconds * 1000.0 >= ROLLUP_MAXTIME) {
+    return ROLLUP_MAXTIME;
+  }
+  return llround(seconds * 1000.0);
+}
+
+static int64_t bucketAt(int64_t time, int64_t width) {
+  return time / width;
+}
+
+static int64_t bucketAfter(int64_t time, int64_t width) {
+  return (time + width - 1) / width;
+}
+
+rollupStats::rollupStats() {
+  count = 0;
+  low = NAN;
+  high = NAN;
+  first = NAN;
+  last = NAN;
+  sum = 0.0;
+  squares = 0.0;
+  firstTime = 0;
+  lastTime = 0;
+}
+
+void rollupStats::add(float value, int64_t time) {
+  if (std::isnan(value)) {
+    return;
+  }
+  if (count == 0) {
+    low = value;
+    high = value;
+    first = value;
+    last = value;
+    firstTime = time;
+    lastTime = time;
+  }
+  else {
+    low = (value < low) ? value : low;
+    high = (value > high) ? value : high;
+    if (time < firstTime) {
+      first = value;
+      firstTime = time;
+    }
+    if (time >= lastTime) {
+      last = value;
+      lastTime = time;
+    }
+  }
+  sum += value;
+  squares += (double)value * value;
+  count++;
+}
+
+void rollupStats::merge(const rollupStats &other) {
+  if (other.count == 0) {
+    return;
+  }
+  if (count == 0) {
+    *this = other;
+    return;
+  }
+  low = (other.low < low) ? other.low : low;
+  high = (other.high > high) ? other.high : high;
+  if (other.firstTime < firstTime) {
+    first = other.first;
+    firstTime = other.firstTime;
+  }
+  if (other.lastTime >= lastTime) {
+    last = other.last;
+    lastTime = other.lastTime;
+  }
+  sum += other.sum;
+  squares += other.squares;
+  count += other.count;
+}
+
+double rollupStats::mean() const {
+  return (count > 0) ? sum / count : NAN;
+}
+
+double rollupStats::deviation() const {
+  if (count == 0) {
+    return NAN;
+  }
+  double average = sum / count;
+  double variance = squares / count - average * average;
+  return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+int64_t rollupWidth(int level) {
+  return levelWidths[level];
+}
+
+uint64_t rollupKey(int level, uint8_t id, int64_t bucket) {
+  return ((uint64_t)level << 56) | ((uint64_t)id << ROLLUP_BUCKETBITS) |
+         ((uint64_t)bucket & ((1ULL << ROLLUP_BUCKETBITS) - 1));
+}
+
+rollupIndex::rollupIndex() {
+  _map = NULL;
+  _size = 0;
+  _records = NULL;
+  _count = 0;
+  _blocks = 0;
+  _storeBlocks = 0;
+  _updated = 0;
+}
+
+rollupIndex::~rollupIndex() {
+  close();
+}
+
+/*!
+ *  @brief  Bring an index up to date with its store, adding the blocks appended since it was last updated, or
+ *          building it, when there is none, or it is not for the store. It is left open.
+ *  @param  path
+ *          The index file, rewritten when it changes.
+ *  @param  store
+ *          The store, open.
+ *  @return False if it could not be written, see error().
+ */
+
+bool rollupIndex::update(const char *path, const storeReader &store) {
+  bool valid = open(path, store);
+  _updated = 0;
+  if (valid && current()) {
+    return true;
+  }
+  std::map<uint64_t, rollupStats> buckets;
+  size_t first = 0;
+  if (valid) {
+    for (uint64_t index = 0; index < _count; index++) {
+      const uint8_t *record = _records + index * ROLLUP_RECORD;
+      getRecord(record, buckets[get(record, 8)]);
+    }
+    first = _blocks;
+  }
+  close();
+  const std::vector<storeBlock> &blocks = store.blocks();
+  std::set<uint64_t> touched;
+  std::vector<double> seconds;
+  std::vector<int64_t> times;
+  std::vector<float> values;
+  for (size_t index = first; index < blocks.size(); index++) {
+    const storeBlock &block = blocks[index];
+    store.decodeTimes(block, seconds);
+    times.resize(seconds.size());
+    for (size_t row = 0; row < seconds.size(); row++) {
+      times[row] = llround(seconds[row] * 1000.0);
+    }
+    for (size_t column = 0; column < block.columns.size(); column++) {
+      uint8_t id = block.columns[column].id;
+      store.decodeColumn(block, id, values);
+      for (int level = 0; level < ROLLUP_LEVELS; level++) {
+        //The rows are nearly always in time order, so a bucket is looked up once for all its rows.
+        int64_t width = levelWidths[level] * 1000;
+        std::map<uint64_t, rollupStats>::iterator bucket = buckets.end();
+        uint64_t key = 0;
+        for (size_t row = 0; row < values.size(); row++) {
+          if (std::isnan(values[row]) || (times[row] < 0)) {
+            continue;
+          }
+          uint64_t rowKey = rollupKey(level, id, bucketAt(times[row], width));
+          if ((bucket == buckets.end()) || (rowKey != key)) {
+            key = rowKey;
+            bucket = buckets.insert(std::make_pair(key, rollupStats())).first;
+            touched.insert(key);
+          }
+          bucket->second.add(values[row], times[row]);
+        }
+      }
+    }
+  }
+  std::vector<uint8_t> bytes(ROLLUP_MAGIC, ROLLUP_MAGIC + ROLLUP_MAGICSIZE);
+  bytes.push_back(ROLLUP_VERSION);
+  put(bytes, blocks.size(), 8);
+  put(bytes, blocks.empty() ? 0 : blocks.back().offset + blocks.back().size, 8);
+  put(bytes, buckets.size(), 8);
+  bytes.reserve(ROLLUP_HEADER + buckets.size() * ROLLUP_RECORD);
+  for (std::map<uint64_t, rollupStats>::const_iterator bucket = buckets.begin(); bucket != buckets.end(); bucket++) {
+    putRecord(bytes, bucket->first, bucket->second);
+  }
+  //Written aside, then renamed over the old one, so a failed update leaves the old index whole.
+  std::string newPath = std::string(path) + ".new";
+  FILE *file = fopen(newPath.c_str(), "wb");
+  bool written = (file != NULL) && (fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+  if ((file != NULL) && (fclose(file) != 0)) {
+    written = false;
+  }
+  if (!written) {
+    _error = newPath + ": " + strerror(errno);
+    return false;
+  }
+#ifdef _WIN32
+  remove(path);
+#endif
+  if (rename(newPath.c_str(), path) != 0) {
+    _error = std::string(path) + ": " + strerror(errno);
+    return false;
+  }
+  if (!open(path, store)) {
+    return false;
+  }
+  _updated = touched.size();
+  return true;
+}
+
+/*!
+ *  @brief  Open an index as it is, for queries.
+ *  @param  path
+ *          The index file.
+ *  @param  store
+ *          The store it is for, open.
+ *  @return False if it could not be opened, or is not an index, or not one for the store, see error(). It may not
+ *          hold the blocks last appended to the store, see current().
+ */
+
+bool rollupIndex::open(const char *path, const storeReader &store) {
+  close();
+#ifdef _WIN32
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    _error = std::string(path) + ": cannot open";
+    return false;
+  }
+  _buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+  _map = _buffer.data();
+  _size = _buffer.size();
+#else
+  int file = ::open(path, O_RDONLY);
+  struct stat status;
+  if ((file < 0) || (fstat(file, &status) != 0)) {
+    _error = std::string(path) + ": " + strerror(errno);
+    if (file >= 0) {
+      ::close(file);
+    }
+    return false;
+  }
+  _size = status.st_size;
+  if (_size > 0) {
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED) {
+      _error = std::string(path) + ": " + strerror(errno);
+      _size = 0;
+      return false;
+    }
+    _map = (const uint8_t *)data;
+  }
+  else {
+    ::close(file);
+  }
+#endif
+  if ((_size < ROLLUP_HEADER) || (memcmp(_map, ROLLUP_MAGIC, ROLLUP_MAGICSIZE) != 0) ||
+      (_map[ROLLUP_MAGICSIZE] != ROLLUP_VERSION)) {
+    _error = std::string(path) + ": not a rollup index, or a version this cannot read";
+    close();
+    return false;
+  }
+  _blocks = get(_map + 9, 8);
+  uint64_t storeOffset = get(_map + 17, 8);
+  _count = get(_map + 25, 8);
+  _records = _map + ROLLUP_HEADER;
+  const std::vector<storeBlock> &blocks = store.blocks();
+  _storeBlocks = blocks.size();
+  if ((_size - ROLLUP_HEADER) / ROLLUP_RECORD != _count) {
+    _error = std::string(path) + ": cut short";
+    close();
+    return false;
+  }
+  if ((_blocks > blocks.size()) ||
+      (storeOffset != ((_blocks == 0) ? 0 : blocks[_blocks - 1].offset + blocks[_blocks - 1].size))) {
+    _error = std::string(path) + ": not for this store";
+    close();
+    return false;
+  }
+  return true;
+}
+
+void rollupIndex::close() {
+#ifndef _WIN32
+  if ((_map != NULL) && _buffer.empty()) {
+    munmap((void *)_map, _size);
+  }
+#endif
+  _buffer.clear();
+  _map = NULL;
+  _size = 0;
+  _records = NULL;
+  _count = 0;
+  _blocks = 0;
+  _storeBlocks = 0;
+}
+
+bool rollupIndex::current() const {
+  return (_map != NULL) && (_blocks == _storeBlocks);
+}
+
+uint64_t rollupIndex::buckets() const {
+  return _count;
+}
+
+uint64_t rollupIndex::size() const {
+  return _size;
+}
+
+uint64_t rollupIndex::updated() const {
+  return _updated;
+}
+
+std::string rollupIndex::error() const {
+  return _error;
+}
+
+const uint8_t *rollupIndex::find(uint64_t key) const {
+  uint64_t low = 0;
+  uint64_t high = _count;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (get(_records + middle * ROLLUP_RECORD, 8) < key) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return _records + low * ROLLUP_RECORD;
+}
+
+/*!
+ *  @brief  A column's values over a time range, from the buckets that fit wholly inside it, coarsest first, and the
+ *          rows at its ends.
+ *  @param  store
+ *          The store the index is for, as it was opened or updated with. The index should be current(), as the rows
+ *          appended since are only read at the range's ends.
+ *  @param  id
+ *          The column.
+ *  @param  from
+ *          The time range, seconds since 1970, from, and up to but not including, to. -INFINITY and INFINITY for
+ *          all of the store.
+ *  @param  to
+ *  @param  stats
+ *          Added to.
+ *  @return The values, a count of 0 when there are none.
+ */
+
+rollupStats rollupIndex::query(const storeReader &store, uint8_t id, double from, double to,
+                               rollupQueryStats &stats) const {
+  rollupStats result;
+  const std::vector<storeBlock> &blocks = store.blocks();
+  if (blocks.empty()) {
+    return result;
+  }
+  //An open ended range only goes as far as the store.
+  int64_t first = blocks[0].first;
+  int64_t last = blocks[0].last;
+  for (size_t index = 1; index < blocks.size(); index++) {
+    first = (blocks[index].first < first) ? blocks[index].first : first;
+    last = (blocks[index].last > last) ? blocks[index].last : last;
+  }
+  int64_t start = toTime(from);
+  int64_t end = toTime(to);
+  start = (start < first) ? first : start;
+  end = (end > last + 1) ? last + 1 : end;
+  addRange(store, ROLLUP_LEVELS - 1, id, start, end, result, stats);
+  return result;
+}
+
+//The whole buckets of a level in a range, then the rest, either side, from the level below, and the rows below that.
+void rollupIndex::addRange(const storeReader &store, int level, uint8_t id, int64_t from, int64_t to,
+                           rollupStats &result, rollupQueryStats &stats) const {
+  if (from >= to) {
+    return;
+  }
+  if ((level < 0) || (_map == NULL)) {
+    addRows(store, id, from, to, result, stats);
+    return;
+  }
+  int64_t width = levelWidths[level] * 1000;
+  int64_t firstBucket = bucketAfter(from, width);
+  int64_t lastBucket = bucketAt(to, width);
+  if (firstBucket >= lastBucket) {
+    addRange(store, level - 1, id, from, to, result, stats);
+    return;
+  }
+  addRange(store, level - 1, id, from, firstBucket * width, result, stats);
+  const uint8_t *end = find(rollupKey(level, id, lastBucket));
+  rollupStats bucket;
+  for (const uint8_t *record = find(rollupKey(level, id, firstBucket)); record < end; record += ROLLUP_RECORD) {
+    getRecord(record, bucket);
+    result.merge(bucket);
+    stats.buckets[level]++;
+  }
+  addRange(store, level - 1, id, lastBucket * width, to, result, stats);
+}
+
+void rollupIndex::addRows(const storeReader &store, uint8_t id, int64_t from, int64_t to, rollupStats &result,
+                          rollupQueryStats &stats) const {
+  const std::vector<storeBlock> &blocks = store.blocks();
+  std::vector<double> times;
+  std::vector<float> values;
+  for (size_t index = 0; index < blocks.size(); index++) {
+    const storeBlock &block = blocks[index];
+    if ((block.last < from) || (block.first >= to) || (block.column(id) == NULL)) {
+      continue;
+    }
+    store.decodeTimes(block, times);
+    store.decodeColumn(block, id, values);
+    stats.blocks++;
+    for (size_t row = 0; row < block.rows; row++) {
+      int64_t time = llround(times[row] * 1000.0);
+      if ((time >= from) && (time < to)) {
+        result.add(values[row], time);
+        stats.rows++;
+      }
+    }
+  }
+}
+
+/*!
+ *  @brief  The buckets of a level that start in a time range.
+ *  @param  level
+ *          ROLLUP_HOUR or ROLLUP_DAY.
+ *  @param  id
+ *          The column.
+ *  @param  from
+ *          The time range, seconds since 1970, from, and up to but not including, to.
+ *  @param  to
+ *  @param  buckets
+ *          The buckets, in time order, added to. Those without a value are left out.
+ *  @return The buckets found.
+ */
+
+size_t rollupIndex::list(int level, uint8_t id, double from, double to, std::vector<rollupBucket> &buckets) const {
+  if ((_map == NULL) || (level < 0) || (level >= ROLLUP_LEVELS)) {
+    return 0;
+  }
+  int64_t width = levelWidths[level] * 1000;
+  const uint8_t *end = find(rollupKey(level, id, bucketAfter(toTime(to), width)));
+  size_t found = 0;
+  for (const uint8_t *record = find(rollupKey(level, id, bucketAfter(toTime(from), width))); record < end;
+       record += ROLLUP_RECORD) {
+    rollupBucket bucket;
+    bucket.start = (double)(get(record, 8) & ((1ULL << ROLLUP_BUCKETBITS) - 1)) * levelWidths[level];
+    getRecord(record, bucket.stats);
+    buckets.push_back(bucket);
+    found++;
+  }
+  return found;
+}
+
+//EOF
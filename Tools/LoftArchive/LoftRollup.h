@@ -0,0 +1,110 @@
+/*
+Loft Environment Monitor Store Rollups.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Keeps, beside a column store (LoftStore.h), each column's count, min, max, sum, sum of squares, first and last value
+  for every hour and every day it has data, so a question over a long time range, e.g. the hottest hour of a July, or a
+  year's mean, is answered from a few hundred of these buckets, not from millions of rows.
+
+A time range is answered from the coarsest buckets that fit wholly inside it, the days, then the hours either side of
+  them, and only the part hours at its ends from the rows themselves, decoding just the store blocks that hold them.
+  A range over years takes a millisecond or two.
+
+The buckets are built from the store's blocks, and the index remembers how many of the blocks it holds, so an update
+  after an append only adds the new blocks' rows, to the buckets they fall in. Should the store not match (e.g. it was
+  rebuilt), the index is built again. There are no minute buckets: at the sketch's data output period, about 16s, a
+  minute holds only four rows, and its bucket would take more room than the rows in the store.
+
+The times are the capture's, the sketch's clock as CoolTerm wrote it, so the days start at its midnight.
+
+The file is:
+  "LoftRoll", a version byte, the store blocks held (uint64_t), the store offset after the last of them (uint64_t),
+  the bucket count (uint64_t), then the buckets, sorted by their key, all little endian:
+  key (uint64_t, the level, column id and bucket number, see rollupKey()), count (uint32_t), min, max, first and last
+  (float), sum and sum of squares (double), first and last time ms (int64_t).
+The reader memory maps the file, and finds the buckets by binary search.
+*/
+
+#ifndef LOFTROLLUP_H
+  #define LOFTROLLUP_H
+
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <string>
+  #include <vector>
+  #include "LoftStore.h"
+
+  #define ROLLUP_VERSION 1
+  #define ROLLUP_HOUR 0                 //The levels, finest first.
+  #define ROLLUP_DAY 1
+  #define ROLLUP_LEVELS 2
+
+  //A bucket's, or a range's, values. nan values are not counted.
+  struct rollupStats {
+    uint64_t count;
+    float low;
+    float high;
+    float first;
+    float last;
+    double sum;
+    double squares;                     //The sum of the squares.
+    int64_t firstTime;                  //ms since 1970.
+    int64_t lastTime;
+    rollupStats();
+    void add(float value, int64_t time);
+    void merge(const rollupStats &other);
+    double mean() const;
+    double deviation() const;           //The population standard deviation.
+  };
+
+  struct rollupBucket {
+    double start;                       //Seconds since 1970.
+    rollupStats stats;
+  };
+
+  //Where a query's answer came from.
+  struct rollupQueryStats {
+    uint64_t buckets[ROLLUP_LEVELS];
+    uint64_t blocks;                    //Store blocks decoded for the range's ends...
+    uint64_t rows;                      //...and the rows in the range from them.
+  };
+
+  int64_t rollupWidth(int level);       //Seconds.
+  uint64_t rollupKey(int level, uint8_t id, int64_t bucket);
+
+  class rollupIndex {
+  public:
+    rollupIndex();
+    ~rollupIndex();
+    bool update(const char *path, const storeReader &store);  //Bring an index up to date, building it if need be.
+    bool open(const char *path, const storeReader &store);    //Open one as it is, if it is for the store.
+    void close();
+    bool current() const;               //It holds every block of the store it was opened for.
+    uint64_t buckets() const;
+    uint64_t size() const;              //File bytes.
+    uint64_t updated() const;           //The buckets added to by the last update.
+    rollupStats query(const storeReader &store, uint8_t id, double from, double to, rollupQueryStats &stats) const;
+    size_t list(int level, uint8_t id, double from, double to, std::vector<rollupBucket> &buckets) const;
+    std::string error() const;
+
+  private:
+    const uint8_t *find(uint64_t key) const;  //The first bucket at or after the key.
+    void addRange(const storeReader &store, int level, uint8_t id, int64_t from, int64_t to, rollupStats &result,
+                  rollupQueryStats &stats) const;
+    void addRows(const storeReader &store, uint8_t id, int64_t from, int64_t to, rollupStats &result,
+                 rollupQueryStats &stats) const;
+    const uint8_t *_map;
+    std::vector<uint8_t> _buffer;       //The file, where it cannot be memory mapped.
+    uint64_t _size;
+    const uint8_t *_records;
+    uint64_t _count;
+    uint64_t _blocks;                   //Of the store, held.
+    uint64_t _storeBlocks;              //In the store.
+    uint64_t _updated;
+    std::string _error;
+  };
+#endif
+
+//EOF
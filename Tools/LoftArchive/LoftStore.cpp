@@ -0,0 +1,849 @@
+/*
+Loft Environment Monitor Column Store.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftStore.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#ifdef _WIN32
+  #include <fstream>
+  #include <iterator>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define STORE_MAGIC "LoftStor"
+#define STORE_MAGICSIZE 8
+#define STORE_BLOCKHEADER 30            //A block record's fixed fields, with the type and size.
+#define STORE_COLUMNHEADER 17           //Each column's fields in a block header.
+
+static const double powersOf10[STORE_MAXDECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4};
+
+//Little endian fields.
+
+static void put(std::vector<uint8_t> &bytes, uint64_t value, int size) {
+  for (int index = 0; index < size; index++) {
+    bytes.push_back((uint8_t)(value >> (8 * index)));
+  }
+}
+
+static void putFloat(std::vector<uint8_t> &bytes, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  put(bytes, bits, 4);
+}
+
+static uint64_t get(const uint8_t *data, int size) {
+  uint64_t value = 0;
+  for (int index = 0; index < size; index++) {
+    value |= (uint64_t)data[index] << (8 * index);
+  }
+  return value;
+}
+
+static float getFloat(const uint8_t *data) {
+  uint32_t bits = (uint32_t)get(data, 4);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+//Bit streams, least significant bit first.
+
+class bitWriter {
+public:
+  bitWriter() : _buffer(0), _count(0) {}
+  void write(uint64_t value, unsigned bits) {
+    if (bits > 32) {
+      write(value & 0xFFFFFFFFULL, 32);
+      write(value >> 32, bits - 32);
+      return;
+    }
+    _buffer |= (value & ((1ULL << bits) - 1)) << _count;
+    _count += bits;
+    while (_count >= 8) {
+      bytes.push_back((uint8_t)_buffer);
+      _buffer >>= 8;
+      _count -= 8;
+    }
+  }
+  void flush() {
+    if (_count > 0) {
+      bytes.push_back((uint8_t)_buffer);
+      _buffer = 0;
+      _count = 0;
+    }
+  }
+  std::vector<uint8_t> bytes;
+
+private:
+  uint64_t _buffer;
+  unsigned _count;
+};
+
+class bitReader {
+public:
+  bitReader(const uint8_t *data, size_t size) : _next(data), _end(data + size), _buffer(0), _count(0) {}
+  uint64_t read(unsigned bits) {
+    if (bits > 32) {
+      uint64_t low = read(32);
+      return low | (read(bits - 32) << 32);
+    }
+    while (_count < bits) {
+      _buffer |= (uint64_t)((_next < _end) ? *_next++ : 0) << _count;   //Past the end reads as 0.
+      _count += 8;
+    }
+    uint64_t value = _buffer & ((1ULL << bits) - 1);
+    _buffer >>= bits;
+    _count -= bits;
+    return value;
+  }
+  bool bit() {
+    return read(1) != 0;
+  }
+
+private:
+  const uint8_t *_next;
+  const uint8_t *_end;
+  uint64_t _buffer;
+  unsigned _count;
+};
+
+static unsigned bitsFor(uint64_t value) {
+  unsigned bits = 0;
+  while (value != 0) {
+    bits++;
+    value >>= 1;
+  }
+  return bits;
+}
+
+static uint64_t zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+//The times, the first as it is, then the deltas of the deltas, in buckets: 0 '0', 7 bits '10', 9 bits '110', 12 bits
+//  '1110', or 64 bits '1111'.
+static void encodeTimes(const std::vector<int64_t> &times, int64_t unit, bitWriter &bits) {
+  bits.write((uint64_t)(times[0] / unit), 64);
+  int64_t previous = times[0] / unit;
+  int64_t delta = 0;
+  for (size_t index = 1; index < times.size(); index++) {
+    int64_t time = times[index] / unit;
+    int64_t step = time - previous;
+    int64_t change = step - delta;
+    if (change == 0) {
+      bits.write(0, 1);
+    }
+    else if ((change >= -63) && (change <= 64)) {
+      bits.write(1, 2);
+      bits.write(change + 63, 7);
+    }
+    else if ((change >= -255) && (change <= 256)) {
+      bits.write(3, 3);
+      bits.write(change + 255, 9);
+    }
+    else if ((change >= -2047) && (change <= 2048)) {
+      bits.write(7, 4);
+      bits.write(change + 2047, 12);
+    }
+    else {
+      bits.write(15, 4);
+      bits.write((uint64_t)change, 64);
+    }
+    previous = time;
+    delta = step;
+  }
+}
+
+//The values, scaled, as zigzag coded changes, in frames, each a 7 bit width and the changes in that many bits.
+static void encodeDelta(const std::vector<int32_t> &scaled, bitWriter &bits) {
+  int64_t previous = 0;
+  for (size_t start = 0; start < scaled.size(); start += STORE_FRAME) {
+    size_t end = (start + STORE_FRAME < scaled.size()) ? start + STORE_FRAME : scaled.size();
+    uint64_t changes[STORE_FRAME];
+    uint64_t all = 0;
+    for (size_t index = start; index < end; index++) {
+      changes[index - start] = zigzag((int64_t)scaled[index] - previous);
+      all |= changes[index - start];
+      previous = scaled[index];
+    }
+    unsigned width = bitsFor(all);
+    bits.write(width, 7);
+    if (width > 0) {
+      for (size_t index = start; index < end; index++) {
+        bits.write(changes[index - start], width);
+      }
+    }
+  }
+}
+
+//The values as floats, each XORed with the one before: '0' the same, '10' the changed bits fit in the last window, or
+//  '11', a 5 bit leading zero count, a 5 bit length - 1, and the changed bits.
+static void encodeXor(const std::vector<float> &values, bitWriter &bits) {
+  uint32_t previous = 0;
+  int leading = -1;
+  int trailing = 0;
+  for (size_t index = 0; index < values.size(); index++) {
+    uint32_t value;
+    memcpy(&value, &values[index], sizeof(value));
+    if (index == 0) {
+      bits.write(value, 32);
+      previous = value;
+      continue;
+    }
+    uint32_t changed = value ^ previous;
+    previous = value;
+    if (changed == 0) {
+      bits.write(0, 1);
+      continue;
+    }
+    int lead = __builtin_clz(changed);
+    int trail = __builtin_ctz(changed);
+    if ((leading >= 0) && (lead >= leading) && (trail >= trailing)) {
+      bits.write(1, 2);
+      bits.write(changed >> trailing, 32 - leading - trailing);
+    }
+    else {
+      leading = lead;
+      trailing = trail;
+      bits.write(3, 2);
+      bits.write(leading, 5);
+      bits.write(31 - leading - trailing, 5);
+      bits.write(changed >> trailing, 32 - leading - trailing);
+    }
+  }
+}
+
+//The fewest decimal places that give every value back exactly, or -1.
+static int findDecimals(const std::vector<float> &values, size_t rows) {
+  for (int decimals = 0; decimals <= STORE_MAXDECIMALS; decimals++) {
+    bool exact = true;
+    for (size_t index = 0; exact && (index < rows); index++) {
+      float value = values[index];
+      if (std::isnan(value)) {
+        continue;
+      }
+      double scaled = std::round(value * powersOf10[decimals]);
+      exact = (std::fabs(scaled) < 2147483647.0) && ((float)(scaled / powersOf10[decimals]) == value);
+    }
+    if (exact) {
+      return decimals;
+    }
+  }
+  return -1;
+}
+
+const storeColumn *storeBlock::column(uint8_t id) const {
+  for (size_t index = 0; index < columns.size(); index++) {
+    if (columns[index].id == id) {
+      return &columns[index];
+    }
+  }
+  return NULL;
+}
+
+/*!
+ *  @brief  Instantiates a new storeWriter class.
+ *  @param  blockRows
+ *          The rows in each block. Fewer rows let a scan skip more finely, more compress a little better.
+ */
+
+storeWriter::storeWriter(uint16_t blockRows) {
+  _file = NULL;
+  _blockRows = (blockRows > 0) ? blockRows : STORE_BLOCKROWS;
+  _bytes = 0;
+  _rows = 0;
+  _untimed = 0;
+  _overlapped = 0;
+  _lastTime = INT64_MIN;
+}
+
+storeWriter::~storeWriter() {
+  close();
+}
+
+/*!
+ *  @brief  Create a store, or open an existing one to append to. A block cut short at its end is dropped.
+ *  @param  path
+ *          The store file.
+ *  @return False if it could not be opened, or is not a store, see error().
+ */
+
+bool storeWriter::open(const char *path) {
+  close();
+  _names.clear();
+  _written.clear();
+  _values.clear();
+  _times.clear();
+  _lastTime = INT64_MIN;
+  FILE *existing = fopen(path, "rb");
+  if (existing != NULL) {
+    fclose(existing);
+    storeReader reader;
+    if (!reader.open(path)) {
+      _error = reader.error();
+      return false;
+    }
+    _names = reader.names();
+    _written.assign(_names.size(), true);
+    _values.resize(_names.size());
+    for (size_t index = 0; index < reader.blocks().size(); index++) {
+      _lastTime = std::max(_lastTime, reader.blocks()[index].last);
+    }
+    uint64_t validSize = reader.validSize();
+    bool cutShort = (validSize < reader.size());
+    reader.close();
+#ifndef _WIN32
+    if (cutShort && (truncate(path, validSize) != 0)) {
+      _error = std::string(path) + ": " + strerror(errno);
+      return false;
+    }
+#endif
+    _file = fopen(path, "ab");
+  }
+  else {
+    _file = fopen(path, "wb");
+    if (_file != NULL) {
+      std::vector<uint8_t> header(STORE_MAGIC, STORE_MAGIC + STORE_MAGICSIZE);
+      header.push_back(STORE_VERSION);
+      if (!write(header)) {
+        return false;
+      }
+    }
+  }
+  if (_file == NULL) {
+    _error = std::string(path) + ": " + strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+int storeWriter::column(const std::string &name) {
+  for (size_t id = 0; id < _names.size(); id++) {
+    if (_names[id] == name) {
+      return (int)id;
+    }
+  }
+  if ((_names.size() >= STORE_MAXCOLUMNS) || name.empty() || (name.size() > 255)) {
+    return -1;
+  }
+  _names.push_back(name);
+  _written.push_back(false);
+  _values.push_back(std::vector<float>());
+  return (int)_names.size() - 1;
+}
+
+/*!
+ *  @brief  Add a row.
+ *  @param  time
+ *          Seconds since 1970. A row without a time (nan) is skipped.
+ *  @param  ids
+ *          The column ids of the values, from column(). The other columns are nan.
+ *  @param  values
+ *          The values.
+ *  @return False if a full block could not be written.
+ */
+
+bool storeWriter::add(double time, const std::vector<int> &ids, const float *values) {
+  if (std::isnan(time)) {
+    _untimed++;
+    return true;
+  }
+  _times.push_back((int64_t)std::llround(time * 1000.0));
+  _lastTime = std::max(_lastTime, _times.back());
+  for (size_t id = 0; id < _values.size(); id++) {
+    _values[id].resize(_times.size(), NAN);
+  }
+  for (size_t index = 0; index < ids.size(); index++) {
+    if (ids[index] >= 0) {
+      _values[ids[index]][_times.size() - 1] = values[index];
+    }
+  }
+  return (_times.size() < _blockRows) || writeBlock();
+}
+
+/*!
+ *  @brief  Add every row of a table, from the capture reader, after the rows already in the store.
+ *          The rows at or before the store's last time are skipped, as they are from a capture added already, or
+ *          overlap the end of the last one. Only the store's time is checked, not each row's, so the rows of the
+ *          table go in as they are, even if its clock steps back, e.g. at the end of summer time.
+ *  @param  table
+ *          The table.
+ *  @return False if a block could not be written, or there are too many columns, see error().
+ */
+
+bool storeWriter::append(const captureTable &table) {
+  std::vector<int> ids;
+  for (size_t index = 0; index < table.names.size(); index++) {
+    ids.push_back(column(table.names[index]));
+    if (ids.back() < 0) {
+      _error = "Too many columns, or a bad column name: " + table.names[index];
+      return false;
+    }
+  }
+  std::vector<float> row(ids.size());
+  int64_t storeLast = _lastTime;
+  for (size_t index = 0; index < table.rows(); index++) {
+    if (!std::isnan(table.times[index]) && ((int64_t)std::llround(table.times[index] * 1000.0) <= storeLast)) {
+      _overlapped++;
+      continue;
+    }
+    for (size_t column = 0; column < ids.size(); column++) {
+      row[column] = table.columns[column][index];
+    }
+    if (!add(table.times[index], ids, row.data())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool storeWriter::write(const std::vector<uint8_t> &bytes) {
+  if (fwrite(bytes.data(), 1, bytes.size(), _file) != bytes.size()) {
+    _error = std::string("Write failed: ") + strerror(errno);
+    return false;
+  }
+  _bytes += bytes.size();
+  return true;
+}
+
+//Write the rows added so far as a block, after the name records of any new columns in it.
+bool storeWriter::writeBlock() {
+  size_t rows = _times.size();
+  if (rows == 0) {
+    return true;
+  }
+  std::vector<uint8_t> names;
+  std::vector<uint8_t> header;
+  std::vector<uint8_t> data;
+  int64_t first = _times[0];
+  int64_t last = _times[0];
+  bool wholeSeconds = true;
+  for (size_t index = 0; index < rows; index++) {
+    first = (_times[index] < first) ? _times[index] : first;
+    last = (_times[index] > last) ? _times[index] : last;
+    wholeSeconds = wholeSeconds && (_times[index] % 1000 == 0);
+  }
+  int64_t unit = wholeSeconds ? 1000 : 1;
+  bitWriter timeBits;
+  encodeTimes(_times, unit, timeBits);
+  timeBits.flush();
+  data = timeBits.bytes;
+  uint8_t columns = 0;
+  std::vector<uint8_t> columnHeaders;
+  for (size_t id = 0; id < _values.size(); id++) {
+    const std::vector<float> &values = _values[id];
+    float low = NAN;
+    float high = NAN;
+    uint16_t nans = 0;
+    for (size_t index = 0; index < rows; index++) {
+      float value = values[index];
+      if (std::isnan(value)) {
+        nans++;
+      }
+      else {
+        low = (std::isnan(low) || (value < low)) ? value : low;
+        high = (std::isnan(high) || (value > high)) ? value : high;
+      }
+    }
+    if (nans == rows) {
+      continue;
+    }
+    //Scaled deltas when the values can be scaled exactly, unless XOR is smaller.
+    bitWriter xorBits;
+    encodeXor(values, xorBits);
+    xorBits.flush();
+    const std::vector<uint8_t> *best = &xorBits.bytes;
+    storeEncoding encoding = STORE_XOR;
+    int decimals = findDecimals(values, rows);
+    bitWriter deltaBits;
+    if (decimals >= 0) {
+      std::vector<int32_t> scaled(rows);
+      for (size_t index = 0; index < rows; index++) {
+        scaled[index] = std::isnan(values[index]) ? STORE_NAN : (int32_t)std::llround(values[index] * powersOf10[decimals]);
+      }
+      encodeDelta(scaled, deltaBits);
+      deltaBits.flush();
+      if (deltaBits.bytes.size() <= xorBits.bytes.size()) {
+        best = &deltaBits.bytes;
+        encoding = STORE_DELTA;
+      }
+    }
+    if (!_written[id]) {
+      names.push_back('N');
+      names.push_back((uint8_t)id);
+      names.push_back((uint8_t)_names[id].size());
+      names.insert(names.end(), _names[id].begin(), _names[id].end());
+      _written[id] = true;
+    }
+    columnHeaders.push_back((uint8_t)id);
+    columnHeaders.push_back(encoding);
+    columnHeaders.push_back((decimals >= 0) ? (uint8_t)decimals : STORE_NODECIMALS);
+    putFloat(columnHeaders, low);
+    putFloat(columnHeaders, high);
+    put(columnHeaders, nans, 2);
+    put(columnHeaders, best->size(), 4);
+    data.insert(data.end(), best->begin(), best->end());
+    columns++;
+  }
+  header.push_back('B');
+  put(header, STORE_BLOCKHEADER - 5 + columnHeaders.size() + data.size(), 4);
+  put(header, rows, 2);
+  put(header, unit, 2);
+  put(header, (uint64_t)first, 8);
+  put(header, (uint64_t)last, 8);
+  put(header, timeBits.bytes.size(), 4);
+  header.push_back(columns);
+  header.insert(header.end(), columnHeaders.begin(), columnHeaders.end());
+  _rows += rows;
+  _times.clear();
+  for (size_t id = 0; id < _values.size(); id++) {
+    _values[id].clear();
+  }
+  return write(names) && write(header) && write(data);
+}
+
+/*!
+ *  @brief  Write the last block, and close the store.
+ *  @return False if the last block could not be written.
+ */
+
+bool storeWriter::close() {
+  if (_file == NULL) {
+    return true;
+  }
+  bool success = writeBlock();
+  if (fclose(_file) != 0) {
+    _error = std::string("Close failed: ") + strerror(errno);
+    success = false;
+  }
+  _file = NULL;
+  return success;
+}
+
+uint64_t storeWriter::bytesWritten() const {
+  return _bytes;
+}
+
+uint64_t storeWriter::rowsWritten() const {
+  return _rows;
+}
+
+uint64_t storeWriter::untimed() const {
+  return _untimed;
+}
+
+uint64_t storeWriter::overlapped() const {
+  return _overlapped;
+}
+
+std::string storeWriter::error() const {
+  return _error;
+}
+
+storeReader::storeReader() {
+  _map = NULL;
+  _size = 0;
+  _validSize = 0;
+  _rows = 0;
+}
+
+storeReader::~storeReader() {
+  close();
+}
+
+/*!
+ *  @brief  Open a store, and read its column names and block headers.
+ *  @param  path
+ *          The store file.
+ *  @return False if it could not be opened, or is not a store, see error(). A block cut short at the end is ignored.
+ */
+
+bool storeReader::open(const char *path) {
+  close();
+#ifdef _WIN32
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    _error = std::string(path) + ": cannot open";
+    return false;
+  }
+  _buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+  _map = _buffer.data();
+  _size = _buffer.size();
+#else
+  int file = ::open(path, O_RDONLY);
+  struct stat status;
+  if ((file < 0) || (fstat(file, &status) != 0)) {
+    _error = std::string(path) + ": " + strerror(errno);
+    if (file >= 0) {
+      ::close(file);
+    }
+    return false;
+  }
+  _size = status.st_size;
+  if (_size > 0) {
+    void *data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED) {
+      _error = std::string(path) + ": " + strerror(errno);
+      _size = 0;
+      return false;
+    }
+    _map = (const uint8_t *)data;
+  }
+  else {
+    ::close(file);
+  }
+#endif
+  if ((_size < STORE_MAGICSIZE + 1) || (memcmp(_map, STORE_MAGIC, STORE_MAGICSIZE) != 0)) {
+    _error = std::string(path) + ": not a store";
+    close();
+    return false;
+  }
+  if (_map[STORE_MAGICSIZE] != STORE_VERSION) {
+    _error = std::string(path) + ": a store version this cannot read";
+    close();
+    return false;
+  }
+  uint64_t offset = STORE_MAGICSIZE + 1;
+  while (offset < _size) {
+    const uint8_t *record = _map + offset;
+    uint64_t left = _size - offset;
+    if ((record[0] == 'N') && (left >= 3) && (left >= 3 + (uint64_t)record[2])) {
+      if (_names.size() <= record[1]) {
+        _names.resize(record[1] + 1);
+      }
+      _names[record[1]] = std::string((const char *)record + 3, record[2]);
+      offset += 3 + record[2];
+    }
+    else if ((record[0] == 'B') && (left >= STORE_BLOCKHEADER)) {
+      storeBlock block;
+      block.size = 5 + (uint32_t)get(record + 1, 4);
+      block.rows = (uint16_t)get(record + 5, 2);
+      block.timeUnit = (uint16_t)get(record + 7, 2);
+      block.first = (int64_t)get(record + 9, 8);
+      block.last = (int64_t)get(record + 17, 8);
+      block.timeSize = (uint32_t)get(record + 25, 4);
+      uint8_t columns = record[29];
+      block.offset = offset;
+      uint64_t dataStart = STORE_BLOCKHEADER + (uint64_t)columns * STORE_COLUMNHEADER;
+      if ((block.size > left) || (dataStart > block.size) || (block.timeUnit == 0)) {
+        break;
+      }
+      block.timeData = record + dataStart;
+      uint64_t dataOffset = dataStart + block.timeSize;
+      bool valid = true;
+      for (uint8_t index = 0; index < columns; index++) {
+        const uint8_t *fields = record + STORE_BLOCKHEADER + index * STORE_COLUMNHEADER;
+        storeColumn column;
+        column.id = fields[0];
+        column.encoding = (storeEncoding)fields[1];
+        column.decimals = fields[2];
+        column.low = getFloat(fields + 3);
+        column.high = getFloat(fields + 7);
+        column.nans = (uint16_t)get(fields + 11, 2);
+        column.size = (uint32_t)get(fields + 13, 4);
+        column.data = record + dataOffset;
+        dataOffset += column.size;
+        valid = valid && (column.encoding <= STORE_XOR) &&
+                ((column.decimals <= STORE_MAXDECIMALS) || ((column.encoding == STORE_XOR) && (column.decimals == STORE_NODECIMALS)));
+        block.columns.push_back(column);
+      }
+      if (!valid || (dataOffset != block.size)) {
+        break;
+      }
+      _blocks.push_back(block);
+      _rows += block.rows;
+      offset += block.size;
+    }
+    else {
+      break;
+    }
+  }
+  _validSize = offset;
+  return true;
+}
+
+void storeReader::close() {
+#ifndef _WIN32
+  if ((_map != NULL) && _buffer.empty()) {
+    munmap((void *)_map, _size);
+  }
+#endif
+  _buffer.clear();
+  _map = NULL;
+  _size = 0;
+  _validSize = 0;
+  _rows = 0;
+  _names.clear();
+  _blocks.clear();
+}
+
+const std::vector<std::string> &storeReader::names() const {
+  return _names;
+}
+
+int storeReader::column(const std::string &name) const {
+  for (size_t id = 0; id < _names.size(); id++) {
+    if (_names[id] == name) {
+      return (int)id;
+    }
+  }
+  return -1;
+}
+
+const std::vector<storeBlock> &storeReader::blocks() const {
+  return _blocks;
+}
+
+uint64_t storeReader::size() const {
+  return _size;
+}
+
+uint64_t storeReader::validSize() const {
+  return _validSize;
+}
+
+uint64_t storeReader::rows() const {
+  return _rows;
+}
+
+std::string storeReader::error() const {
+  return _error;
+}
+
+void storeReader::decodeTimes(const storeBlock &block, std::vector<double> &times) const {
+  times.resize(block.rows);
+  if (block.rows == 0) {
+    return;
+  }
+  bitReader bits(block.timeData, block.timeSize);
+  int64_t time = (int64_t)bits.read(64);
+  int64_t delta = 0;
+  double unit = block.timeUnit / 1000.0;
+  times[0] = time * unit;
+  for (size_t index = 1; index < block.rows; index++) {
+    int64_t change;
+    if (!bits.bit()) {
+      change = 0;
+    }
+    else if (!bits.bit()) {
+      change = (int64_t)bits.read(7) - 63;
+    }
+    else if (!bits.bit()) {
+      change = (int64_t)bits.read(9) - 255;
+    }
+    else if (!bits.bit()) {
+      change = (int64_t)bits.read(12) - 2047;
+    }
+    else {
+      change = (int64_t)bits.read(64);
+    }
+    delta += change;
+    time += delta;
+    times[index] = time * unit;
+  }
+}
+
+void storeReader::decodeColumn(const storeBlock &block, uint8_t id, std::vector<float> &values) const {
+  values.assign(block.rows, NAN);
+  const storeColumn *column = block.column(id);
+  if (column == NULL) {
+    return;
+  }
+  bitReader bits(column->data, column->size);
+  if (column->encoding == STORE_DELTA) {
+    int64_t value = 0;
+    double scale = powersOf10[column->decimals];
+    for (size_t start = 0; start < block.rows; start += STORE_FRAME) {
+      size_t end = (start + STORE_FRAME < block.rows) ? start + STORE_FRAME : block.rows;
+      unsigned width = (unsigned)bits.read(7);
+      for (size_t index = start; index < end; index++) {
+        value += (width > 0) ? unzigzag(bits.read(width)) : 0;
+        values[index] = (value == STORE_NAN) ? NAN : (float)(value / scale);
+      }
+    }
+  }
+  else {
+    uint32_t value = (uint32_t)bits.read(32);
+    int leading = 0;
+    int trailing = 0;
+    for (size_t index = 0; index < block.rows; index++) {
+      if ((index > 0) && bits.bit()) {
+        if (bits.bit()) {
+          leading = (int)bits.read(5);
+          trailing = 31 - leading - (int)bits.read(5);
+        }
+        value ^= (uint32_t)bits.read(32 - leading - trailing) << trailing;
+      }
+      memcpy(&values[index], &value, sizeof(value));
+    }
+  }
+}
+
+/*!
+ *  @brief  Find the rows in a time range, and their values of a column, optionally only those in a value range. The
+ *          blocks outside the time range, or without the column, or whose values are all outside the value range,
+ *          are skipped without being decoded.
+ *  @param  from
+ *          The time range, seconds since 1970, inclusive.
+ *  @param  to
+ *  @param  id
+ *          The column.
+ *  @param  low
+ *          The value range, inclusive, -INFINITY and INFINITY for every value, nan too.
+ *  @param  high
+ *  @param  times
+ *          The rows found, added to.
+ *  @param  values
+ *  @param  stats
+ *          Added to.
+ *  @return The rows found.
+ */
+
+size_t storeReader::scan(double from, double to, int id, float low, float high, std::vector<double> &times,
+                         std::vector<float> &values, storeScanStats &stats) const {
+  bool filtered = !(std::isinf(low) && (low < 0) && std::isinf(high) && (high > 0));
+  size_t found = 0;
+  std::vector<double> blockTimes;
+  std::vector<float> blockValues;
+  for (size_t index = 0; index < _blocks.size(); index++) {
+    const storeBlock &block = _blocks[index];
+    const storeColumn *column = block.column(id);
+    stats.blocks++;
+    if ((block.last / 1000.0 < from) || (block.first / 1000.0 > to) || (filtered && (column == NULL)) ||
+        (filtered && ((column->high < low) || (column->low > high)))) {
+      stats.skipped++;
+      continue;
+    }
+    decodeTimes(block, blockTimes);
+    decodeColumn(block, id, blockValues);
+    stats.rows += block.rows;
+    for (size_t row = 0; row < block.rows; row++) {
+      double time = blockTimes[row];
+      float value = blockValues[row];
+      if ((time >= from) && (time <= to) && (!filtered || ((value >= low) && (value <= high)))) {
+        times.push_back(time);
+        values.push_back(value);
+        found++;
+      }
+    }
+  }
+  stats.matched += found;
+  return found;
+}
+
+//EOF
@@ -0,0 +1,156 @@
+/*
+Loft Environment Monitor Column Store.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Keeps years of captured data in a small, append only file, a column at a time, so it can be scanned quickly, without
+  keeping the CSV captures. The data suits it: the times step by the data output period, about 16s, and most values
+  repeat, or move by a step or two in their last decimal place, from one row to the next.
+
+The rows are stored in blocks of up to STORE_BLOCKROWS rows, and each block holds its times, then each column:
+  Times   - In ms (or whole seconds, when they all are), as the change in the step from one row to the next, the delta of
+            the delta, which is nearly always 0. That takes 1 bit, and the others 9 to 16 bits, or 68 for a jump, e.g. a
+            gap in the capture (Gorilla's scheme). The first time is stored as it is.
+  Values  - As integers, the value scaled by its decimal places (at most STORE_MAXDECIMALS), as the change from the
+            value before, zigzag coded (so small negative changes are small too), and packed in frames of 64, each with
+            just enough bits for its largest change - no bits at all when the value does not change. A failed sensor's
+            nan is stored as STORE_NAN. A column that cannot be scaled exactly, or that is smaller that way, is stored
+            as floats, each XORed with the one before, keeping only the bits that changed (Gorilla's scheme again). A
+            column that is all nan in a block is not stored at all.
+Each block starts with a header of its rows, time range and, for each column, its min and max and where its data is,
+  so a scan can skip the blocks outside a time range, or whose values cannot match, without decoding them.
+
+The column names are kept in the file too, each as a name record before the first block that has it, so the columns
+  can change from one capture to the next, as they do when the sketch changes. The values read back are the same
+  floats as the capture reader (LoftCapture.h) gives.
+
+The file is:
+  "LoftStor", a version byte, then records, each a type byte and its fields, all little endian:
+  'N', column id (uint8_t), name length (uint8_t), name.
+  'B', size of the rest (uint32_t), rows (uint16_t), time unit ms (uint16_t), first and last time ms (int64_t), time
+       data bytes (uint32_t), column count (uint8_t), then for each column: id (uint8_t), encoding (uint8_t), decimals
+       (uint8_t), min and max (float), nan count (uint16_t), data bytes (uint32_t), then the time data, then the column
+       data.
+A block that was cut short, e.g. by a crash while appending, is dropped the next time the file is opened to append.
+
+The reader memory maps the file, and decodes straight from the map.
+
+https://www.vldb.org/pvldb/vol8/p1816-teller.pdf (Gorilla)
+*/
+
+#ifndef LOFTSTORE_H
+  #define LOFTSTORE_H
+
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <stdio.h>
+  #include <string>
+  #include <vector>
+  #include "../LoftIngest/LoftCapture.h"
+
+  #define STORE_VERSION 1
+  #define STORE_BLOCKROWS 4096          //About 18 hours at the sketch's data output period.
+  #define STORE_MAXDECIMALS 4
+  #define STORE_NODECIMALS 255          //An XOR column whose values cannot be scaled exactly.
+  #define STORE_MAXCOLUMNS 255
+  #define STORE_NAN INT32_MIN           //A nan, as a scaled value.
+  #define STORE_FRAME 64                //Values per bit packed frame.
+
+  enum storeEncoding : uint8_t {STORE_DELTA, STORE_XOR};
+
+  struct storeColumn {
+    uint8_t id;
+    storeEncoding encoding;
+    uint8_t decimals;                   //The decimal places, for a DELTA column, and an XOR one that could be scaled.
+    float low;                          //nan when every value is.
+    float high;
+    uint16_t nans;
+    uint32_t size;                      //Data bytes.
+    const uint8_t *data;
+  };
+
+  struct storeBlock {
+    uint16_t rows;
+    uint16_t timeUnit;                  //ms.
+    int64_t first;                      //ms since 1970, the earliest and latest times in the block.
+    int64_t last;
+    uint32_t timeSize;
+    const uint8_t *timeData;
+    std::vector<storeColumn> columns;
+    uint64_t offset;                    //In the file.
+    uint32_t size;                      //Of the whole block record.
+    const storeColumn *column(uint8_t id) const;  //NULL when the block does not have it.
+  };
+
+  //A range scan's counts.
+  struct storeScanStats {
+    uint64_t blocks;
+    uint64_t skipped;                   //Blocks skipped on their header alone.
+    uint64_t rows;                      //Rows decoded...
+    uint64_t matched;                   //...and those returned.
+  };
+
+  class storeWriter {
+  public:
+    storeWriter(uint16_t blockRows = STORE_BLOCKROWS);
+    ~storeWriter();
+    bool open(const char *path);        //Create a store, or open one to append to.
+    bool append(const captureTable &table);  //Rows without a timestamp, or already in the store, are skipped.
+    bool add(double time, const std::vector<int> &ids, const float *values);
+    int column(const std::string &name);     //The id for a column name, adding it if it is new, -1 if there are too many.
+    bool close();                       //Write the last block.
+    uint64_t bytesWritten() const;
+    uint64_t rowsWritten() const;
+    uint64_t untimed() const;           //Rows skipped by append()...
+    uint64_t overlapped() const;        //...and those at or before the store's last time.
+    std::string error() const;
+
+  private:
+    bool writeBlock();
+    bool write(const std::vector<uint8_t> &bytes);
+    FILE *_file;
+    uint16_t _blockRows;
+    std::vector<std::string> _names;    //By id.
+    std::vector<bool> _written;         //The name record is in the file.
+    std::vector<int64_t> _times;        //The block being filled, ms.
+    std::vector<std::vector<float> > _values;  //By id.
+    uint64_t _bytes;
+    uint64_t _rows;
+    uint64_t _untimed;
+    uint64_t _overlapped;
+    int64_t _lastTime;                  //The latest time in the store, ms, INT64_MIN when it is empty.
+    std::string _error;
+  };
+
+  class storeReader {
+  public:
+    storeReader();
+    ~storeReader();
+    bool open(const char *path);
+    void close();
+    const std::vector<std::string> &names() const;  //By id, "" for an id not used.
+    int column(const std::string &name) const;       //-1 when there is no such column.
+    const std::vector<storeBlock> &blocks() const;
+    uint64_t size() const;              //File bytes...
+    uint64_t validSize() const;         //...up to the end of the last whole record.
+    uint64_t rows() const;
+    void decodeTimes(const storeBlock &block, std::vector<double> &times) const;        //Seconds since 1970.
+    void decodeColumn(const storeBlock &block, uint8_t id, std::vector<float> &values) const;  //nan when absent.
+    size_t scan(double from, double to, int id, float low, float high, std::vector<double> &times,
+                std::vector<float> &values, storeScanStats &stats) const;
+    std::string error() const;
+
+  private:
+    const uint8_t *_map;
+    std::vector<uint8_t> _buffer;       //The file, where it cannot be memory mapped.
+    uint64_t _size;
+    uint64_t _validSize;
+    uint64_t _rows;
+    std::vector<std::string> _names;
+    std::vector<storeBlock> _blocks;
+    std::string _error;
+  };
+#endif
+
+//EOF
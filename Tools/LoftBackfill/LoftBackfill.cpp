@@ -0,0 +1,270 @@
+/*
+Loft Environment Monitor Capture Backfill.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Fills the gaps in CoolTerm captures (e.g. LoftMon20210111-1.csv) from the sketch's history (USE_HISTORY).
+
+When a capture has been stopped, or the PC restarted, send "B" (or "B<sequence>", from the last #E reply) to the
+  sketch with the capture running. If the sketch has restarted since the #E, its sequence numbers have started again
+  from 0, and it sends every kept line. The kept data lines come back as "#B,<sequence>,<age secs>,<columns...>" reply
+  lines, and this tool gives each one the time it was kept, its capture timestamp less its age, and merges those that
+  fall in a gap into the capture, as ordinary timestamped data lines, in time order. The kept lines are only one every
+  HISTORY_EVERY data outputs (2 minutes), so a filled gap has fewer rows than the rest of the capture.
+
+The captures must have CoolTerm timestamps ("2021-01-11 12:45:58<tab>" before each line). Give every capture that
+  covers the gap, and the one with the backfill replies, in time order. A kept line is merged if there is no data line
+  (captured, or already merged, a backfill can be asked for twice) within the gap limit of it, and if it has as many
+  columns as the header. The other '#' lines, command replies and latency probe times, are dropped. The merged capture is written to stdout, and a report
+  to stderr.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftBackfill LoftBackfill.cpp
+
+Usage:
+  LoftBackfill [-d delimiter] [-g gap] [capture.csv...]    (reads stdin when no capture is given)
+    -d  The column delimiter, default "," (the sketch's DATADELIMITER).
+    -g  The gap limit, seconds, default 45 (3 data outputs).
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct captureLine {
+  double time;                        //Seconds since 1970, -1 if the line has no timestamp.
+  std::string text;                   //The line, without its timestamp for a backfill row.
+  bool data;                          //A timestamped data line.
+  bool backfill;                      //A #B reply, with time set to when it was kept.
+  bool merged;
+};
+
+struct backfillStats {
+  unsigned long lines;
+  unsigned long dataLines;
+  unsigned long replies;              //#B reply lines.
+  unsigned long merged;
+  unsigned long covered;              //Replies with a data line within the gap limit, not merged.
+  unsigned long mismatched;           //Replies with the wrong number of columns, not merged.
+  unsigned gaps;                      //Gaps between data lines longer than the gap limit...
+  unsigned filled;                    //...and those with lines merged into them.
+};
+
+static std::string delimiter = ",";
+static double gapLimit = 45.0;
+
+//Seconds since 1970 for a "YYYY-MM-DD HH:MM:SS" timestamp, or -1 if the line does not start with one.
+static double parseTimestamp(const char *text) {
+  int year, month, day, hour, minute, second;
+  if (sscanf(text, "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return -1.0;
+  }
+  //Days from the civil date, http://howardhinnant.github.io/date_algorithms.html
+  year -= (month <= 2) ? 1 : 0;
+  long era = (year >= 0 ? year : year - 399) / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+  return days * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+}
+
+//The "YYYY-MM-DD HH:MM:SS" timestamp for seconds since 1970, the civil date from the days, as above.
+static std::string formatTimestamp(double time) {
+  long seconds = (long)(time + 0.5);
+  long days = (seconds >= 0) ? seconds / 86400 : (seconds - 86399) / 86400;
+  long secondOfDay = seconds - days * 86400;
+  days += 719468;
+  long era = (days >= 0 ? days : days - 146096) / 146097;
+  long dayOfEra = days - era * 146097;
+  long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  long monthIndex = (5 * dayOfYear + 2) / 153;
+  long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  long month = monthIndex + ((monthIndex < 10) ? 3 : -9);
+  long year = yearOfEra + era * 400 + ((month <= 2) ? 1 : 0);
+  char text[80];
+  snprintf(text, sizeof(text), "%04ld-%02ld-%02ld %02ld:%02ld:%02ld", year, month, day,
+           secondOfDay / 3600, (secondOfDay / 60) % 60, secondOfDay % 60);
+  return text;
+}
+
+static std::vector<std::string> splitFields(const std::string &line, const std::string &separator) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = line.find(separator, start);
+    fields.push_back(line.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + separator.size();
+  }
+  return fields;
+}
+
+//The data columns in a line, not counting an empty one after a trailing delimiter.
+static size_t countColumns(const std::string &line) {
+  std::vector<std::string> fields = splitFields(line, delimiter);
+  return fields.size() - ((fields.size() > 1) && fields.back().empty() ? 1 : 0);
+}
+
+static void readCapture(FILE *input, std::vector<captureLine> &lines, backfillStats &stats) {
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), input) != NULL) {
+    std::string text = buffer;
+    while (!text.empty() && ((text[text.size() - 1] == '\n') || (text[text.size() - 1] == '\r'))) {
+      text.erase(text.size() - 1);
+    }
+    captureLine line = {parseTimestamp(text.c_str()), text, false, false, false};
+    size_t tab = text.find('\t');
+    std::string payload = ((line.time >= 0.0) && (tab != std::string::npos)) ? text.substr(tab + 1) : text;
+    if (payload.compare(0, 3, "#B,") == 0) {
+      //#B,<sequence>,<age secs>,<columns...>
+      std::vector<std::string> fields = splitFields(payload, ",");
+      if ((line.time < 0.0) || (fields.size() < 4)) {
+        continue;
+      }
+      line.time -= strtod(fields[2].c_str(), NULL);
+      line.text.clear();
+      for (size_t index = 3; index < fields.size(); index++) {
+        line.text += fields[index];
+        if (index + 1 < fields.size()) {
+          line.text += delimiter;
+        }
+      }
+      line.backfill = true;
+      stats.replies++;
+    }
+    else if (!payload.empty() && (payload[0] == '#')) {
+      //Another command reply.
+      continue;
+    }
+    else if (line.time >= 0.0) {
+      char *end;
+      strtod(payload.c_str(), &end);
+      line.data = (end != payload.c_str());
+      stats.dataLines += line.data ? 1 : 0;
+    }
+    stats.lines++;
+    lines.push_back(line);
+  }
+}
+
+//Is there a time in a sorted list within the gap limit of time?
+static bool covered(const std::vector<double> &times, double time) {
+  std::vector<double>::const_iterator next = std::lower_bound(times.begin(), times.end(), time);
+  return ((next != times.end()) && (*next - time <= gapLimit)) || ((next != times.begin()) && (time - *(next - 1) <= gapLimit));
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<captureLine> lines;
+  backfillStats stats = {0, 0, 0, 0, 0, 0, 0, 0};
+  bool readAny = false;
+  for (int arg = 1; arg < argc; arg++) {
+    if ((strcmp(argv[arg], "-d") == 0) && (arg + 1 < argc)) {
+      delimiter = argv[++arg];
+    }
+    else if ((strcmp(argv[arg], "-g") == 0) && (arg + 1 < argc)) {
+      gapLimit = atof(argv[++arg]);
+    }
+    else if (argv[arg][0] == '-') {
+      fprintf(stderr, "Usage: %s [-d delimiter] [-g gap] [capture.csv...]\n", argv[0]);
+      return 1;
+    }
+    else {
+      FILE *input = fopen(argv[arg], "r");
+      if (input == NULL) {
+        perror(argv[arg]);
+        return 1;
+      }
+      readCapture(input, lines, stats);
+      fclose(input);
+      readAny = true;
+    }
+  }
+  if (!readAny) {
+    readCapture(stdin, lines, stats);
+  }
+  //The data line times, and the gaps between them.
+  std::vector<double> times;
+  std::vector<std::pair<double, double> > gaps;
+  size_t columns = 0;
+  for (size_t index = 0; index < lines.size(); index++) {
+    if (lines[index].data) {
+      if (!times.empty() && (lines[index].time - times.back() > gapLimit)) {
+        gaps.push_back(std::make_pair(times.back(), lines[index].time));
+      }
+      times.push_back(lines[index].time);
+    }
+    else if ((columns == 0) && !lines[index].backfill && (lines[index].time >= 0.0)) {
+      //The header, the first timestamped line that is not data.
+      size_t tab = lines[index].text.find('\t');
+      columns = countColumns(lines[index].text.substr(tab + 1));
+    }
+  }
+  stats.gaps = gaps.size();
+  std::sort(times.begin(), times.end());
+  //Pick the replies to merge, oldest first, so a second backfill of the same line is covered by the first.
+  std::vector<captureLine> replies;
+  for (size_t index = 0; index < lines.size(); index++) {
+    if (lines[index].backfill) {
+      replies.push_back(lines[index]);
+    }
+  }
+  std::stable_sort(replies.begin(), replies.end(), [](const captureLine &a, const captureLine &b) {
+    return a.time < b.time;
+  });
+  std::vector<double> mergedTimes;
+  for (size_t index = 0; index < replies.size(); index++) {
+    if ((columns != 0) && (countColumns(replies[index].text) != columns)) {
+      stats.mismatched++;
+    }
+    else if (covered(times, replies[index].time) || covered(mergedTimes, replies[index].time)) {
+      stats.covered++;
+    }
+    else {
+      replies[index].merged = true;
+      mergedTimes.push_back(replies[index].time);
+      stats.merged++;
+      for (size_t gap = 0; gap < gaps.size(); gap++) {
+        if ((replies[index].time > gaps[gap].first) && (replies[index].time < gaps[gap].second)) {
+          gaps[gap].second = -gaps[gap].second;   //Mark it filled.
+        }
+      }
+    }
+  }
+  for (size_t gap = 0; gap < gaps.size(); gap++) {
+    stats.filled += (gaps[gap].second < 0.0) ? 1 : 0;
+  }
+  //Write the capture, with the merged lines before the first data line after them.
+  size_t next = 0;
+  for (size_t index = 0; index < lines.size(); index++) {
+    if (lines[index].backfill) {
+      continue;
+    }
+    if (lines[index].data) {
+      for (; (next < replies.size()) && (replies[next].time < lines[index].time); next++) {
+        if (replies[next].merged) {
+          printf("%s\t%s\n", formatTimestamp(replies[next].time).c_str(), replies[next].text.c_str());
+        }
+      }
+    }
+    printf("%s\n", lines[index].text.c_str());
+  }
+  for (; next < replies.size(); next++) {
+    if (replies[next].merged) {
+      printf("%s\t%s\n", formatTimestamp(replies[next].time).c_str(), replies[next].text.c_str());
+    }
+  }
+  fprintf(stderr, "Lines: %lu, data lines: %lu, gaps: %u, filled: %u\n", stats.lines, stats.dataLines, stats.gaps, stats.filled);
+  fprintf(stderr, "Backfill lines: %lu, merged: %lu, already captured: %lu, wrong columns: %lu\n",
+          stats.replies, stats.merged, stats.covered, stats.mismatched);
+  return 0;
+}
+
+//EOF
@@ -0,0 +1,603 @@
+/*
+Loft Environment Monitor Thermistor Calibration.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Fits the KY013's and MF52D's Steinhart-Hart and Beta coefficients to a reference sensor's readings, by default the
+  DS18B20's, over any number of CoolTerm captures (e.g. LoftMon20210111-1.csv), in place of an online calculator and
+  three hand picked points. The KY013's published coefficients were no use, see the sketch's ToDo J.
+
+Each thermistor row's resistance is worked back from its logged temperature, with the coefficients it was logged with
+  (the sketch's, or -k and -b), through the ADC reading that gave it, the divider as vDivider::doCalcR2() works it out
+  from the reading (R2 = R1 / ((ADCMAXVALUE + 1) / ADC - 1)). The fitted coefficients so turn the same reading into
+  the reference's temperature, with the same balance resistor. Then, by weighted least squares, over every row:
+  Steinhart-Hart - 1/T = C1 + C2 * ln(R) + C3 * ln(R)^3, as Thermistor::readTemperatureK(), for setC123().
+  Beta           - 1/T = 1/T0 + ln(R / R0) / Beta, for setCBeta(), with the nominal resistance at T0 fitted too...
+  Beta (R0)      - ...or kept as it is, e.g. the MF52D's 10K.
+The fits are linear in 1/T, weighted by T^4, so they are close to the least squares of the temperatures. The rows are
+  taken in batches, by a thread each, each adding to its own sums (of the weighted powers of ln(R), centred on ln(R0)
+  so they keep their precision), which are added together and solved once, and again for the residuals. Millions of
+  rows take a second or two.
+
+For each thermistor the report has the residuals, the temperature given by each fit less the reference's, as logged,
+  and for each fit, their count, mean (the bias), standard deviation and the largest, and the #defines, or set up,
+  for the sketch. A row is only used when both have a reading, within CALIBRATE_MAXDIFFERENCE (or -m) of each other,
+  and its ADC reading was not at either end of its range. The reference should be next to the thermistors, and, with
+  -s, only the rows where it is changing slowly can be used, as the sensors do not follow the loft at the same pace
+  (see Tools/LoftCompare).
+The Steinhart-Hart C3 only shows over a wide range of temperatures, so its fit is only given when the reference spans
+  at least CALIBRATE_MINSPAN (or -w), and its C3 is positive, as it is for any real NTC thermistor. Otherwise there is
+  a warning instead, and Beta, which has one less coefficient to pin down, is the one to use. With the KY013, the
+  Beta with R0 kept is around the R0 its logged Steinhart-Hart coefficients give at 25 deg C, not its nominal 100K.
+
+Build (any C++11 compiler with threads):
+  g++ -std=c++11 -O2 -pthread -o LoftCalibrate Tools/LoftCalibrate/LoftCalibrate.cpp Tools/LoftIngest/LoftCapture.cpp
+
+Usage:
+  LoftCalibrate [-d delimiter] [-j threads] [-r reference] [-m difference] [-s rate] [-w span] [-k c1,c2,c3]
+                [-b beta,r0,t0] capture.csv...
+    -d  The column delimiter, ",", "tab" or "space" (the sketch's DATADELIMITER), by default found from each capture.
+    -j  The most threads to use, default one per core.
+    -r  The reference column, default "Temperature(DS18B20)".
+    -m  The largest difference from the reference of a row used, deg C, default 10.
+    -s  Only use the rows where the reference changed by less than this, deg C per hour, over the rows before.
+    -w  The smallest span of the reference, deg C, for a Steinhart-Hart fit to be given, default 20.
+    -k  The KY013 Steinhart-Hart coefficients the captures were logged with, default C1_KY, C2_KY, C3_KY.
+    -b  The MF52D Beta, nominal resistance and temperature the captures were logged with, default CBETA_MF, NOMRST_MF,
+        NOMTEMP_MF.
+
+https://en.wikipedia.org/wiki/Steinhart%E2%80%93Hart_equation
+https://en.wikipedia.org/wiki/Thermistor#B_or_%CE%B2_parameter_equation
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../LoftIngest/LoftCapture.h"
+
+#define CALIBRATE_KELVIN 273.15
+#define CALIBRATE_ADCMAX 1023           //The sketch's ADCMAXVALUE.
+#define CALIBRATE_MAXDIFFERENCE 10.0
+#define CALIBRATE_MINSPAN 20.0          //deg C.
+#define CALIBRATE_STEADYROWS 16         //The rows a reference's rate of change is taken over, about 4 minutes.
+#define CALIBRATE_BATCH 4096            //Rows worked out together.
+#define CALIBRATE_POWERS 7              //The sums of the weighted powers of ln(R), 0 - 6...
+#define CALIBRATE_VALUES 4              //...and of the weighted 1/T times the powers, 0 - 3.
+#define CALIBRATE_FITS 4                //As logged, Steinhart-Hart, Beta, Beta with R0 kept.
+
+//A thermistor as the sketch sets it up, and the coefficients it was logged with.
+struct thermistor {
+  const char *name;
+  const char *column;
+  double balanceResistor;               //R1.
+  bool useBeta;
+  double coefficients[3];               //C1, C2, C3.
+  double beta;
+  double nomRst;
+  double nomTemp;
+  const char *defines[3];               //The sketch's names for the coefficients it uses.
+};
+
+static thermistor thermistors[] = {
+  {"KY013", "Temperature(KY013)", 110000.0, false, {0.0005182977433, 0.0002252079282, 0.0000001615362158}, 0.0, 0.0,
+   0.0, {"C1_KY", "C2_KY", "C3_KY"}},
+  {"MF52D", "Temperature(MF52D)", 10000.0, true, {0.0, 0.0, 0.0}, 3435.0, 10000.0, 25.0,
+   {"CBETA_MF", "NOMRST_MF", "NOMTEMP_MF"}}
+};
+
+//The rows used, and the point the fits are centred on.
+struct calibrationRows {
+  std::vector<double> logRst;           //ln(R).
+  std::vector<double> logged;           //The thermistor's logged temperature, deg C.
+  std::vector<double> reference;        //deg C.
+  double nomTemp;                       //T0, deg C...
+  double logNomRst;                     //...and ln(R) there, with the coefficients as logged.
+  double adcLow;
+  double adcHigh;
+  double referenceLow;                  //deg C.
+  double referenceHigh;
+  uint64_t skipped;
+};
+
+struct fitSums {
+  double powers[CALIBRATE_POWERS];
+  double values[CALIBRATE_VALUES];
+
+  fitSums() {
+    for (int power = 0; power < CALIBRATE_POWERS; power++) {
+      powers[power] = 0.0;
+    }
+    for (int power = 0; power < CALIBRATE_VALUES; power++) {
+      values[power] = 0.0;
+    }
+  }
+
+  void merge(const fitSums &other) {
+    for (int power = 0; power < CALIBRATE_POWERS; power++) {
+      powers[power] += other.powers[power];
+    }
+    for (int power = 0; power < CALIBRATE_VALUES; power++) {
+      values[power] += other.values[power];
+    }
+  }
+};
+
+//Residuals, deg C (Welford, merged by Chan's method).
+struct residuals {
+  uint64_t count;
+  double mean;
+  double m2;
+  double largest;                       //The largest size, either sign.
+
+  residuals() : count(0), mean(0.0), m2(0.0), largest(0.0) {}
+
+  void add(double value) {
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+    largest = (fabs(value) > fabs(largest)) ? value : largest;
+  }
+
+  void merge(const residuals &other) {
+    if (other.count == 0) {
+      return;
+    }
+    uint64_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+    count = total;
+    largest = (fabs(other.largest) > fabs(largest)) ? other.largest : largest;
+  }
+
+  double deviation() const {
+    return (count > 1) ? sqrt(m2 / count) : NAN;
+  }
+};
+
+//The fitted coefficients.
+struct calibration {
+  double coefficients[3];               //Steinhart-Hart.
+  double beta;                          //Beta, R0 fitted...
+  double nomRst;
+  double keptBeta;                      //...and R0 kept.
+  double nomTemp;
+};
+
+//ln(R) for a temperature, with the coefficients it was logged with, the Steinhart-Hart cubic solved by Cardano's method.
+static double logResistance(const thermistor &device, double temperatureC) {
+  double oneOverTK = 1.0 / (temperatureC + CALIBRATE_KELVIN);
+  if (device.useBeta) {
+    return log(device.nomRst) + device.beta * (oneOverTK - 1.0 / (device.nomTemp + CALIBRATE_KELVIN));
+  }
+  if (device.coefficients[2] == 0.0) {
+    return (oneOverTK - device.coefficients[0]) / device.coefficients[1];
+  }
+  double p = device.coefficients[1] / device.coefficients[2];
+  double q = (device.coefficients[0] - oneOverTK) / device.coefficients[2];
+  double root = sqrt(q * q / 4.0 + p * p * p / 27.0);
+  return cbrt(-q / 2.0 + root) + cbrt(-q / 2.0 - root);
+}
+
+//The ADC reading for a resistance, and back, as vDivider::calcRRatio() and doCalcR2() with the balance resistor as R1.
+static double readingFor(const thermistor &device, double resistance) {
+  return (CALIBRATE_ADCMAX + 1) / (1.0 + device.balanceResistor / resistance);
+}
+
+static double resistanceFor(const thermistor &device, double averageADC) {
+  double rRatio = ((double)(CALIBRATE_ADCMAX + 1) / averageADC) - 1.0;
+  return device.balanceResistor / rRatio;
+}
+
+//The reference's rate of change, deg C per hour, over the CALIBRATE_STEADYROWS before a row, nan across a gap or restart.
+static double referenceRate(const captureTable &table, const std::vector<float> &reference, size_t row,
+                            const std::vector<bool> &starts) {
+  if (row < CALIBRATE_STEADYROWS) {
+    return NAN;
+  }
+  for (size_t before = row - CALIBRATE_STEADYROWS + 1; before <= row; before++) {
+    if (starts[before]) {
+      return NAN;
+    }
+  }
+  size_t first = row - CALIBRATE_STEADYROWS;
+  double hours = (table.times[row] - table.times[first]) / 3600.0;
+  return (hours > 0.0) ? (reference[row] - reference[first]) / hours : NAN;
+}
+
+static void selectRows(const captureTable &table, const thermistor &device, int column, int referenceColumn,
+                       double maxDifference, double maxRate, calibrationRows &rows) {
+  const std::vector<float> &logged = table.columns[column];
+  const std::vector<float> &reference = table.columns[referenceColumn];
+  std::vector<bool> starts(table.rows() + 1, false);
+  for (size_t index = 0; index < table.headers.size(); index++) {
+    starts[table.headers[index].row] = true;
+  }
+  rows.nomTemp = device.useBeta ? device.nomTemp : 25.0;
+  rows.logNomRst = logResistance(device, rows.nomTemp);
+  rows.adcLow = NAN;
+  rows.adcHigh = NAN;
+  rows.referenceLow = NAN;
+  rows.referenceHigh = NAN;
+  rows.skipped = 0;
+  for (size_t row = 0; row < table.rows(); row++) {
+    if (std::isnan(logged[row]) || std::isnan(reference[row])) {
+      continue;
+    }
+    double averageADC = readingFor(device, exp(logResistance(device, logged[row])));
+    bool steady = std::isinf(maxRate) || (fabs(referenceRate(table, reference, row, starts)) <= maxRate);
+    if ((fabs(logged[row] - reference[row]) > maxDifference) || !steady || !(averageADC >= 1.0) ||
+        !(averageADC <= CALIBRATE_ADCMAX - 1)) {
+      rows.skipped++;
+      continue;
+    }
+    rows.adcLow = (rows.logRst.empty() || (averageADC < rows.adcLow)) ? averageADC : rows.adcLow;
+    rows.adcHigh = (rows.logRst.empty() || (averageADC > rows.adcHigh)) ? averageADC : rows.adcHigh;
+    rows.referenceLow = (rows.logRst.empty() || (reference[row] < rows.referenceLow)) ? reference[row] : rows.referenceLow;
+    rows.referenceHigh = (rows.logRst.empty() || (reference[row] > rows.referenceHigh)) ? reference[row] : rows.referenceHigh;
+    rows.logRst.push_back(log(resistanceFor(device, averageADC)));
+    rows.logged.push_back(logged[row]);
+    rows.reference.push_back(reference[row]);
+  }
+}
+
+//The sums for rows [first, last), a batch at a time: u = ln(R) - ln(R0), y = 1/T - 1/T0, the weight (T/T0)^4.
+static void addSums(const calibrationRows &rows, size_t first, size_t last, fitSums &sums) {
+  double oneOverNomTemp = 1.0 / (rows.nomTemp + CALIBRATE_KELVIN);
+  double u[CALIBRATE_BATCH];
+  double y[CALIBRATE_BATCH];
+  double weight[CALIBRATE_BATCH];
+  for (size_t start = first; start < last; start += CALIBRATE_BATCH) {
+    size_t count = std::min((size_t)CALIBRATE_BATCH, last - start);
+    for (size_t index = 0; index < count; index++) {
+      double temperatureK = rows.reference[start + index] + CALIBRATE_KELVIN;
+      double ratio = temperatureK * oneOverNomTemp;
+      u[index] = rows.logRst[start + index] - rows.logNomRst;
+      y[index] = 1.0 / temperatureK - oneOverNomTemp;
+      weight[index] = ratio * ratio * ratio * ratio;
+    }
+    for (int power = 0; power < CALIBRATE_POWERS; power++) {
+      double total = 0.0;
+      double values = 0.0;
+      for (size_t index = 0; index < count; index++) {
+        total += weight[index];
+        values += weight[index] * y[index];
+        weight[index] *= u[index];
+      }
+      sums.powers[power] += total;
+      if (power < CALIBRATE_VALUES) {
+        sums.values[power] += values;
+      }
+    }
+  }
+}
+
+//Solve a small symmetric system, by Gaussian elimination with partial pivoting. False if it is singular.
+static bool solve(long double matrix[3][3], long double vector[3], int size, long double solution[3]) {
+  for (int column = 0; column < size; column++) {
+    int pivot = column;
+    for (int row = column + 1; row < size; row++) {
+      pivot = (fabsl(matrix[row][column]) > fabsl(matrix[pivot][column])) ? row : pivot;
+    }
+    if (matrix[pivot][column] == 0.0L) {
+      return false;
+    }
+    for (int index = 0; index < size; index++) {
+      std::swap(matrix[column][index], matrix[pivot][index]);
+    }
+    std::swap(vector[column], vector[pivot]);
+    for (int row = column + 1; row < size; row++) {
+      long double factor = matrix[row][column] / matrix[column][column];
+      for (int index = column; index < size; index++) {
+        matrix[row][index] -= factor * matrix[column][index];
+      }
+      vector[row] -= factor * vector[column];
+    }
+  }
+  for (int row = size - 1; row >= 0; row--) {
+    long double total = vector[row];
+    for (int index = row + 1; index < size; index++) {
+      total -= matrix[row][index] * solution[index];
+    }
+    solution[row] = total / matrix[row][row];
+  }
+  return true;
+}
+
+/*!
+ *  @brief  The coefficients from the sums, in u = ln(R) - m, with m = ln(R0), and y = 1/T - 1/T0.
+ *          Steinhart-Hart is fitted as y = b0 + b1 * u + b3 * (u^3 + 3m * u^2), the same curve as C1 + C2 * ln(R) +
+ *          C3 * ln(R)^3 - 1/T0, less the parts of ln(R)^3 that are a constant and a slope, which would otherwise be
+ *          all but the same as C1 and C2 over a loft's temperatures.
+ *  @return False if a fit cannot be made, e.g. all the rows have the same reading.
+ */
+
+static bool fitCoefficients(const fitSums &sums, const calibrationRows &rows, calibration &result) {
+  long double s[CALIBRATE_POWERS];
+  long double v[CALIBRATE_VALUES];
+  for (int power = 0; power < CALIBRATE_POWERS; power++) {
+    s[power] = sums.powers[power];
+  }
+  for (int power = 0; power < CALIBRATE_VALUES; power++) {
+    v[power] = sums.values[power];
+  }
+  long double m = rows.logNomRst;
+  long double oneOverNomTemp = 1.0L / (rows.nomTemp + CALIBRATE_KELVIN);
+  long double matrix[3][3] = {{s[0], s[1], s[3] + 3 * m * s[2]},
+                              {s[1], s[2], s[4] + 3 * m * s[3]},
+                              {s[3] + 3 * m * s[2], s[4] + 3 * m * s[3], s[6] + 6 * m * s[5] + 9 * m * m * s[4]}};
+  long double vector[3] = {v[0], v[1], v[3] + 3 * m * v[2]};
+  long double b[3];
+  if (!solve(matrix, vector, 3, b)) {
+    return false;
+  }
+  result.coefficients[0] = (double)(oneOverNomTemp + b[0] - b[1] * m + 2 * m * m * m * b[2]);
+  result.coefficients[1] = (double)(b[1] - 3 * m * m * b[2]);
+  result.coefficients[2] = (double)b[2];
+  long double line[3][3] = {{s[0], s[1], 0}, {s[1], s[2], 0}, {0, 0, 0}};
+  long double lineVector[3] = {v[0], v[1], 0};
+  if (!solve(line, lineVector, 2, b) || (b[1] == 0.0L)) {
+    return false;
+  }
+  result.beta = (double)(1.0L / b[1]);
+  result.nomRst = (double)expl(m - b[0] / b[1]);
+  result.keptBeta = (double)(s[2] / v[1]);
+  result.nomTemp = rows.nomTemp;
+  return true;
+}
+
+//The residuals for rows [first, last), with each fit as the sketch would work it out, in floats, and Beta a whole number.
+static void addResiduals(const calibrationRows &rows, const calibration &fit, size_t first, size_t last,
+                         residuals results[CALIBRATE_FITS]) {
+  float c1 = (float)fit.coefficients[0];
+  float c2 = (float)fit.coefficients[1];
+  float c3 = (float)fit.coefficients[2];
+  float oneOverNomTemp = (float)(1.0 / (fit.nomTemp + CALIBRATE_KELVIN));
+  float oneOverBeta = 1.0f / (float)(uint16_t)lround(fit.beta);
+  float oneOverKeptBeta = 1.0f / (float)(uint16_t)lround(fit.keptBeta);
+  float logNomRst = (float)log(fit.nomRst);
+  float logKeptRst = (float)rows.logNomRst;
+  for (size_t row = first; row < last; row++) {
+    float logRst = (float)rows.logRst[row];
+    double reference = rows.reference[row];
+    results[0].add(rows.logged[row] - reference);
+    results[1].add(1.0 / (c1 + c2 * logRst + c3 * logRst * logRst * logRst) - CALIBRATE_KELVIN - reference);
+    results[2].add(1.0 / (oneOverNomTemp + oneOverBeta * (logRst - logNomRst)) - CALIBRATE_KELVIN - reference);
+    results[3].add(1.0 / (oneOverNomTemp + oneOverKeptBeta * (logRst - logKeptRst)) - CALIBRATE_KELVIN - reference);
+  }
+}
+
+//A coefficient as a decimal, with ten significant figures, as the sketch's #defines are written.
+static std::string formatCoefficient(double value) {
+  char text[40];
+  int decimals = 9 - (int)floor(log10(fabs(value)));
+  snprintf(text, sizeof(text), "%.*f", std::max(decimals, 1), value);
+  return text;
+}
+
+//A #define as the sketch lays them out, its comment in the 27th column, or two spaces after a long one.
+static void printDefine(const char *name, const std::string &value, const std::string &comment) {
+  std::string define = std::string("#define ") + name + " " + value;
+  define.resize(std::max(define.size() + 2, (size_t)26), ' ');
+  printf("  %s//%s\n", define.c_str(), comment.c_str());
+}
+
+static void report(const thermistor &device, const char *referenceName, const calibrationRows &rows,
+                   const calibration &fit, const residuals results[CALIBRATE_FITS], double minSpan) {
+  printf("\n%s (%s) against %s: %zu rows, %llu skipped, R %.0f - %.0f Ohms, ADC %.1f - %.1f, reference %.1f - %.1f "
+         "deg C\n\n", device.name, device.column, referenceName, rows.logRst.size(), (unsigned long long)rows.skipped,
+         resistanceFor(device, rows.adcHigh), resistanceFor(device, rows.adcLow), rows.adcLow, rows.adcHigh,
+         rows.referenceLow, rows.referenceHigh);
+  const char *names[CALIBRATE_FITS] = {"As logged", "Steinhart-Hart", "Beta", "Beta (R0 kept)"};
+  printf("%-16s %10s %8s %8s %8s\n", "Residuals", "Count", "Bias", "SD", "Largest");
+  for (int index = 0; index < CALIBRATE_FITS; index++) {
+    printf("%-16s %10llu %8.3f %8.3f %8.3f\n", names[index], (unsigned long long)results[index].count,
+           results[index].mean, results[index].deviation(), results[index].largest);
+  }
+  std::string c1 = formatCoefficient(fit.coefficients[0]);
+  std::string c2 = formatCoefficient(fit.coefficients[1]);
+  std::string c3 = formatCoefficient(fit.coefficients[2]);
+  double keptNomRst = exp(rows.logNomRst);
+  double span = rows.referenceHigh - rows.referenceLow;
+  printf("\nSteinhart-Hart:\n");
+  if (span < minSpan) {
+    printf("  Not given, the reference only spans %.1f deg C, less than the %.1f needed to fit C3 (-w), use Beta.\n",
+           span, minSpan);
+  }
+  else if (fit.coefficients[2] <= 0.0) {
+    printf("  Not given, C3 is %.3e, but must be positive for a thermistor, use Beta.\n", fit.coefficients[2]);
+  }
+  else if (!device.useBeta) {
+    const std::string values[3] = {c1, c2, c3};
+    for (int index = 0; index < 3; index++) {
+      char comment[60];
+      snprintf(comment, sizeof(comment), "Steinhart-Hart coefficient %d, %.9e.", index + 1, fit.coefficients[index]);
+      printDefine(device.defines[index], values[index], comment);
+    }
+  }
+  if ((span >= minSpan) && (fit.coefficients[2] > 0.0)) {
+    printf("  device.setC123(%s, %s, %s);\n", c1.c_str(), c2.c_str(), c3.c_str());
+  }
+  printf("Beta:\n");
+  if (device.useBeta) {
+    char beta[20], nomRst[20], nomTemp[20];
+    snprintf(beta, sizeof(beta), "%ld", lround(fit.beta));
+    snprintf(nomRst, sizeof(nomRst), "%.0f", fit.nomRst);
+    snprintf(nomTemp, sizeof(nomTemp), "%.1f", fit.nomTemp);
+    printDefine(device.defines[0], beta, "Beta coefficient.");
+    printDefine(device.defines[1], nomRst, "Nominal resistance.");
+    printDefine(device.defines[2], nomTemp, "Nominal temperature.");
+  }
+  printf("  device.setCBeta(%ld, %.0f, %.1f);\n", lround(fit.beta), fit.nomRst, fit.nomTemp);
+  if (device.useBeta) {
+    printf("Beta (R0 kept):\n");
+  }
+  else {
+    printf("Beta (R0 kept, as the logged Steinhart-Hart coefficients give it at %.1f deg C, not the nominal R0):\n",
+           fit.nomTemp);
+  }
+  printf("  device.setCBeta(%ld, %.0f, %.1f);\n", lround(fit.keptBeta), keptNomRst, fit.nomTemp);
+}
+
+//Run a job over [0, rows) on threads, each with its own part.
+template <class T, class F> static void runParts(size_t rows, unsigned threads, std::vector<T> &parts, F job) {
+  threads = std::max(1u, std::min(threads, (unsigned)((rows + CALIBRATE_BATCH - 1) / CALIBRATE_BATCH)));
+  parts.assign(threads, T());
+  std::vector<std::thread> pool;
+  for (unsigned thread = 0; thread < threads; thread++) {
+    size_t first = rows * thread / threads;
+    size_t last = rows * (thread + 1) / threads;
+    pool.push_back(std::thread(job, first, last, std::ref(parts[thread])));
+  }
+  for (size_t thread = 0; thread < pool.size(); thread++) {
+    pool[thread].join();
+  }
+}
+
+struct residualPart {
+  residuals results[CALIBRATE_FITS];
+};
+
+static bool parseNumbers(const char *text, double *numbers, int count) {
+  for (int index = 0; index < count; index++) {
+    char *end;
+    numbers[index] = strtod(text, &end);
+    if ((end == text) || (*end != ((index + 1 < count) ? ',' : '\0'))) {
+      return false;
+    }
+    text = end + 1;
+  }
+  return true;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-d delimiter] [-j threads] [-r reference] [-m difference] [-s rate] [-w span] "
+                  "[-k c1,c2,c3] [-b beta,r0,t0] capture.csv...\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  char delimiter = 0;
+  unsigned threads = 0;
+  std::string referenceName = "Temperature(DS18B20)";
+  double maxDifference = CALIBRATE_MAXDIFFERENCE;
+  double maxRate = INFINITY;
+  double minSpan = CALIBRATE_MINSPAN;
+  std::vector<const char *> paths;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    bool hasValue = (arg + 1 < argc);
+    if ((option == "-d") && hasValue) {
+      std::string text = argv[++arg];
+      delimiter = (text == "tab") ? '\t' : ((text == "space") ? ' ' : text[0]);
+    }
+    else if ((option == "-j") && hasValue) {
+      threads = atoi(argv[++arg]);
+    }
+    else if ((option == "-r") && hasValue) {
+      referenceName = argv[++arg];
+    }
+    else if ((option == "-m") && hasValue) {
+      maxDifference = atof(argv[++arg]);
+    }
+    else if ((option == "-s") && hasValue) {
+      maxRate = atof(argv[++arg]);
+    }
+    else if ((option == "-w") && hasValue) {
+      minSpan = atof(argv[++arg]);
+    }
+    else if ((option == "-k") && hasValue) {
+      if (!parseNumbers(argv[++arg], thermistors[0].coefficients, 3)) {
+        usage(argv[0]);
+      }
+    }
+    else if ((option == "-b") && hasValue) {
+      double numbers[3];
+      if (!parseNumbers(argv[++arg], numbers, 3)) {
+        usage(argv[0]);
+      }
+      thermistors[1].beta = numbers[0];
+      thermistors[1].nomRst = numbers[1];
+      thermistors[1].nomTemp = numbers[2];
+    }
+    else if ((option.size() > 1) && (option[0] == '-')) {
+      usage(argv[0]);
+    }
+    else {
+      paths.push_back(argv[arg]);
+    }
+  }
+  if (paths.empty()) {
+    usage(argv[0]);
+  }
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  captureReader reader(delimiter, threads);
+  captureTable table;
+  for (size_t index = 0; index < paths.size(); index++) {
+    if (!reader.read(paths[index], table)) {
+      fprintf(stderr, "%s\n", reader.error().c_str());
+      return 1;
+    }
+  }
+  const captureStats &stats = reader.stats();
+  printf("Captures: %zu, %.1f MB, %llu rows, read in %.2fs\n", paths.size(), stats.bytes / 1e6,
+         (unsigned long long)stats.rows, stats.seconds);
+  int referenceColumn = table.column(referenceName);
+  if (referenceColumn < 0) {
+    fprintf(stderr, "No %s column\n", referenceName.c_str());
+    return 1;
+  }
+  bool found = false;
+  for (size_t index = 0; index < sizeof(thermistors) / sizeof(thermistors[0]); index++) {
+    const thermistor &device = thermistors[index];
+    int column = table.column(device.column);
+    if (column < 0) {
+      continue;
+    }
+    found = true;
+    calibrationRows rows;
+    selectRows(table, device, column, referenceColumn, maxDifference, maxRate, rows);
+    std::vector<fitSums> sumParts;
+    runParts(rows.logRst.size(), threads, sumParts, [&rows](size_t first, size_t last, fitSums &sums) {
+      addSums(rows, first, last, sums);
+    });
+    fitSums sums;
+    for (size_t part = 0; part < sumParts.size(); part++) {
+      sums.merge(sumParts[part]);
+    }
+    calibration fit;
+    if (rows.logRst.empty() || !fitCoefficients(sums, rows, fit)) {
+      printf("\n%s (%s) against %s: %zu rows, %llu skipped, too few different readings to fit\n", device.name,
+             device.column, referenceName.c_str(), rows.logRst.size(), (unsigned long long)rows.skipped);
+      continue;
+    }
+    std::vector<residualPart> residualParts;
+    runParts(rows.logRst.size(), threads, residualParts,
+             [&rows, &fit](size_t first, size_t last, residualPart &part) {
+      addResiduals(rows, fit, first, last, part.results);
+    });
+    residuals results[CALIBRATE_FITS];
+    for (size_t part = 0; part < residualParts.size(); part++) {
+      for (int index = 0; index < CALIBRATE_FITS; index++) {
+        results[index].merge(residualParts[part].results[index]);
+      }
+    }
+    report(device, referenceName.c_str(), rows, fit, results, minSpan);
+  }
+  if (!found) {
+    fprintf(stderr, "No thermistor columns, %s or %s\n", thermistors[0].column, thermistors[1].column);
+    return 1;
+  }
+  return 0;
+}
+
+//EOF
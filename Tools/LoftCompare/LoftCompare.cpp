@@ -0,0 +1,801 @@
+/*
+Loft Environment Monitor Sensor Comparison.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Compares the sensors against each other, over any number of CoolTerm captures (e.g. LoftMon20210111-1.csv), in one
+  pass, without LibreCalc. The columns are grouped by what they measure, the name before the sensor in brackets, e.g.
+  the Temperature(...) columns, and compared within their group:
+  Noise       - Each sensor's mean, standard deviation, and Allan deviation, how much the mean of its readings over a
+                time (1, 4, 16... samples) moves from one such time to the next. The shortest times show the noise
+                and the resolution, the longest the real changes in the loft.
+  Bias        - Each pair of sensors' mean difference (row minus column), from the rows they both have.
+  Correlation - Each pair of sensors' correlation, from the same rows.
+  Lag         - Against a reference sensor, by default the DS18B20 (or the group's first column), how far each
+                sensor's changes trail (+) or lead (-) the reference's, the lag with the highest correlation between
+                their changes over COMPARE_SPAN rows, refined between rows.
+  Response    - The step response time constant of each sensor against the reference, the time to 63% of a step, as
+                the first order lag (of 0 to -l rows) that, applied to the reference, best turns it into the sensor,
+                the least variation in their difference. Fitted over every row, not just the few clean steps. A
+                negative one is a sensor faster than the reference, the lag applied to the sensor instead. "-" when
+                the best fit is at the end of the range. A sensor that is more like a delay than a lag has a Lag
+                close to its Response, a first order lag one well short of it.
+The rows are split into runs, at each header (a sketch restart), each gap in the times of more than COMPARE_GAP times
+  their usual step, and the end of each capture, and the Allan deviation, lags and response only use the rows within
+  a run.
+
+Each capture is read and worked on by its own thread, into a partial result of sums and Welford moments, and the
+  partial results are merged, in capture order, so the result is the same for any number of threads, and the time
+  falls with each core, as long as there are as many captures. With fewer captures than cores, the spare cores read.
+  A capture without a header, a new CoolTerm file while the sketch ran on, is read again once the capture before it
+  has been, with its columns.
+
+Build (any C++11 compiler with threads):
+  g++ -std=c++11 -O2 -pthread -o LoftCompare Tools/LoftCompare/LoftCompare.cpp Tools/LoftIngest/LoftCapture.cpp
+
+Usage:
+  LoftCompare [-d delimiter] [-j threads] [-l lags] [-r reference]... capture.csv...
+    -d  The column delimiter, ",", "tab" or "space" (the sketch's DATADELIMITER), by default found from each capture.
+    -j  The most threads to use, default one per core.
+    -l  The most rows to look for a lag, or response, either side, default 128, about 34 minutes at the sketch's data
+        output period. The time taken grows with it.
+    -r  The reference column for its group, e.g. "Humidity(DHT22)", -r for each group.
+
+https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance (Welford, and Chan's merge)
+https://en.wikipedia.org/wiki/Allan_variance
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../LoftIngest/LoftCapture.h"
+
+#define COMPARE_OCTAVES 12            //Allan deviation times, 1 to 2048 rows.
+#define COMPARE_MINALLAN 10           //The fewest differences to report an Allan deviation.
+#define COMPARE_MAXLAG 128
+#define COMPARE_SPAN 8                //The rows a change is taken over, for the lags.
+#define COMPARE_BATCH 8               //Lags, or responses, worked on side by side.
+#define COMPARE_GAP 3.0               //A step in the times this many times the usual one is a gap.
+#define COMPARE_REFERENCE "DS18B20"   //The default reference sensor.
+
+//A mean and variance, one value at a time (Welford), and merged (Chan).
+struct moments {
+  uint64_t count;
+  double mean;
+  double m2;                          //The sum of the squared differences from the mean.
+
+  moments() : count(0), mean(0.0), m2(0.0) {}
+
+  void add(double value) {
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+  }
+
+  void merge(const moments &other) {
+    if (other.count == 0) {
+      return;
+    }
+    uint64_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+    count = total;
+  }
+
+  double deviation() const {
+    return (count > 1) ? sqrt(m2 / count) : NAN;
+  }
+};
+
+//Two values' means, variances and covariance.
+struct comoments {
+  uint64_t count;
+  double meanX;
+  double meanY;
+  double m2X;
+  double m2Y;
+  double cXY;                         //The sum of the products of the differences from the means.
+
+  comoments() : count(0), meanX(0.0), meanY(0.0), m2X(0.0), m2Y(0.0), cXY(0.0) {}
+
+  void add(double x, double y) {
+    count++;
+    double deltaX = x - meanX;
+    double deltaY = y - meanY;
+    meanX += deltaX / count;
+    meanY += deltaY / count;
+    m2X += deltaX * (x - meanX);
+    m2Y += deltaY * (y - meanY);
+    cXY += deltaX * (y - meanY);
+  }
+
+  void merge(const comoments &other) {
+    if (other.count == 0) {
+      return;
+    }
+    uint64_t total = count + other.count;
+    double deltaX = other.meanX - meanX;
+    double deltaY = other.meanY - meanY;
+    double weight = (double)count * other.count / total;
+    meanX += deltaX * other.count / total;
+    meanY += deltaY * other.count / total;
+    m2X += other.m2X + deltaX * deltaX * weight;
+    m2Y += other.m2Y + deltaY * deltaY * weight;
+    cXY += other.cXY + deltaX * deltaY * weight;
+    count = total;
+  }
+
+  double correlation() const {
+    return ((m2X > 0.0) && (m2Y > 0.0)) ? cXY / sqrt(m2X * m2Y) : NAN;
+  }
+};
+
+//Plain sums, for the lags and responses, whose values are changes, or differences, near 0, so they keep their
+//  precision. They are added to a lag, or response, at a time, in local variables, and then here.
+struct sums {
+  uint64_t count;
+  double x;
+  double y;
+  double xx;
+  double yy;
+  double xy;
+
+  sums() : count(0), x(0.0), y(0.0), xx(0.0), yy(0.0), xy(0.0) {}
+
+  void add(double valueX, double valueY) {
+    count++;
+    x += valueX;
+    y += valueY;
+    xx += valueX * valueX;
+    yy += valueY * valueY;
+    xy += valueX * valueY;
+  }
+
+  void merge(const sums &other) {
+    count += other.count;
+    x += other.x;
+    y += other.y;
+    xx += other.xx;
+    yy += other.yy;
+    xy += other.xy;
+  }
+
+  double variance() const {             //Of x.
+    return (count > 0) ? xx / count - (x / count) * (x / count) : NAN;
+  }
+
+  double correlation() const {
+    double varianceX = count * xx - x * x;
+    double varianceY = count * yy - y * y;
+    return ((varianceX > 0.0) && (varianceY > 0.0)) ? (count * xy - x * y) / sqrt(varianceX * varianceY) : NAN;
+  }
+};
+
+struct columnResult {
+  moments values;
+  double allan[COMPARE_OCTAVES];      //The sums of the squared differences of the means...
+  uint64_t allanCounts[COMPARE_OCTAVES];  //...and their counts.
+
+  columnResult() {
+    for (int octave = 0; octave < COMPARE_OCTAVES; octave++) {
+      allan[octave] = 0.0;
+      allanCounts[octave] = 0;
+    }
+  }
+};
+
+struct pairResult {
+  moments difference;
+  comoments both;
+};
+
+struct lagResult {
+  std::vector<sums> lags;             //By lag, -maxLag to maxLag rows.
+  std::vector<sums> responses;        //The differences from the lagged reference, by time constant, likewise.
+};
+
+typedef std::pair<std::string, std::string> namePair;
+
+//A capture's results, or the merged results of several.
+struct partialResult {
+  std::vector<std::string> names;     //In the order first seen.
+  std::map<std::string, columnResult> columns;
+  std::map<namePair, pairResult> pairs;  //By name, in name order, the difference is first minus second.
+  std::map<namePair, lagResult> lags;    //Reference, then sensor.
+  double steps;                       //The steps in the times within the runs...
+  uint64_t stepCount;                 //...and how many.
+  captureStats stats;
+  std::vector<std::string> lastNames; //The capture's columns when it ended, for one that carries on.
+  std::vector<int> lastFields;
+
+  partialResult() : steps(0.0), stepCount(0) {
+    stats = captureStats();
+  }
+
+  void merge(const partialResult &other) {
+    for (size_t index = 0; index < other.names.size(); index++) {
+      if (std::find(names.begin(), names.end(), other.names[index]) == names.end()) {
+        names.push_back(other.names[index]);
+      }
+    }
+    for (std::map<std::string, columnResult>::const_iterator column = other.columns.begin();
+         column != other.columns.end(); column++) {
+      columnResult &merged = columns[column->first];
+      merged.values.merge(column->second.values);
+      for (int octave = 0; octave < COMPARE_OCTAVES; octave++) {
+        merged.allan[octave] += column->second.allan[octave];
+        merged.allanCounts[octave] += column->second.allanCounts[octave];
+      }
+    }
+    for (std::map<namePair, pairResult>::const_iterator pair = other.pairs.begin(); pair != other.pairs.end(); pair++) {
+      pairs[pair->first].difference.merge(pair->second.difference);
+      pairs[pair->first].both.merge(pair->second.both);
+    }
+    for (std::map<namePair, lagResult>::const_iterator lag = other.lags.begin(); lag != other.lags.end(); lag++) {
+      lagResult &merged = lags[lag->first];
+      merged.lags.resize(lag->second.lags.size());
+      merged.responses.resize(lag->second.responses.size());
+      for (size_t index = 0; index < lag->second.lags.size(); index++) {
+        merged.lags[index].merge(lag->second.lags[index]);
+        merged.responses[index].merge(lag->second.responses[index]);
+      }
+    }
+    steps += other.steps;
+    stepCount += other.stepCount;
+    stats.bytes += other.stats.bytes;
+    stats.lines += other.stats.lines;
+    stats.rows += other.stats.rows;
+    stats.headers += other.stats.headers;
+    stats.orphans += other.stats.orphans;
+    stats.untimed += other.stats.untimed;
+  }
+};
+
+struct compareOptions {
+  char delimiter;
+  unsigned readThreads;
+  int maxLag;
+  std::vector<std::string> references;
+};
+
+//"Temperature" for "Temperature(DS18B20)", "" for a column that is not a sensor's, e.g. "Temperature-Band".
+static std::string quantityOf(const std::string &name) {
+  size_t open = name.find('(');
+  if ((open == std::string::npos) || (open == 0) || (name[name.size() - 1] != ')')) {
+    return "";
+  }
+  return name.substr(0, open);
+}
+
+static std::string sensorOf(const std::string &name) {
+  size_t open = name.find('(');
+  return (open == std::string::npos) ? name : name.substr(open + 1, name.size() - open - 2);
+}
+
+//The runs of rows, [first, last), split at the headers, gaps, and rows without a time.
+static void findRuns(const captureTable &table, partialResult &partial, std::vector<std::pair<size_t, size_t> > &runs) {
+  size_t rows = table.rows();
+  std::vector<double> steps;
+  for (size_t row = 1; row < rows; row++) {
+    double step = table.times[row] - table.times[row - 1];
+    if (step > 0.0) {
+      steps.push_back(step);
+    }
+  }
+  double gap = INFINITY;
+  if (!steps.empty()) {
+    std::nth_element(steps.begin(), steps.begin() + steps.size() / 2, steps.end());
+    gap = COMPARE_GAP * steps[steps.size() / 2];
+  }
+  std::vector<bool> starts(rows + 1, false);
+  for (size_t index = 0; index < table.headers.size(); index++) {
+    starts[table.headers[index].row] = true;
+  }
+  size_t first = 0;
+  for (size_t row = 1; row <= rows; row++) {
+    double step = (row < rows) ? table.times[row] - table.times[row - 1] : NAN;
+    if ((row < rows) && !starts[row] && (step > 0.0) && (step <= gap)) {
+      partial.steps += step;
+      partial.stepCount++;
+      continue;
+    }
+    if (row > first) {
+      runs.push_back(std::make_pair(first, row));
+    }
+    first = row;
+  }
+}
+
+//The Allan deviation's sums, over each stretch of readings, from the running sums of the values, so each time takes
+//  one pass. Overlapping, every start row is used, not just every m'th.
+static void addAllan(const std::vector<float> &values, size_t first, size_t last, columnResult &result) {
+  std::vector<double> running;
+  size_t start = first;
+  for (size_t row = first; row <= last; row++) {
+    if ((row < last) && !std::isnan(values[row])) {
+      continue;
+    }
+    size_t length = row - start;
+    running.assign(length + 1, 0.0);
+    for (size_t index = 0; index < length; index++) {
+      running[index + 1] = running[index] + values[start + index];
+    }
+    for (int octave = 0; octave < COMPARE_OCTAVES; octave++) {
+      size_t width = (size_t)1 << octave;
+      if (2 * width > length) {
+        break;
+      }
+      double total = 0.0;
+      for (size_t index = 0; index + 2 * width <= length; index++) {
+        double difference = (running[index + 2 * width] - 2.0 * running[index + width] + running[index]) / width;
+        total += difference * difference;
+      }
+      result.allan[octave] += total;
+      result.allanCounts[octave] += length + 1 - 2 * width;
+    }
+    start = row + 1;
+  }
+}
+
+//The response's sums, over a run, for each time constant: the sensor's differences from the reference passed through
+//  a first order lag of that time constant, in rows, or, for a negative one, the reference's from the lagged sensor. The
+//  first rows of a run, while the lag settles, are left out. COMPARE_BATCH time constants are worked on in each pass,
+//  side by side, as each one's lag depends on its last row, but not on the others.
+static void addResponses(const std::vector<float> &x, const std::vector<float> &y, size_t first, size_t last,
+                         int maxLag, std::vector<sums> &responses) {
+  size_t settled = first + 3 * maxLag;
+  for (int direction = 1; direction >= -1; direction -= 2) {
+    const float *input = (direction > 0) ? x.data() : y.data();
+    const float *output = (direction > 0) ? y.data() : x.data();
+    for (int start = (direction > 0) ? 0 : 1; start <= maxLag; start += COMPARE_BATCH) {
+      double rates[COMPARE_BATCH];
+      double lagged[COMPARE_BATCH];
+      double totals[COMPARE_BATCH];
+      double squares[COMPARE_BATCH];
+      for (int lane = 0; lane < COMPARE_BATCH; lane++) {
+        rates[lane] = (start + lane == 0) ? 1.0 : 1.0 - exp(-1.0 / (start + lane));
+        totals[lane] = 0.0;
+        squares[lane] = 0.0;
+      }
+      bool started = false;
+      uint64_t count = 0;
+      for (size_t row = first; row < last; row++) {
+        double value = input[row];
+        if (!std::isnan(value)) {
+          for (int lane = 0; lane < COMPARE_BATCH; lane++) {
+            lagged[lane] = started ? lagged[lane] + rates[lane] * (value - lagged[lane]) : value;
+          }
+          started = true;
+        }
+        if ((row >= settled) && started && !std::isnan(output[row])) {
+          double sensor = direction * (double)output[row];
+          for (int lane = 0; lane < COMPARE_BATCH; lane++) {
+            double difference = sensor - direction * lagged[lane];
+            totals[lane] += difference;
+            squares[lane] += difference * difference;
+          }
+          count++;
+        }
+      }
+      for (int lane = 0; (lane < COMPARE_BATCH) && (start + lane <= maxLag); lane++) {
+        sums &response = responses[maxLag + direction * (start + lane)];
+        response.count += count;
+        response.x += totals[lane];
+        response.xx += squares[lane];
+      }
+    }
+  }
+}
+
+//The lags' sums, over a run, of the reference's changes against the sensor's, that many rows later. COMPARE_BATCH lags
+//  are worked on in each pass, from the sensor's changes copied with a gap of maxLag rows either side, and a nan as 0
+//  with a weight of 0, so each lag takes the same steps.
+static void addLags(const std::vector<float> &changeX, const std::vector<float> &changeY, size_t first, size_t last,
+                    int maxLag, std::vector<sums> &lags) {
+  size_t length = last - first;
+  std::vector<double> values(length + 2 * maxLag + COMPARE_BATCH, 0.0);
+  std::vector<double> weights(values.size(), 0.0);
+  for (size_t row = first; row < last; row++) {
+    if (!std::isnan(changeY[row])) {
+      values[row - first + maxLag] = changeY[row];
+      weights[row - first + maxLag] = 1.0;
+    }
+  }
+  for (int start = 0; start <= 2 * maxLag; start += COMPARE_BATCH) {
+    double counts[COMPARE_BATCH] = {0.0};
+    double xs[COMPARE_BATCH] = {0.0};
+    double ys[COMPARE_BATCH] = {0.0};
+    double xxs[COMPARE_BATCH] = {0.0};
+    double yys[COMPARE_BATCH] = {0.0};
+    double xys[COMPARE_BATCH] = {0.0};
+    for (size_t row = first; row < last; row++) {
+      double x = changeX[row];
+      if (std::isnan(x)) {
+        continue;
+      }
+      const double *y = values.data() + (row - first) + start;
+      const double *weight = weights.data() + (row - first) + start;
+      for (int lane = 0; lane < COMPARE_BATCH; lane++) {
+        counts[lane] += weight[lane];
+        xs[lane] += x * weight[lane];
+        ys[lane] += y[lane];
+        xxs[lane] += x * x * weight[lane];
+        yys[lane] += y[lane] * y[lane];
+        xys[lane] += x * y[lane];
+      }
+    }
+    for (int lane = 0; (lane < COMPARE_BATCH) && (start + lane <= 2 * maxLag); lane++) {
+      sums &lag = lags[start + lane];
+      lag.count += (uint64_t)counts[lane];
+      lag.x += xs[lane];
+      lag.y += ys[lane];
+      lag.xx += xxs[lane];
+      lag.yy += yys[lane];
+      lag.xy += xys[lane];
+    }
+  }
+}
+
+static void analyseTable(const captureTable &table, const compareOptions &options, partialResult &partial) {
+  std::vector<std::pair<size_t, size_t> > runs;
+  findRuns(table, partial, runs);
+  //The sensor columns, by what they measure.
+  std::map<std::string, std::vector<size_t> > groups;
+  for (size_t column = 0; column < table.names.size(); column++) {
+    std::string quantity = quantityOf(table.names[column]);
+    if (!quantity.empty()) {
+      groups[quantity].push_back(column);
+      partial.names.push_back(table.names[column]);
+    }
+  }
+  //The changes over COMPARE_SPAN rows, nan at the start of a run. Over a single row they are mostly the sensors'
+  //  resolution and noise.
+  std::vector<std::vector<float> > changes(table.names.size());
+  for (std::map<std::string, std::vector<size_t> >::const_iterator group = groups.begin(); group != groups.end(); group++) {
+    for (size_t member = 0; member < group->second.size(); member++) {
+      size_t column = group->second[member];
+      const std::vector<float> &values = table.columns[column];
+      columnResult &result = partial.columns[table.names[column]];
+      std::vector<float> &change = changes[column];
+      change.assign(values.size(), NAN);
+      for (size_t run = 0; run < runs.size(); run++) {
+        for (size_t row = runs[run].first; row < runs[run].second; row++) {
+          if (!std::isnan(values[row])) {
+            result.values.add(values[row]);
+          }
+          if (row >= runs[run].first + COMPARE_SPAN) {
+            change[row] = values[row] - values[row - COMPARE_SPAN];
+          }
+        }
+        addAllan(values, runs[run].first, runs[run].second, result);
+      }
+    }
+  }
+  for (std::map<std::string, std::vector<size_t> >::const_iterator group = groups.begin(); group != groups.end(); group++) {
+    const std::vector<size_t> &members = group->second;
+    //Every pair's bias and correlation.
+    for (size_t one = 0; one < members.size(); one++) {
+      for (size_t other = one + 1; other < members.size(); other++) {
+        size_t first = members[one];
+        size_t second = members[other];
+        if (table.names[second] < table.names[first]) {
+          std::swap(first, second);
+        }
+        pairResult &result = partial.pairs[namePair(table.names[first], table.names[second])];
+        const std::vector<float> &x = table.columns[first];
+        const std::vector<float> &y = table.columns[second];
+        for (size_t row = 0; row < x.size(); row++) {
+          if (!std::isnan(x[row]) && !std::isnan(y[row])) {
+            result.difference.add((double)x[row] - y[row]);
+            result.both.add(x[row], y[row]);
+          }
+        }
+      }
+    }
+    //Each sensor's lag and response against the group's reference.
+    size_t reference = members[0];
+    for (size_t member = 0; member < members.size(); member++) {
+      if (sensorOf(table.names[members[member]]) == COMPARE_REFERENCE) {
+        reference = members[member];
+      }
+    }
+    for (size_t member = 0; member < members.size(); member++) {
+      const std::string &name = table.names[members[member]];
+      if (std::find(options.references.begin(), options.references.end(), name) != options.references.end()) {
+        reference = members[member];
+      }
+    }
+    const std::vector<float> &x = table.columns[reference];
+    const std::vector<float> &changeX = changes[reference];
+    int maxLag = options.maxLag;
+    for (size_t member = 0; member < members.size(); member++) {
+      size_t column = members[member];
+      if (column == reference) {
+        continue;
+      }
+      lagResult &result = partial.lags[namePair(table.names[reference], table.names[column])];
+      result.lags.resize(2 * maxLag + 1);
+      result.responses.resize(2 * maxLag + 1);
+      const std::vector<float> &y = table.columns[column];
+      const std::vector<float> &changeY = changes[column];
+      for (size_t run = 0; run < runs.size(); run++) {
+        addLags(changeX, changeY, runs[run].first, runs[run].second, maxLag, result.lags);
+        addResponses(x, y, runs[run].first, runs[run].second, maxLag, result.responses);
+      }
+    }
+  }
+  partial.lastNames = table.names;
+  partial.lastFields = table.fields;
+}
+
+static bool analyseCapture(const char *path, const compareOptions &options, const partialResult *before,
+                           partialResult &partial, std::string &error) {
+  captureReader reader(options.delimiter, options.readThreads);
+  captureTable table;
+  if (before != NULL) {
+    table.names = before->lastNames;
+    table.columns.resize(table.names.size());
+    table.fields = before->lastFields;
+  }
+  if (!reader.read(path, table)) {
+    error = reader.error();
+    return false;
+  }
+  partial = partialResult();
+  partial.stats = reader.stats();
+  analyseTable(table, options, partial);
+  return true;
+}
+
+static std::string formatDuration(double seconds) {
+  char text[20];
+  if (seconds < 120.0) {
+    snprintf(text, sizeof(text), "%.0fs", seconds);
+  }
+  else if (seconds < 7200.0) {
+    snprintf(text, sizeof(text), "%.0fm", seconds / 60.0);
+  }
+  else {
+    snprintf(text, sizeof(text), "%.1fh", seconds / 3600.0);
+  }
+  return text;
+}
+
+static std::string formatNumber(double value, int decimals) {
+  char text[32];
+  if (std::isnan(value)) {
+    return "-";
+  }
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  return text;
+}
+
+//A sensor's white noise variance, from its Allan variance over one row.
+static double noiseOf(const partialResult &result, const std::string &name) {
+  const columnResult &column = result.columns.find(name)->second;
+  return (column.allanCounts[0] > 0) ? column.allan[0] / (2.0 * column.allanCounts[0]) : 0.0;
+}
+
+static void reportGroup(const partialResult &result, const std::string &quantity, double period) {
+  std::vector<std::string> members;
+  for (size_t index = 0; index < result.names.size(); index++) {
+    if (quantityOf(result.names[index]) == quantity) {
+      members.push_back(result.names[index]);
+    }
+  }
+  printf("\n%s, %zu sensors\n\n", quantity.c_str(), members.size());
+  printf("%-10s %10s %8s %8s  Allan deviation at", "Sensor", "Count", "Mean", "SD");
+  for (int octave = 0; octave < COMPARE_OCTAVES; octave += 2) {
+    printf(" %7s", formatDuration(period * ((size_t)1 << octave)).c_str());
+  }
+  printf("\n");
+  for (size_t member = 0; member < members.size(); member++) {
+    const columnResult &column = result.columns.find(members[member])->second;
+    printf("%-10s %10llu %8.2f %8.3f  %18s", sensorOf(members[member]).c_str(), (unsigned long long)column.values.count,
+           column.values.mean, column.values.deviation(), "");
+    for (int octave = 0; octave < COMPARE_OCTAVES; octave += 2) {
+      if (column.allanCounts[octave] < COMPARE_MINALLAN) {
+        printf(" %7s", "-");
+      }
+      else {
+        printf(" %7.4f", sqrt(column.allan[octave] / (2.0 * column.allanCounts[octave])));
+      }
+    }
+    printf("\n");
+  }
+  if (members.size() < 2) {
+    return;
+  }
+  for (int table = 0; table < 2; table++) {
+    printf("\n%-10s", (table == 0) ? "Bias" : "Correlation");
+    for (size_t member = 0; member < members.size(); member++) {
+      printf(" %8.8s", sensorOf(members[member]).c_str());
+    }
+    printf("\n");
+    for (size_t one = 0; one < members.size(); one++) {
+      printf("%-10s", sensorOf(members[one]).c_str());
+      for (size_t other = 0; other < members.size(); other++) {
+        bool swapped = (members[other] < members[one]);
+        std::map<namePair, pairResult>::const_iterator pair =
+          result.pairs.find(swapped ? namePair(members[other], members[one]) : namePair(members[one], members[other]));
+        if ((one == other) || (pair == result.pairs.end()) || (pair->second.difference.count == 0)) {
+          printf(" %8s", "-");
+        }
+        else if (table == 0) {
+          printf(" %8.3f", swapped ? -pair->second.difference.mean : pair->second.difference.mean);
+        }
+        else {
+          printf(" %8.3f", pair->second.both.correlation());
+        }
+      }
+      printf("\n");
+    }
+  }
+  printf("\n%-10s %-10s %10s %8s %10s %12s %10s\n", "Sensor", "Against", "Rows", "Lag (s)", "Lag corr", "Response (s)",
+         "Resp SD");
+  for (std::map<namePair, lagResult>::const_iterator lag = result.lags.begin(); lag != result.lags.end(); lag++) {
+    if (quantityOf(lag->first.first) != quantity) {
+      continue;
+    }
+    const std::vector<sums> &lags = lag->second.lags;
+    int maxLag = (int)lags.size() / 2;
+    int best = -1;
+    for (int index = 0; index < (int)lags.size(); index++) {
+      if (!std::isnan(lags[index].correlation()) && ((best < 0) || (lags[index].correlation() > lags[best].correlation()))) {
+        best = index;
+      }
+    }
+    double shift = NAN;
+    double peak = NAN;
+    if (best >= 0) {
+      //The peak between rows, from a parabola through the best lag and those either side.
+      shift = best - maxLag;
+      peak = lags[best].correlation();
+      if ((best > 0) && (best + 1 < (int)lags.size())) {
+        double before = lags[best - 1].correlation();
+        double after = lags[best + 1].correlation();
+        double curve = before - 2.0 * peak + after;
+        if (curve < 0.0) {
+          shift += 0.5 * (before - after) / curve;
+        }
+      }
+    }
+    //The time constant that leaves the least variation in the difference, likewise between rows. The lag smooths
+    //  the noise of the sensor it is applied to, and would favour smoothing a noisy one, so that noise's share is
+    //  taken off first, the variance that is left after a first order lag, 2 - a times smaller, of the sensor's white
+    //  noise, its Allan variance over one row.
+    const std::vector<sums> &responses = lag->second.responses;
+    double noises[2] = {noiseOf(result, lag->first.first), noiseOf(result, lag->first.second)};
+    std::vector<double> variances(responses.size(), NAN);
+    int fit = -1;
+    for (int index = 0; index < (int)responses.size(); index++) {
+      if (responses[index].count > 1) {
+        int shift = index - maxLag;
+        double rate = (shift == 0) ? 1.0 : 1.0 - exp(-1.0 / abs(shift));
+        variances[index] = responses[index].variance() - noises[(shift >= 0) ? 0 : 1] * rate / (2.0 - rate) -
+                           noises[(shift >= 0) ? 1 : 0];
+        fit = ((fit < 0) || (variances[index] < variances[fit])) ? index : fit;
+      }
+    }
+    double response = NAN;
+    double spread = NAN;
+    if ((fit > 0) && (fit + 1 < (int)responses.size()) && !std::isnan(variances[fit - 1]) &&
+        !std::isnan(variances[fit + 1])) {
+      response = fit - maxLag;
+      spread = sqrt(responses[fit].variance());
+      double curve = variances[fit - 1] - 2.0 * variances[fit] + variances[fit + 1];
+      if (curve > 0.0) {
+        response += 0.5 * (variances[fit - 1] - variances[fit + 1]) / curve;
+      }
+    }
+    printf("%-10s %-10s %10llu %8s %10s %12s %10s\n", sensorOf(lag->first.second).c_str(),
+           sensorOf(lag->first.first).c_str(), (unsigned long long)lags[maxLag].count,
+           formatNumber(shift * period, 0).c_str(), formatNumber(peak, 3).c_str(),
+           formatNumber(response * period, 0).c_str(), formatNumber(spread, 3).c_str());
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-d delimiter] [-j threads] [-l lags] [-r reference]... capture.csv...\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  compareOptions options;
+  options.delimiter = 0;
+  options.readThreads = 1;
+  options.maxLag = COMPARE_MAXLAG;
+  unsigned threads = 0;
+  std::vector<const char *> paths;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    bool hasValue = (arg + 1 < argc);
+    if ((option == "-d") && hasValue) {
+      std::string text = argv[++arg];
+      options.delimiter = (text == "tab") ? '\t' : ((text == "space") ? ' ' : text[0]);
+    }
+    else if ((option == "-j") && hasValue) {
+      threads = atoi(argv[++arg]);
+    }
+    else if ((option == "-l") && hasValue) {
+      options.maxLag = atoi(argv[++arg]);
+    }
+    else if ((option == "-r") && hasValue) {
+      options.references.push_back(argv[++arg]);
+    }
+    else if ((option.size() > 1) && (option[0] == '-')) {
+      usage(argv[0]);
+    }
+    else {
+      paths.push_back(argv[arg]);
+    }
+  }
+  if (paths.empty() || (options.maxLag < 1)) {
+    usage(argv[0]);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  unsigned workers = std::min(threads, (unsigned)paths.size());
+  options.readThreads = std::max(1u, threads / workers);
+  std::vector<partialResult> partials(paths.size());
+  std::vector<std::string> errors(paths.size());
+  std::vector<bool> done(paths.size(), false);
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for (unsigned worker = 0; worker < workers; worker++) {
+    pool.push_back(std::thread([&]() {
+      for (size_t index = next++; index < paths.size(); index = next++) {
+        done[index] = analyseCapture(paths[index], options, NULL, partials[index], errors[index]);
+      }
+    }));
+  }
+  for (size_t worker = 0; worker < pool.size(); worker++) {
+    pool[worker].join();
+  }
+  partialResult result;
+  for (size_t index = 0; index < paths.size(); index++) {
+    if (!done[index]) {
+      fprintf(stderr, "%s\n", errors[index].c_str());
+      return 1;
+    }
+    //A capture that carries on from the one before, read again with its columns.
+    if ((partials[index].stats.orphans > 0) && (index > 0) && !partials[index - 1].lastFields.empty()) {
+      if (!analyseCapture(paths[index], options, &partials[index - 1], partials[index], errors[index])) {
+        fprintf(stderr, "%s\n", errors[index].c_str());
+        return 1;
+      }
+    }
+    result.merge(partials[index]);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double period = (result.stepCount > 0) ? result.steps / result.stepCount : 1.0;
+  printf("Captures: %zu, %.1f MB, %llu rows, %llu headers (sketch starts), rows before a header: %llu, read and compared in %.2fs, %u threads\n",
+         paths.size(), result.stats.bytes / 1e6, (unsigned long long)result.stats.rows,
+         (unsigned long long)result.stats.headers, (unsigned long long)result.stats.orphans, seconds,
+         workers * options.readThreads);
+  printf("Rows every %.1fs\n", period);
+  std::vector<std::string> quantities;
+  for (size_t index = 0; index < result.names.size(); index++) {
+    std::string quantity = quantityOf(result.names[index]);
+    if (std::find(quantities.begin(), quantities.end(), quantity) == quantities.end()) {
+      quantities.push_back(quantity);
+      reportGroup(result, quantity, period);
+    }
+  }
+  return 0;
+}
+
+//EOF
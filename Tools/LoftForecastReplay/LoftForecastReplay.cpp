@@ -0,0 +1,280 @@
+/*
+Loft Environment Monitor Forecast Replay.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Replays captured CSV logs (e.g. LoftMon20210111-1.csv) through the sketch's trend forecast
+  (Loft-Monitor/LoftForecast.cpp, the same code, compiled for the PC), to see how early its pre-alert warns of a
+  threshold being crossed, and how often it warns of a crossing that never comes.
+
+The logs can have CoolTerm timestamps ("2021-01-11 12:45:58<tab>" before each line), or none, when the rows are taken
+  to be the data output period apart. A gap in the timestamps longer than the gap limit starts the forecast again.
+  The sketch's command replies ('#' lines) are skipped, and so are sparse lines ('~' lines, PLOTSPARSE) - expand a
+  sparse capture with Tools/LoftSparseExpander first.
+  The temperature is the Temperature(Fused) column when there is one, or the named column, or else the mean of all
+  the Temperature columns, skipping failed (0.00) readings. So a Tools/LoftThermalSim trace can be replayed too, with
+  "-c Sensor -p 10".
+
+A crossing is the temperature rising to the threshold (and it must fall 0.5 deg C below it again, BAND_HYSTERESIS,
+  before the next one counts). A crossing is warned if the pre-alert was raised when it happened, and the lead time
+  is how long the pre-alert had been raised. A false alarm is a pre-alert that cleared without a crossing.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftForecastReplay LoftForecastReplay.cpp ../../Loft-Monitor/LoftForecast.cpp
+
+Usage:
+  LoftForecastReplay [-c column] [-t threshold] [-h horizon] [-w window] [-m minslope] [-p period] [-g gap] [-v] [log.csv...]
+    -c  The temperature column name, e.g. "Temperature(DS18B20)".
+    -t  The threshold, deg C, default 45 (the <Melting!> band).
+    -h  The pre-alert horizon, minutes, default 30 (FORECAST_HORIZON).
+    -w  The forecast window, minutes, default 15 (FORECAST_WINDOW).
+    -m  The slowest rise forecast, deg C/min, default 0.005 (FORECAST_MINSLOPE).
+    -p  The seconds between rows without timestamps, default 15 (the sketch's data output period).
+    -g  The longest gap, minutes, before the forecast is started again, default 10.
+    -v  List every crossing and pre-alert.
+  Reads stdin when no log is given.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../Loft-Monitor/LoftForecast.h"
+
+#define REPLAY_HYSTERESIS 0.5         //BAND_HYSTERESIS, deg C.
+
+struct replayStats {
+  unsigned long rows;
+  double seconds;                     //The time covered by the logs.
+  unsigned crossings;
+  unsigned warned;
+  double leadTotal;                   //Minutes.
+  double leadMin;
+  double leadMax;
+  unsigned alerts;
+  unsigned falseAlerts;
+  unsigned openAlerts;                //Still raised at a gap or the end of a log, so neither true nor false.
+};
+
+static std::string columnName;
+static float threshold = 45.0;
+static float horizon = 30.0;
+static float window = 15.0;
+static float minSlope = 0.005;
+static double rowPeriod = 15.0;
+static double gapLimit = 10.0;
+static bool verbose = false;
+
+//Seconds since 1970 for a "YYYY-MM-DD HH:MM:SS" timestamp, or -1 if the line does not start with one.
+static double parseTimestamp(const char *text) {
+  int year, month, day, hour, minute, second;
+  if (sscanf(text, "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) {
+    return -1.0;
+  }
+  //Days from the civil date, http://howardhinnant.github.io/date_algorithms.html
+  year -= (month <= 2) ? 1 : 0;
+  long era = (year >= 0 ? year : year - 399) / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+  return days * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+}
+
+static std::vector<std::string> splitFields(const std::string &line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = line.find(',', start);
+    fields.push_back(line.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return fields;
+}
+
+static void replayFile(FILE *input, replayStats &stats) {
+  loftForecast forecast(window, minSlope);
+  std::vector<int> columns;           //The temperature columns to use.
+  double lastTime = -1.0;
+  double rowTime = 0.0;
+  bool above = false;
+  double alertRaised = 0.0;
+  bool crossedInAlert = false;
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), input) != NULL) {
+    std::string line = buffer;
+    while (!line.empty() && ((line[line.size() - 1] == '\n') || (line[line.size() - 1] == '\r'))) {
+      line.erase(line.size() - 1);
+    }
+    double time = parseTimestamp(line.c_str());
+    size_t tab = line.find('\t');
+    if ((time >= 0.0) && (tab != std::string::npos)) {
+      line = line.substr(tab + 1);
+    }
+    else {
+      time = rowTime;
+    }
+    if (!line.empty() && ((line[0] == '#') || (line[0] == '~'))) {
+      //A command reply (the sketch's USE_HISTORY), or a sparse line (PLOTSPARSE), not data.
+      continue;
+    }
+    rowTime = time + rowPeriod;
+    std::vector<std::string> fields = splitFields(line);
+    char *end;
+    strtod(fields[0].c_str(), &end);
+    if (!fields[0].empty() && (end == fields[0].c_str())) {
+      //A header line (it does not start with a number), pick the columns.
+      std::vector<std::string> &names = fields;
+      columns.clear();
+      for (size_t index = 0; index < names.size(); index++) {
+        if ((!columnName.empty() && (names[index] == columnName)) || (columnName.empty() && (names[index] == "Temperature(Fused)"))) {
+          columns.assign(1, index);
+          break;
+        }
+        if (columnName.empty() && (names[index].compare(0, 12, "Temperature(") == 0)) {
+          columns.push_back(index);
+        }
+      }
+      if (!columnName.empty() && ((columns.size() != 1) || (names[columns[0]] != columnName))) {
+        columns.clear();
+        fprintf(stderr, "No %s column in the header, rows skipped.\n", columnName.c_str());
+      }
+      continue;
+    }
+    if (columns.empty()) {
+      continue;
+    }
+    double total = 0.0;
+    unsigned count = 0;
+    for (size_t index = 0; index < columns.size(); index++) {
+      if ((size_t)columns[index] < fields.size()) {
+        double value = strtod(fields[columns[index]].c_str(), &end);
+        if ((end != fields[columns[index]].c_str()) && (value == value) && (value != 0.0)) {
+          total += value;
+          count++;
+        }
+      }
+    }
+    float temperature = (count > 0) ? total / count : NAN;
+    if ((lastTime < 0.0) || (time - lastTime > gapLimit * 60.0) || (time < lastTime)) {
+      if (forecast.alert()) {
+        stats.openAlerts++;
+      }
+      forecast.reset();
+      lastTime = time;
+    }
+    else {
+      stats.seconds += time - lastTime;
+    }
+    double elapsed = time - lastTime;
+    lastTime = time;
+    stats.rows++;
+    forecast.add(temperature, (uint16_t)((elapsed * 1000.0 > 65535.0) ? 65535.0 : elapsed * 1000.0));
+    bool wasAlert = forecast.alert();
+    bool alert = forecast.checkAlert(threshold, horizon);
+    if (alert && !wasAlert) {
+      stats.alerts++;
+      alertRaised = time;
+      crossedInAlert = false;
+      if (verbose) {
+        printf("%.0f Pre-alert, %.1f deg C rising %.3f deg C/min, %.0f min to %.1f deg C.\n", time, forecast.level(), forecast.slope(), forecast.minutesTo(threshold), threshold);
+      }
+    }
+    if (!isnan(temperature)) {
+      if (!above && (temperature >= threshold)) {
+        above = true;
+        stats.crossings++;
+        if (alert) {
+          double lead = (time - alertRaised) / 60.0;
+          stats.warned++;
+          stats.leadTotal += lead;
+          stats.leadMin = (stats.warned == 1 || lead < stats.leadMin) ? lead : stats.leadMin;
+          stats.leadMax = (lead > stats.leadMax) ? lead : stats.leadMax;
+          crossedInAlert = true;
+        }
+        if (verbose) {
+          printf("%.0f Crossing, %.2f deg C, %s.\n", time, temperature, alert ? "warned" : "missed");
+        }
+      }
+      else if (above && (temperature < threshold - REPLAY_HYSTERESIS)) {
+        above = false;
+      }
+    }
+    if (!alert && wasAlert) {
+      if (!crossedInAlert) {
+        stats.falseAlerts++;
+      }
+      if (verbose) {
+        printf("%.0f Pre-alert cleared%s.\n", time, crossedInAlert ? "" : ", a false alarm");
+      }
+    }
+  }
+  if (forecast.alert()) {
+    stats.openAlerts++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<const char *> files;
+  for (int arg = 1; arg < argc; arg++) {
+    if ((strcmp(argv[arg], "-c") == 0) && (arg + 1 < argc)) {
+      columnName = argv[++arg];
+    }
+    else if ((strcmp(argv[arg], "-t") == 0) && (arg + 1 < argc)) {
+      threshold = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-h") == 0) && (arg + 1 < argc)) {
+      horizon = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-w") == 0) && (arg + 1 < argc)) {
+      window = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-m") == 0) && (arg + 1 < argc)) {
+      minSlope = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-p") == 0) && (arg + 1 < argc)) {
+      rowPeriod = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-g") == 0) && (arg + 1 < argc)) {
+      gapLimit = atof(argv[++arg]);
+    }
+    else if (strcmp(argv[arg], "-v") == 0) {
+      verbose = true;
+    }
+    else if (argv[arg][0] == '-') {
+      fprintf(stderr, "Usage: %s [-c column] [-t threshold] [-h horizon] [-w window] [-m minslope] [-p period] [-g gap] [-v] [log.csv...]\n", argv[0]);
+      return 1;
+    }
+    else {
+      files.push_back(argv[arg]);
+    }
+  }
+  replayStats stats = {0, 0.0, 0, 0, 0.0, 0.0, 0.0, 0, 0, 0};
+  if (files.empty()) {
+    replayFile(stdin, stats);
+  }
+  for (size_t index = 0; index < files.size(); index++) {
+    FILE *input = fopen(files[index], "r");
+    if (input == NULL) {
+      perror(files[index]);
+      return 1;
+    }
+    replayFile(input, stats);
+    fclose(input);
+  }
+  double days = stats.seconds / 86400.0;
+  printf("Rows: %lu, %.2f days. Threshold %.2f deg C, horizon %.0f min, window %.0f min.\n", stats.rows, days, threshold, horizon, window);
+  printf("Crossings: %u, warned: %u, missed: %u.\n", stats.crossings, stats.warned, stats.crossings - stats.warned);
+  if (stats.warned > 0) {
+    printf("Lead time: min %.1f, mean %.1f, max %.1f min.\n", stats.leadMin, stats.leadTotal / stats.warned, stats.leadMax);
+  }
+  printf("Pre-alerts: %u, false alarms: %u (%.2f per day), still raised at a gap or the end: %u.\n", stats.alerts, stats.falseAlerts, (days > 0.0) ? stats.falseAlerts / days : 0.0, stats.openAlerts);
+  return 0;
+}
+
+//EOF
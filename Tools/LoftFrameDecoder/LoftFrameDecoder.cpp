@@ -0,0 +1,260 @@
+/*
+Loft Environment Monitor Binary Telemetry Frame Decoder.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Turns the binary frames sent by the Loft-Monitor sketch with PLOTBINARY enabled back into the same CSV lines,
+  and column names, that the sketch sends with just PLOTDATA enabled.
+  The header line is written before the first frame, and again whenever the column set changes.
+  Bytes that are not part of a valid frame (noise, or text sent before the frames started) are skipped, except the
+  sketch's command reply lines (USE_HISTORY), which start with '#', and are passed through as they are.
+  Dropped frames (gaps in the sequence numbers), sketch restarts and CRC errors are reported on stderr. The sketch
+  numbers its frames from 0 each time it starts, so a sequence that goes back to 0, other than from 65535, is counted
+  as a restart, not as dropped frames.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftFrameDecoder LoftFrameDecoder.cpp
+
+Usage:
+  LoftFrameDecoder [-d delimiter] [-q] [capture.bin]    (reads stdin when no file is given)
+    -d  The column delimiter, default ",".
+    -q  Quiet, do not report dropped frames, restarts and errors as they are found, only the totals.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../Loft-Monitor/LoftFrame.h"
+
+struct decoderStats {
+  unsigned long frames;
+  unsigned long dropped;
+  unsigned long restarts;
+  unsigned long crcErrors;
+  unsigned long badFrames;
+  unsigned long skippedBytes;
+};
+
+#define MAXREPLY 512                //The longest command reply line passed through.
+
+static std::string delimiter = ",";
+static bool quiet = false;
+
+//The column names for a sensor mask, exactly as the sketch sends them.
+static std::vector<std::string> columnNames(uint16_t mask, uint8_t probes) {
+  std::vector<std::string> names;
+  if (mask & LFM_BME280) {
+    names.push_back("Temperature(BME280)");
+    names.push_back("Humidity(BME280)");
+  }
+  if (mask & LFM_DHT11) {
+    names.push_back("Temperature(DHT11)");
+    names.push_back("Humidity(DHT11)");
+  }
+  if (mask & LFM_DHT22) {
+    names.push_back("Temperature(DHT22)");
+    names.push_back("Humidity(DHT22)");
+  }
+  if (mask & LFM_DS18B20) {
+    for (uint8_t probe = 0; probe < probes; probe++) {
+      names.push_back(probe == 0 ? "Temperature(DS18B20)" : "Temperature(DS18B20-" + std::to_string(probe + 1) + ")");
+    }
+  }
+  if (mask & LFM_KY013) {
+    names.push_back("Temperature(KY013)");
+  }
+  if (mask & LFM_TMP36) {
+    names.push_back("Temperature(TMP36)");
+  }
+  if (mask & LFM_MF52D) {
+    names.push_back("Temperature(MF52D)");
+  }
+  if (mask & LFM_LDR) {
+    names.push_back("Light-Level(LDR)");
+  }
+  if (mask & LFM_FAN) {
+    names.push_back("Fan-Duty(PWM)");
+  }
+  if (mask & LFM_FUSED) {
+    names.push_back("Temperature(Fused)");
+  }
+  if (mask & LFM_FORECAST) {
+    names.push_back("Minutes-To-Alert");
+  }
+  return names;
+}
+
+//Format a field as the sketch would print it, 2 decimal places for 1/100ths.
+static std::string formatField(int16_t value, bool whole) {
+  char text[16];
+  if (whole) {
+    snprintf(text, sizeof(text), "%d", value);
+  }
+  else if (value == LOFTFRAME_NAN) {
+    snprintf(text, sizeof(text), "nan");
+  }
+  else {
+    int magnitude = (value < 0) ? -value : value;
+    snprintf(text, sizeof(text), "%s%d.%02d", (value < 0) ? "-" : "", magnitude / 100, magnitude % 100);
+  }
+  return text;
+}
+
+//Try to decode a frame at the start of buffer. Returns the frame length, 0 if more bytes are needed, or -1 if it is not a frame.
+static long decodeFrame(const uint8_t *buffer, size_t available, decoderStats &stats) {
+  static bool started = false;
+  static uint16_t lastSequence = 0;
+  static uint16_t lastMask = 0;
+  static uint8_t lastProbes = 0;
+  if (available < LOFTFRAME_HEADER) {
+    return 0;
+  }
+  if ((buffer[0] != LOFTFRAME_SYNC1) || (buffer[1] != LOFTFRAME_SYNC2) || (buffer[2] != LOFTFRAME_VERSION) || (buffer[8] > LOFTFRAME_MAXFIELDS)) {
+    return -1;
+  }
+  uint8_t count = buffer[8];
+  size_t length = LOFTFRAME_HEADER + (2 * count) + LOFTFRAME_CRC;
+  if (available < length) {
+    return 0;
+  }
+  uint16_t crc = LOFTFRAME_CRCINIT;
+  for (size_t index = 2; index < length - LOFTFRAME_CRC; index++) {
+    crc = loftFrameCRC(crc, buffer[index]);
+  }
+  if (crc != (buffer[length - 2] | (buffer[length - 1] << 8))) {
+    stats.crcErrors++;
+    if (!quiet) {
+      fprintf(stderr, "CRC error, frame skipped.\n");
+    }
+    return -1;
+  }
+  uint16_t sequence = buffer[3] | (buffer[4] << 8);
+  uint16_t mask = buffer[5] | (buffer[6] << 8);
+  uint8_t probes = buffer[7];
+  std::vector<std::string> names = columnNames(mask, probes);
+  if (names.size() + ((mask & LFM_BAND) ? 1 : 0) != count) {
+    stats.badFrames++;
+    if (!quiet) {
+      fprintf(stderr, "Field count %u does not match the sensor mask 0x%04X, frame skipped.\n", count, mask);
+    }
+    return -1;
+  }
+  //A sequence back to 0, that has not just wrapped, is the sketch starting again.
+  bool restarted = started && (sequence == 0) && (lastSequence != 0xFFFF);
+  if (restarted) {
+    stats.restarts++;
+    if (!quiet) {
+      fprintf(stderr, "Sketch restarted after sequence %u.\n", lastSequence);
+    }
+  }
+  //Write the header for a new column set. The sketch always ends the header with the temperature band.
+  if (!started || (mask != lastMask) || (probes != lastProbes)) {
+    for (size_t index = 0; index < names.size(); index++) {
+      fputs(names[index].c_str(), stdout);
+      fputs(delimiter.c_str(), stdout);
+    }
+    fputs("Temperature-Band\n", stdout);
+  }
+  else if (!restarted && ((uint16_t)(sequence - lastSequence) != 1)) {
+    unsigned gap = (uint16_t)(sequence - lastSequence - 1);
+    stats.dropped += gap;
+    if (!quiet) {
+      fprintf(stderr, "%u frame(s) dropped before sequence %u.\n", gap, sequence);
+    }
+  }
+  started = true;
+  lastSequence = sequence;
+  lastMask = mask;
+  lastProbes = probes;
+  //Write the fields, each followed by the delimiter, except the temperature band.
+  for (unsigned index = 0; index < count; index++) {
+    int16_t value = (int16_t)(buffer[LOFTFRAME_HEADER + (2 * index)] | (buffer[LOFTFRAME_HEADER + (2 * index) + 1] << 8));
+    fputs(formatField(value, loftFrameWholeField(mask, count, index)).c_str(), stdout);
+    if (!((mask & LFM_BAND) && (index == count - 1u))) {
+      fputs(delimiter.c_str(), stdout);
+    }
+  }
+  fputs("\n", stdout);
+  fflush(stdout);
+  stats.frames++;
+  return length;
+}
+
+//Try to pass through a command reply line at the start of buffer. Returns the line length, 0 if more bytes are needed, or
+//  -1 if it is not a reply line.
+static long passReply(const uint8_t *buffer, size_t available) {
+  if (buffer[0] != '#') {
+    return -1;
+  }
+  for (size_t index = 1; (index < available) && (index < MAXREPLY); index++) {
+    if (buffer[index] == '\n') {
+      size_t end = ((index > 1) && (buffer[index - 1] == '\r')) ? index - 1 : index;
+      fwrite(buffer, 1, end, stdout);
+      fputs("\n", stdout);
+      fflush(stdout);
+      return index + 1;
+    }
+    if (((buffer[index] < ' ') || (buffer[index] > '~')) && (buffer[index] != '\r')) {
+      return -1;
+    }
+  }
+  return (available < MAXREPLY) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+  FILE *input = stdin;
+  for (int arg = 1; arg < argc; arg++) {
+    if ((strcmp(argv[arg], "-d") == 0) && (arg + 1 < argc)) {
+      delimiter = argv[++arg];
+    }
+    else if (strcmp(argv[arg], "-q") == 0) {
+      quiet = true;
+    }
+    else if (argv[arg][0] == '-') {
+      fprintf(stderr, "Usage: %s [-d delimiter] [-q] [capture.bin]\n", argv[0]);
+      return 1;
+    }
+    else {
+      input = fopen(argv[arg], "rb");
+      if (input == NULL) {
+        perror(argv[arg]);
+        return 1;
+      }
+    }
+  }
+  decoderStats stats = {0, 0, 0, 0, 0, 0};
+  std::vector<uint8_t> buffer;
+  uint8_t chunk[4096];
+  size_t got;
+  bool done = false;
+  while (!done) {
+    got = fread(chunk, 1, sizeof(chunk), input);
+    done = (got == 0);
+    buffer.insert(buffer.end(), chunk, chunk + got);
+    size_t position = 0;
+    while (position < buffer.size()) {
+      long length = decodeFrame(&buffer[position], buffer.size() - position, stats);
+      if (length < 0) {
+        length = passReply(&buffer[position], buffer.size() - position);
+      }
+      if (length > 0) {
+        position += length;
+      }
+      else if ((length < 0) || done) {
+        position++;
+        stats.skippedBytes++;
+      }
+      else {
+        break;
+      }
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + position);
+  }
+  fprintf(stderr, "Frames: %lu, dropped: %lu, restarts: %lu, CRC errors: %lu, bad frames: %lu, bytes skipped: %lu\n",
+          stats.frames, stats.dropped, stats.restarts, stats.crcErrors, stats.badFrames, stats.skippedBytes);
+  return 0;
+}
+
+//EOF
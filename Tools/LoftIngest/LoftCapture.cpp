@@ -0,0 +1,512 @@
+/*
+Loft Environment Monitor Capture Reader.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+*/
+
+#include "LoftCapture.h"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#ifdef _WIN32
+  #include <fstream>
+  #include <sstream>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+//A header, as found by a chunk.
+struct chunkHeader {
+  size_t row;                           //The chunk's first row after it.
+  double time;
+  std::vector<std::string> names;
+  std::vector<int> fields;              //The table columns, once matched up.
+};
+
+//A part of a capture, parsed by one thread.
+struct captureChunk {
+  const char *begin;
+  const char *end;
+  std::vector<chunkHeader> headers;
+  std::vector<double> times;
+  std::vector<float> values;            //Every row's values, one after another...
+  std::vector<size_t> ends;             //...and where each row ends.
+  std::vector<int> inherited;           //The columns of the rows before its first header, from an earlier chunk.
+  size_t dropped;                       //Rows before the first header of all, so not copied.
+  std::vector<bool> mismatched;         //Rows with more or fewer values than their header, so not copied either.
+  size_t firstRow;                      //The table row its first copied row goes to.
+  captureStats stats;
+};
+
+static const double powersOf10[19] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+                                      1e15, 1e16, 1e17, 1e18};
+
+double captureTimestamp(const char *text, size_t size, size_t &length) {
+  //"YYYY-MM-DD HH:MM:SS", D a digit.
+  static const char pattern[] = "DDDD-DD-DD DD:DD:DD";
+  length = 0;
+  if (size < sizeof(pattern) - 1) {
+    return NAN;
+  }
+  for (size_t index = 0; index < sizeof(pattern) - 1; index++) {
+    if ((pattern[index] == 'D') ? ((unsigned)(text[index] - '0') > 9) : (text[index] != pattern[index])) {
+      return NAN;
+    }
+  }
+  #define TWO_DIGITS(at) ((text[at] - '0') * 10 + (text[(at) + 1] - '0'))
+  int year = TWO_DIGITS(0) * 100 + TWO_DIGITS(2);
+  int month = TWO_DIGITS(5);
+  int day = TWO_DIGITS(8);
+  int hour = TWO_DIGITS(11);
+  int minute = TWO_DIGITS(14);
+  int second = TWO_DIGITS(17);
+  #undef TWO_DIGITS
+  if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour > 23) || (minute > 59) || (second > 60)) {
+    return NAN;
+  }
+  length = sizeof(pattern) - 1;
+  double fraction = 0.0;
+  if ((length < size) && (text[length] == '.')) {
+    double scale = 0.1;
+    for (length++; (length < size) && ((unsigned)(text[length] - '0') <= 9); length++) {
+      fraction += (text[length] - '0') * scale;
+      scale /= 10.0;
+    }
+  }
+  //Days from the civil date, http://howardhinnant.github.io/date_algorithms.html
+  year -= (month <= 2) ? 1 : 0;
+  long era = year / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+  return days * 86400.0 + hour * 3600.0 + minute * 60.0 + second + fraction;
+}
+
+//The civil date from the days, http://howardhinnant.github.io/date_algorithms.html
+std::string formatTimestamp(double time) {
+  long seconds = (long)floor(time);
+  long days = (seconds >= 0) ? seconds / 86400 : (seconds - 86399) / 86400;
+  long secondOfDay = seconds - days * 86400;
+  days += 719468;
+  long era = (days >= 0 ? days : days - 146096) / 146097;
+  long dayOfEra = days - era * 146097;
+  long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  long monthIndex = (5 * dayOfYear + 2) / 153;
+  long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  long month = monthIndex + ((monthIndex < 10) ? 3 : -9);
+  long year = yearOfEra + era * 400 + ((month <= 2) ? 1 : 0);
+  char text[80];
+  snprintf(text, sizeof(text), "%04ld-%02ld-%02ld %02ld:%02ld:%02ld", year, month, day,
+           secondOfDay / 3600, (secondOfDay / 60) % 60, secondOfDay % 60);
+  return text;
+}
+
+//Read the usual value, digits with a decimal point, from next, up to the first character that is not part of one. The
+//  digits are read as an integer, then scaled, which is exact for the sketch's two decimal places.
+static inline bool scanDecimal(const char *&next, const char *end, float &value) {
+  bool negative = false;
+  if ((next < end) && ((*next == '-') || (*next == '+'))) {
+    negative = (*next == '-');
+    next++;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int decimals = 0;
+  bool point = false;
+  for (; next < end; next++) {
+    unsigned digit = (unsigned)(*next - '0');
+    if (digit <= 9) {
+      mantissa = mantissa * 10 + digit;
+      digits++;
+      decimals += point ? 1 : 0;
+    }
+    else if ((*next == '.') && !point) {
+      point = true;
+    }
+    else {
+      break;
+    }
+  }
+  if ((digits == 0) || (digits > 18)) {
+    return false;
+  }
+  double scaled = (double)mantissa / powersOf10[decimals];
+  value = (float)(negative ? -scaled : scaled);
+  return true;
+}
+
+float captureValue(const char *text, size_t size) {
+  const char *next = text;
+  float value;
+  if (scanDecimal(next, text + size, value) && (next == text + size)) {
+    return value;
+  }
+  //An exponent, too many digits, "nan", or not a number at all.
+  char buffer[64];
+  if ((size == 0) || (size >= sizeof(buffer))) {
+    return NAN;
+  }
+  memcpy(buffer, text, size);
+  buffer[size] = '\0';
+  char *stop;
+  double number = strtod(buffer, &stop);
+  while ((*stop == ' ') || (*stop == '\t')) {
+    stop++;
+  }
+  return ((stop == buffer) || (*stop != '\0')) ? NAN : (float)number;
+}
+
+int captureTable::column(const std::string &name) const {
+  for (size_t index = 0; index < names.size(); index++) {
+    if (names[index] == name) {
+      return (int)index;
+    }
+  }
+  return -1;
+}
+
+size_t captureTable::rows() const {
+  return times.size();
+}
+
+void captureTable::clear() {
+  names.clear();
+  columns.clear();
+  times.clear();
+  headers.clear();
+  fields.clear();
+}
+
+/*!
+ *  @brief  Instantiates a new captureReader class.
+ *  @param  delimiter
+ *          The sketch's DATADELIMITER, ',', '\t' or ' ', or 0 to find it from each capture's first line.
+ *  @param  threads
+ *          The most threads to parse a capture with, 0 for one per core.
+ */
+
+captureReader::captureReader(char delimiter, unsigned threads) {
+  _delimiter = delimiter;
+  _threads = (threads > 0) ? threads : std::thread::hardware_concurrency();
+  if (_threads == 0) {
+    _threads = 1;
+  }
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+const captureStats &captureReader::stats() const {
+  return _stats;
+}
+
+std::string captureReader::error() const {
+  return _error;
+}
+
+//The delimiter from the first data or header line, the first of ',', tab and space that it has.
+static char findDelimiter(const char *data, size_t size) {
+  const char *line = data;
+  const char *end = data + size;
+  while (line < end) {
+    const char *stop = (const char *)memchr(line, '\n', end - line);
+    stop = (stop == NULL) ? end : stop;
+    size_t length;
+    double time = captureTimestamp(line, stop - line, length);
+    const char *text = (!std::isnan(time) && (line + length < stop) && (line[length] == '\t')) ? line + length + 1 : line;
+    if ((text < stop) && (*text != '#') && (*text != '~') && (*text != '\r')) {
+      std::string body(text, stop);
+      return (body.find(',') != std::string::npos) ? ',' : ((body.find('\t') != std::string::npos) ? '\t' : ' ');
+    }
+    line = stop + 1;
+  }
+  return ',';
+}
+
+//A header line starts with a name, a letter, and not with "nan", "inf" or "ovf", the sketch's failed values.
+static bool isHeader(const char *text, const char *stop, char delimiter) {
+  if (!(((*text >= 'A') && (*text <= 'Z')) || ((*text >= 'a') && (*text <= 'z')))) {
+    return false;
+  }
+  const char *field = (const char *)memchr(text, delimiter, stop - text);
+  size_t length = ((field == NULL) ? stop : field) - text;
+  return !((length == 3) && ((strncmp(text, "nan", 3) == 0) || (strncmp(text, "inf", 3) == 0) ||
+                             (strncmp(text, "ovf", 3) == 0)));
+}
+
+//Parse a chunk's lines, into its headers and rows.
+static void parseChunk(captureChunk &chunk, char delimiter) {
+  const char *line = chunk.begin;
+  //A rough guess of the rows, from the size of the sample capture's lines, to save growing the vectors.
+  size_t guess = (chunk.end - chunk.begin) / 80;
+  chunk.times.reserve(guess);
+  chunk.ends.reserve(guess);
+  chunk.values.reserve(guess * 12);
+  while (line < chunk.end) {
+    const char *eol = (const char *)memchr(line, '\n', chunk.end - line);
+    eol = (eol == NULL) ? chunk.end : eol;
+    const char *stop = ((eol > line) && (eol[-1] == '\r')) ? eol - 1 : eol;
+    chunk.stats.lines++;
+    size_t length;
+    double time = captureTimestamp(line, stop - line, length);
+    const char *text = line;
+    if (!std::isnan(time) && (line + length < stop) && (line[length] == '\t')) {
+      text = line + length + 1;
+    }
+    else {
+      time = NAN;
+    }
+    if ((text == stop) || (*text == '#') || (*text == '~')) {
+      chunk.stats.skipped++;
+    }
+    else if (isHeader(text, stop, delimiter)) {
+      chunkHeader header;
+      header.row = chunk.times.size();
+      header.time = time;
+      while (true) {
+        const char *field = (const char *)memchr(text, delimiter, stop - text);
+        header.names.push_back(std::string(text, (field == NULL) ? stop : field));
+        if (field == NULL) {
+          break;
+        }
+        text = field + 1;
+      }
+      chunk.headers.push_back(header);
+      chunk.stats.headers++;
+    }
+    else {
+      while (true) {
+        //Read the usual value as the delimiter is looked for, and only hand anything else to captureValue().
+        const char *next = text;
+        float value;
+        if (!scanDecimal(next, stop, value) || ((next < stop) && (*next != delimiter))) {
+          next = (const char *)memchr(next, delimiter, stop - next);
+          next = (next == NULL) ? stop : next;
+          value = captureValue(text, next - text);
+        }
+        chunk.values.push_back(value);
+        if (next == stop) {
+          break;
+        }
+        text = next + 1;
+      }
+      chunk.ends.push_back(chunk.values.size());
+      chunk.times.push_back(time);
+      chunk.stats.untimed += std::isnan(time) ? 1 : 0;
+    }
+    line = eol + 1;
+  }
+}
+
+//Copy a chunk's rows into the table's columns, each row into its header's columns.
+static void copyChunk(captureChunk &chunk, captureTable &table) {
+  size_t header = 0;
+  const std::vector<int> *fields = &chunk.inherited;
+  size_t row = chunk.firstRow;
+  for (size_t index = chunk.dropped; index < chunk.times.size(); index++) {
+    while ((header < chunk.headers.size()) && (chunk.headers[header].row <= index)) {
+      fields = &chunk.headers[header++].fields;
+    }
+    if (chunk.mismatched[index]) {
+      continue;
+    }
+    size_t start = (index == 0) ? 0 : chunk.ends[index - 1];
+    for (size_t field = 0; field < fields->size(); field++) {
+      table.columns[(*fields)[field]][row] = chunk.values[start + field];
+    }
+    table.times[row++] = chunk.times[index];
+  }
+  //Free the chunk's copy.
+  std::vector<float>().swap(chunk.values);
+  std::vector<size_t>().swap(chunk.ends);
+  std::vector<bool>().swap(chunk.mismatched);
+}
+
+/*!
+ *  @brief  Parse a capture in memory, and add its rows to a table.
+ *  @param  data
+ *          The capture.
+ *  @param  size
+ *          Its size, bytes.
+ *  @param  table
+ *          The table. Its columns are added to when a header has new ones.
+ *  @return True, it cannot fail. Bad lines are counted in the stats.
+ */
+
+bool captureReader::parse(const char *data, size_t size, captureTable &table) {
+  char delimiter = (_delimiter != 0) ? _delimiter : findDelimiter(data, size);
+  //Split the capture into chunks, each ending at the end of a line.
+  size_t count = size / CAPTURE_MINCHUNK;
+  count = (count < 1) ? 1 : ((count > _threads) ? _threads : count);
+  std::vector<captureChunk> chunks(count);
+  const char *begin = data;
+  for (size_t index = 0; index < count; index++) {
+    const char *end = data + size * (index + 1) / count;
+    if (index == count - 1) {
+      end = data + size;
+    }
+    else if (end < begin) {
+      end = begin;
+    }
+    else {
+      const char *eol = (const char *)memchr(end, '\n', data + size - end);
+      end = (eol == NULL) ? data + size : eol + 1;
+    }
+    chunks[index].begin = begin;
+    chunks[index].end = end;
+    chunks[index].dropped = 0;
+    chunks[index].firstRow = 0;
+    memset(&chunks[index].stats, 0, sizeof(captureStats));
+    begin = end;
+  }
+  std::vector<std::thread> threads;
+  for (size_t index = 1; index < count; index++) {
+    threads.push_back(std::thread(parseChunk, std::ref(chunks[index]), delimiter));
+  }
+  parseChunk(chunks[0], delimiter);
+  for (size_t index = 0; index < threads.size(); index++) {
+    threads[index].join();
+  }
+  //Match the headers up, in order, with the table's columns, adding any new ones, and place each chunk's rows. A row
+  //  with more or fewer values than its header (a line cut short by a reset, or two run together) is dropped, as its
+  //  last value may be cut short too, and its values may not be in their columns.
+  size_t rows = table.rows();
+  for (size_t index = 0; index < count; index++) {
+    captureChunk &chunk = chunks[index];
+    chunk.inherited = table.fields;
+    if (table.fields.empty()) {
+      //Before the first header of all, the columns are not known.
+      chunk.dropped = chunk.headers.empty() ? chunk.times.size() : chunk.headers[0].row;
+      chunk.stats.orphans += chunk.dropped;
+    }
+    chunk.firstRow = rows;
+    chunk.mismatched.assign(chunk.times.size(), false);
+    size_t row = chunk.dropped;
+    for (size_t header = 0; header <= chunk.headers.size(); header++) {
+      //The rows before this header, or to the end of the chunk, under the one before it.
+      size_t end = (header < chunk.headers.size()) ? chunk.headers[header].row : chunk.times.size();
+      for (; row < end; row++) {
+        size_t values = chunk.ends[row] - ((row == 0) ? 0 : chunk.ends[row - 1]);
+        if (values == table.fields.size()) {
+          rows++;
+        }
+        else {
+          chunk.mismatched[row] = true;
+          chunk.stats.mismatched++;
+        }
+      }
+      if (header == chunk.headers.size()) {
+        break;
+      }
+      chunkHeader &found = chunk.headers[header];
+      for (size_t name = 0; name < found.names.size(); name++) {
+        int column = table.column(found.names[name]);
+        if (column < 0) {
+          column = table.names.size();
+          table.names.push_back(found.names[name]);
+          table.columns.push_back(std::vector<float>());
+        }
+        found.fields.push_back(column);
+      }
+      captureHeader start = {rows, found.time};
+      table.headers.push_back(start);
+      table.fields = found.fields;
+    }
+  }
+  table.times.resize(rows);
+  for (size_t column = 0; column < table.columns.size(); column++) {
+    table.columns[column].resize(rows, NAN);
+  }
+  threads.clear();
+  for (size_t index = 1; index < count; index++) {
+    threads.push_back(std::thread(copyChunk, std::ref(chunks[index]), std::ref(table)));
+  }
+  copyChunk(chunks[0], table);
+  for (size_t index = 0; index < threads.size(); index++) {
+    threads[index].join();
+  }
+  _stats.bytes += size;
+  for (size_t index = 0; index < count; index++) {
+    const captureStats &stats = chunks[index].stats;
+    _stats.lines += stats.lines;
+    _stats.rows += chunks[index].times.size() - chunks[index].dropped - stats.mismatched;
+    _stats.headers += stats.headers;
+    _stats.skipped += stats.skipped;
+    _stats.orphans += stats.orphans;
+    _stats.mismatched += stats.mismatched;
+    _stats.untimed += stats.untimed;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Read a capture file, and add its rows to a table.
+ *  @param  path
+ *          The file, or "-" for stdin.
+ *  @param  table
+ *          The table.
+ *  @return False if the file could not be read, see error().
+ */
+
+bool captureReader::read(const char *path, captureTable &table) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool success = true;
+  _error.clear();
+  if (strcmp(path, "-") == 0) {
+    std::string data;
+    char buffer[65536];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+      data.append(buffer, size);
+    }
+    parse(data.data(), data.size(), table);
+  }
+  else {
+#ifdef _WIN32
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+      _error = std::string(path) + ": cannot open";
+      return false;
+    }
+    std::ostringstream data;
+    data << input.rdbuf();
+    std::string text = data.str();
+    parse(text.data(), text.size(), table);
+#else
+    int file = open(path, O_RDONLY);
+    struct stat status;
+    if ((file < 0) || (fstat(file, &status) != 0)) {
+      _error = std::string(path) + ": " + strerror(errno);
+      if (file >= 0) {
+        close(file);
+      }
+      return false;
+    }
+    if (status.st_size > 0) {
+      void *data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+      if (data == MAP_FAILED) {
+        _error = std::string(path) + ": " + strerror(errno);
+        success = false;
+      }
+      else {
+        madvise(data, status.st_size, MADV_SEQUENTIAL);
+        parse((const char *)data, status.st_size, table);
+        munmap(data, status.st_size);
+      }
+    }
+    close(file);
+#endif
+  }
+  _stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return success;
+}
+
+//EOF
@@ -0,0 +1,105 @@
+/*
+Loft Environment Monitor Capture Reader.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Reads CoolTerm captures (e.g. LoftMon20210111-1.csv) into columns, fast enough for years of them - millions of rows.
+
+A capture line is a CoolTerm timestamp ("2021-01-11 12:45:58", with optional fractional seconds), a tab, and the
+  sketch's DATADELIMITER separated values, or a header line of the column names, sent by setup(). The sketch sends a
+  header every time it starts, so a capture can have more than one, after a reset or a new sketch, and the columns can
+  change from one to the next. The columns read are all those in any header, in the order they were first seen, and a
+  row only fills those in its own header, the rest are nan. The sketch's command replies ('#' lines), sparse lines ('~'
+  lines, PLOTSPARSE, expand those with Tools/LoftSparseExpander first) and blank lines are skipped, and so are the rows
+  before the first header, as their columns are not known, and the rows with more or fewer values than their header,
+  as they are cut short or run together. A line without a timestamp has a nan time.
+
+The file is memory mapped, and split into chunks, on line boundaries, that are parsed by separate threads. A chunk's
+  rows before its first header belong to the header before it, in an earlier chunk, so the headers are matched up
+  once all the chunks are parsed, and then the threads copy their rows into the columns. The timestamps and the values
+  are parsed by hand, not by sscanf() or strtod(): the timestamp at fixed positions, and a value, at most 18 digits
+  with a decimal point and no exponent, as an integer that is then scaled, which is exact for the sketch's two decimal
+  places. Anything else goes to strtod(), and a value that is not a number, e.g. "nan" from a failed sensor, is nan.
+
+CoolTerm can start a new capture file while the sketch runs on, so a capture without a header carries on with the
+  columns of the last header read into the same table.
+
+Usage:
+  captureReader reader;               //Auto detect the delimiter, and use a thread per core.
+  captureTable table;
+  if (reader.read("LoftMon20210111-1.csv", table)) {
+    int column = table.column("Temperature(DS18B20)");
+    for (size_t row = 0; row < table.rows(); row++) {
+      ... table.times[row], table.columns[column][row] ...
+    }
+  }
+*/
+
+#ifndef LOFTCAPTURE_H
+  #define LOFTCAPTURE_H
+
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <string>
+  #include <vector>
+
+  #define CAPTURE_MINCHUNK 1048576      //Smaller chunks are not worth a thread.
+
+  //Seconds since 1970 for a "YYYY-MM-DD HH:MM:SS" timestamp, nan if it is not one. The time is as written, CoolTerm's
+  //  local time, with no time zone. Fractional seconds, ".sss", are allowed. length is set to the timestamp's length.
+  double captureTimestamp(const char *text, size_t size, size_t &length);
+
+  //The time, seconds since 1970, as a "YYYY-MM-DD HH:MM:SS" timestamp, as CoolTerm writes them.
+  std::string formatTimestamp(double time);
+
+  //A value from text[0 .. size - 1], nan if it is not a number.
+  float captureValue(const char *text, size_t size);
+
+  //A header, where the sketch (re)started.
+  struct captureHeader {
+    size_t row;                         //The first row after it.
+    double time;
+  };
+
+  struct captureStats {
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t rows;                      //Data rows read into the columns.
+    uint64_t headers;
+    uint64_t skipped;                   //Command replies, sparse and blank lines.
+    uint64_t orphans;                   //Rows before the first header, dropped.
+    uint64_t mismatched;                //Rows with more or fewer values than their header, dropped.
+    uint64_t untimed;                   //Rows without a timestamp.
+    double seconds;                     //The real time taken to read them.
+  };
+
+  class captureTable {
+  public:
+    std::vector<std::string> names;     //The column names.
+    std::vector<std::vector<float> > columns;
+    std::vector<double> times;          //Seconds since 1970, as written, nan when a row had no timestamp.
+    std::vector<captureHeader> headers;
+    std::vector<int> fields;            //The last header's columns, in its order, for a capture that carries on.
+    int column(const std::string &name) const;  //-1 if there is no such column.
+    size_t rows() const;
+    void clear();
+  };
+
+  class captureReader {
+  public:
+    captureReader(char delimiter = 0, unsigned threads = 0);  //0 to auto detect the delimiter, and a thread per core.
+    bool read(const char *path, captureTable &table);         //Add a capture file's rows to the table.
+    bool parse(const char *data, size_t size, captureTable &table);
+    const captureStats &stats() const;                        //The totals over all the captures read.
+    std::string error() const;
+
+  private:
+    char _delimiter;
+    unsigned _threads;
+    captureStats _stats;
+    std::string _error;
+  };
+#endif
+
+//EOF
@@ -0,0 +1,162 @@
+/*
+Loft Environment Monitor Capture Ingest.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Reads any number of CoolTerm captures (e.g. LoftMon20210111-1.csv), in parallel, with the capture reader
+  (LoftCapture.h), and reports what they hold - the rows, the sketch restarts (the header lines), the time covered and
+  the count, min, mean and max of every column - and how fast they were read. A year of captures, millions of rows,
+  takes seconds, where LibreCalc gives up.
+
+With -o the rows are also written as one CSV, a single header of every column, with the time as the first column, for
+  other programs to import. A column a row did not have (its header did not) is left empty.
+
+Give the captures in time order, as a capture without a header, a new CoolTerm file while the sketch ran on, carries on
+  with the columns of the one before.
+
+Build (any C++11 compiler with threads):
+  g++ -std=c++11 -O2 -pthread -o LoftIngest Tools/LoftIngest/LoftIngest.cpp Tools/LoftIngest/LoftCapture.cpp
+
+Usage:
+  LoftIngest [-d delimiter] [-j threads] [-o output.csv] [capture.csv...]    (reads stdin when no capture is given)
+    -d  The column delimiter, ",", "tab" or "space" (the sketch's DATADELIMITER), by default found from each capture.
+    -j  The most threads to use, default one per core.
+    -o  Write the rows as one CSV.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "LoftCapture.h"
+
+static bool writeTable(const char *path, const captureTable &table) {
+  FILE *output = fopen(path, "w");
+  if (output == NULL) {
+    perror(path);
+    return false;
+  }
+  fprintf(output, "Time");
+  for (size_t column = 0; column < table.names.size(); column++) {
+    fprintf(output, ",%s", table.names[column].c_str());
+  }
+  fprintf(output, "\n");
+  for (size_t row = 0; row < table.rows(); row++) {
+    if (!std::isnan(table.times[row])) {
+      fputs(formatTimestamp(table.times[row]).c_str(), output);
+    }
+    for (size_t column = 0; column < table.columns.size(); column++) {
+      float value = table.columns[column][row];
+      if (std::isnan(value)) {
+        fputc(',', output);
+      }
+      else {
+        fprintf(output, ",%.2f", value);
+      }
+    }
+    fputc('\n', output);
+  }
+  if (fclose(output) != 0) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+static void report(const captureTable &table, const captureReader &reader, unsigned files) {
+  const captureStats &stats = reader.stats();
+  printf("Captures: %u, %.1f MB, %llu lines, read in %.3fs (%.0f MB/s, %.0f rows/s)\n", files, stats.bytes / 1e6,
+         (unsigned long long)stats.lines, stats.seconds, (stats.seconds > 0.0) ? stats.bytes / 1e6 / stats.seconds : 0.0,
+         (stats.seconds > 0.0) ? stats.rows / stats.seconds : 0.0);
+  printf("Rows: %llu, headers (sketch starts): %llu, skipped lines: %llu, rows before a header: %llu, rows not matching their header: %llu, rows without a timestamp: %llu\n",
+         (unsigned long long)stats.rows, (unsigned long long)stats.headers, (unsigned long long)stats.skipped,
+         (unsigned long long)stats.orphans, (unsigned long long)stats.mismatched, (unsigned long long)stats.untimed);
+  double first = NAN;
+  double last = NAN;
+  for (size_t row = 0; row < table.rows(); row++) {
+    double time = table.times[row];
+    if (!std::isnan(time)) {
+      first = (std::isnan(first) || (time < first)) ? time : first;
+      last = (std::isnan(last) || (time > last)) ? time : last;
+    }
+  }
+  if (!std::isnan(first)) {
+    printf("From %s to %s, %.1f days\n", formatTimestamp(first).c_str(), formatTimestamp(last).c_str(),
+           (last - first) / 86400.0);
+  }
+  if (table.names.empty()) {
+    return;
+  }
+  printf("\n%-26s %10s %10s %10s %10s\n", "Column", "Count", "Min", "Mean", "Max");
+  for (size_t column = 0; column < table.columns.size(); column++) {
+    const std::vector<float> &values = table.columns[column];
+    unsigned long count = 0;
+    double total = 0.0;
+    float low = NAN;
+    float high = NAN;
+    for (size_t row = 0; row < values.size(); row++) {
+      float value = values[row];
+      if (!std::isnan(value)) {
+        low = ((count == 0) || (value < low)) ? value : low;
+        high = ((count == 0) || (value > high)) ? value : high;
+        total += value;
+        count++;
+      }
+    }
+    printf("%-26s %10lu %10.2f %10.2f %10.2f\n", table.names[column].c_str(), count, low,
+           (count > 0) ? total / count : NAN, high);
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-d delimiter] [-j threads] [-o output.csv] [capture.csv...]\n", name);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  char delimiter = 0;
+  unsigned threads = 0;
+  const char *outputPath = NULL;
+  std::vector<const char *> paths;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string option = argv[arg];
+    bool hasValue = (arg + 1 < argc);
+    if ((option == "-d") && hasValue) {
+      std::string text = argv[++arg];
+      delimiter = (text == "tab") ? '\t' : ((text == "space") ? ' ' : text[0]);
+    }
+    else if ((option == "-j") && hasValue) {
+      threads = atoi(argv[++arg]);
+    }
+    else if ((option == "-o") && hasValue) {
+      outputPath = argv[++arg];
+    }
+    else if ((option.size() > 1) && (option[0] == '-')) {
+      usage(argv[0]);
+    }
+    else {
+      paths.push_back(argv[arg]);
+    }
+  }
+  if (paths.empty()) {
+    paths.push_back("-");
+  }
+  captureReader reader(delimiter, threads);
+  captureTable table;
+  for (size_t index = 0; index < paths.size(); index++) {
+    if (!reader.read(paths[index], table)) {
+      fprintf(stderr, "%s\n", reader.error().c_str());
+      return 1;
+    }
+  }
+  report(table, reader, paths.size());
+  if ((outputPath != NULL) && !writeTable(outputPath, table)) {
+    return 1;
+  }
+  return 0;
+}
+
+//EOF
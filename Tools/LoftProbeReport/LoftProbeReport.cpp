@@ -0,0 +1,232 @@
+/*
+Loft Environment Monitor Latency Report.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Summarises the sketch's latency probe lines (USE_PROBES) from CoolTerm captures, or decoded binary captures - how long
+  each sensor read, and the data output, takes, over the whole capture.
+
+The sketch sends one probe's times after a data line, in turn, each covering the runs since it was last sent:
+  #P,<probe>,<count>,<min us>,<mean us>,<max us>,<bucket counts...>
+This tool adds up the lines for each probe - the runs, the overall min and max, the mean weighted by the runs, and the
+  histogram buckets (see LoftProbe.h) - and estimates the median, 95th and 99th percentiles from the histogram, as the
+  upper limit of the bucket they fall in, or the max if that is less. A bucket count stops at 255 in the sketch, so a
+  probe that ran more often than that between its lines has its percentiles marked "*", as only roughly right.
+
+All the other lines, and any CoolTerm timestamps, are ignored. The report, one row per probe in the order they were
+  first seen, is written to stdout, with the histograms, as % of the runs, when asked for.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftProbeReport Tools/LoftProbeReport/LoftProbeReport.cpp
+
+Usage:
+  LoftProbeReport [-h] [capture.csv...]    (reads stdin when no capture is given)
+    -h  Show each probe's histogram too.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../Loft-Monitor/LoftProbe.h"
+
+struct probeTotals {
+  std::string name;
+  unsigned long records;              //#P lines.
+  unsigned long count;                //Runs.
+  unsigned long low;                  //us.
+  unsigned long high;
+  double total;                       //The sum of the times, from the means, us.
+  unsigned long buckets[LOFTPROBE_BUCKETS];
+  bool saturated;                     //A bucket count reached 255, so the histogram is short of some runs.
+};
+
+struct reportStats {
+  unsigned long lines;
+  unsigned long records;
+  unsigned long bad;                  //#P lines that could not be read.
+};
+
+static std::vector<std::string> splitFields(const std::string &line, const std::string &separator) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = line.find(separator, start);
+    fields.push_back(line.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + separator.size();
+  }
+  return fields;
+}
+
+static bool parseNumber(const std::string &text, unsigned long &number) {
+  char *end;
+  number = strtoul(text.c_str(), &end, 10);
+  return !text.empty() && (*end == '\0');
+}
+
+static probeTotals &findProbe(std::vector<probeTotals> &probes, const std::string &name) {
+  for (size_t index = 0; index < probes.size(); index++) {
+    if (probes[index].name == name) {
+      return probes[index];
+    }
+  }
+  probeTotals probe;
+  probe.name = name;
+  probe.records = 0;
+  probe.count = 0;
+  probe.low = 0;
+  probe.high = 0;
+  probe.total = 0.0;
+  for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+    probe.buckets[bucket] = 0;
+  }
+  probe.saturated = false;
+  probes.push_back(probe);
+  return probes.back();
+}
+
+static void readCapture(FILE *input, std::vector<probeTotals> &probes, reportStats &stats) {
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), input) != NULL) {
+    std::string line = buffer;
+    while (!line.empty() && ((line[line.size() - 1] == '\n') || (line[line.size() - 1] == '\r'))) {
+      line.erase(line.size() - 1);
+    }
+    stats.lines++;
+    //Skip a CoolTerm timestamp.
+    size_t tab = line.find('\t');
+    if ((line.compare(0, 3, "#P,") != 0) && (tab != std::string::npos)) {
+      line = line.substr(tab + 1);
+    }
+    if (line.compare(0, 3, "#P,") != 0) {
+      continue;
+    }
+    //#P,<probe>,<count>,<min us>,<mean us>,<max us>,<bucket counts...>
+    std::vector<std::string> fields = splitFields(line, ",");
+    unsigned long values[4 + LOFTPROBE_BUCKETS];
+    bool valid = (fields.size() == 6 + LOFTPROBE_BUCKETS) && !fields[1].empty();
+    for (size_t index = 2; valid && (index < fields.size()); index++) {
+      valid = parseNumber(fields[index], values[index - 2]);
+    }
+    if (!valid || (values[0] == 0)) {
+      stats.bad++;
+      continue;
+    }
+    probeTotals &probe = findProbe(probes, fields[1]);
+    if ((probe.count == 0) || (values[1] < probe.low)) {
+      probe.low = values[1];
+    }
+    if (values[3] > probe.high) {
+      probe.high = values[3];
+    }
+    probe.total += (double)values[2] * values[0];
+    probe.count += values[0];
+    for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+      probe.buckets[bucket] += values[4 + bucket];
+      probe.saturated = probe.saturated || (values[4 + bucket] >= 255);
+    }
+    probe.records++;
+    stats.records++;
+  }
+}
+
+//A time, us, as text, in us or ms.
+static std::string formatTime(double time) {
+  char text[32];
+  if (time < 1000.0) {
+    snprintf(text, sizeof(text), "%.0fus", time);
+  }
+  else {
+    snprintf(text, sizeof(text), "%.1fms", time / 1000.0);
+  }
+  return text;
+}
+
+//The upper limit of the bucket that holds the fraction of the runs, or the max if that is less.
+static std::string percentile(const probeTotals &probe, double fraction) {
+  unsigned long runs = 0;
+  for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+    runs += probe.buckets[bucket];
+  }
+  unsigned long sum = 0;
+  int bucket = 0;
+  for (; bucket < LOFTPROBE_BUCKETS - 1; bucket++) {
+    sum += probe.buckets[bucket];
+    if (sum >= fraction * runs) {
+      break;
+    }
+  }
+  uint32_t limit = loftProbeLimit(bucket);
+  std::string text = ((limit == 0) || (probe.high < limit)) ? formatTime(probe.high) : "<" + formatTime(limit);
+  return text + (probe.saturated ? "*" : "");
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<probeTotals> probes;
+  reportStats stats = {0, 0, 0};
+  bool histograms = false;
+  bool readAny = false;
+  for (int arg = 1; arg < argc; arg++) {
+    if (strcmp(argv[arg], "-h") == 0) {
+      histograms = true;
+    }
+    else if (argv[arg][0] == '-') {
+      fprintf(stderr, "Usage: %s [-h] [capture.csv...]\n", argv[0]);
+      return 1;
+    }
+    else {
+      FILE *input = fopen(argv[arg], "r");
+      if (input == NULL) {
+        perror(argv[arg]);
+        return 1;
+      }
+      readCapture(input, probes, stats);
+      fclose(input);
+      readAny = true;
+    }
+  }
+  if (!readAny) {
+    readCapture(stdin, probes, stats);
+  }
+  printf("Lines: %lu, probe lines: %lu, unreadable: %lu\n\n", stats.lines, stats.records, stats.bad);
+  if (probes.empty()) {
+    printf("No probe lines, is USE_PROBES enabled?\n");
+    return 0;
+  }
+  printf("%-12s %8s %10s %10s %10s %10s %10s %10s %10s\n", "Probe", "Lines", "Runs", "Min", "Mean", "Median", "95%", "99%", "Max");
+  for (size_t index = 0; index < probes.size(); index++) {
+    const probeTotals &probe = probes[index];
+    printf("%-12s %8lu %10lu %10s %10s %10s %10s %10s %10s\n", probe.name.c_str(), probe.records, probe.count,
+           formatTime(probe.low).c_str(), formatTime(probe.total / probe.count).c_str(), percentile(probe, 0.50).c_str(),
+           percentile(probe, 0.95).c_str(), percentile(probe, 0.99).c_str(), formatTime(probe.high).c_str());
+  }
+  if (histograms) {
+    printf("\n%-12s", "Histogram");
+    for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+      uint32_t limit = loftProbeLimit(bucket);
+      std::string label = (limit > 0) ? "<" + formatTime(limit) : ">=" + formatTime(loftProbeLimit(bucket - 1));
+      printf(" %8s", label.c_str());
+    }
+    printf("\n");
+    for (size_t index = 0; index < probes.size(); index++) {
+      const probeTotals &probe = probes[index];
+      unsigned long runs = 0;
+      for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+        runs += probe.buckets[bucket];
+      }
+      printf("%-12s", probe.name.c_str());
+      for (int bucket = 0; bucket < LOFTPROBE_BUCKETS; bucket++) {
+        printf(" %7.1f%%", (runs > 0) ? 100.0 * probe.buckets[bucket] / runs : 0.0);
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
+
+//EOF
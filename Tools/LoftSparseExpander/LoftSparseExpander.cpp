@@ -0,0 +1,162 @@
+/*
+Loft Environment Monitor Sparse Capture Expander.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Turns a capture of the sketch's sparse lines (PLOTSPARSE) back into the full CSV lines that the sketch sends with just
+  PLOTDATA enabled, so it can be analysed, replayed or backfilled as usual.
+
+With PLOTSPARSE the sketch sends a full CSV line (a keyframe) first, and then every SPARSE_KEYFRAME data outputs. In
+  between it sends "~" lines, of just the columns that have moved more than their deadband since they were last sent,
+  as <column>:<value> pairs, e.g. "~10:19.94<delimiter>11:741" (columns counted from 0), and nothing when nothing has
+  moved. Each "~" line is expanded to a full line, from the last full line, with the sent columns changed. So every
+  column in the expanded capture is within its deadband of the reading, and there is a line for every line sent, but
+  not for the outputs when nothing moved.
+
+CoolTerm timestamps ("2021-01-11 12:45:58<tab>" before each line), and each line's ending (CR LF from the sketch) are kept. The header, keyframes and any other lines
+  are passed through as they are. "~" lines before the first keyframe, or with a column that is not in it, cannot be
+  expanded, and are skipped. A report, with the bytes saved, is written to stderr.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftSparseExpander LoftSparseExpander.cpp
+
+Usage:
+  LoftSparseExpander [-d delimiter] [capture.csv...]    (reads stdin when no capture is given)
+    -d  The column delimiter, default "," (the sketch's DATADELIMITER).
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct expanderStats {
+  unsigned long lines;
+  unsigned long keyframes;
+  unsigned long expanded;
+  unsigned long skipped;
+  unsigned long bytesIn;
+  unsigned long bytesOut;
+};
+
+static std::string delimiter = ",";
+
+static std::vector<std::string> splitFields(const std::string &line, const std::string &separator) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t end = line.find(separator, start);
+    fields.push_back(line.substr(start, (end == std::string::npos) ? std::string::npos : end - start));
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + separator.size();
+  }
+  return fields;
+}
+
+static void writeLine(const std::string &line, const std::string &ending, expanderStats &stats) {
+  fputs(line.c_str(), stdout);
+  fputs(ending.c_str(), stdout);
+  stats.bytesOut += line.size() + ending.size();
+}
+
+static void expandCapture(FILE *input, expanderStats &stats) {
+  std::vector<std::string> columns;     //The last full line, expanded or sent.
+  char buffer[1024];
+  while (fgets(buffer, sizeof(buffer), input) != NULL) {
+    std::string line = buffer;
+    size_t length = line.size();
+    while ((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r'))) {
+      length--;
+    }
+    std::string ending = line.substr(length);
+    line.erase(length);
+    stats.bytesIn += line.size() + ending.size();
+    stats.lines++;
+    //Split off a CoolTerm timestamp.
+    std::string timestamp;
+    size_t tab = line.find('\t');
+    int year, month, day, hour, minute, second;
+    if ((tab != std::string::npos) && (sscanf(line.c_str(), "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) == 6)) {
+      timestamp = line.substr(0, tab + 1);
+      line = line.substr(tab + 1);
+    }
+    if (line.empty() || (line[0] != '~')) {
+      //A keyframe (it starts with a number), or the header, or anything else.
+      char *end;
+      strtod(line.c_str(), &end);
+      if (!line.empty() && (end != line.c_str())) {
+        columns = splitFields(line, delimiter);
+        stats.keyframes++;
+      }
+      writeLine(timestamp + line, ending, stats);
+      continue;
+    }
+    bool valid = !columns.empty();
+    std::vector<std::string> expanded = columns;
+    if (line.size() > 1) {
+      std::vector<std::string> pairs = splitFields(line.substr(1), delimiter);
+      for (size_t index = 0; valid && (index < pairs.size()); index++) {
+        size_t colon = pairs[index].find(':');
+        char *end;
+        unsigned long column = strtoul(pairs[index].c_str(), &end, 10);
+        if ((colon == std::string::npos) || (end != pairs[index].c_str() + colon) || (column >= expanded.size())) {
+          valid = false;
+        }
+        else {
+          expanded[column] = pairs[index].substr(colon + 1);
+        }
+      }
+    }
+    if (!valid) {
+      stats.skipped++;
+      continue;
+    }
+    columns = expanded;
+    std::string full;
+    for (size_t index = 0; index < columns.size(); index++) {
+      full += columns[index];
+      if (index + 1 < columns.size()) {
+        full += delimiter;
+      }
+    }
+    writeLine(timestamp + full, ending, stats);
+    stats.expanded++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  expanderStats stats = {0, 0, 0, 0, 0, 0};
+  bool readAny = false;
+  for (int arg = 1; arg < argc; arg++) {
+    if ((strcmp(argv[arg], "-d") == 0) && (arg + 1 < argc)) {
+      delimiter = argv[++arg];
+    }
+    else if (argv[arg][0] == '-') {
+      fprintf(stderr, "Usage: %s [-d delimiter] [capture.csv...]\n", argv[0]);
+      return 1;
+    }
+    else {
+      FILE *input = fopen(argv[arg], "r");
+      if (input == NULL) {
+        perror(argv[arg]);
+        return 1;
+      }
+      expandCapture(input, stats);
+      fclose(input);
+      readAny = true;
+    }
+  }
+  if (!readAny) {
+    expandCapture(stdin, stats);
+  }
+  fprintf(stderr, "Lines: %lu, keyframes: %lu, expanded: %lu, skipped: %lu\n", stats.lines, stats.keyframes, stats.expanded, stats.skipped);
+  fprintf(stderr, "Bytes: %lu sparse, %lu expanded (%.1f x)\n", stats.bytesIn, stats.bytesOut,
+          (stats.bytesIn > 0) ? (double)stats.bytesOut / stats.bytesIn : 0.0);
+  return 0;
+}
+
+//EOF
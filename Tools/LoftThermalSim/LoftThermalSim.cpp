@@ -0,0 +1,278 @@
+/*
+Loft Environment Monitor Fan Controller Thermal Simulation.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+Licence: GPLv3
+
+Runs the sketch's fan controller (Loft-Monitor/LoftControl.cpp, the same code, compiled for the PC) against a simple
+  thermal model of a loft, so the fan curve, PID and feed-forward settings can be compared without any hardware.
+
+The loft model has two heat stores, stepped every 100 ms:
+  Roof      - the tiles and timbers. Heated by the sun, and loses heat to the outside and to the loft air.
+  Loft air  - the air and contents. Heated by the roof, and by the sun through the roof lights, and loses heat to
+              the outside by leakage and by the fan, whose air flow is proportional to its duty.
+  The temperature sensor lags the loft air, and its cached reading is refreshed every few seconds, with noise, as
+  the sketch's sensor tasks do. The controller only sees the cached reading, on its own period.
+
+Scenarios:
+  step - A cloud clears, the sun comes out at full strength 10 minutes in, and stays out for 3 hours.
+  day  - 24 hours from midnight, a sunny day with the outside temperature following the sun.
+
+For each controller set up the report gives:
+  Fan on   - the latency, minutes from the start of the heating (step) or sunrise (day) to the fan first starting.
+  Peak     - the highest loft air temperature, deg C.
+  Over     - the overshoot, how far the peak was above the setpoint (deg C).
+  Above    - minutes the loft air was more than 1 deg C above the setpoint.
+  Settle   - step only, minutes from the step until the air stays within 0.5 deg C of its final temperature.
+  Duty     - the mean fan duty, %, a measure of the fan energy used.
+  Starts   - the number of times the fan started.
+
+Build (any C++11 compiler):
+  g++ -std=c++11 -O2 -o LoftThermalSim LoftThermalSim.cpp ../../Loft-Monitor/LoftControl.cpp
+
+Usage:
+  LoftThermalSim [-s step|day] [-t setpoint] [-p period] [-trace name]
+    -s      The scenario, default step.
+    -t      The setpoint, deg C, for the PID set ups and the Over and Above figures, default 30 (FAN_SETPOINT).
+    -p      The fast controller period, ms, default 1000 (FAN_PERIOD).
+    -trace  Write a CSV trace of one set up (the names in the report) to stdout, every 10 seconds, instead of the report.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../../Loft-Monitor/LoftControl.h"
+
+#define SIM_STEP 0.1                  //Model time step, seconds.
+#define SIM_SENSORPERIOD 5.0          //The cached sensor reading refresh, seconds.
+#define SIM_SENSORLAG 20.0            //The sensor time constant, seconds.
+#define SIM_SENSORNOISE 0.05          //The sensor noise, deg C (standard deviation).
+#define SIM_SETTLEBAND 0.5            //deg C.
+
+//The loft model. Capacities in J/K, conductances in W/K, power in W.
+struct loftModel {
+  double roofCapacity;
+  double airCapacity;
+  double roofToOutside;
+  double roofToAir;
+  double airLeakage;
+  double fanFlow;                     //At 100% duty, W/K (air density x specific heat x flow, 1.2 x 1005 x 0.3 m3/s).
+  double sunPower;                    //Peak absorbed solar power.
+  double sunToAir;                    //The share of the solar power that heats the air directly, through the roof lights.
+};
+
+static const loftModel loft = {2.0e6, 1.5e5, 150.0, 400.0, 30.0, 362.0, 6000.0, 0.3};
+
+//The sketch's defaults, see the fan controller defines in Loft-Monitor.ino.
+static const fanCurvePoint fanCurve[] = {
+  {25.0, 0},
+  {30.0, 30},
+  {40.0, 70},
+  {45.0, 100}
+};
+
+struct controllerSetup {
+  const char *name;
+  bool pid;
+  float feedForward;                  //Duty % per deg C/min.
+  unsigned long period;               //ms, 0 for the fast period.
+};
+
+static const controllerSetup setups[] = {
+  {"none", false, 0.0, 0},            //No fan.
+  {"curve-15s", false, 0.0, 15000},   //The fan curve, updated at the data output cadence.
+  {"curve", false, 0.0, 0},
+  {"curve-ff", false, 10.0, 0},
+  {"pid", true, 0.0, 0},
+  {"pid-ff", true, 10.0, 0}
+};
+
+struct runResult {
+  double fanOnLatency;                //Minutes, negative if the fan never started.
+  double peak;
+  double aboveMinutes;
+  double settleMinutes;               //Negative if not settled.
+  double meanDuty;
+  unsigned starts;
+};
+
+static std::string scenario = "step";
+static float setpoint = 30.0;
+static unsigned long fastPeriod = 1000;
+
+//The outside temperature and the solar power at a time, seconds.
+static void weather(double time, double &outside, double &sun) {
+  if (scenario == "day") {
+    double hour = time / 3600.0;
+    double daylight = (hour - 6.0) / 14.0;                        //Sunrise at 6:00, sunset at 20:00.
+    sun = ((daylight > 0.0) && (daylight < 1.0)) ? loft.sunPower * sin(M_PI * daylight) : 0.0;
+    outside = 16.0 - 6.0 * cos(2.0 * M_PI * (hour - 3.0) / 24.0); //10 deg C at 3:00, 22 deg C at 15:00.
+  }
+  else {
+    outside = 20.0;
+    sun = (time >= 600.0) ? loft.sunPower : 0.0;
+  }
+}
+
+static double duration() {
+  return (scenario == "day") ? 24.0 * 3600.0 : 600.0 + 3.0 * 3600.0;
+}
+
+//The time the heating starts, seconds, for the fan on latency.
+static double heatingStart() {
+  return (scenario == "day") ? 6.0 * 3600.0 : 600.0;
+}
+
+//Gaussian noise, from the sum of uniform random numbers.
+static double noise(double deviation) {
+  double total = 0.0;
+  for (int count = 0; count < 12; count++) {
+    total += rand() / (double)RAND_MAX;
+  }
+  return (total - 6.0) * deviation;
+}
+
+static runResult simulate(const controllerSetup &setup, FILE *trace) {
+  runResult result = {-1.0, -1000.0, 0.0, -1.0, 0.0, 0};
+  fanController controller;
+  controller.setCurve(fanCurve, sizeof(fanCurve) / sizeof(fanCurve[0]));
+  controller.setPID(setpoint, 10.0, 0.05, 0.0);
+  controller.setFeedForward(setup.feedForward, 30.0);
+  controller.setLimits(25, 100, 1000);
+  controller.usePID(setup.pid);
+  bool useFan = (strcmp(setup.name, "none") != 0);
+  unsigned long period = (setup.period > 0) ? setup.period : fastPeriod;
+  srand(1);
+  //Start in equilibrium with the starting weather.
+  double outside, sun;
+  weather(0.0, outside, sun);
+  double roof = outside;
+  double air = outside;
+  double sensor = air;
+  float reading = air;
+  uint8_t duty = 0;
+  double dutyTotal = 0.0;
+  unsigned long steps = 0;
+  unsigned long nextSensor = 0, nextControl = 0, nextTrace = 0;   //ms.
+  std::vector<double> airHistory;                                 //Every 10 seconds, for the settling time.
+  double end = duration();
+  for (double time = 0.0; time < end; time += SIM_STEP) {
+    unsigned long ms = (unsigned long)(time * 1000.0 + 0.5);
+    weather(time, outside, sun);
+    if (ms >= nextSensor) {
+      reading = (float)(sensor + noise(SIM_SENSORNOISE));
+      nextSensor += (unsigned long)(SIM_SENSORPERIOD * 1000.0);
+    }
+    if (useFan && (ms >= nextControl)) {
+      uint8_t last = duty;
+      duty = controller.update(reading, (uint16_t)period);
+      if ((last == 0) && (duty > 0)) {
+        result.starts++;
+        if ((result.fanOnLatency < 0.0) && (time >= heatingStart())) {
+          result.fanOnLatency = (time - heatingStart()) / 60.0;
+        }
+      }
+      nextControl += period;
+    }
+    if (ms >= nextTrace) {
+      if (trace != NULL) {
+        fprintf(trace, "%.0f,%.2f,%.2f,%.2f,%.2f,%u\n", time, outside, roof, air, reading, duty);
+      }
+      airHistory.push_back(air);
+      nextTrace += 10000;
+    }
+    //Step the model.
+    double toAir = loft.roofToAir * (roof - air);
+    double roofChange = (sun * (1.0 - loft.sunToAir) - loft.roofToOutside * (roof - outside) - toAir) / loft.roofCapacity;
+    double airChange = (sun * loft.sunToAir + toAir - (loft.airLeakage + loft.fanFlow * duty / 100.0) * (air - outside)) / loft.airCapacity;
+    roof += roofChange * SIM_STEP;
+    air += airChange * SIM_STEP;
+    sensor += (air - sensor) * SIM_STEP / (SIM_SENSORLAG + SIM_STEP);
+    if (air > result.peak) {
+      result.peak = air;
+    }
+    if (air > setpoint + 1.0) {
+      result.aboveMinutes += SIM_STEP / 60.0;
+    }
+    dutyTotal += duty;
+    steps++;
+  }
+  result.meanDuty = dutyTotal / steps;
+  //The settling time, from the step to the last time the air was outside the band around its final temperature.
+  if (scenario == "step") {
+    double final = airHistory.back();
+    size_t last = 0;
+    for (size_t index = 0; index < airHistory.size(); index++) {
+      if (fabs(airHistory[index] - final) > SIM_SETTLEBAND) {
+        last = index + 1;
+      }
+    }
+    result.settleMinutes = (last * 10.0 - heatingStart()) / 60.0;
+    if (result.settleMinutes < 0.0) {
+      result.settleMinutes = 0.0;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  const char *traceName = NULL;
+  for (int arg = 1; arg < argc; arg++) {
+    if ((strcmp(argv[arg], "-s") == 0) && (arg + 1 < argc)) {
+      scenario = argv[++arg];
+    }
+    else if ((strcmp(argv[arg], "-t") == 0) && (arg + 1 < argc)) {
+      setpoint = atof(argv[++arg]);
+    }
+    else if ((strcmp(argv[arg], "-p") == 0) && (arg + 1 < argc)) {
+      fastPeriod = strtoul(argv[++arg], NULL, 10);
+    }
+    else if ((strcmp(argv[arg], "-trace") == 0) && (arg + 1 < argc)) {
+      traceName = argv[++arg];
+    }
+    else {
+      fprintf(stderr, "Usage: %s [-s step|day] [-t setpoint] [-p period] [-trace name]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (((scenario != "step") && (scenario != "day")) || (fastPeriod == 0) || (fastPeriod > 0xFFFF)) {
+    fprintf(stderr, "The scenario must be step or day, and the period 1 - 65535 ms.\n");
+    return 1;
+  }
+  if (traceName != NULL) {
+    for (size_t index = 0; index < sizeof(setups) / sizeof(setups[0]); index++) {
+      if (strcmp(setups[index].name, traceName) == 0) {
+        printf("Time(s),Outside,Roof,Loft-Air,Sensor,Fan-Duty\n");
+        simulate(setups[index], stdout);
+        return 0;
+      }
+    }
+    fprintf(stderr, "No set up called %s.\n", traceName);
+    return 1;
+  }
+  printf("Scenario %s, setpoint %.1f deg C, fast period %lu ms.\n", scenario.c_str(), setpoint, fastPeriod);
+  printf("%-10s %8s %7s %6s %7s %7s %6s %6s\n", "Set up", "Fan on", "Peak", "Over", "Above", "Settle", "Duty", "Starts");
+  for (size_t index = 0; index < sizeof(setups) / sizeof(setups[0]); index++) {
+    runResult result = simulate(setups[index], NULL);
+    char fanOn[16], settle[16];
+    if (result.fanOnLatency < 0.0) {
+      snprintf(fanOn, sizeof(fanOn), "-");
+    }
+    else {
+      snprintf(fanOn, sizeof(fanOn), "%.1fm", result.fanOnLatency);
+    }
+    if (result.settleMinutes < 0.0) {
+      snprintf(settle, sizeof(settle), "-");
+    }
+    else {
+      snprintf(settle, sizeof(settle), "%.0fm", result.settleMinutes);
+    }
+    printf("%-10s %8s %7.2f %6.2f %6.0fm %7s %5.1f%% %6u\n", setups[index].name, fanOn, result.peak,
+           (result.peak > setpoint) ? result.peak - setpoint : 0.0, result.aboveMinutes, settle, result.meanDuty, result.starts);
+  }
+  return 0;
+}
+
+//EOF
@@ -17,6 +17,8 @@ https://forums.adafruit.com/viewtopic.php?f=25&t=11597&sid=9f283ac80d4fd357991fe
 
 //Initialise the vDivider counter.
 uint8_t vDivider::_vDivCounter = 0;
+//Initialise the ADC multiplexer pin tracker (no pin read yet).
+uint8_t vDivider::_adcPin = 0xFF;
 
 /*!
  *  @brief  Instantiates a new vDivider class.
@@ -37,6 +39,10 @@ vDivider::vDivider(uint8_t pin, float balanceResistor, bool isR1) {
   _adcReadyDelay = _ADCREADYDELAY;    //Set to the default.
   _avRef = _AVREF;                    //Set to the default.
   _adcMax = _ADCMAX;                  //Set to the default.
+  _sState = VDS_IDLE;                 //No non-blocking reading in progress.
+  _sResult = 0;
+  _samplesUsed = 0;
+  setAdaptive();                      //Set to the default.
   _vDivCounter++;                     //A vDivider has been created.
   init();
 }
@@ -75,21 +81,183 @@ void vDivider::setConsts(uint16_t samples, uint8_t sampleDelay, uint8_t adcReady
   _adcMax = adcMax;
 }
 
+/*!
+ *  @brief  Set up adaptive sampling, which stops taking samples early when the signal is quiet.
+ *          A running mean and variance are kept, and sampling stops once at least minSamples have been taken
+ *          and the standard error of the mean is below maxStdError. No more than the setConsts() samples are taken.
+ *          Use with no more than 4096 samples.
+ *  @param  minSamples
+ *          The minimum number of samples to take. 0 disables adaptive sampling.
+ *  @param  maxStdError
+ *          The target standard error of the mean, in ADC steps.
+ */
+
+void vDivider::setAdaptive(uint16_t minSamples, float maxStdError) {
+  _minSamples = minSamples;
+  _maxVariance = maxStdError * maxStdError;
+}
+
 uint16_t vDivider::readADC() {
-  float totalADC = 0;
+  uint32_t totalADC = 0;
+  uint32_t totalSquares = 0;
+  uint16_t counter = 0;
   //Wait for the multiplexed ADC to connect and become ready for accurate reading.
   if(_adcReadyDelay > 0) {
-    analogRead(_pin);
+    adcRead(_pin);
     delay(_adcReadyDelay);
   }
-  for (uint16_t counter = 0; counter < _samples; counter++) {
-    //Accumulate the readings, adding 0.5 to average the rounding down caused by the ADC quantisation.
-    totalADC += (analogRead(_pin) + 0.5);
+  while (!samplingDone(counter, totalADC, totalSquares)) {
+    uint16_t sample = adcRead(_pin);
+    totalADC += sample;
+    totalSquares += (uint32_t)sample * sample;
+    counter++;
     delay(_sampleDelay);  //Default 1ms delay between samples.
   }
+  _samplesUsed = counter;
+  return averageADC(totalADC, counter);
+}
+
+/*!
+ *  @brief  Oversample and decimate, for extra bits of resolution.
+ *          4^extraBits samples are summed and shifted right by extraBits, so the result is the ADC value scaled by 2^extraBits.
+ *          This only works if there is at least 1 ADC step of noise on the signal. Adaptive sampling is not used.
+ *  @param  extraBits
+ *          The number of extra bits of resolution, 0 - 6.
+ *  @return The ADC value, 0 - ((adcMax + 1) * 2^extraBits) - 1.
+ */
+
+uint16_t vDivider::readADCOversampled(uint8_t extraBits) {
+  uint32_t totalADC = 0;
+  if (extraBits > _VDIVMAXEXTRABITS) {
+    extraBits = _VDIVMAXEXTRABITS;
+  }
+  uint16_t samples = 1 << (2 * extraBits);
+  if(_adcReadyDelay > 0) {
+    adcRead(_pin);
+    delay(_adcReadyDelay);
+  }
+  for (uint16_t counter = 0; counter < samples; counter++) {
+    totalADC += adcRead(_pin);
+    delay(_sampleDelay);
+  }
+  _samplesUsed = samples;
+  return (totalADC >> extraBits);
+}
+
+uint16_t vDivider::samplesUsed() {
+  return _samplesUsed;
+}
+
+//Enough samples have been taken when the sample count is reached, or adaptively when the standard error is small enough.
+bool vDivider::samplingDone(uint16_t count, uint32_t total, uint32_t squares) {
+  if (count >= _samples) {
+    return true;
+  }
+  if ((_minSamples == 0) || (count < _minSamples) || (count < 2)) {
+    return false;
+  }
+  //Variance of the mean = (n * sum(x^2) - sum(x)^2) / (n^2 * (n - 1)).
+  float sum = total;
+  float spread = ((float)count * squares) - (sum * sum);
+  return (spread <= (_maxVariance * count * count * (count - 1)));
+}
+
+/*!
+ *  @brief  Start a non-blocking ADC reading.
+ *          The reading is advanced by calling isReady() from loop(), and collected with result().
+ *          Only one divider should be sampled at a time, as the ADC multiplexer is shared.
+ *          If another reading switches the multiplexer, the ADC ready delay is repeated before sampling continues.
+ *  @return False if a non-blocking reading is already in progress.
+ */
+
+bool vDivider::startSampling() {
+  if (isSampling()) {
+    return false;
+  }
+  _sCount = 0;
+  _sTotal = 0;
+  _sSquares = 0;
+  startSettling();
+  return true;
+}
+
+bool vDivider::isSampling() {
+  return (_sState != VDS_IDLE);
+}
+
+/*!
+ *  @brief  Advance a non-blocking ADC reading, taking at most one sample per call.
+ *  @return True when the averaged ADC value is ready to be collected with result().
+ */
+
+bool vDivider::isReady() {
+  if (_sState == VDS_GROUPED) {
+    return false;                     //A vDividerGroup is sampling this divider.
+  }
+  if (_sState == VDS_SETTLING) {
+    if ((uint32_t)(millis() - _sTimer) < _adcReadyDelay) {
+      return false;
+    }
+    _sState = VDS_SAMPLING;
+  }
+  if (_sState == VDS_SAMPLING) {
+    if (_adcPin != _pin) {
+      //Another reading has switched the ADC multiplexer, so it must settle again.
+      startSettling();
+      return false;
+    }
+    if ((_sCount > 0) && ((uint32_t)(millis() - _sTimer) < _sampleDelay)) {
+      return false;
+    }
+    uint16_t sample = adcRead(_pin);
+    _sTotal += sample;
+    _sSquares += (uint32_t)sample * sample;
+    _sTimer = millis();
+    if (samplingDone(++_sCount, _sTotal, _sSquares)) {
+      _sResult = averageADC(_sTotal, _sCount);
+      _samplesUsed = _sCount;
+      _sState = VDS_READY;
+    }
+  }
+  return (_sState == VDS_READY);
+}
+
+//Collect the averaged ADC value, and allow a new non-blocking reading to be started.
+uint16_t vDivider::result() {
+  if (_sState == VDS_READY) {
+    _sState = VDS_IDLE;
+  }
+  return _sResult;
+}
+
+void vDivider::startSettling() {
+  if (_adcReadyDelay > 0) {
+    adcRead(_pin);
+    _sTimer = millis();
+    _sState = VDS_SETTLING;
+  }
+  else {
+    _adcPin = _pin;                   //No settling needed, so treat the multiplexer as connected.
+    _sState = VDS_SAMPLING;
+  }
+}
+
+//Read the ADC, remembering which pin the multiplexer is now connected to.
+uint16_t vDivider::adcRead(uint8_t pin) {
+  _adcPin = pin;
+  return analogRead(pin);
+}
+
+//Average an ADC total, giving the same result as accumulating each sample with 0.5 added.
+uint16_t vDivider::averageADC(uint32_t totalADC, uint16_t samples) {
+  if (samples == 0) {
+    return 0;
+  }
+  //Add 0.5 per sample to average the rounding down caused by the ADC quantisation.
+  float total = totalADC + (0.5 * samples);
   //Average the reading and add 0.5 so that the rounding is to the nearest whole number, up or down.
-  uint16_t averageADC = (totalADC / _samples) + 0.5;
-  return averageADC;
+  uint16_t average = (total / samples) + 0.5;
+  return average;
 }
 
 float vDivider::calcVOut() {
@@ -325,4 +493,140 @@ float vDivider::calcRRatio(float vOut) {
   return rRatio;
 }
 
+/*!
+ *  @brief  Instantiates a new vDividerGroup class.
+ *          The group samples its dividers in turn, one sample each per round, so the ADC ready delay
+ *          and the sample delay are paid once per group instead of once per divider.
+ *  @param  switchDiscard
+ *          True/False to discard the first conversion after each ADC multiplexer switch.
+ */
+
+vDividerGroup::vDividerGroup(bool switchDiscard) {
+  _count = 0;
+  _switchDiscard = switchDiscard;
+  _gState = VDS_IDLE;
+}
+
+int8_t vDividerGroup::add(vDivider &divider) {
+  if (_count >= _VDIVGROUPMAX) {
+    return -1;
+  }
+  _members[_count] = &divider;
+  return _count++;
+}
+
+uint8_t vDividerGroup::count() {
+  return _count;
+}
+
+void vDividerGroup::readADC() {
+  if (startSampling()) {
+    while (!isReady()) {
+      //Keep sampling until every divider is done.
+    }
+  }
+}
+
+/*!
+ *  @brief  Start a non-blocking sweep of all the dividers in the group.
+ *          Each divider keeps its own sample count, and its averaged ADC value is collected with its own
+ *          result() function, or with the group result() function.
+ *  @return False if a non-blocking sweep is already in progress.
+ */
+
+bool vDividerGroup::startSampling() {
+  if (isSampling() || (_count == 0)) {
+    return false;
+  }
+  _readyDelay = 0;
+  _sampleDelay = 0;
+  for (uint8_t index = 0; index < _count; index++) {
+    vDivider *divider = _members[index];
+    divider->_sCount = 0;
+    divider->_sTotal = 0;
+    divider->_sSquares = 0;
+    divider->_sState = VDS_GROUPED;
+    if (divider->_adcReadyDelay > _readyDelay) {
+      _readyDelay = divider->_adcReadyDelay;
+    }
+    if (divider->_sampleDelay > _sampleDelay) {
+      _sampleDelay = divider->_sampleDelay;
+    }
+  }
+  if (_readyDelay > 0) {
+    //Connect the ADC to the first divider, and wait once for the whole group.
+    vDivider::adcRead(_members[0]->_pin);
+    _gTimer = millis();
+    _gState = VDS_SETTLING;
+  }
+  else {
+    _gState = VDS_SAMPLING;
+    sampleRound();
+  }
+  return true;
+}
+
+bool vDividerGroup::isSampling() {
+  return (_gState == VDS_SETTLING) || (_gState == VDS_SAMPLING);
+}
+
+/*!
+ *  @brief  Advance a non-blocking sweep, taking at most one round of samples per call.
+ *  @return True when every divider in the group has its averaged ADC value.
+ */
+
+bool vDividerGroup::isReady() {
+  if (_gState == VDS_SETTLING) {
+    if ((uint32_t)(millis() - _gTimer) < _readyDelay) {
+      return false;
+    }
+    _gState = VDS_SAMPLING;
+    sampleRound();
+  }
+  else if (_gState == VDS_SAMPLING) {
+    if ((uint32_t)(millis() - _gTimer) >= _sampleDelay) {
+      sampleRound();
+    }
+  }
+  return (_gState == VDS_READY);
+}
+
+uint16_t vDividerGroup::result(uint8_t index) {
+  if (index >= _count) {
+    return 0;
+  }
+  if (_gState == VDS_READY) {
+    _gState = VDS_IDLE;
+  }
+  return _members[index]->result();
+}
+
+void vDividerGroup::sampleRound() {
+  bool done = true;
+  for (uint8_t index = 0; index < _count; index++) {
+    vDivider *divider = _members[index];
+    if (divider->_sState != VDS_GROUPED) {
+      continue;                       //This divider is done.
+    }
+    if (_switchDiscard && (vDivider::_adcPin != divider->_pin)) {
+      vDivider::adcRead(divider->_pin); //Let the sample and hold capacitor charge from the new pin.
+    }
+    uint16_t sample = vDivider::adcRead(divider->_pin);
+    divider->_sTotal += sample;
+    divider->_sSquares += (uint32_t)sample * sample;
+    if (divider->samplingDone(++divider->_sCount, divider->_sTotal, divider->_sSquares)) {
+      divider->_sResult = vDivider::averageADC(divider->_sTotal, divider->_sCount);
+      divider->_samplesUsed = divider->_sCount;
+      divider->_sState = VDS_READY;
+    }
+    else {
+      done = false;
+    }
+  }
+  _gTimer = millis();
+  if (done) {
+    _gState = VDS_READY;
+  }
+}
+
 //EOF
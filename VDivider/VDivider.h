@@ -43,6 +43,10 @@ Assumed Voltage Divider design:
 
   #define _ADCREADYDELAY 10         //Milliseconds, 0 - 255.
 
+  #define _VDIVMINSAMPLES 0         //Adaptive sampling minimum samples, 0 = adaptive sampling disabled.
+  #define _VDIVMAXSTDERR 0.25       //Adaptive sampling target standard error of the mean, in ADC steps.
+  #define _VDIVMAXEXTRABITS 6       //Oversampling limit, 4^6 = 4096 samples for 16bit results.
+
   //Platform dependant default analogue reference voltage.
   #ifndef __AVR__
     #define _AVREF 3.3
@@ -52,14 +56,31 @@ Assumed Voltage Divider design:
 
   #define _ADCMAX 1023              //The maximum value a 10bit ADC can return, 1 is added to get the ADC steps when needed.
 
+  //Non-blocking (asynchronous) sampling states.
+  #define VDS_IDLE 0                //No reading in progress.
+  #define VDS_SETTLING 1            //Waiting for the multiplexed ADC to connect and become ready.
+  #define VDS_SAMPLING 2            //Collecting samples, one per sample delay.
+  #define VDS_READY 3               //The averaged ADC value is waiting to be collected.
+  #define VDS_GROUPED 4             //Being sampled by a vDividerGroup.
+
+  #define _VDIVGROUPMAX 8           //The maximum number of voltage dividers in a scan group.
+
   class vDivider {
+    friend class vDividerGroup;
   public:
     vDivider(uint8_t pin = _ANALOGPIN, float balanceResistor = _BALANCERESISTOR, bool isR1 = true);
     ~vDivider();
     void setConsts(uint16_t samples = _VDIVSAMPLES, uint8_t sampleDelay = _SAMPLEDELAY, uint8_t adcReadyDelay = _ADCREADYDELAY, float avRef = _AVREF, uint16_t adcMax = _ADCMAX);
+    void setAdaptive(uint16_t minSamples = _VDIVMINSAMPLES, float maxStdError = _VDIVMAXSTDERR);
     uint8_t analogPin;          //The pin that the voltage divider is connected to.
     static uint8_t vDivCount(); //A function to return the number of defined voltage dividers.
     uint16_t readADC();         //A function to read the ADC value from the divider pin.
+    uint16_t readADCOversampled(uint8_t extraBits); //Oversample and decimate, returning an ADC value with extra bits of resolution.
+    uint16_t samplesUsed();     //The number of samples taken by the last ADC reading.
+    bool startSampling();       //Start a non-blocking ADC reading, returns false if one is already in progress.
+    bool isSampling();          //Check if a non-blocking ADC reading is in progress, or waiting to be collected.
+    bool isReady();             //Advance a non-blocking ADC reading, returns true when the averaged ADC value is available.
+    uint16_t result();          //Collect the averaged ADC value from the last completed non-blocking ADC reading.
     float calcVOut();           //Calculate the divider voltage by reading the ADC value.
     float calcVOut(uint16_t);   //Function version that will use a given ADC value.
     float calcR1();             //Calculate the R1 resistance by reading the ADC value.
@@ -78,6 +99,8 @@ Assumed Voltage Divider design:
     float calcR2x(uint16_t);    //Function version that will use a given ADC reading.
     float calcR2x(int);         //Function version that will use a given ADC reading (accepting it as an int).
     float calcR2x(float);       //Function version that will use a given divider voltage.
+    static uint16_t adcRead(uint8_t);                 //Read the ADC, remembering which pin the multiplexer is connected to.
+    static uint16_t averageADC(uint32_t, uint16_t);   //Average an ADC total over a number of samples.
 
   protected:
     uint8_t _pin;
@@ -88,10 +111,22 @@ Assumed Voltage Divider design:
     uint8_t _adcReadyDelay;
     float _avRef;
     uint16_t _adcMax;
+    uint8_t _sState;            //Non-blocking sampling state.
+    uint16_t _sCount;           //Non-blocking samples collected so far.
+    uint32_t _sTotal;           //Non-blocking samples total.
+    uint32_t _sSquares;         //Non-blocking samples total of squares.
+    uint32_t _sTimer;           //Non-blocking settle/sample delay start time.
+    uint16_t _sResult;          //Non-blocking averaged ADC value.
+    uint16_t _minSamples;       //Adaptive sampling minimum samples, 0 = disabled.
+    float _maxVariance;         //Adaptive sampling target variance of the mean (standard error squared).
+    uint16_t _samplesUsed;
+    bool samplingDone(uint16_t count, uint32_t total, uint32_t squares); //Check if enough samples have been taken.
 
   private:
     static uint8_t _vDivCounter;
+    static uint8_t _adcPin;     //The pin that the ADC multiplexer was last connected to.
     void init();
+    void startSettling();       //Connect the ADC multiplexer and start the ADC ready delay.
     float doCalcR1(uint16_t);   //Calculate R1 using the provided ADC reading.
     float doCalcR1(float);      //Function version that will use a given divider voltage.
     float doCalcR2(uint16_t);   //Calculate R2 using the provided ADC reading.
@@ -103,6 +138,29 @@ Assumed Voltage Divider design:
     float calcRRatio(uint16_t); //Calculate the divider resistor ratio using the provided ADC reading.
     float calcRRatio(float);    //Function version that will use a given divider voltage.
   };
+
+  //Interleaved (round robin) sampling of several voltage dividers, sharing the ADC multiplexer settle and sample delays.
+  class vDividerGroup {
+  public:
+    vDividerGroup(bool switchDiscard = true);
+    int8_t add(vDivider &divider);  //Add a divider to the group, returns its index, or -1 if the group is full.
+    uint8_t count();                //A function to return the number of dividers in the group.
+    void readADC();                 //Sample all the dividers, waiting until they are done.
+    bool startSampling();           //Start a non-blocking sweep of all the dividers, returns false if one is already in progress.
+    bool isSampling();              //Check if a non-blocking sweep is in progress.
+    bool isReady();                 //Advance a non-blocking sweep, returns true when every divider has its averaged ADC value.
+    uint16_t result(uint8_t index); //Collect the averaged ADC value of a divider, by its group index.
+
+  private:
+    vDivider *_members[_VDIVGROUPMAX];
+    uint8_t _count;
+    bool _switchDiscard;            //Discard the first conversion after each multiplexer switch.
+    uint8_t _gState;
+    uint8_t _readyDelay;            //The longest ADC ready delay of all the dividers.
+    uint8_t _sampleDelay;           //The longest sample delay of all the dividers.
+    uint32_t _gTimer;
+    void sampleRound();             //Take one sample from every divider that still needs one.
+  };
 #endif
 
 //EOF
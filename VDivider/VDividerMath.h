@@ -0,0 +1,129 @@
+/*
+Arduino library for Voltage Dividers - compile time selectable arithmetic.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+Two traits classes provide the same divider calculations as the vDivider class:
+ - vdFloatMath : float volts and ohms, exactly as vDivider::calcVOut(), calcR1x() and calcR2x().
+ - vdFixedMath : Q16.16 volts and whole ohms, using only 32bit integer arithmetic.
+Code written against a traits parameter, e.g. template <class M> ..., selects one or the other at compile time.
+No speed or size is claimed for either, as it depends on the rest of the sketch (any float arithmetic elsewhere
+  still links the soft float library). Time and size them on the target with the AlogTSensors Fixed-Point example.
+
+vdFixedMath error bounds, against vdFloatMath, for a 10bit ADC:
+ - vOut : within 1 LSB of Q16.16 (15uV), for avRef up to 32V.
+ - r1/r2: within 0.5 Ohm (rounded to the nearest Ohm), for balance resistors up to 4M Ohms.
+ - ln   : within 0.0002, for any resistance from 1 Ohm to 4G Ohms.
+
+https://en.wikipedia.org/wiki/Q_(number_format)
+https://en.wikipedia.org/wiki/Binary_logarithm#Calculation
+*/
+
+#ifndef VDIVIDERMATH_H
+  #define VDIVIDERMATH_H
+
+  #include <Arduino.h>
+
+  //Q16.16 fixed point numbers.
+  typedef int32_t q16_t;
+  #define Q16ONE 65536L
+  #define Q16LN2 45426UL                    //ln(2) in Q16.16.
+
+  constexpr q16_t toQ16(double value) {
+    return (q16_t)((value * Q16ONE) + ((value >= 0.0) ? 0.5 : -0.5));
+  }
+
+  inline float q16ToFloat(q16_t value) {
+    return value / (float)Q16ONE;
+  }
+
+  //log2(1 + i/32) in Q16.16, for linear interpolation of the mantissa.
+  const uint16_t _vdLog2Table[33] PROGMEM = {
+        0,  2909,  5732,  8473, 11136, 13727, 16248, 18704, 21098, 23433, 25711, 27936, 30109, 32234, 34312, 36346,
+    38336, 40286, 42196, 44068, 45904, 47705, 49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047,
+    65535
+  };
+
+  //Divider calculations using float arithmetic.
+  struct vdFloatMath {
+    typedef float volts_t;                  //Volts.
+    typedef float ohms_t;                   //Ohms.
+    static constexpr volts_t volts(double value) {
+      return value;
+    }
+    static constexpr ohms_t ohms(double value) {
+      return value;
+    }
+    static float toFloat(float value) {
+      return value;
+    }
+    static volts_t vOut(uint16_t averageADC, volts_t avRef, uint16_t adcMax) {
+      return averageADC * (avRef / (float)(adcMax + 1));
+    }
+    //R1 when the balance resistor is R2.
+    static ohms_t r1(uint16_t averageADC, ohms_t balanceResistor, uint16_t adcMax) {
+      return balanceResistor * (((float)(adcMax + 1) / (float)averageADC) - 1.0);
+    }
+    //R2 when the balance resistor is R1.
+    static ohms_t r2(uint16_t averageADC, ohms_t balanceResistor, uint16_t adcMax) {
+      return balanceResistor / (((float)(adcMax + 1) / (float)averageADC) - 1.0);
+    }
+    static float ln(ohms_t value) {
+      return log(value);
+    }
+  };
+
+  //Divider calculations using integer arithmetic only.
+  struct vdFixedMath {
+    typedef q16_t volts_t;                  //Q16.16 volts.
+    typedef uint32_t ohms_t;                //Whole ohms.
+    static constexpr volts_t volts(double value) {
+      return toQ16(value);
+    }
+    static constexpr ohms_t ohms(double value) {
+      return (ohms_t)(value + 0.5);
+    }
+    static float toFloat(q16_t value) {
+      return q16ToFloat(value);
+    }
+    static volts_t vOut(uint16_t averageADC, volts_t avRef, uint16_t adcMax) {
+      return ((int32_t)averageADC * avRef) / (int32_t)(adcMax + 1);
+    }
+    //R1 when the balance resistor is R2. An ADC value of 0 returns the maximum resistance.
+    static ohms_t r1(uint16_t averageADC, ohms_t balanceResistor, uint16_t adcMax) {
+      if (averageADC == 0) {
+        return 0xFFFFFFFF;
+      }
+      uint32_t steps = (uint32_t)(adcMax + 1) - averageADC;
+      return ((balanceResistor * steps) + (averageADC / 2)) / averageADC;
+    }
+    //R2 when the balance resistor is R1. An ADC value at or above adcMax + 1 returns the maximum resistance.
+    static ohms_t r2(uint16_t averageADC, ohms_t balanceResistor, uint16_t adcMax) {
+      if (averageADC > adcMax) {
+        return 0xFFFFFFFF;
+      }
+      uint32_t steps = (uint32_t)(adcMax + 1) - averageADC;
+      return ((balanceResistor * averageADC) + (steps / 2)) / steps;
+    }
+    //Natural logarithm in Q16.16, from the highest set bit and an interpolated mantissa table. ln(0) returns ln(1).
+    static q16_t ln(ohms_t value) {
+      uint8_t exponent = 31;
+      if (value == 0) {
+        return 0;
+      }
+      while (!(value & 0x80000000UL)) {
+        value <<= 1;
+        exponent--;
+      }
+      uint16_t mantissa = (value >> 15) & 0xFFFF; //The 16 bits below the leading 1.
+      uint8_t index = mantissa >> 11;
+      uint16_t fraction = mantissa & 0x07FF;
+      uint16_t lower = pgm_read_word(&_vdLog2Table[index]);
+      uint16_t upper = pgm_read_word(&_vdLog2Table[index + 1]);
+      uint32_t log2Fraction = lower + (((uint32_t)(upper - lower) * fraction) >> 11);
+      return ((q16_t)exponent * Q16LN2) + (q16_t)((log2Fraction * Q16LN2) >> 16);
+    }
+  };
+#endif
+
+//EOF
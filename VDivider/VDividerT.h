@@ -0,0 +1,111 @@
+/*
+Arduino library for Voltage Dividers - compile time configured version.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+vDividerT is the vDivider class with its configuration held in template parameters instead of member variables.
+  Every function is static, so an instance uses no RAM for its settings, there is no instance counter, and the
+  compiler can fold the divider ratio arithmetic into constants. The arithmetic (vdFloatMath or vdFixedMath) is also
+  a template parameter.
+
+Usage:
+  vDividerT<A3, 100000, false, 32> myLDR;   //Pin A3, 100K balance resistor as R2, 32 samples.
+  uint16_t lightLevel = myLDR.readADC();
+or, without an instance at all:
+  typedef vDividerT<A3, 100000, false, 32> LDR;
+  uint16_t lightLevel = LDR::readADC();
+
+The runtime configured vDivider class remains available, and is needed for vDividerGroup and non-blocking sampling.
+*/
+
+#ifndef VDIVIDERT_H
+  #define VDIVIDERT_H
+
+  #include <Arduino.h>
+  #include "VDivider.h"
+  #include "VDividerMath.h"
+
+  //Platform dependant default analogue reference voltage, in millivolts.
+  #ifndef __AVR__
+    #define _AVREFMV 3300
+  #else
+    #define _AVREFMV 5000
+  #endif
+
+  template <uint8_t Pin = _ANALOGPIN,
+            uint32_t BalanceResistor = (uint32_t)_BALANCERESISTOR,
+            bool IsR1 = true,
+            uint16_t Samples = _VDIVSAMPLES,
+            uint8_t SampleDelay = _SAMPLEDELAY,
+            uint8_t AdcReadyDelay = _ADCREADYDELAY,
+            uint16_t AvRefmV = _AVREFMV,
+            uint16_t AdcMax = _ADCMAX,
+            class M = vdFloatMath>
+  class vDividerT {
+  public:
+    typedef M math_t;
+    typedef typename M::volts_t volts_t;
+    typedef typename M::ohms_t ohms_t;
+    static constexpr uint8_t analogPin = Pin;
+    static constexpr bool isR1 = IsR1;
+
+    vDividerT() {
+      pinMode(Pin, INPUT);
+    }
+
+    //Read the averaged ADC value from the divider pin, exactly as vDivider::readADC().
+    static uint16_t readADC() {
+      uint32_t totalADC = 0;
+      if (AdcReadyDelay > 0) {
+        vDivider::adcRead(Pin);
+        delay(AdcReadyDelay);
+      }
+      for (uint16_t counter = 0; counter < Samples; counter++) {
+        totalADC += vDivider::adcRead(Pin);
+        delay(SampleDelay);
+      }
+      return vDivider::averageADC(totalADC, Samples);
+    }
+
+    static volts_t calcVOut() {
+      return calcVOut(readADC());
+    }
+
+    static volts_t calcVOut(uint16_t averageADC) {
+      return M::vOut(averageADC, M::volts(AvRefmV / 1000.0), AdcMax);
+    }
+
+    static ohms_t calcR1() {
+      return calcR1(readADC());
+    }
+
+    static ohms_t calcR1(uint16_t averageADC) {
+      return IsR1 ? M::ohms(BalanceResistor) : calcR1x(averageADC);
+    }
+
+    static ohms_t calcR2() {
+      return calcR2(readADC());
+    }
+
+    static ohms_t calcR2(uint16_t averageADC) {
+      return IsR1 ? calcR2x(averageADC) : M::ohms(BalanceResistor);
+    }
+
+    //The unknown resistance, whichever side of the divider it is on.
+    static ohms_t calcRUnknown(uint16_t averageADC) {
+      return IsR1 ? calcR2x(averageADC) : calcR1x(averageADC);
+    }
+
+    //R1, assuming that the balance resistor is R2.
+    static ohms_t calcR1x(uint16_t averageADC) {
+      return M::r1(averageADC, M::ohms(BalanceResistor), AdcMax);
+    }
+
+    //R2, assuming that the balance resistor is R1.
+    static ohms_t calcR2x(uint16_t averageADC) {
+      return M::r2(averageADC, M::ohms(BalanceResistor), AdcMax);
+    }
+  };
+#endif
+
+//EOF
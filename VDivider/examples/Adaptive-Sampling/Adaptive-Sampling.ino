@@ -0,0 +1,75 @@
+/*
+Adaptive and oversampled Voltage Divider example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+https://en.wikipedia.org/wiki/Voltage_divider
+https://en.wikipedia.org/wiki/Standard_error
+https://en.wikipedia.org/wiki/Oversampling#Resolution
+*/
+
+/*
+Assumed Voltage Divider design:
+ - The balance resistor is R1.
+ - The resistance that varies is R2.
+
+ AVRef ----
+ (5V)     |
+         ---
+         |R| R1 = 10K Resistor
+         ---
+          |----- vOut --> Arduino Pin A1
+         ---
+         |R| R2 = Potentiometer
+         ---
+          |
+ Gnd ------
+*/
+
+#include <VDivider.h>
+
+#define VDPIN A1                            //The vDivider class default is A0.
+#define R1 10000                            //The vDivider class default is 10K.
+
+#define VDIVSAMPLES 64                      //The most samples an adaptive reading will take.
+#define MINSAMPLES 8                        //The least samples an adaptive reading will take.
+#define MAXSTDERR 0.25                      //Stop sampling when the standard error of the mean is below 1/4 of an ADC step.
+#define EXTRABITS 2                         //Oversample 4^2 = 16 times for a 12bit reading.
+
+#define DELAY 5000
+
+vDivider myDivider(VDPIN, R1, true);        //The balance resistor is R1.
+
+void setup() {
+  //Start the serial output at 9600 baud.
+  Serial.begin(9600);
+  //Set up voltage divider constants, and adaptive sampling.
+  myDivider.setConsts(VDIVSAMPLES);
+  myDivider.setAdaptive(MINSAMPLES, MAXSTDERR);
+}
+
+void loop() {
+  unsigned long sampleTime = millis();
+  unsigned int avgADC = myDivider.readADC();
+  sampleTime = millis() - sampleTime;
+  Serial.print("Voltage Divider on Arduino pin: A");
+  Serial.println(myDivider.analogPin - 14);
+  Serial.print("  Adaptive ADC Val     = ");
+  Serial.print(avgADC);
+  Serial.print(" (");
+  Serial.print(myDivider.samplesUsed());
+  Serial.print(" samples, ");
+  Serial.print(sampleTime);
+  Serial.println("ms)");
+  //Oversampling needs some noise on the signal, a quiet signal gives no extra resolution.
+  unsigned int osADC = myDivider.readADCOversampled(EXTRABITS);
+  Serial.print("  Oversampled ADC Val  = ");
+  Serial.print(osADC / (float)(1 << EXTRABITS), EXTRABITS);
+  Serial.print(" (");
+  Serial.print(myDivider.samplesUsed());
+  Serial.println(" samples)");
+  Serial.println();
+  delay(DELAY);
+}
+
+//EOF
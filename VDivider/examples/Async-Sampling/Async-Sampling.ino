@@ -0,0 +1,80 @@
+/*
+Non-blocking Voltage Divider example sketch.
+
+(c) 2020-2021 Ian Neill, arduino@binaria.co.uk
+
+https://en.wikipedia.org/wiki/Voltage_divider
+*/
+
+/*
+Assumed Voltage Divider design:
+ - The balance resistor is R1.
+ - The resistance that varies is R2.
+
+ AVRef ----
+ (5V)     |
+         ---
+         |R| R1 = 10K Resistor
+         ---
+          |----- vOut --> Arduino Pin A1
+         ---
+         |R| R2 = Potentiometer
+         ---
+          |
+ Gnd ------
+*/
+
+#include <VDivider.h>
+
+#define VDPIN A1                            //The vDivider class default is A0.
+#define R1 10000                            //The vDivider class default is 10K.
+#define HB_LED 13
+
+#define VDIVSAMPLES 32                      //The vDivider class default is 16 samples per reading, averaged.
+#define SAMPLEDELAY 1                       //The vDivider class default is 1ms delay between samples.
+#define ADCREADYDELAY 10                    //The vDivider class default is a 10ms delay before the first sample.
+
+#define HBDELAY 250
+#define DELAY 5000
+
+vDivider myDivider(VDPIN, R1, true);        //The balance resistor is R1.
+bool hbStatus = LOW;
+unsigned long hbTime = 0;
+unsigned long readTime = 0;
+
+void setup() {
+  //Start the serial output at 9600 baud.
+  Serial.begin(9600);
+  pinMode(HB_LED, OUTPUT);
+  //Set up voltage divider constants, if necessary.
+  myDivider.setConsts(VDIVSAMPLES, SAMPLEDELAY, ADCREADYDELAY);
+}
+
+void loop() {
+  //The heartbeat keeps running while the divider is being sampled.
+  if (millis() - hbTime >= HBDELAY) {
+    hbTime = millis();
+    hbStatus = !hbStatus;
+    digitalWrite(HB_LED, hbStatus);
+  }
+  //Start a new reading every DELAY ms.
+  if (millis() - readTime >= DELAY) {
+    readTime = millis();
+    myDivider.startSampling();
+  }
+  //Each call takes at most one sample, and never waits.
+  if (myDivider.isReady()) {
+    unsigned int avgADC = myDivider.result();
+    float potVal = myDivider.calcR2(avgADC);  //Pass the ADC reading already taken, else this function will get a new reading.
+    Serial.print("Voltage Divider on Arduino pin: A");
+    Serial.println(myDivider.analogPin - 14);
+    Serial.print("  Avg ADC Val    = ");
+    Serial.println(avgADC);
+    Serial.print("  Pot Resistance = ");
+    Serial.print(potVal);
+    Serial.println("R");
+    Serial.println();
+  }
+}
+
+//EOF